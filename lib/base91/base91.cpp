@@ -5,6 +5,8 @@
 
 #include "base91.h"
 
+#include <cstring>
+
 // 91 printable ASCII characters - excludes NUL (0x00), " (0x22), ' (0x27), \ (0x5C)
 // This ensures no null bytes in encoded output (critical for strlen-based messaging)
 const char Base91::ALPHABET[91] = {
@@ -17,6 +19,138 @@ const char Base91::ALPHABET[91] = {
     '>', '?', '@', '[', ']', '^', '_', '`', '{', '|', '}', '~', '-'
 };
 
+// Encode pair table: characters ALPHABET[v % 91], ALPHABET[v / 91] for every 13-bit value v
+// (the alphabet has no quotes or backslashes, so it is a plain string literal)
+const char Base91::ENCODE_PAIRS[8192 * 2 + 1] =
+    "AABACADAEAFAGAHAIAJAKALAMANAOAPAQARASATAUAVAWAXAYAZAaAbAcAdAeAfAgAhAiAjAkAlAmAnAoApAqArAsAtAuAvAwAxAyAzA0A1A2A3A4A5A6A7A8A9A!A#A"
+    "$A%A&A(A)A*A+A,A.A/A:A;A<A=A>A?A@A[A]A^A_A`A{A|A}A~A-AABBBCBDBEBFBGBHBIBJBKBLBMBNBOBPBQBRBSBTBUBVBWBXBYBZBaBbBcBdBeBfBgBhBiBjBkB"
+    "lBmBnBoBpBqBrBsBtBuBvBwBxByBzB0B1B2B3B4B5B6B7B8B9B!B#B$B%B&B(B)B*B+B,B.B/B:B;B<B=B>B?B@B[B]B^B_B`B{B|B}B~B-BACBCCCDCECFCGCHCICJC"
+    "KCLCMCNCOCPCQCRCSCTCUCVCWCXCYCZCaCbCcCdCeCfCgChCiCjCkClCmCnCoCpCqCrCsCtCuCvCwCxCyCzC0C1C2C3C4C5C6C7C8C9C!C#C$C%C&C(C)C*C+C,C.C/C"
+    ":C;C<C=C>C?C@C[C]C^C_C`C{C|C}C~C-CADBDCDDDEDFDGDHDIDJDKDLDMDNDODPDQDRDSDTDUDVDWDXDYDZDaDbDcDdDeDfDgDhDiDjDkDlDmDnDoDpDqDrDsDtDuD"
+    "vDwDxDyDzD0D1D2D3D4D5D6D7D8D9D!D#D$D%D&D(D)D*D+D,D.D/D:D;D<D=D>D?D@D[D]D^D_D`D{D|D}D~D-DAEBECEDEEEFEGEHEIEJEKELEMENEOEPEQERESETE"
+    "UEVEWEXEYEZEaEbEcEdEeEfEgEhEiEjEkElEmEnEoEpEqErEsEtEuEvEwExEyEzE0E1E2E3E4E5E6E7E8E9E!E#E$E%E&E(E)E*E+E,E.E/E:E;E<E=E>E?E@E[E]E^E"
+    "_E`E{E|E}E~E-EAFBFCFDFEFFFGFHFIFJFKFLFMFNFOFPFQFRFSFTFUFVFWFXFYFZFaFbFcFdFeFfFgFhFiFjFkFlFmFnFoFpFqFrFsFtFuFvFwFxFyFzF0F1F2F3F4F"
+    "5F6F7F8F9F!F#F$F%F&F(F)F*F+F,F.F/F:F;F<F=F>F?F@F[F]F^F_F`F{F|F}F~F-FAGBGCGDGEGFGGGHGIGJGKGLGMGNGOGPGQGRGSGTGUGVGWGXGYGZGaGbGcGdG"
+    "eGfGgGhGiGjGkGlGmGnGoGpGqGrGsGtGuGvGwGxGyGzG0G1G2G3G4G5G6G7G8G9G!G#G$G%G&G(G)G*G+G,G.G/G:G;G<G=G>G?G@G[G]G^G_G`G{G|G}G~G-GAHBHCH"
+    "DHEHFHGHHHIHJHKHLHMHNHOHPHQHRHSHTHUHVHWHXHYHZHaHbHcHdHeHfHgHhHiHjHkHlHmHnHoHpHqHrHsHtHuHvHwHxHyHzH0H1H2H3H4H5H6H7H8H9H!H#H$H%H&H"
+    "(H)H*H+H,H.H/H:H;H<H=H>H?H@H[H]H^H_H`H{H|H}H~H-HAIBICIDIEIFIGIHIIIJIKILIMINIOIPIQIRISITIUIVIWIXIYIZIaIbIcIdIeIfIgIhIiIjIkIlImInI"
+    "oIpIqIrIsItIuIvIwIxIyIzI0I1I2I3I4I5I6I7I8I9I!I#I$I%I&I(I)I*I+I,I.I/I:I;I<I=I>I?I@I[I]I^I_I`I{I|I}I~I-IAJBJCJDJEJFJGJHJIJJJKJLJMJ"
+    "NJOJPJQJRJSJTJUJVJWJXJYJZJaJbJcJdJeJfJgJhJiJjJkJlJmJnJoJpJqJrJsJtJuJvJwJxJyJzJ0J1J2J3J4J5J6J7J8J9J!J#J$J%J&J(J)J*J+J,J.J/J:J;J<J"
+    "=J>J?J@J[J]J^J_J`J{J|J}J~J-JAKBKCKDKEKFKGKHKIKJKKKLKMKNKOKPKQKRKSKTKUKVKWKXKYKZKaKbKcKdKeKfKgKhKiKjKkKlKmKnKoKpKqKrKsKtKuKvKwKxK"
+    "yKzK0K1K2K3K4K5K6K7K8K9K!K#K$K%K&K(K)K*K+K,K.K/K:K;K<K=K>K?K@K[K]K^K_K`K{K|K}K~K-KALBLCLDLELFLGLHLILJLKLLLMLNLOLPLQLRLSLTLULVLWL"
+    "XLYLZLaLbLcLdLeLfLgLhLiLjLkLlLmLnLoLpLqLrLsLtLuLvLwLxLyLzL0L1L2L3L4L5L6L7L8L9L!L#L$L%L&L(L)L*L+L,L.L/L:L;L<L=L>L?L@L[L]L^L_L`L{L"
+    "|L}L~L-LAMBMCMDMEMFMGMHMIMJMKMLMMMNMOMPMQMRMSMTMUMVMWMXMYMZMaMbMcMdMeMfMgMhMiMjMkMlMmMnMoMpMqMrMsMtMuMvMwMxMyMzM0M1M2M3M4M5M6M7M"
+    "8M9M!M#M$M%M&M(M)M*M+M,M.M/M:M;M<M=M>M?M@M[M]M^M_M`M{M|M}M~M-MANBNCNDNENFNGNHNINJNKNLNMNNNONPNQNRNSNTNUNVNWNXNYNZNaNbNcNdNeNfNgN"
+    "hNiNjNkNlNmNnNoNpNqNrNsNtNuNvNwNxNyNzN0N1N2N3N4N5N6N7N8N9N!N#N$N%N&N(N)N*N+N,N.N/N:N;N<N=N>N?N@N[N]N^N_N`N{N|N}N~N-NAOBOCODOEOFO"
+    "GOHOIOJOKOLOMONOOOPOQOROSOTOUOVOWOXOYOZOaObOcOdOeOfOgOhOiOjOkOlOmOnOoOpOqOrOsOtOuOvOwOxOyOzO0O1O2O3O4O5O6O7O8O9O!O#O$O%O&O(O)O*O"
+    "+O,O.O/O:O;O<O=O>O?O@O[O]O^O_O`O{O|O}O~O-OAPBPCPDPEPFPGPHPIPJPKPLPMPNPOPPPQPRPSPTPUPVPWPXPYPZPaPbPcPdPePfPgPhPiPjPkPlPmPnPoPpPqP"
+    "rPsPtPuPvPwPxPyPzP0P1P2P3P4P5P6P7P8P9P!P#P$P%P&P(P)P*P+P,P.P/P:P;P<P=P>P?P@P[P]P^P_P`P{P|P}P~P-PAQBQCQDQEQFQGQHQIQJQKQLQMQNQOQPQ"
+    "QQRQSQTQUQVQWQXQYQZQaQbQcQdQeQfQgQhQiQjQkQlQmQnQoQpQqQrQsQtQuQvQwQxQyQzQ0Q1Q2Q3Q4Q5Q6Q7Q8Q9Q!Q#Q$Q%Q&Q(Q)Q*Q+Q,Q.Q/Q:Q;Q<Q=Q>Q?Q"
+    "@Q[Q]Q^Q_Q`Q{Q|Q}Q~Q-QARBRCRDRERFRGRHRIRJRKRLRMRNRORPRQRRRSRTRURVRWRXRYRZRaRbRcRdReRfRgRhRiRjRkRlRmRnRoRpRqRrRsRtRuRvRwRxRyRzR0R"
+    "1R2R3R4R5R6R7R8R9R!R#R$R%R&R(R)R*R+R,R.R/R:R;R<R=R>R?R@R[R]R^R_R`R{R|R}R~R-RASBSCSDSESFSGSHSISJSKSLSMSNSOSPSQSRSSSTSUSVSWSXSYSZS"
+    "aSbScSdSeSfSgShSiSjSkSlSmSnSoSpSqSrSsStSuSvSwSxSySzS0S1S2S3S4S5S6S7S8S9S!S#S$S%S&S(S)S*S+S,S.S/S:S;S<S=S>S?S@S[S]S^S_S`S{S|S}S~S"
+    "-SATBTCTDTETFTGTHTITJTKTLTMTNTOTPTQTRTSTTTUTVTWTXTYTZTaTbTcTdTeTfTgThTiTjTkTlTmTnToTpTqTrTsTtTuTvTwTxTyTzT0T1T2T3T4T5T6T7T8T9T!T"
+    "#T$T%T&T(T)T*T+T,T.T/T:T;T<T=T>T?T@T[T]T^T_T`T{T|T}T~T-TAUBUCUDUEUFUGUHUIUJUKULUMUNUOUPUQURUSUTUUUVUWUXUYUZUaUbUcUdUeUfUgUhUiUjU"
+    "kUlUmUnUoUpUqUrUsUtUuUvUwUxUyUzU0U1U2U3U4U5U6U7U8U9U!U#U$U%U&U(U)U*U+U,U.U/U:U;U<U=U>U?U@U[U]U^U_U`U{U|U}U~U-UAVBVCVDVEVFVGVHVIV"
+    "JVKVLVMVNVOVPVQVRVSVTVUVVVWVXVYVZVaVbVcVdVeVfVgVhViVjVkVlVmVnVoVpVqVrVsVtVuVvVwVxVyVzV0V1V2V3V4V5V6V7V8V9V!V#V$V%V&V(V)V*V+V,V.V"
+    "/V:V;V<V=V>V?V@V[V]V^V_V`V{V|V}V~V-VAWBWCWDWEWFWGWHWIWJWKWLWMWNWOWPWQWRWSWTWUWVWWWXWYWZWaWbWcWdWeWfWgWhWiWjWkWlWmWnWoWpWqWrWsWtW"
+    "uWvWwWxWyWzW0W1W2W3W4W5W6W7W8W9W!W#W$W%W&W(W)W*W+W,W.W/W:W;W<W=W>W?W@W[W]W^W_W`W{W|W}W~W-WAXBXCXDXEXFXGXHXIXJXKXLXMXNXOXPXQXRXSX"
+    "TXUXVXWXXXYXZXaXbXcXdXeXfXgXhXiXjXkXlXmXnXoXpXqXrXsXtXuXvXwXxXyXzX0X1X2X3X4X5X6X7X8X9X!X#X$X%X&X(X)X*X+X,X.X/X:X;X<X=X>X?X@X[X]X"
+    "^X_X`X{X|X}X~X-XAYBYCYDYEYFYGYHYIYJYKYLYMYNYOYPYQYRYSYTYUYVYWYXYYYZYaYbYcYdYeYfYgYhYiYjYkYlYmYnYoYpYqYrYsYtYuYvYwYxYyYzY0Y1Y2Y3Y"
+    "4Y5Y6Y7Y8Y9Y!Y#Y$Y%Y&Y(Y)Y*Y+Y,Y.Y/Y:Y;Y<Y=Y>Y?Y@Y[Y]Y^Y_Y`Y{Y|Y}Y~Y-YAZBZCZDZEZFZGZHZIZJZKZLZMZNZOZPZQZRZSZTZUZVZWZXZYZZZaZbZcZ"
+    "dZeZfZgZhZiZjZkZlZmZnZoZpZqZrZsZtZuZvZwZxZyZzZ0Z1Z2Z3Z4Z5Z6Z7Z8Z9Z!Z#Z$Z%Z&Z(Z)Z*Z+Z,Z.Z/Z:Z;Z<Z=Z>Z?Z@Z[Z]Z^Z_Z`Z{Z|Z}Z~Z-ZAaBa"
+    "CaDaEaFaGaHaIaJaKaLaMaNaOaPaQaRaSaTaUaVaWaXaYaZaaabacadaeafagahaiajakalamanaoapaqarasatauavawaxayaza0a1a2a3a4a5a6a7a8a9a!a#a$a%a"
+    "&a(a)a*a+a,a.a/a:a;a<a=a>a?a@a[a]a^a_a`a{a|a}a~a-aAbBbCbDbEbFbGbHbIbJbKbLbMbNbObPbQbRbSbTbUbVbWbXbYbZbabbbcbdbebfbgbhbibjbkblbmb"
+    "nbobpbqbrbsbtbubvbwbxbybzb0b1b2b3b4b5b6b7b8b9b!b#b$b%b&b(b)b*b+b,b.b/b:b;b<b=b>b?b@b[b]b^b_b`b{b|b}b~b-bAcBcCcDcEcFcGcHcIcJcKcLc"
+    "McNcOcPcQcRcScTcUcVcWcXcYcZcacbcccdcecfcgchcicjckclcmcncocpcqcrcsctcucvcwcxcyczc0c1c2c3c4c5c6c7c8c9c!c#c$c%c&c(c)c*c+c,c.c/c:c;c"
+    "<c=c>c?c@c[c]c^c_c`c{c|c}c~c-cAdBdCdDdEdFdGdHdIdJdKdLdMdNdOdPdQdRdSdTdUdVdWdXdYdZdadbdcdddedfdgdhdidjdkdldmdndodpdqdrdsdtdudvdwd"
+    "xdydzd0d1d2d3d4d5d6d7d8d9d!d#d$d%d&d(d)d*d+d,d.d/d:d;d<d=d>d?d@d[d]d^d_d`d{d|d}d~d-dAeBeCeDeEeFeGeHeIeJeKeLeMeNeOePeQeReSeTeUeVe"
+    "WeXeYeZeaebecedeeefegeheiejekelemeneoepeqereseteuevewexeyeze0e1e2e3e4e5e6e7e8e9e!e#e$e%e&e(e)e*e+e,e.e/e:e;e<e=e>e?e@e[e]e^e_e`e"
+    "{e|e}e~e-eAfBfCfDfEfFfGfHfIfJfKfLfMfNfOfPfQfRfSfTfUfVfWfXfYfZfafbfcfdfefffgfhfifjfkflfmfnfofpfqfrfsftfufvfwfxfyfzf0f1f2f3f4f5f6f"
+    "7f8f9f!f#f$f%f&f(f)f*f+f,f.f/f:f;f<f=f>f?f@f[f]f^f_f`f{f|f}f~f-fAgBgCgDgEgFgGgHgIgJgKgLgMgNgOgPgQgRgSgTgUgVgWgXgYgZgagbgcgdgegfg"
+    "gghgigjgkglgmgngogpgqgrgsgtgugvgwgxgygzg0g1g2g3g4g5g6g7g8g9g!g#g$g%g&g(g)g*g+g,g.g/g:g;g<g=g>g?g@g[g]g^g_g`g{g|g}g~g-gAhBhChDhEh"
+    "FhGhHhIhJhKhLhMhNhOhPhQhRhShThUhVhWhXhYhZhahbhchdhehfhghhhihjhkhlhmhnhohphqhrhshthuhvhwhxhyhzh0h1h2h3h4h5h6h7h8h9h!h#h$h%h&h(h)h"
+    "*h+h,h.h/h:h;h<h=h>h?h@h[h]h^h_h`h{h|h}h~h-hAiBiCiDiEiFiGiHiIiJiKiLiMiNiOiPiQiRiSiTiUiViWiXiYiZiaibicidieifigihiiijikiliminioipi"
+    "qirisitiuiviwixiyizi0i1i2i3i4i5i6i7i8i9i!i#i$i%i&i(i)i*i+i,i.i/i:i;i<i=i>i?i@i[i]i^i_i`i{i|i}i~i-iAjBjCjDjEjFjGjHjIjJjKjLjMjNjOj"
+    "PjQjRjSjTjUjVjWjXjYjZjajbjcjdjejfjgjhjijjjkjljmjnjojpjqjrjsjtjujvjwjxjyjzj0j1j2j3j4j5j6j7j8j9j!j#j$j%j&j(j)j*j+j,j.j/j:j;j<j=j>j"
+    "?j@j[j]j^j_j`j{j|j}j~j-jAkBkCkDkEkFkGkHkIkJkKkLkMkNkOkPkQkRkSkTkUkVkWkXkYkZkakbkckdkekfkgkhkikjkkklkmknkokpkqkrksktkukvkwkxkykzk"
+    "0k1k2k3k4k5k6k7k8k9k!k#k$k%k&k(k)k*k+k,k.k/k:k;k<k=k>k?k@k[k]k^k_k`k{k|k}k~k-kAlBlClDlElFlGlHlIlJlKlLlMlNlOlPlQlRlSlTlUlVlWlXlYl"
+    "Zlalblcldlelflglhliljlklllmlnlolplqlrlsltlulvlwlxlylzl0l1l2l3l4l5l6l7l8l9l!l#l$l%l&l(l)l*l+l,l.l/l:l;l<l=l>l?l@l[l]l^l_l`l{l|l}l"
+    "~l-lAmBmCmDmEmFmGmHmImJmKmLmMmNmOmPmQmRmSmTmUmVmWmXmYmZmambmcmdmemfmgmhmimjmkmlmmmnmompmqmrmsmtmumvmwmxmymzm0m1m2m3m4m5m6m7m8m9m"
+    "!m#m$m%m&m(m)m*m+m,m.m/m:m;m<m=m>m?m@m[m]m^m_m`m{m|m}m~m-mAnBnCnDnEnFnGnHnInJnKnLnMnNnOnPnQnRnSnTnUnVnWnXnYnZnanbncndnenfngnhnin"
+    "jnknlnmnnnonpnqnrnsntnunvnwnxnynzn0n1n2n3n4n5n6n7n8n9n!n#n$n%n&n(n)n*n+n,n.n/n:n;n<n=n>n?n@n[n]n^n_n`n{n|n}n~n-nAoBoCoDoEoFoGoHo"
+    "IoJoKoLoMoNoOoPoQoRoSoToUoVoWoXoYoZoaobocodoeofogohoiojokolomonooopoqorosotouovowoxoyozo0o1o2o3o4o5o6o7o8o9o!o#o$o%o&o(o)o*o+o,o"
+    ".o/o:o;o<o=o>o?o@o[o]o^o_o`o{o|o}o~o-oApBpCpDpEpFpGpHpIpJpKpLpMpNpOpPpQpRpSpTpUpVpWpXpYpZpapbpcpdpepfpgphpipjpkplpmpnpopppqprpsp"
+    "tpupvpwpxpypzp0p1p2p3p4p5p6p7p8p9p!p#p$p%p&p(p)p*p+p,p.p/p:p;p<p=p>p?p@p[p]p^p_p`p{p|p}p~p-pAqBqCqDqEqFqGqHqIqJqKqLqMqNqOqPqQqRq"
+    "SqTqUqVqWqXqYqZqaqbqcqdqeqfqgqhqiqjqkqlqmqnqoqpqqqrqsqtquqvqwqxqyqzq0q1q2q3q4q5q6q7q8q9q!q#q$q%q&q(q)q*q+q,q.q/q:q;q<q=q>q?q@q[q"
+    "]q^q_q`q{q|q}q~q-qArBrCrDrErFrGrHrIrJrKrLrMrNrOrPrQrRrSrTrUrVrWrXrYrZrarbrcrdrerfrgrhrirjrkrlrmrnrorprqrrrsrtrurvrwrxryrzr0r1r2r"
+    "3r4r5r6r7r8r9r!r#r$r%r&r(r)r*r+r,r.r/r:r;r<r=r>r?r@r[r]r^r_r`r{r|r}r~r-rAsBsCsDsEsFsGsHsIsJsKsLsMsNsOsPsQsRsSsTsUsVsWsXsYsZsasbs"
+    "csdsesfsgshsisjskslsmsnsospsqsrssstsusvswsxsyszs0s1s2s3s4s5s6s7s8s9s!s#s$s%s&s(s)s*s+s,s.s/s:s;s<s=s>s?s@s[s]s^s_s`s{s|s}s~s-sAt"
+    "BtCtDtEtFtGtHtItJtKtLtMtNtOtPtQtRtStTtUtVtWtXtYtZtatbtctdtetftgthtitjtktltmtntotptqtrtstttutvtwtxtytzt0t1t2t3t4t5t6t7t8t9t!t#t$t"
+    "%t&t(t)t*t+t,t.t/t:t;t<t=t>t?t@t[t]t^t_t`t{t|t}t~t-tAuBuCuDuEuFuGuHuIuJuKuLuMuNuOuPuQuRuSuTuUuVuWuXuYuZuaubucudueufuguhuiujukulu"
+    "munuoupuqurusutuuuvuwuxuyuzu0u1u2u3u4u5u6u7u8u9u!u#u$u%u&u(u)u*u+u,u.u/u:u;u<u=u>u?u@u[u]u^u_u`u{u|u}u~u-uAvBvCvDvEvFvGvHvIvJvKv"
+    "LvMvNvOvPvQvRvSvTvUvVvWvXvYvZvavbvcvdvevfvgvhvivjvkvlvmvnvovpvqvrvsvtvuvvvwvxvyvzv0v1v2v3v4v5v6v7v8v9v!v#v$v%v&v(v)v*v+v,v.v/v:v"
+    ";v<v=v>v?v@v[v]v^v_v`v{v|v}v~v-vAwBwCwDwEwFwGwHwIwJwKwLwMwNwOwPwQwRwSwTwUwVwWwXwYwZwawbwcwdwewfwgwhwiwjwkwlwmwnwowpwqwrwswtwuwvw"
+    "wwxwywzw0w1w2w3w4w5w6w7w8w9w!w#w$w%w&w(w)w*w+w,w.w/w:w;w<w=w>w?w@w[w]w^w_w`w{w|w}w~w-wAxBxCxDxExFxGxHxIxJxKxLxMxNxOxPxQxRxSxTxUx"
+    "VxWxXxYxZxaxbxcxdxexfxgxhxixjxkxlxmxnxoxpxqxrxsxtxuxvxwxxxyxzx0x1x2x3x4x5x6x7x8x9x!x#x$x%x&x(x)x*x+x,x.x/x:x;x<x=x>x?x@x[x]x^x_x"
+    "`x{x|x}x~x-xAyByCyDyEyFyGyHyIyJyKyLyMyNyOyPyQyRySyTyUyVyWyXyYyZyaybycydyeyfygyhyiyjykylymynyoypyqyrysytyuyvywyxyyyzy0y1y2y3y4y5y"
+    "6y7y8y9y!y#y$y%y&y(y)y*y+y,y.y/y:y;y<y=y>y?y@y[y]y^y_y`y{y|y}y~y-yAzBzCzDzEzFzGzHzIzJzKzLzMzNzOzPzQzRzSzTzUzVzWzXzYzZzazbzczdzez"
+    "fzgzhzizjzkzlzmznzozpzqzrzsztzuzvzwzxzyzzz0z1z2z3z4z5z6z7z8z9z!z#z$z%z&z(z)z*z+z,z.z/z:z;z<z=z>z?z@z[z]z^z_z`z{z|z}z~z-zA0B0C0D0"
+    "E0F0G0H0I0J0K0L0M0N0O0P0Q0R0S0T0U0V0W0X0Y0Z0a0b0c0d0e0f0g0h0i0j0k0l0m0n0o0p0q0r0s0t0u0v0w0x0y0z000102030405060708090!0#0$0%0&0(0"
+    ")0*0+0,0.0/0:0;0<0=0>0?0@0[0]0^0_0`0{0|0}0~0-0A1B1C1D1E1F1G1H1I1J1K1L1M1N1O1P1Q1R1S1T1U1V1W1X1Y1Z1a1b1c1d1e1f1g1h1i1j1k1l1m1n1o1"
+    "p1q1r1s1t1u1v1w1x1y1z101112131415161718191!1#1$1%1&1(1)1*1+1,1.1/1:1;1<1=1>1?1@1[1]1^1_1`1{1|1}1~1-1A2B2C2D2E2F2G2H2I2J2K2L2M2N2"
+    "O2P2Q2R2S2T2U2V2W2X2Y2Z2a2b2c2d2e2f2g2h2i2j2k2l2m2n2o2p2q2r2s2t2u2v2w2x2y2z202122232425262728292!2#2$2%2&2(2)2*2+2,2.2/2:2;2<2=2"
+    ">2?2@2[2]2^2_2`2{2|2}2~2-2A3B3C3D3E3F3G3H3I3J3K3L3M3N3O3P3Q3R3S3T3U3V3W3X3Y3Z3a3b3c3d3e3f3g3h3i3j3k3l3m3n3o3p3q3r3s3t3u3v3w3x3y3"
+    "z303132333435363738393!3#3$3%3&3(3)3*3+3,3.3/3:3;3<3=3>3?3@3[3]3^3_3`3{3|3}3~3-3A4B4C4D4E4F4G4H4I4J4K4L4M4N4O4P4Q4R4S4T4U4V4W4X4"
+    "Y4Z4a4b4c4d4e4f4g4h4i4j4k4l4m4n4o4p4q4r4s4t4u4v4w4x4y4z404142434445464748494!4#4$4%4&4(4)4*4+4,4.4/4:4;4<4=4>4?4@4[4]4^4_4`4{4|4"
+    "}4~4-4A5B5C5D5E5F5G5H5I5J5K5L5M5N5O5P5Q5R5S5T5U5V5W5X5Y5Z5a5b5c5d5e5f5g5h5i5j5k5l5m5n5o5p5q5r5s5t5u5v5w5x5y5z5051525354555657585"
+    "95!5#5$5%5&5(5)5*5+5,5.5/5:5;5<5=5>5?5@5[5]5^5_5`5{5|5}5~5-5A6B6C6D6E6F6G6H6I6J6K6L6M6N6O6P6Q6R6S6T6U6V6W6X6Y6Z6a6b6c6d6e6f6g6h6"
+    "i6j6k6l6m6n6o6p6q6r6s6t6u6v6w6x6y6z606162636465666768696!6#6$6%6&6(6)6*6+6,6.6/6:6;6<6=6>6?6@6[6]6^6_6`6{6|6}6~6-6A7B7C7D7E7F7G7"
+    "H7I7J7K7L7M7N7O7P7Q7R7S7T7U7V7W7X7Y7Z7a7b7c7d7e7f7g7h7i7j7k7l7m7n7o7p7q7r7s7t7u7v7w7x7y7z707172737475767778797!7#7$7%7&7(7)7*7+7"
+    ",7.7/7:7;7<7=7>7?7@7[7]7^7_7`7{7|7}7~7-7A8B8C8D8E8F8G8H8I8J8K8L8M8N8O8P8Q8R8S8T8U8V8W8X8Y8Z8a8b8c8d8e8f8g8h8i8j8k8l8m8n8o8p8q8r8"
+    "s8t8u8v8w8x8y8z808182838485868788898!8#8$8%8&8(8)8*8+8,8.8/8:8;8<8=8>8?8@8[8]8^8_8`8{8|8}8~8-8A9B9C9D9E9F9G9H9I9J9K9L9M9N9O9P9Q9"
+    "R9S9T9U9V9W9X9Y9Z9a9b9c9d9e9f9g9h9i9j9k9l9m9n9o9p9q9r9s9t9u9v9w9x9y9z909192939495969798999!9#9$9%9&9(9)9*9+9,9.9/9:9;9<9=9>9?9@9"
+    "[9]9^9_9`9{9|9}9~9-9A!B!C!D!E!F!G!H!I!J!K!L!M!N!O!P!Q!R!S!T!U!V!W!X!Y!Z!a!b!c!d!e!f!g!h!i!j!k!l!m!n!o!p!q!r!s!t!u!v!w!x!y!z!0!1!"
+    "2!3!4!5!6!7!8!9!!!#!$!%!&!(!)!*!+!,!.!/!:!;!<!=!>!?!@![!]!^!_!`!{!|!}!~!-!A#B#C#D#E#F#G#H#I#J#K#L#M#N#O#P#Q#R#S#T#U#V#W#X#Y#Z#a#"
+    "b#c#d#e#f#g#h#i#j#k#l#m#n#o#p#q#r#s#t#u#v#w#x#y#z#0#1#2#3#4#5#6#7#8#9#!###$#%#&#(#)#*#+#,#.#/#:#;#<#=#>#?#@#[#]#^#_#`#{#|#}#~#-#"
+    "A$B$C$D$E$F$G$H$I$J$K$L$M$N$O$P$Q$R$S$T$U$V$W$X$Y$Z$a$b$c$d$e$f$g$h$i$j$k$l$m$n$o$p$q$r$s$t$u$v$w$x$y$z$0$1$2$3$4$5$6$7$8$9$!$#$"
+    "$$%$&$($)$*$+$,$.$/$:$;$<$=$>$?$@$[$]$^$_$`${$|$}$~$-$A%B%C%D%E%F%G%H%I%J%K%L%M%N%O%P%Q%R%S%T%U%V%W%X%Y%Z%a%b%c%d%e%f%g%h%i%j%k%"
+    "l%m%n%o%p%q%r%s%t%u%v%w%x%y%z%0%1%2%3%4%5%6%7%8%9%!%#%$%%%&%(%)%*%+%,%.%/%:%;%<%=%>%?%@%[%]%^%_%`%{%|%}%~%-%A&B&C&D&E&F&G&H&I&J&"
+    "K&L&M&N&O&P&Q&R&S&T&U&V&W&X&Y&Z&a&b&c&d&e&f&g&h&i&j&k&l&m&n&o&p&q&r&s&t&u&v&w&x&y&z&0&1&2&3&4&5&6&7&8&9&!&#&$&%&&&(&)&*&+&,&.&/&"
+    ":&;&<&=&>&?&@&[&]&^&_&`&{&|&}&~&-&A(B(C(D(E(F(G(H(I(J(K(L(M(N(O(P(Q(R(S(T(U(V(W(X(Y(Z(a(b(c(d(e(f(g(h(i(j(k(l(m(n(o(p(q(r(s(t(u("
+    "v(w(x(y(z(0(1(2(3(4(5(6(7(8(9(!(#($(%(&((()(*(+(,(.(/(:(;(<(=(>(?(@([(](^(_(`({(|(}(~(-(A)B)C)D)E)F)G)H)I)J)K)L)M)N)O)P)Q)R)S)T)"
+    "U)V)W)X)Y)Z)a)b)c)d)e)f)g)h)i)j)k)l)m)n)o)p)q)r)s)t)u)v)w)x)y)z)0)1)2)3)4)5)6)7)8)9)!)#)$)%)&)()))*)+),).)/):);)<)=)>)?)@)[)])^)"
+    "_)`){)|)})~)-)A*B*C*D*E*F*G*H*I*J*K*L*M*N*O*P*Q*R*S*T*U*V*W*X*Y*Z*a*b*c*d*e*f*g*h*i*j*k*l*m*n*o*p*q*r*s*t*u*v*w*x*y*z*0*1*2*3*4*"
+    "5*6*7*8*9*!*#*$*%*&*(*)***+*,*.*/*:*;*<*=*>*?*@*[*]*^*_*`*{*|*}*~*-*A+B+C+D+E+F+G+H+I+J+K+L+M+N+O+P+Q+R+S+T+U+V+W+X+Y+Z+a+b+c+d+"
+    "e+f+g+h+i+j+k+l+m+n+o+p+q+r+s+t+u+v+w+x+y+z+0+1+2+3+4+5+6+7+8+9+!+#+$+%+&+(+)+*+++,+.+/+:+;+<+=+>+?+@+[+]+^+_+`+{+|+}+~+-+A,B,C,"
+    "D,E,F,G,H,I,J,K,L,M,N,O,P,Q,R,S,T,U,V,W,X,Y,Z,a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v,w,x,y,z,0,1,2,3,4,5,6,7,8,9,!,#,$,%,&,"
+    "(,),*,+,,,.,/,:,;,<,=,>,?,@,[,],^,_,`,{,|,},~,-,A.B.C.D.E.F.G.H.I.J.K.L.M.N.O.P.Q.R.S.T.U.V.W.X.Y.Z.a.b.c.d.e.f.g.h.i.j.k.l.m.n."
+    "o.p.q.r.s.t.u.v.w.x.y.z.0.1.2.3.4.5.6.7.8.9.!.#.$.%.&.(.).*.+.,.../.:.;.<.=.>.?.@.[.].^._.`.{.|.}.~.-.A/B/C/D/E/F/G/H/I/J/K/L/M/"
+    "N/O/P/Q/R/S/T/U/V/W/X/Y/Z/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s/t/u/v/w/x/y/z/0/1/2/3/4/5/6/7/8/9/!/#/$/%/&/(/)/*/+/,/.///:/;/</"
+    "=/>/?/@/[/]/^/_/`/{/|/}/~/-/A:B:C:D:E:F:G:H:I:J:K:L:M:N:O:P:Q:R:S:T:U:V:W:X:Y:Z:a:b:c:d:e:f:g:h:i:j:k:l:m:n:o:p:q:r:s:t:u:v:w:x:"
+    "y:z:0:1:2:3:4:5:6:7:8:9:!:#:$:%:&:(:):*:+:,:.:/:::;:<:=:>:?:@:[:]:^:_:`:{:|:}:~:-:A;B;C;D;E;F;G;H;I;J;K;L;M;N;O;P;Q;R;S;T;U;V;W;"
+    "X;Y;Z;a;b;c;d;e;f;g;h;i;j;k;l;m;n;o;p;q;r;s;t;u;v;w;x;y;z;0;1;2;3;4;5;6;7;8;9;!;#;$;%;&;(;);*;+;,;.;/;:;;;<;=;>;?;@;[;];^;_;`;{;"
+    "|;};~;-;A<B<C<D<E<F<G<H<I<J<K<L<M<N<O<P<Q<R<S<T<U<V<W<X<Y<Z<a<b<c<d<e<f<g<h<i<j<k<l<m<n<o<p<q<r<s<t<u<v<w<x<y<z<0<1<2<3<4<5<6<7<"
+    "8<9<!<#<$<%<&<(<)<*<+<,<.</<:<;<<<=<><?<@<[<]<^<_<`<{<|<}<~<-<A=B=C=D=E=F=G=H=I=J=K=L=M=N=O=P=Q=R=S=T=U=V=W=X=Y=Z=a=b=c=d=e=f=g="
+    "h=i=j=k=l=m=n=o=p=q=r=s=t=u=v=w=x=y=z=0=1=2=3=4=5=6=7=8=9=!=#=$=%=&=(=)=*=+=,=.=/=:=;=<===>=?=@=[=]=^=_=`={=|=}=~=-=A>B>C>D>E>F>"
+    "G>H>I>J>K>L>M>N>O>P>Q>R>S>T>U>V>W>X>Y>Z>a>b>c>d>e>f>g>h>i>j>k>l>m>n>o>p>q>r>s>t>u>v>w>x>y>z>0>1>2>3>4>5>6>7>8>9>!>#>$>%>&>(>)>*>"
+    "+>,>.>/>:>;><>=>>>?>@>[>]>^>_>`>{>|>}>~>->A?B?C?D?E?F?G?H?I?J?K?L?M?N?O?P?Q?R?S?T?U?V?W?X?Y?Z?a?b?c?d?e?f?g?h?i?j?k?l?m?n?o?p?q?"
+    "r?s?t?u?v?w?x?y?z?0?1?2?3?4?5?6?7?8?9?!?#?$?%?&?(?)?*?+?,?.?/?:?;?<?=?>???@?[?]?^?_?`?{?|?}?~?-?A@B@C@D@E@F@G@H@I@J@K@L@M@N@O@P@"
+    "Q@R@S@T@U@V@W@X@Y@Z@a@b@c@d@e@f@g@h@i@j@k@l@m@n@o@p@q@r@s@t@u@v@w@x@y@z@0@1@2@3@4@5@6@7@8@9@!@#@$@%@&@(@)@*@+@,@.@/@:@;@<@=@>@?@"
+    "@@[@]@^@_@`@{@|@}@~@-@A[B[C[D[E[F[G[H[I[J[K[L[M[N[O[P[Q[R[S[T[U[V[W[X[Y[Z[a[b[c[d[e[f[g[h[i[j[k[l[m[n[o[p[q[r[s[t[u[v[w[x[y[z[0["
+    "1[2[3[4[5[6[7[8[9[![#[$[%[&[([)[*[+[,[.[/[:[;[<[=[>[?[@[[[][^[_[`[{[|[}[~[-[A]B]C]D]E]F]G]H]I]J]K]L]M]N]O]P]Q]R]S]T]U]V]W]X]Y]Z]"
+    "a]b]c]d]e]f]g]h]i]j]k]l]m]n]o]p]q]r]s]t]u]v]w]x]y]z]0]1]2]3]4]5]6]7]8]9]!]#]$]%]&](])]*]+],].]/]:];]<]=]>]?]@][]]]^]_]`]{]|]}]~]"
+    "-]A^B^C^D^E^F^G^H^I^J^K^L^M^N^O^P^Q^R^S^T^U^V^W^X^Y^Z^a^b^c^d^e^f^g^h^i^j^k^l^m^n^o^p^q^r^s^t^u^v^w^x^y^z^0^1^2^3^4^5^6^7^8^9^!^"
+    "#^$^%^&^(^)^*^+^,^.^/^:^;^<^=^>^?^@^[^]^^^_^`^{^|^}^~^-^A_B_C_D_E_F_G_H_I_J_K_L_M_N_O_P_Q_R_S_T_U_V_W_X_Y_Z_a_b_c_d_e_f_g_h_i_j_"
+    "k_l_m_n_o_p_q_r_s_t_u_v_w_x_y_z_0_1_2_3_4_5_6_7_8_9_!_#_$_%_&_(_)_*_+_,_._/_:_;_<_=_>_?_@_[_]_^___`_{_|_}_~_-_A`B`C`D`E`F`G`H`I`"
+    "J`K`L`M`N`O`P`Q`R`S`T`U`V`W`X`Y`Z`a`b`c`d`e`f`g`h`i`j`k`l`m`n`o`p`q`r`s`t`u`v`w`x`y`z`0`1`2`3`4`5`6`7`8`9`!`#`$`%`&`(`)`*`+`,`.`"
+    "/`:`;`<`=`>`?`@`[`]`^`_```{`|`}`~`-`A{B{C{D{E{F{G{H{I{J{K{L{M{N{O{P{Q{R{S{T{U{V{W{X{Y{Z{a{b{c{d{e{f{g{h{i{j{k{l{m{n{o{p{q{r{s{t{"
+    "u{v{w{x{y{z{0{1{2{3{4{5{6{7{8{9{!{#{${%{&{({){*{+{,{.{/{:{;{<{={>{?{@{[{]{^{_{`{{{|{}{~{-{A|B|C|D|E|F|G|H|I|J|K|L|M|N|O|P|Q|R|S|"
+    "T|U|V|W|X|Y|Z|a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z|0|1|2|3|4|5|6|7|8|9|!|#|$|%|&|(|)|*|+|,|.|/|:|;|<|=|>|?|@|[|]|"
+    "^|_|`|{|||}|~|-|A}B}C}D}E}F}G}H}I}J}K}L}M}N}O}P}Q}R}S}T}U}V}W}X}Y}Z}a}b}c}d}e}f}g}h}i}j}k}l}m}n}o}p}q}r}s}t}u}v}w}x}y}z}0}1}2}3}"
+    "4}5}6}7}8}9}!}#}$}%}&}(})}*}+},}.}/}:};}<}=}>}?}@}[}]}^}_}`}{}|}}}~}-}A~B~C~D~E~F~G~H~I~J~K~L~M~N~O~P~Q~R~S~T~U~V~W~X~Y~Z~a~b~c~"
+    "d~e~f~g~h~i~j~k~l~m~n~o~p~q~r~s~t~u~v~w~x~y~z~0~1~2~3~4~5~6~7~8~9~!~#~$~%~&~(~)~*~+~,~.~/~:~;~<~=~>~?~@~[~]~^~_~`~{~|~}~~~-~A-B-";
+
 // Decode lookup table (-1 = invalid character)
 const int8_t Base91::DECODE_TABLE[256] = {
     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x00-0x0F
@@ -37,105 +171,284 @@ const int8_t Base91::DECODE_TABLE[256] = {
     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1   // 0xF0-0xFF
 };
 
+
 size_t Base91::encode(const uint8_t* input, size_t inputLen, 
                       char* output, size_t outputMaxLen) {
     if (input == nullptr || output == nullptr || outputMaxLen == 0) {
         return 0;
     }
     
-    size_t outPos = 0;
-    uint32_t queue = 0;
-    int numBits = 0;
+    Encoder encoder(output, outputMaxLen);
+    encoder.update(input, inputLen);
+    return encoder.finish();
+}
+
+size_t Base91::fit(const uint8_t* input, size_t inputLen, size_t maxChars) {
+    if (input == nullptr) {
+        return 0;
+    }
+    return Encoder(nullptr, 0).fit(input, inputLen, maxChars);
+}
+
+size_t Base91::decode(const char* input, uint8_t* output, size_t outputMaxLen) {
+    if (input == nullptr) {
+        return 0;
+    }
+    return decodeImpl((const uint8_t*)input, strlen(input), output, outputMaxLen);
+}
+
+size_t Base91::decode(const char* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    return decodeImpl((const uint8_t*)input, inputLen, output, outputMaxLen);
+}
+
+size_t Base91::decodeInPlace(uint8_t* buffer, size_t len) {
+    return decodeImpl(buffer, len, buffer, len);
+}
+
+size_t Base91::decodeImpl(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    if (input == nullptr || output == nullptr || outputMaxLen == 0) {
+        return 0;
+    }
+    
+    Decoder decoder(output, outputMaxLen);
+    decoder.update((const char*)input, inputLen);
+    return decoder.finish();
+}
+
+// ============================================================================
+// Streaming encoder
+// ============================================================================
+
+Base91::Encoder::Encoder(char* output, size_t outputMaxLen)
+    : output(output), outputMaxLen(outputMaxLen), outPos(0), queue(0), numBits(0),
+      failed(output != nullptr && outputMaxLen == 0) {
+}
+
+bool Base91::Encoder::update(const uint8_t* input, size_t inputLen) {
+    if (failed || (input == nullptr && inputLen > 0)) {
+        failed = true;
+        return false;
+    }
     
-    for (size_t i = 0; i < inputLen; i++) {
-        queue |= ((uint32_t)input[i]) << numBits;
-        numBits += 8;
+    // Same bit stream as the byte-at-a-time encoder: a pair is emitted whenever
+    // more than 13 bits are queued, so refilling a whole word at a time and
+    // draining all pairs afterwards yields identical output (also across calls)
+    // State is kept in locals, output may alias the members as far as the compiler knows
+    char* out = output;
+    size_t pos = outPos;
+    uint64_t q = queue;
+    int bits = numBits;
+    size_t i = 0;
+    while (i < inputLen) {
+        if (inputLen - i >= 4) {
+            uint32_t word = (uint32_t)input[i] | ((uint32_t)input[i + 1] << 8) |
+                            ((uint32_t)input[i + 2] << 16) | ((uint32_t)input[i + 3] << 24);
+            q |= ((uint64_t)word) << bits;
+            bits += 32;
+            i += 4;
+        } else {
+            q |= ((uint64_t)input[i]) << bits;
+            bits += 8;
+            i++;
+        }
         
-        if (numBits > 13) {
+        while (bits > 13) {
+            if (out && pos + 2 > outputMaxLen - 1) {  // -1 for null terminator
+                failed = true;
+                return false;  // Buffer too small
+            }
+            
             // Extract 13 bits and encode as 2 characters
-            uint32_t val = queue & 8191;  // 8191 = 2^13 - 1
+            uint32_t val = (uint32_t)q & 8191;  // 8191 = 2^13 - 1
             
             if (val > 88) {
-                queue >>= 13;
-                numBits -= 13;
+                q >>= 13;
+                bits -= 13;
             } else {
                 // For small values, use 14 bits for better encoding
-                val = queue & 16383;  // 16383 = 2^14 - 1
-                queue >>= 14;
-                numBits -= 14;
+                val = (uint32_t)q & 16383;  // 16383 = 2^14 - 1
+                q >>= 14;
+                bits -= 14;
             }
             
-            if (outPos + 2 > outputMaxLen - 1) {  // -1 for null terminator
-                return 0;  // Buffer too small
+            if (out) {
+                if (val > 8191) {
+                    // 8192..8280 is past the pair table: 8192 = 90 * 91 + 2
+                    out[pos] = ALPHABET[val - 8190];
+                    out[pos + 1] = ALPHABET[90];
+                } else {
+                    out[pos] = ENCODE_PAIRS[val * 2];
+                    out[pos + 1] = ENCODE_PAIRS[val * 2 + 1];
+                }
             }
-            
-            output[outPos++] = ALPHABET[val % 91];
-            output[outPos++] = ALPHABET[val / 91];
+            pos += 2;
         }
     }
     
-    // Handle remaining bits
+    outPos = pos;
+    queue = q;
+    numBits = bits;
+    return true;
+}
+
+size_t Base91::Encoder::finish() {
+    if (failed) {
+        return 0;
+    }
+    
+    // Handle remaining bits (at most 13, so the pair table applies)
     if (numBits > 0) {
-        if (outPos + 1 > outputMaxLen - 1) {
+        uint32_t val = (uint32_t)queue;
+        size_t tailLen = (numBits > 7 || val > 90) ? 2 : 1;
+        if (output && outPos + tailLen > outputMaxLen - 1) {
+            failed = true;
             return 0;
         }
-        output[outPos++] = ALPHABET[queue % 91];
-        
-        if (numBits > 7 || queue > 90) {
-            if (outPos + 1 > outputMaxLen - 1) {
-                return 0;
+        if (output) {
+            output[outPos] = ENCODE_PAIRS[val * 2];
+            if (tailLen == 2) {
+                output[outPos + 1] = ENCODE_PAIRS[val * 2 + 1];
             }
-            output[outPos++] = ALPHABET[queue / 91];
         }
+        outPos += tailLen;
+        queue = 0;
+        numBits = 0;
     }
     
-    output[outPos] = '\0';
+    if (output) {
+        output[outPos] = '\0';
+    }
     return outPos;
 }
 
-size_t Base91::decode(const char* input, uint8_t* output, size_t outputMaxLen) {
-    if (input == nullptr || output == nullptr || outputMaxLen == 0) {
+size_t Base91::Encoder::fit(const uint8_t* input, size_t inputLen, size_t maxChars) const {
+    if (failed || input == nullptr) {
         return 0;
     }
     
-    size_t outPos = 0;
-    uint32_t queue = 0;
-    int numBits = 0;
-    int val = -1;
+    // Run the encoder without output, the encoded length never shrinks
+    // when a byte is added, so stop at the first prefix that overflows
+    size_t pos = outPos;
+    uint32_t q = (uint32_t)queue;  // At most 13 bits between calls
+    int bits = numBits;
+    
+    for (size_t i = 0; i < inputLen; i++) {
+        q |= ((uint32_t)input[i]) << bits;
+        bits += 8;
+        
+        if (bits > 13) {
+            if ((q & 8191) > 88) {
+                q >>= 13;
+                bits -= 13;
+            } else {
+                q >>= 14;
+                bits -= 14;
+            }
+            pos += 2;
+        }
+        
+        // Length if the input ended here (same rules as the tail in finish)
+        size_t encodedLen = pos;
+        if (bits > 0) {
+            encodedLen += (bits > 7 || q > 90) ? 2 : 1;
+        }
+        if (encodedLen > maxChars) {
+            return i;
+        }
+    }
     
-    for (size_t i = 0; input[i] != '\0'; i++) {
+    return inputLen;
+}
+
+// ============================================================================
+// Streaming decoder
+// ============================================================================
+
+Base91::Decoder::Decoder(uint8_t* output, size_t outputMaxLen)
+    : output(output), outputMaxLen(outputMaxLen), outPos(0), queue(0), numBits(0), val(-1),
+      failed(output == nullptr || outputMaxLen == 0) {
+}
+
+bool Base91::Decoder::update(const char* input, size_t inputLen) {
+    if (failed || (input == nullptr && inputLen > 0)) {
+        failed = true;
+        return false;
+    }
+    
+    // Every character pair yields at most 14 bits, so outPos stays behind i
+    // and output may be the input buffer itself (also when flushing 4 bytes,
+    // which needs 32 bits = at least 6 characters read)
+    // State is kept in locals, output may alias the members as far as the compiler knows
+    uint8_t* out = output;
+    size_t pos = outPos;
+    uint64_t q = queue;
+    int bits = numBits;
+    int v = val;
+    
+    for (size_t i = 0; i < inputLen; i++) {
         int8_t d = DECODE_TABLE[(uint8_t)input[i]];
         if (d == -1) {
             continue;  // Skip invalid characters
         }
         
-        if (val == -1) {
-            val = d;
-        } else {
-            val += d * 91;
-            queue |= ((uint32_t)val) << numBits;
-            numBits += (val & 8191) > 88 ? 13 : 14;
-            
-            while (numBits >= 8) {
-                if (outPos >= outputMaxLen) {
-                    return 0;  // Buffer too small
-                }
-                output[outPos++] = (uint8_t)(queue & 0xFF);
-                queue >>= 8;
-                numBits -= 8;
+        if (v == -1) {
+            v = d;
+            continue;
+        }
+        
+        v += d * 91;
+        q |= ((uint64_t)v) << bits;
+        bits += (v & 8191) > 88 ? 13 : 14;
+        v = -1;
+        
+        if (bits >= 32) {
+            if (pos + 4 > outputMaxLen) {
+                failed = true;
+                return false;  // Buffer too small
             }
-            
-            val = -1;
+            out[pos++] = (uint8_t)q;
+            out[pos++] = (uint8_t)(q >> 8);
+            out[pos++] = (uint8_t)(q >> 16);
+            out[pos++] = (uint8_t)(q >> 24);
+            q >>= 32;
+            bits -= 32;
+        }
+    }
+    
+    outPos = pos;
+    queue = q;
+    numBits = bits;
+    val = v;
+    return true;
+}
+
+size_t Base91::Decoder::finish() {
+    if (failed) {
+        return 0;
+    }
+    
+    // Flush whole bytes still queued
+    while (numBits >= 8) {
+        if (outPos >= outputMaxLen) {
+            failed = true;
+            return 0;  // Buffer too small
         }
+        output[outPos++] = (uint8_t)queue;
+        queue >>= 8;
+        numBits -= 8;
     }
     
     // Handle remaining value
     if (val != -1) {
         if (outPos >= outputMaxLen) {
+            failed = true;
             return 0;
         }
-        output[outPos++] = (uint8_t)((queue | ((uint32_t)val << numBits)) & 0xFF);
+        output[outPos++] = (uint8_t)((queue | ((uint64_t)val << numBits)) & 0xFF);
+        val = -1;
     }
+    queue = 0;
+    numBits = 0;
     
     return outPos;
 }
@@ -9,6 +9,11 @@
  * - Null byte (0x00) - would truncate MeshCore strlen() messages
  * - Backslash, single/double quotes - problematic in many contexts
  * 
+ * The encoder works a 32-bit word at a time and looks up both characters of
+ * a pair in a 16 KB table (const, so it stays in flash on ESP32), the
+ * decoder flushes 4 bytes at a time. Output is identical to the original
+ * byte-at-a-time codec kept in test/base91_reference.h.
+ * 
  */
 
 #ifndef BASE91_H
@@ -41,6 +46,118 @@ public:
      */
     static size_t decode(const char* input, uint8_t* output, size_t outputMaxLen);
     
+    /**
+     * Decode a length-delimited Base91 string to binary data
+     * 
+     * @param input Base91 encoded characters (no null terminator needed)
+     * @param inputLen Number of characters in input
+     * @param output Output buffer for decoded binary data
+     * @param outputMaxLen Maximum size of output buffer
+     * @return Length of decoded data, or 0 on error
+     */
+    static size_t decode(const char* input, size_t inputLen, uint8_t* output, size_t outputMaxLen);
+    
+    /**
+     * Decode Base91 in place, the decoded data is always shorter than the input
+     * On error (no valid characters) the buffer is left untouched
+     * 
+     * @param buffer Base91 encoded characters, overwritten with the decoded data
+     * @param len Number of characters in buffer
+     * @return Length of decoded data, or 0 on error
+     */
+    static size_t decodeInPlace(uint8_t* buffer, size_t len);
+    
+    /**
+     * Find the longest prefix of input that encodes within maxChars characters
+     * 
+     * Base91 packs 13 or 14 bits per character pair depending on the data,
+     * so the exact fit is usually a few bytes more than the worst-case ratio.
+     * 
+     * @param input Binary data to pack
+     * @param inputLen Length of input data
+     * @param maxChars Character budget (not including null terminator)
+     * @return Number of leading input bytes whose encoding fits in maxChars
+     */
+    static size_t fit(const uint8_t* input, size_t inputLen, size_t maxChars);
+    
+    /**
+     * Streaming encoder, encodes slices from separate buffers (e.g. a UDH
+     * and a payload fragment) into one Base91 string as if they were one buffer
+     * 
+     * Output is identical to encode() on the concatenated input.
+     */
+    class Encoder {
+    public:
+        /**
+         * @param output Output buffer for the Base91 string (null-terminated by finish()),
+         *               or nullptr to only count characters
+         * @param outputMaxLen Maximum size of output buffer
+         */
+        Encoder(char* output, size_t outputMaxLen);
+        
+        /**
+         * Encode the next slice of input
+         * @return false if the output buffer is too small (the encoder stays failed)
+         */
+        bool update(const uint8_t* input, size_t inputLen);
+        
+        /**
+         * Flush the remaining bits and null-terminate, ends the stream
+         * @return Length of encoded string (not including null terminator), or 0 on error
+         */
+        size_t finish();
+        
+        /**
+         * Find the longest prefix of input that, appended to what was encoded
+         * so far, finishes within maxChars characters (the encoder is not changed)
+         */
+        size_t fit(const uint8_t* input, size_t inputLen, size_t maxChars) const;
+        
+    private:
+        char* output;
+        size_t outputMaxLen;
+        size_t outPos;
+        uint64_t queue;
+        int numBits;
+        bool failed;
+    };
+    
+    /**
+     * Streaming decoder, decodes a Base91 string delivered in slices
+     * 
+     * Output is identical to decode() on the concatenated input, and output
+     * may be the input buffer itself.
+     */
+    class Decoder {
+    public:
+        /**
+         * @param output Output buffer for decoded binary data
+         * @param outputMaxLen Maximum size of output buffer
+         */
+        Decoder(uint8_t* output, size_t outputMaxLen);
+        
+        /**
+         * Decode the next slice of characters (invalid characters are skipped)
+         * @return false if the output buffer is too small (the decoder stays failed)
+         */
+        bool update(const char* input, size_t inputLen);
+        
+        /**
+         * Flush the remaining bits, ends the stream
+         * @return Length of decoded data, or 0 on error
+         */
+        size_t finish();
+        
+    private:
+        uint8_t* output;
+        size_t outputMaxLen;
+        size_t outPos;
+        uint64_t queue;
+        int numBits;
+        int val;
+        bool failed;
+    };
+    
     /**
      * Calculate maximum encoded size for given input length
      * Base91 worst case is ceil(inputLen * 16 / 13) + 1
@@ -58,8 +175,12 @@ public:
     }
 
 private:
+    // Shared decoder, output may alias input (writes never overtake reads)
+    static size_t decodeImpl(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen);
+    
     // 91 printable ASCII characters (excludes NUL, ", ', \, and some others)
     static const char ALPHABET[91];
+    static const char ENCODE_PAIRS[8192 * 2 + 1];
     static const int8_t DECODE_TABLE[256];
 };
 
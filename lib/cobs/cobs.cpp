@@ -0,0 +1,132 @@
+/**
+ * cobs.cpp - COBS Framing Implementation
+ *
+ */
+
+#include "cobs.h"
+
+#include <cstring>
+
+size_t Cobs::encode(const uint8_t* input, size_t inputLen,
+                    char* output, size_t outputMaxLen) {
+    if (input == nullptr || output == nullptr || outputMaxLen < 2) {
+        return 0;
+    }
+
+    Encoder encoder(output, outputMaxLen);
+    encoder.update(input, inputLen);
+    return encoder.finish();
+}
+
+Cobs::Encoder::Encoder(char* output, size_t outputMaxLen)
+    : output(output), outputMaxLen(outputMaxLen), codePos(0), outPos(1), code(1),
+      maxCode(FIRST_BLOCK_CODE), failed(output == nullptr || outputMaxLen < 2) {
+}
+
+bool Cobs::Encoder::update(const uint8_t* input, size_t inputLen) {
+    if (failed || (input == nullptr && inputLen > 0)) {
+        failed = true;
+        return false;
+    }
+
+    // Each block starts with a code byte: 1 + number of data bytes that follow.
+    // A block shorter than its maximum implies a 0x00 after its data.
+    for (size_t i = 0; i < inputLen; i++) {
+        if (input[i] != 0) {
+            if (outPos + 1 > outputMaxLen - 1) {  // -1 for null terminator
+                failed = true;
+                return false;  // Buffer too small
+            }
+            output[outPos++] = (char)input[i];
+            code++;
+            if (code < maxCode) {
+                continue;
+            }
+            // Block full - no implied zero, start a new block
+        }
+
+        if (outPos + 1 > outputMaxLen - 1) {
+            failed = true;
+            return false;
+        }
+        output[codePos] = (char)code;
+        codePos = outPos++;
+        code = 1;
+        maxCode = BLOCK_CODE;
+    }
+
+    return true;
+}
+
+size_t Cobs::Encoder::finish() {
+    if (failed) {
+        return 0;
+    }
+
+    output[codePos] = (char)code;
+    output[0] = (char)((uint8_t)output[0] | FRAME_MARKER);
+    output[outPos] = '\0';
+    failed = true;  // Ends the stream, the code bytes are final
+    return outPos;
+}
+
+size_t Cobs::decode(const char* input, uint8_t* output, size_t outputMaxLen) {
+    if (input == nullptr) {
+        return 0;
+    }
+    return decodeImpl((const uint8_t*)input, strlen(input), output, outputMaxLen);
+}
+
+size_t Cobs::decode(const char* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    return decodeImpl((const uint8_t*)input, inputLen, output, outputMaxLen);
+}
+
+size_t Cobs::decodeInPlace(uint8_t* buffer, size_t len) {
+    return decodeImpl(buffer, len, buffer, len);
+}
+
+size_t Cobs::decodeImpl(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    if (input == nullptr || output == nullptr || outputMaxLen == 0 || inputLen == 0 ||
+        (input[0] & FRAME_MARKER) == 0) {
+        return 0;
+    }
+
+    // The leading code byte produces no output, so outPos stays behind pos
+    // and output may be the input buffer itself
+    size_t pos = 1;
+    size_t outPos = 0;
+    uint8_t code = input[0] & ~FRAME_MARKER;
+    uint8_t maxCode = FIRST_BLOCK_CODE;
+
+    while (true) {
+        if (code == 0) {
+            return 0;  // Malformed - code bytes are never 0
+        }
+
+        for (uint8_t i = 1; i < code; i++) {
+            if (pos >= inputLen || input[pos] == 0) {
+                return 0;  // Truncated block
+            }
+            if (outPos >= outputMaxLen) {
+                return 0;  // Buffer too small
+            }
+            output[outPos++] = input[pos++];
+        }
+
+        if (pos >= inputLen) {
+            break;  // End of frame, the last block implies no zero
+        }
+
+        if (code != maxCode) {
+            if (outPos >= outputMaxLen) {
+                return 0;
+            }
+            output[outPos++] = 0;
+        }
+
+        code = input[pos++];
+        maxCode = BLOCK_CODE;
+    }
+
+    return outPos;
+}
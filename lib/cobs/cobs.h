@@ -0,0 +1,137 @@
+/**
+ * cobs.h - COBS (Consistent Overhead Byte Stuffing) framing for MeshCore
+ *
+ * COBS removes every 0x00 from binary data at a fixed cost of one code byte
+ * per run of up to 254 non-zero bytes, so a MeshCore-sized frame (<150 bytes)
+ * carries its WDP payload with 1 byte of overhead instead of Base91's ~23%.
+ *
+ * Frames are distinguishable from Base91 text and plain chat messages:
+ * - The leading code byte has bit 7 set (0x81..0xFF), Base91 and ASCII never do
+ * - The first block is limited to 126 data bytes so its code fits in 7 bits,
+ *   costing one extra code byte only if the first 126 bytes contain no 0x00
+ *
+ * Worst case is therefore 2 bytes of overhead per frame, typically 1.
+ *
+ */
+
+#ifndef COBS_H
+#define COBS_H
+
+#include <cstdint>
+#include <cstddef>
+
+class Cobs {
+public:
+    /**
+     * Encode binary data to a NUL-free COBS frame
+     *
+     * @param input Binary data to encode
+     * @param inputLen Length of input data
+     * @param output Output buffer for the frame (will be null-terminated)
+     * @param outputMaxLen Maximum size of output buffer
+     * @return Length of encoded frame (not including null terminator), or 0 on error
+     */
+    static size_t encode(const uint8_t* input, size_t inputLen,
+                         char* output, size_t outputMaxLen);
+
+    /**
+     * Decode a COBS frame to binary data
+     *
+     * @param input COBS frame (null-terminated)
+     * @param output Output buffer for decoded binary data
+     * @param outputMaxLen Maximum size of output buffer
+     * @return Length of decoded data, or 0 on error (not a frame, malformed or too large)
+     */
+    static size_t decode(const char* input, uint8_t* output, size_t outputMaxLen);
+
+    /**
+     * Decode a length-delimited COBS frame to binary data
+     *
+     * @param input COBS frame (no null terminator needed)
+     * @param inputLen Length of the frame
+     * @param output Output buffer for decoded binary data
+     * @param outputMaxLen Maximum size of output buffer
+     * @return Length of decoded data, or 0 on error (not a frame, malformed or too large)
+     */
+    static size_t decode(const char* input, size_t inputLen, uint8_t* output, size_t outputMaxLen);
+
+    /**
+     * Decode a COBS frame in place, the decoded data is always shorter than the frame
+     * On error the buffer contents are undefined
+     *
+     * @param buffer COBS frame, overwritten with the decoded data
+     * @param len Length of the frame
+     * @return Length of decoded data, or 0 on error
+     */
+    static size_t decodeInPlace(uint8_t* buffer, size_t len);
+
+    /**
+     * Streaming encoder, frames slices from separate buffers (e.g. a UDH and
+     * a payload fragment) as one COBS frame
+     *
+     * Output is identical to encode() on the concatenated input.
+     */
+    class Encoder {
+    public:
+        /**
+         * @param output Output buffer for the frame (null-terminated by finish())
+         * @param outputMaxLen Maximum size of output buffer
+         */
+        Encoder(char* output, size_t outputMaxLen);
+
+        /**
+         * Frame the next slice of input
+         * @return false if the output buffer is too small (the encoder stays failed)
+         */
+        bool update(const uint8_t* input, size_t inputLen);
+
+        /**
+         * Write the last code byte and null-terminate, ends the stream
+         * @return Length of encoded frame (not including null terminator), or 0 on error
+         */
+        size_t finish();
+
+    private:
+        char* output;
+        size_t outputMaxLen;
+        size_t codePos;
+        size_t outPos;
+        uint8_t code;
+        uint8_t maxCode;
+        bool failed;
+    };
+
+    /**
+     * Check whether a received text message is a COBS frame
+     * (as opposed to Base91 or plain text)
+     */
+    static bool isFrame(const char* input) {
+        return input != nullptr && ((uint8_t)input[0] & FRAME_MARKER) != 0;
+    }
+
+    /**
+     * Calculate maximum encoded size for given input length
+     * One code byte per 254 bytes, plus one for the shorter first block
+     */
+    static size_t encodedSize(size_t inputLen) {
+        return inputLen + 2 + inputLen / 254 + 1;  // +1 for null terminator
+    }
+
+    /**
+     * Calculate the largest input that always encodes within encodedLen characters
+     * Exact for frames up to 254 + 126 bytes, which covers any MeshCore message
+     */
+    static size_t maxDecodedSize(size_t encodedLen) {
+        return encodedLen > 2 ? encodedLen - 2 : 0;
+    }
+
+private:
+    // Shared decoder, output may alias input (writes stay behind reads)
+    static size_t decodeImpl(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen);
+
+    static const uint8_t FRAME_MARKER = 0x80;     // Set on the leading code byte
+    static const uint8_t FIRST_BLOCK_CODE = 0x7F; // Max code of the first block (126 data bytes)
+    static const uint8_t BLOCK_CODE = 0xFF;       // Max code of later blocks (254 data bytes)
+};
+
+#endif // COBS_H
@@ -0,0 +1,314 @@
+/**
+ * http_request_parser.h - Incremental HTTP request parser with a fixed buffer
+ *
+ * Bytes are fed as they come off the socket, in chunks of any size, and the
+ * parser answers "need more" until the header block is complete. Nothing is
+ * allocated: the request line and the few headers the AP uses (Host,
+ * Content-Type, Content-Length) are tokenized in place in one fixed buffer,
+ * every other header is skipped as it streams past without being stored.
+ *
+ * Header names are matched case-insensitively. Lines may end in CRLF or a bare
+ * LF. The request target must fit the buffer (414 otherwise), and the header
+ * block is limited to HTTP_MAX_HEADER_BYTES in total (431 otherwise).
+ *
+ * Usage:
+ *   HttpRequestParser<512> parser;
+ *   size_t used;
+ *   HttpParseStatus status = parser.feed(data, len, &used);   // Repeat while HTTP_PARSE_NEED_MORE
+ *   if (status == HTTP_PARSE_DONE) {
+ *       ... parser.method(), parser.path(), parser.host()        // Body starts at data + used
+ *   } else if (status == HTTP_PARSE_ERROR) {
+ *       ... answer with parser.errorStatus()
+ *   }
+ */
+
+#ifndef HTTP_REQUEST_PARSER_H
+#define HTTP_REQUEST_PARSER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#ifndef HTTP_MAX_HEADER_BYTES
+#define HTTP_MAX_HEADER_BYTES 8192      // Request line and headers, including skipped ones
+#endif
+
+enum HttpParseStatus {
+    HTTP_PARSE_NEED_MORE,       // Header block not complete yet, feed more bytes
+    HTTP_PARSE_DONE,            // Request line and headers parsed
+    HTTP_PARSE_ERROR            // Malformed or too large, see errorStatus()
+};
+
+template <size_t Size>
+class HttpRequestParser {
+    static_assert(Size >= 32 && Size < 0xFFFF, "offsets are 16-bit");
+
+public:
+    HttpRequestParser() {
+        reset();
+    }
+
+    /**
+     * Start over for a new request
+     */
+    void reset() {
+        state = REQUEST_LINE;
+        status = HTTP_PARSE_NEED_MORE;
+        kept = 0;
+        used = 0;
+        total = 0;
+        header = -1;
+        methodAt = NONE;
+        pathAt = NONE;
+        for (int i = 0; i < HEADER_COUNT; i++) {
+            valueAt[i] = NONE;
+        }
+        seen = 0;
+        length = 0;
+        errorCode = 0;
+        errorText = nullptr;
+        buf[0] = '\0';
+    }
+
+    /**
+     * Parse the next bytes of the request
+     *
+     * @param data Bytes received
+     * @param len Number of bytes
+     * @param consumed Set to the bytes used, less than len if the body (or the
+     *                 next request) follows the header block
+     * @return Status, stays DONE or ERROR until reset()
+     */
+    HttpParseStatus feed(const uint8_t* data, size_t len, size_t* consumed = nullptr) {
+        size_t pos = 0;
+        while (pos < len && status == HTTP_PARSE_NEED_MORE) {
+            if (state == SKIP) {
+                // Header not used, drop it up to the end of its line
+                const uint8_t* eol = (const uint8_t*)memchr(data + pos, '\n', len - pos);
+                size_t n = eol ? (size_t)(eol - (data + pos)) + 1 : len - pos;
+                if (!count(n)) {
+                    break;
+                }
+                pos += n;
+                if (eol) {
+                    state = HEADER_NAME;
+                }
+                continue;
+            }
+
+            // Copy up to the end of the line (or a name's colon) into the buffer in one go
+            const uint8_t* start = data + pos;
+            const uint8_t* stop = (const uint8_t*)memchr(start, '\n', len - pos);
+            if (state == HEADER_NAME) {
+                const uint8_t* colon = (const uint8_t*)memchr(start, ':', (stop ? stop : data + len) - start);
+                if (colon) {
+                    stop = colon;
+                }
+            }
+            size_t n = stop ? (size_t)(stop - start) : len - pos;
+            if (!count(n) || !append(start, n)) {
+                break;
+            }
+            pos += n;
+            if (!stop || state == SKIP) {
+                continue;       // Line goes on in the next chunk, or a name too long to be kept
+            }
+            if (!count(1)) {
+                break;
+            }
+            pos++;
+            if (*stop == ':') {
+                nameDone();
+            } else {
+                lineDone();
+            }
+        }
+        if (consumed) {
+            *consumed = pos;
+        }
+        return status;
+    }
+
+    HttpParseStatus result() const { return status; }
+
+    const char* method() const { return at(methodAt); }
+    const char* path() const { return at(pathAt); }
+    const char* host() const { return at(valueAt[HOST]); }
+    const char* contentType() const { return at(valueAt[CONTENT_TYPE]); }
+    size_t contentLength() const { return length; }
+
+    /**
+     * HTTP status to answer a request that failed to parse with (400, 414 or 431)
+     */
+    int errorStatus() const { return errorCode; }
+    const char* error() const { return errorText ? errorText : ""; }
+
+private:
+    enum State {
+        REQUEST_LINE,           // Collecting the request line
+        HEADER_NAME,            // Collecting a header name (or the empty line)
+        HEADER_VALUE,           // Collecting the value of a header that is kept
+        SKIP                    // Dropping the rest of a header that is not kept
+    };
+
+    enum Header { HOST, CONTENT_TYPE, CONTENT_LENGTH, HEADER_COUNT };
+
+    static const uint16_t NONE = 0xFFFF;
+
+    char buf[Size];
+    State state;
+    HttpParseStatus status;
+    size_t kept;                // Bytes of buf holding kept tokens
+    size_t used;                // Bytes of buf in use, kept tokens plus the line being collected
+    size_t total;               // Header block bytes seen
+    int header;                 // Header whose value is being collected
+    uint16_t methodAt;
+    uint16_t pathAt;
+    uint16_t valueAt[HEADER_COUNT];
+    uint8_t seen;               // Bit per header already parsed
+    size_t length;
+    int errorCode;
+    const char* errorText;
+
+    const char* at(uint16_t offset) const {
+        return offset == NONE ? "" : &buf[offset];
+    }
+
+    bool fail(int code, const char* text) {
+        status = HTTP_PARSE_ERROR;
+        errorCode = code;
+        errorText = text;
+        return false;
+    }
+
+    bool count(size_t n) {
+        total += n;
+        if (total > HTTP_MAX_HEADER_BYTES) {
+            return fail(431, "header block too large");
+        }
+        return true;
+    }
+
+    bool append(const uint8_t* data, size_t n) {
+        // One byte stays free for the terminator
+        if (used + n >= Size) {
+            if (state == HEADER_NAME) {
+                // Name longer than any header kept, drop the line
+                used = kept;
+                state = SKIP;
+                return true;
+            }
+            return fail(state == REQUEST_LINE ? 414 : 431,
+                        state == REQUEST_LINE ? "request line too long" : "header value too long");
+        }
+        memcpy(&buf[used], data, n);
+        used += n;
+        return true;
+    }
+
+    // Line without its ending (a trailing CR is dropped) at buf[kept..used)
+    size_t lineEnd() {
+        if (used > kept && buf[used - 1] == '\r') {
+            used--;
+        }
+        buf[used] = '\0';
+        return used;
+    }
+
+    static char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+
+    static bool nameIs(const char* name, size_t len, const char* lowerName) {
+        for (size_t i = 0; i < len; i++) {
+            if (lowerName[i] == '\0' || lower(name[i]) != lowerName[i]) {
+                return false;
+            }
+        }
+        return lowerName[len] == '\0';
+    }
+
+    void nameDone() {
+        const char* name = &buf[kept];
+        size_t len = used - kept;
+        used = kept;
+        header = nameIs(name, len, "host") ? HOST :
+                 nameIs(name, len, "content-type") ? CONTENT_TYPE :
+                 nameIs(name, len, "content-length") ? CONTENT_LENGTH : -1;
+        // The first of repeated headers wins
+        state = (header >= 0 && !(seen & (1 << header))) ? HEADER_VALUE : SKIP;
+    }
+
+    void lineDone() {
+        size_t end = lineEnd();
+        if (state == REQUEST_LINE) {
+            if (end == kept) {
+                return;         // Empty lines before the request line are ignored
+            }
+            requestLineDone(end);
+        } else if (state == HEADER_NAME) {
+            if (end == kept) {
+                status = HTTP_PARSE_DONE;
+            }
+            used = kept;        // Line without a colon, ignored
+        } else if (state == HEADER_VALUE) {
+            valueDone(end);
+            state = HEADER_NAME;
+        }
+    }
+
+    // METHOD SP target SP HTTP/x.y, the version is checked and dropped
+    void requestLineDone(size_t end) {
+        char* line = &buf[kept];
+        char* sp1 = (char*)memchr(line, ' ', end - kept);
+        char* sp2 = sp1 ? (char*)memchr(sp1 + 1, ' ', &buf[end] - (sp1 + 1)) : nullptr;
+        if (!sp1 || !sp2 || sp1 == line || sp2 == sp1 + 1 || strncmp(sp2 + 1, "HTTP/", 5) != 0) {
+            fail(400, "malformed request line");
+            return;
+        }
+        *sp1 = '\0';
+        *sp2 = '\0';
+        methodAt = (uint16_t)kept;
+        pathAt = (uint16_t)(sp1 + 1 - buf);
+        kept = used = (size_t)(sp2 + 1 - buf);
+        state = HEADER_NAME;
+    }
+
+    void valueDone(size_t end) {
+        // Trim the optional whitespace around the value
+        size_t from = kept;
+        while (from < end && (buf[from] == ' ' || buf[from] == '\t')) {
+            from++;
+        }
+        while (end > from && (buf[end - 1] == ' ' || buf[end - 1] == '\t')) {
+            end--;
+        }
+
+        seen |= 1 << header;
+        if (header == CONTENT_LENGTH) {
+            size_t value = 0;
+            if (from == end) {
+                fail(400, "invalid Content-Length");
+                return;
+            }
+            for (size_t i = from; i < end; i++) {
+                if (buf[i] < '0' || buf[i] > '9' || value > (SIZE_MAX - 9) / 10) {
+                    fail(400, "invalid Content-Length");
+                    return;
+                }
+                value = value * 10 + (buf[i] - '0');
+            }
+            length = value;
+            used = kept;
+            return;
+        }
+
+        memmove(&buf[kept], &buf[from], end - from);
+        valueAt[header] = (uint16_t)kept;
+        kept += end - from;
+        buf[kept++] = '\0';
+        used = kept;
+    }
+};
+
+#endif // HTTP_REQUEST_PARSER_H
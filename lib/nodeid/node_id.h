@@ -0,0 +1,142 @@
+/**
+ * node_id.h - Binary mesh node IDs and an index from node ID to contact
+ *
+ * The WDP gateways identify mesh nodes by the first 4 bytes of their public
+ * key, packed big-endian into a MeshNodeId. Its value is the same as the hex
+ * prefix used in logs and config ("a1b2c3d4" -> 0xa1b2c3d4).
+ *
+ * NodeIdIndex maps node IDs to entries (contacts) with open addressing and a
+ * short probe window. It is a cache: when the window is full the home slot is
+ * overwritten, so callers fall back to a full lookup on a miss.
+ *
+ * Usage:
+ *   MeshNodeId id = meshNodeId(contact->id.pub_key);
+ *   NodeIdIndex<ContactInfo, 64> index;
+ *   index.put(id, contact);
+ *   ContactInfo* c = index.find(id);     // nullptr if not cached
+ */
+
+#ifndef NODE_ID_H
+#define NODE_ID_H
+
+#include <cstdint>
+#include <cstddef>
+
+typedef uint32_t MeshNodeId;
+
+#define MESH_NODE_ID_PREFIX_LEN 4       // Public key bytes in a node ID
+
+/**
+ * Node ID of a public key (or of its first 4 bytes)
+ */
+inline MeshNodeId meshNodeId(const uint8_t* pubKey) {
+    return ((uint32_t)pubKey[0] << 24) | ((uint32_t)pubKey[1] << 16) |
+           ((uint32_t)pubKey[2] << 8) | pubKey[3];
+}
+
+/**
+ * Public key prefix of a node ID
+ */
+inline void meshNodePrefix(MeshNodeId id, uint8_t* prefix) {
+    prefix[0] = (uint8_t)(id >> 24);
+    prefix[1] = (uint8_t)(id >> 16);
+    prefix[2] = (uint8_t)(id >> 8);
+    prefix[3] = (uint8_t)id;
+}
+
+/**
+ * Node ID from a hex public key or prefix (e.g. a configured node), 0 if not hex
+ */
+inline MeshNodeId meshNodeIdFromHex(const char* hex) {
+    MeshNodeId id = 0;
+    for (int i = 0; i < MESH_NODE_ID_PREFIX_LEN * 2; i++) {
+        char c = hex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else {
+            return 0;
+        }
+        id = (id << 4) | nibble;
+    }
+    return id;
+}
+
+template <typename T, int Slots>
+class NodeIdIndex {
+    static_assert(Slots >= 4 && (Slots & (Slots - 1)) == 0, "slots must be a power of two");
+
+public:
+    NodeIdIndex() {
+        clear();
+    }
+
+    void clear() {
+        for (int i = 0; i < Slots; i++) {
+            entries[i] = nullptr;
+        }
+    }
+
+    /**
+     * Cached entry for a node ID, or nullptr
+     */
+    T* find(MeshNodeId id) const {
+        int home = homeSlot(id);
+        for (int i = 0; i < PROBES; i++) {
+            int slot = (home + i) & (Slots - 1);
+            if (entries[slot] && ids[slot] == id) {
+                return entries[slot];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Cache an entry, replacing the one for the same ID
+     */
+    void put(MeshNodeId id, T* entry) {
+        int home = homeSlot(id);
+        int target = -1;
+        for (int i = 0; i < PROBES; i++) {
+            int slot = (home + i) & (Slots - 1);
+            if (entries[slot] && ids[slot] == id) {
+                target = slot;
+                break;
+            }
+            if (!entries[slot] && target < 0) {
+                target = slot;
+            }
+        }
+        if (target < 0) {
+            target = home;
+        }
+        ids[target] = id;
+        entries[target] = entry;
+    }
+
+    void remove(MeshNodeId id) {
+        int home = homeSlot(id);
+        for (int i = 0; i < PROBES; i++) {
+            int slot = (home + i) & (Slots - 1);
+            if (entries[slot] && ids[slot] == id) {
+                entries[slot] = nullptr;
+            }
+        }
+    }
+
+private:
+    static const int PROBES = 4;
+
+    MeshNodeId ids[Slots];
+    T* entries[Slots];
+
+    static int homeSlot(MeshNodeId id) {
+        return (int)((id * 0x9E3779B1u) >> 16) & (Slots - 1);
+    }
+};
+
+#endif // NODE_ID_H
@@ -0,0 +1,102 @@
+/**
+ * rtt_estimator.h - Smoothed round trip time and timeout (Jacobson/Karels)
+ *
+ * Keeps the smoothed RTT and its mean deviation from round trip samples,
+ * in fixed point like the classic TCP implementation:
+ *   srtt   += (sample - srtt) / 8
+ *   rttvar += (|sample - srtt| - rttvar) / 4
+ *   timeout = srtt + 4 * rttvar
+ * The first sample sets srtt = sample and rttvar = sample / 2.
+ *
+ * Each timeout without a new sample doubles the timeout (exponential
+ * backoff), the next sample undoes it. Timeouts are clamped to the
+ * range given at construction.
+ *
+ * Usage:
+ *   RttEstimator rtt(500, 60000);
+ *   rtt.sample(1800);                   // ACK after 1.8 s
+ *   uint32_t t = rtt.timeout(15000);    // 15000 until there is a sample
+ */
+
+#ifndef RTT_ESTIMATOR_H
+#define RTT_ESTIMATOR_H
+
+#include <cstdint>
+
+class RttEstimator {
+public:
+    RttEstimator(uint32_t minTimeoutMs = 500, uint32_t maxTimeoutMs = 60000)
+        : minTimeout(minTimeoutMs), maxTimeout(maxTimeoutMs) {
+        reset();
+    }
+
+    /**
+     * Forget all samples (e.g. the path changed)
+     */
+    void reset() {
+        srtt8 = 0;
+        rttvar4 = 0;
+        samples = 0;
+        backoff = 0;
+    }
+
+    /**
+     * Add a round trip sample in ms
+     */
+    void sample(uint32_t rttMs) {
+        if (rttMs > maxTimeout) {
+            rttMs = maxTimeout;
+        }
+        if (samples == 0) {
+            srtt8 = rttMs << 3;
+            rttvar4 = rttMs << 1;
+        } else {
+            int32_t err = (int32_t)rttMs - (int32_t)(srtt8 >> 3);
+            srtt8 += err;
+            if (err < 0) {
+                err = -err;
+            }
+            rttvar4 += err - (int32_t)(rttvar4 >> 2);
+        }
+        if (samples < 0xFFFF) {
+            samples++;
+        }
+        backoff = 0;
+    }
+
+    /**
+     * A timeout expired without an answer, back off until the next sample
+     */
+    void timedOut() {
+        if (backoff < 6) {
+            backoff++;
+        }
+    }
+
+    bool hasSamples() const { return samples > 0; }
+    uint16_t sampleCount() const { return samples; }
+    uint32_t srtt() const { return srtt8 >> 3; }
+    uint32_t rttvar() const { return rttvar4 >> 2; }
+
+    /**
+     * Current timeout in ms, or fallbackMs (backed off) before the first sample
+     */
+    uint32_t timeout(uint32_t fallbackMs) const {
+        uint32_t base = samples ? (srtt8 >> 3) + rttvar4 : fallbackMs;
+        uint32_t t = (base < minTimeout) ? minTimeout : base;
+        for (int i = 0; i < backoff && t < maxTimeout; i++) {
+            t <<= 1;
+        }
+        return (t > maxTimeout) ? maxTimeout : t;
+    }
+
+private:
+    uint32_t minTimeout;
+    uint32_t maxTimeout;
+    uint32_t srtt8;     // Smoothed RTT * 8
+    uint32_t rttvar4;   // Mean deviation * 4
+    uint16_t samples;
+    uint8_t backoff;    // Timeouts since the last sample
+};
+
+#endif // RTT_ESTIMATOR_H
@@ -0,0 +1,176 @@
+/**
+ * spsc_ring.h - Single-producer/single-consumer ring of variable-length records
+ *
+ * Records are stored back to back in one byte arena, each behind a 4-byte
+ * length word and padded to 4 bytes, so a struct at the start of a record is
+ * aligned. A record that doesn't fit before the end of the arena leaves a
+ * wrap marker and starts over at the beginning, so every record is contiguous.
+ *
+ * The write and read positions are free-running counters, owned by the
+ * producer and the consumer respectively and published with release/acquire,
+ * so one task may push while another pops without a lock. The consumer reads
+ * a record in place (and may modify it) until it pops it.
+ *
+ * Records of up to Size / 2 - 4 bytes always fit once the ring has drained.
+ *
+ * Usage:
+ *   SpscRing<4096> ring;
+ *   uint8_t* rec = ring.reserve(len);       // Producer
+ *   if (rec) { memcpy(rec, data, len); ring.commit(len); }
+ *
+ *   size_t len;
+ *   uint8_t* rec = ring.front(&len);        // Consumer
+ *   if (rec) { ...; ring.pop(); }
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+
+template <size_t Size>
+class SpscRing {
+    static_assert(Size >= 16 && (Size & (Size - 1)) == 0, "size must be a power of two");
+    static_assert(Size <= 0x80000000u, "positions are 32-bit");
+
+public:
+    SpscRing() : head(0), tail(0), reservedSkip(0), reservedLen(0) { }
+
+    /**
+     * Contiguous space for a record of len bytes (producer)
+     *
+     * Nothing is visible to the consumer until commit().
+     *
+     * @return Start of the record, or nullptr if the ring is too full
+     */
+    uint8_t* reserve(size_t len) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        size_t need = HEADER + padded(len);
+        size_t pos = h & MASK;
+        size_t skip = (need > Size - pos) ? Size - pos : 0;
+        if (skip + need > Size - (h - t)) {
+            return nullptr;
+        }
+        reservedSkip = skip;
+        reservedLen = len;
+        return &arena[(skip ? 0 : pos) + HEADER];
+    }
+
+    /**
+     * Publish the record from the last reserve() (producer)
+     *
+     * @param len Bytes actually written, at most the reserved length
+     */
+    void commit(size_t len) {
+        if (len > reservedLen) {
+            len = reservedLen;
+        }
+        uint32_t h = head.load(std::memory_order_relaxed);
+        size_t pos = h & MASK;
+        if (reservedSkip) {
+            writeWord(pos, WRAP);
+            pos = 0;
+        }
+        writeWord(pos, (uint32_t)len);
+        head.store(h + reservedSkip + HEADER + padded(len), std::memory_order_release);
+        reservedSkip = 0;
+        reservedLen = 0;
+    }
+
+    /**
+     * Copy a record in (producer)
+     *
+     * @return false if the ring is too full
+     */
+    bool push(const void* data, size_t len) {
+        uint8_t* rec = reserve(len);
+        if (!rec) {
+            return false;
+        }
+        memcpy(rec, data, len);
+        commit(len);
+        return true;
+    }
+
+    /**
+     * Oldest record, stays in the ring until pop() (consumer)
+     *
+     * @param len Set to the record length
+     * @return Start of the record, or nullptr if the ring is empty
+     */
+    uint8_t* front(size_t* len) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        size_t pos = recordPos(t);
+        *len = readWord(pos);
+        return &arena[pos + HEADER];
+    }
+
+    /**
+     * Drop the oldest record (consumer)
+     */
+    void pop() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return;
+        }
+        size_t pos = recordPos(t);
+        tail.store(t + HEADER + padded(readWord(pos)), std::memory_order_release);
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Bytes in use, including record headers and padding
+     */
+    size_t used() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() { return Size; }
+
+private:
+    static const size_t MASK = Size - 1;
+    static const size_t HEADER = 4;
+    static const uint32_t WRAP = 0xFFFFFFFFu;   // Rest of the arena unused, next record at 0
+
+    alignas(4) uint8_t arena[Size];
+    std::atomic<uint32_t> head;     // Written by the producer
+    std::atomic<uint32_t> tail;     // Written by the consumer
+    size_t reservedSkip;            // Producer only
+    size_t reservedLen;
+
+    static size_t padded(size_t len) {
+        return (len + 3) & ~(size_t)3;
+    }
+
+    uint32_t readWord(size_t pos) const {
+        uint32_t word;
+        memcpy(&word, &arena[pos], sizeof(word));
+        return word;
+    }
+
+    void writeWord(size_t pos, uint32_t word) {
+        memcpy(&arena[pos], &word, sizeof(word));
+    }
+
+    // Arena position of the record at read position t, t steps over a wrap marker
+    size_t recordPos(uint32_t& t) const {
+        size_t pos = t & MASK;
+        if (readWord(pos) == WRAP) {
+            t += (uint32_t)(Size - pos);
+            pos = 0;
+        }
+        return pos;
+    }
+};
+
+#endif // SPSC_RING_H
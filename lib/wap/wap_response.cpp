@@ -374,8 +374,13 @@ bool WAPResponse::decodeWithoutTID(const uint8_t* data, size_t len, HTTPResponse
     response->rawHeaders = &data[pos];
     response->rawHeadersLen = headersLen;
     
+    // Header block cut off (a first fragment), see WSPReplyParser for partial PDUs
+    if (pos + headersLen > len) {
+        return false;
+    }
+    
     // Parse headers
-    if (headersLen > 0 && pos + headersLen <= len) {
+    if (headersLen > 0) {
         parseHeaders(&data[pos], headersLen, response);
         pos += headersLen;
     }
@@ -35,7 +35,7 @@ public:
      * @param data PDU data (transaction ID already stripped)
      * @param len Length of data
      * @param response Output: Decoded HTTP response
-     * @return true if decoding succeeded
+     * @return true if decoding succeeded, false if not a Reply or the header block is cut off
      */
     static bool decodeWithoutTID(const uint8_t* data, size_t len, HTTPResponse* response);
     
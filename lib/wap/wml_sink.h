@@ -0,0 +1,145 @@
+/**
+ * wml_sink.h - Destinations for decompiled WML text
+ *
+ * The WMLC decompiler writes its text to a WMLSink as it goes, so where the
+ * text ends up is the caller's choice:
+ *   WMLBufferSink      - a caller's char buffer, reports text that didn't fit
+ *   WMLCountingSink    - nothing, counts the bytes (exact Content-Length without the text)
+ *   WMLClientSink      - a socket (WiFiClient, or anything with write(const uint8_t*, size_t)),
+ *                        in writes of Size bytes, however small the pieces of each token
+ *
+ * Usage:
+ *   WMLCountingSink counter;
+ *   WMLCDecompiler::decompile(wmlc, wmlcLen, counter);      // counter.count() bytes of WML
+ *
+ *   WMLClientSink<WiFiClient, 1436> out;
+ *   out.begin(&client);
+ *   WMLCDecompiler::decompile(wmlc, wmlcLen, out);
+ *   out.flush();
+ */
+
+#ifndef WML_SINK_H
+#define WML_SINK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+class WMLSink {
+public:
+    virtual ~WMLSink() { }
+
+    /**
+     * Take the next piece of text (not terminated, any length)
+     */
+    virtual void write(const char* text, size_t len) = 0;
+};
+
+/**
+ * Text into a fixed buffer, kept terminated
+ */
+class WMLBufferSink : public WMLSink {
+public:
+    WMLBufferSink(char* buffer, size_t size) : buf(buffer), cap(size), used(0), lost(false) {
+        if (cap > 0) buf[0] = '\0';
+    }
+
+    void write(const char* text, size_t len) {
+        if (used + len >= cap) {
+            // Keep what fits, but remember the text is incomplete
+            lost = true;
+            if (cap == 0) return;
+            len = cap - 1 - used;
+        }
+        memcpy(&buf[used], text, len);
+        used += len;
+        buf[used] = '\0';
+    }
+
+    size_t length() const { return used; }
+
+    /**
+     * Some text didn't fit the buffer
+     */
+    bool overflowed() const { return lost; }
+
+private:
+    char* buf;
+    size_t cap;
+    size_t used;
+    bool lost;
+};
+
+/**
+ * Counts the text without keeping it
+ */
+class WMLCountingSink : public WMLSink {
+public:
+    WMLCountingSink() : total(0) { }
+
+    void write(const char*, size_t len) { total += len; }
+
+    size_t count() const { return total; }
+
+private:
+    size_t total;
+};
+
+/**
+ * Text to a client, collected into writes of Size bytes (one TCP segment: 1436
+ * is the ESP32's lwIP MSS). Call flush() when the text so far should reach the
+ * client, it sends the shorter rest.
+ */
+template <typename Client, size_t Size>
+class WMLClientSink : public WMLSink {
+public:
+    WMLClientSink() : client(nullptr), used(0), total(0) { }
+
+    /**
+     * Send the following text to client (anything still collected goes to the previous one)
+     */
+    void begin(Client* c) {
+        flush();
+        client = c;
+    }
+
+    void write(const char* text, size_t len) {
+        while (len > 0) {
+            size_t n = Size - used < len ? Size - used : len;
+            memcpy(&buf[used], text, n);
+            used += n;
+            text += n;
+            len -= n;
+            if (used == Size) {
+                flush();
+            }
+        }
+    }
+
+    void flush() {
+        if (used > 0) {
+            send(buf, used);
+            used = 0;
+        }
+    }
+
+    /**
+     * Bytes handed to the clients so far
+     */
+    size_t sent() const { return total; }
+
+private:
+    Client* client;
+    size_t used;
+    size_t total;
+    char buf[Size];
+
+    void send(const char* data, size_t len) {
+        if (client) {
+            client->write((const uint8_t*)data, len);
+        }
+        total += len;
+    }
+};
+
+#endif // WML_SINK_H
@@ -0,0 +1,976 @@
+/**
+ * wmlc_compiler.cpp - WML to WMLC (Compiled WML) Compiler Implementation
+ *
+ * Document layout (WAP-192-WBXML 5.3):
+ *   Version(0x03) PublicId(mb) Charset(mb, 0x6A UTF-8) StringTableLen(mb) StringTable Body
+ *
+ * The body is built as a list of ops while the text is parsed: token bytes,
+ * and references to the strings kept in the text pool. finish() picks the
+ * string table and then writes every string reference in its final form.
+ */
+
+#include "wmlc_compiler.h"
+#include "wmlc_decompiler.h"
+#include <cstring>
+#include <cstdlib>
+
+static const uint8_t WBXML_VERSION_1_3 = 0x03;
+static const uint8_t CHARSET_UTF8 = 0x6A;
+static const unsigned long PUBLIC_ID_WML_1_1 = 0x04;
+static const unsigned long PUBLIC_ID_WML_1_2 = 0x09;
+static const unsigned long PUBLIC_ID_WML_1_3 = 0x0A;
+
+static const uint16_t NO_COST = 0xFFFF;
+
+static size_t mbLen(unsigned long value) {
+    size_t n = 1;
+    while (value >>= 7) {
+        n++;
+    }
+    return n;
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool contains(const char* data, size_t len, const char* word) {
+    size_t wordLen = strlen(word);
+    for (size_t i = 0; i + wordLen <= len; i++) {
+        if (memcmp(&data[i], word, wordLen) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Encode a code point as UTF-8, returns the number of bytes
+static size_t putUtf8(unsigned long cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Output with bounds checking, stops writing once full
+struct WMLCWriter {
+    uint8_t* out;
+    size_t size;
+    size_t len;
+    bool full;
+
+    void byte(uint8_t b) {
+        if (len < size) {
+            out[len++] = b;
+        } else {
+            full = true;
+        }
+    }
+
+    void bytes(const char* data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            byte((uint8_t)data[i]);
+        }
+    }
+
+    void mb(unsigned long value) {
+        uint8_t buf[5];
+        size_t n = 0;
+        do {
+            buf[n++] = value & 0x7F;
+            value >>= 7;
+        } while (value > 0);
+        while (n > 1) {
+            byte(buf[--n] | 0x80);
+        }
+        byte(buf[0]);
+    }
+};
+
+WMLCCompiler::WMLCCompiler() {
+    reset();
+}
+
+void WMLCCompiler::reset() {
+    state = TEXT;
+    errorText = nullptr;
+    publicId = PUBLIC_ID_WML_1_1;
+    nameLen = 0;
+    attrNameLen = 0;
+    quote = 0;
+    markupMatch = 0;
+    runLen = 0;
+    segmentCount = 0;
+    textLen = 0;
+    stringCount = 0;
+    opCount = 0;
+    depth = 0;
+    candidateCount = 0;
+    tableLen = 0;
+}
+
+void WMLCCompiler::fail(const char* text) {
+    if (state != FAILED) {
+        state = FAILED;
+        errorText = text;
+    }
+}
+
+void WMLCCompiler::addOp(uint8_t kind, uint8_t token, size_t str) {
+    if (opCount >= WMLC_COMPILER_MAX_OPS) {
+        fail("document has too many tokens");
+        return;
+    }
+    ops[opCount].kind = kind;
+    ops[opCount].token = token;
+    ops[opCount].str = (uint16_t)str;
+    opCount++;
+}
+
+int WMLCCompiler::addString(const char* data, size_t len, bool whole) {
+    for (size_t i = 0; i < stringCount; i++) {
+        if (strings[i].len == len && memcmp(&text[strings[i].offset], data, len) == 0) {
+            if (whole) strings[i].wholeUses++;
+            else strings[i].textUses++;
+            return (int)i;
+        }
+    }
+    if (stringCount >= WMLC_COMPILER_MAX_STRINGS) {
+        fail("document has too many strings");
+        return -1;
+    }
+    if (textLen + len > WMLC_COMPILER_MAX_TEXT) {
+        fail("document has too much text");
+        return -1;
+    }
+    String& s = strings[stringCount];
+    memset(&s, 0, sizeof(s));
+    s.offset = (uint16_t)textLen;
+    s.len = (uint16_t)len;
+    if (whole) s.wholeUses = 1;
+    else s.textUses = 1;
+    memcpy(&text[textLen], data, len);
+    textLen += len;
+    return (int)stringCount++;
+}
+
+bool WMLCCompiler::appendRun(char c) {
+    if (runLen >= sizeof(run)) {
+        fail(state == ATTR_VALUE ? "attribute value too long" : "text run too long");
+        return false;
+    }
+    run[runLen++] = c;
+    return true;
+}
+
+bool WMLCCompiler::isNameChar(char c) const {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == ':' || c == '-' || c == '.';
+}
+
+WMLCCompileStatus WMLCCompiler::feed(const char* data, size_t len) {
+    size_t pos = 0;
+    while (pos < len && state != FAILED) {
+        if (state == TEXT || state == ATTR_VALUE) {
+            // Copy up to the end of the text run or value in one go
+            char stop = state == TEXT ? '<' : quote;
+            const char* end = (const char*)memchr(&data[pos], stop, len - pos);
+            size_t n = end ? (size_t)(end - &data[pos]) : len - pos;
+            if (state == ATTR_VALUE && memchr(&data[pos], '<', n)) {
+                fail("'<' in attribute value");
+                break;
+            }
+            if (runLen + n > sizeof(run)) {
+                fail(state == ATTR_VALUE ? "attribute value too long" : "text run too long");
+                break;
+            }
+            memcpy(&run[runLen], &data[pos], n);
+            runLen += n;
+            pos += n;
+            if (!end) {
+                break;
+            }
+        }
+        markupChar(data[pos++]);
+    }
+    return result();
+}
+
+void WMLCCompiler::markupChar(char c) {
+    switch (state) {
+        case TEXT:
+            // '<', the rest of the run was copied by feed()
+            flushText(false);
+            state = TAG_START;
+            break;
+
+        case TAG_START:
+            if (c == '/') {
+                nameLen = 0;
+                markupMatch = 0;
+                state = END_TAG;
+            } else if (c == '!') {
+                nameLen = 0;
+                state = MARKUP_DECL;
+            } else if (c == '?') {
+                markupMatch = 0;
+                state = PI;
+            } else if (isNameChar(c)) {
+                name[0] = c;
+                nameLen = 1;
+                state = TAG_NAME;
+            } else {
+                fail("'<' does not start a tag");
+            }
+            break;
+
+        case TAG_NAME:
+            if (isNameChar(c)) {
+                if (nameLen >= sizeof(name)) {
+                    fail("element name too long");
+                    break;
+                }
+                name[nameLen++] = c;
+            } else if (isSpace(c) || c == '/' || c == '>') {
+                startElement();
+                state = ATTRS;
+                if (!isSpace(c)) {
+                    markupChar(c);
+                }
+            } else {
+                fail("malformed start tag");
+            }
+            break;
+
+        case END_TAG:
+            // markupMatch is set once whitespace follows the name
+            if (isNameChar(c) && !markupMatch) {
+                if (nameLen >= sizeof(name)) {
+                    fail("element name too long");
+                    break;
+                }
+                name[nameLen++] = c;
+            } else if (c == '>' && nameLen > 0) {
+                endElement();
+                state = TEXT;
+            } else if (isSpace(c) && nameLen > 0) {
+                markupMatch = 1;
+            } else {
+                fail("malformed end tag");
+            }
+            break;
+
+        case ATTRS:
+            if (isSpace(c)) {
+                break;
+            }
+            if (c == '/') {
+                state = SELF_CLOSE;
+            } else if (c == '>') {
+                closeStartTag(false);
+                state = TEXT;
+            } else if (isNameChar(c)) {
+                attrName[0] = c;
+                attrNameLen = 1;
+                state = ATTR_NAME;
+            } else {
+                fail("malformed attribute");
+            }
+            break;
+
+        case ATTR_NAME:
+            if (isNameChar(c)) {
+                if (attrNameLen >= sizeof(attrName)) {
+                    fail("attribute name too long");
+                    break;
+                }
+                attrName[attrNameLen++] = c;
+            } else if (c == '=') {
+                state = ATTR_EQ;
+            } else if (isSpace(c)) {
+                state = ATTR_AFTER_NAME;
+            } else {
+                fail("malformed attribute");
+            }
+            break;
+
+        case ATTR_AFTER_NAME:
+            if (c == '=') {
+                state = ATTR_EQ;
+            } else if (!isSpace(c)) {
+                fail("attribute without value");
+            }
+            break;
+
+        case ATTR_EQ:
+            if (c == '"' || c == '\'') {
+                quote = c;
+                runLen = 0;
+                state = ATTR_VALUE;
+            } else if (!isSpace(c)) {
+                fail("attribute value not quoted");
+            }
+            break;
+
+        case ATTR_VALUE:
+            // Closing quote, the value was copied by feed()
+            attribute();
+            if (state != FAILED) {
+                state = ATTRS;
+            }
+            break;
+
+        case SELF_CLOSE:
+            if (c == '>') {
+                closeStartTag(true);
+                state = TEXT;
+            } else {
+                fail("malformed empty-element tag");
+            }
+            break;
+
+        case MARKUP_DECL: {
+            // "<!--", "<![CDATA[" or "<!DOCTYPE"
+            name[nameLen++] = c;
+            bool comment = nameLen <= 2 && memcmp(name, "--", nameLen) == 0;
+            bool cdata = nameLen <= 7 && memcmp(name, "[CDATA[", nameLen) == 0;
+            bool doctypeDecl = nameLen <= 7 && memcmp(name, "DOCTYPE", nameLen) == 0;
+            if (comment && nameLen == 2) {
+                markupMatch = 0;
+                state = COMMENT;
+            } else if (cdata && nameLen == 7) {
+                markupMatch = 0;
+                runLen = 0;
+                state = CDATA;
+            } else if (doctypeDecl && nameLen == 7) {
+                runLen = 0;
+                state = DOCTYPE;
+            } else if (!comment && !cdata && !doctypeDecl) {
+                fail("unknown markup declaration");
+            }
+            break;
+        }
+
+        case COMMENT:
+            // Ends at "-->"
+            if (c == '>' && markupMatch >= 2) {
+                state = TEXT;
+            } else {
+                markupMatch = c == '-' ? markupMatch + 1 : 0;
+            }
+            break;
+
+        case CDATA:
+            // Ends at "]]>", the content is text as is
+            if (c == '>' && markupMatch >= 2) {
+                runLen -= 2;
+                flushText(true);
+                state = TEXT;
+                break;
+            }
+            markupMatch = c == ']' ? markupMatch + 1 : 0;
+            appendRun(c);
+            break;
+
+        case DOCTYPE:
+            if (c == '>') {
+                doctype();
+                state = TEXT;
+            } else if (runLen < sizeof(run)) {
+                run[runLen++] = c;
+            }
+            break;
+
+        case PI:
+            // Processing instruction or XML declaration, ends at "?>"
+            if (c == '>' && markupMatch) {
+                state = TEXT;
+            } else {
+                markupMatch = c == '?';
+            }
+            break;
+
+        case FAILED:
+            break;
+    }
+
+    // An error in an element or attribute handler outlasts the state set after it
+    if (errorText) {
+        state = FAILED;
+    }
+}
+
+void WMLCCompiler::doctype() {
+    if (contains(run, runLen, "WML 1.3")) {
+        publicId = PUBLIC_ID_WML_1_3;
+    } else if (contains(run, runLen, "WML 1.2")) {
+        publicId = PUBLIC_ID_WML_1_2;
+    } else {
+        publicId = PUBLIC_ID_WML_1_1;
+    }
+    runLen = 0;
+}
+
+bool WMLCCompiler::decodeRun(const char* data, size_t len, bool collapse, bool raw) {
+    // Split the run into strings and variables, the strings with their entities
+    // resolved and, in content, whitespace collapsed to one space. Whitespace
+    // alone across a line break is indentation and goes.
+    size_t out = 0;
+    size_t segStart = 0;
+    bool space = false;
+    segmentCount = 0;
+
+    if (collapse) {
+        bool blank = true;
+        for (size_t i = 0; i < len && blank; i++) {
+            blank = isSpace(data[i]);
+        }
+        if (blank && memchr(data, '\n', len)) {
+            return true;
+        }
+    }
+
+    auto closeSegment = [&](uint8_t var) {
+        if ((out > segStart || var) && segmentCount < WMLC_COMPILER_MAX_SEGMENTS) {
+            segments[segmentCount].start = (uint16_t)segStart;
+            segments[segmentCount].len = (uint16_t)(out - segStart);
+            segments[segmentCount].var = var;
+            segmentCount++;
+        } else if (out > segStart || var) {
+            fail("too many variables in one run");
+        }
+        segStart = out;
+    };
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (raw) {
+            decoded[out++] = c;
+            continue;
+        }
+        if (collapse && isSpace(c)) {
+            space = true;
+            continue;
+        }
+        if (space) {
+            decoded[out++] = ' ';
+            space = false;
+        }
+
+        if (c == '&') {
+            const char* semi = (const char*)memchr(&data[i], ';', len - i < 12 ? len - i : 12);
+            if (!semi) {
+                fail("unterminated entity");
+                return false;
+            }
+            const char* ent = &data[i + 1];
+            size_t entLen = semi - ent;
+            unsigned long cp = 0;
+            if (entLen >= 2 && ent[0] == '#') {
+                char* end;
+                cp = (ent[1] == 'x' || ent[1] == 'X') ? strtoul(&ent[2], &end, 16) : strtoul(&ent[1], &end, 10);
+                if (end != semi) cp = 0;
+            } else if (entLen == 3 && memcmp(ent, "amp", 3) == 0) cp = '&';
+            else if (entLen == 2 && memcmp(ent, "lt", 2) == 0) cp = '<';
+            else if (entLen == 2 && memcmp(ent, "gt", 2) == 0) cp = '>';
+            else if (entLen == 4 && memcmp(ent, "quot", 4) == 0) cp = '"';
+            else if (entLen == 4 && memcmp(ent, "apos", 4) == 0) cp = '\'';
+            else if (entLen == 4 && memcmp(ent, "nbsp", 4) == 0) cp = 0xA0;
+            else if (entLen == 3 && memcmp(ent, "shy", 3) == 0) cp = 0xAD;
+            if (cp == 0 || cp > 0x10FFFF) {
+                fail("unknown entity");
+                return false;
+            }
+            out += putUtf8(cp, &decoded[out]);
+            i = semi - data;
+            continue;
+        }
+
+        if (c == '$' && i + 1 < len && data[i + 1] == '$') {
+            decoded[out++] = '$';
+            i++;
+            continue;
+        }
+        if (c == '$' && i + 1 < len && (data[i + 1] == '(' || isNameChar(data[i + 1]))) {
+            // Variable: $name, $(name) or $(name:conversion)
+            bool paren = data[i + 1] == '(';
+            size_t nameStart = paren ? i + 2 : i + 1;
+            size_t nameEnd = nameStart;
+            while (nameEnd < len && (isNameChar(data[nameEnd]) && data[nameEnd] != ':')) {
+                nameEnd++;
+            }
+            uint8_t token = WMLCDecompiler::WBXML_EXT_I_0;
+            size_t end = nameEnd;
+            if (paren) {
+                const char* close = (const char*)memchr(&data[nameEnd], ')', len - nameEnd);
+                if (!close) {
+                    fail("unterminated variable");
+                    return false;
+                }
+                end = close - data + 1;
+                if (data[nameEnd] == ':') {
+                    // escape, unesc or noesc, or their first letter
+                    char conv = data[nameEnd + 1] | 0x20;
+                    if (conv == 'e') token = WMLCDecompiler::WBXML_EXT_I_1;
+                    else if (conv == 'u') token = WMLCDecompiler::WBXML_EXT_I_2;
+                } else if (data[nameEnd] != ')') {
+                    fail("malformed variable");
+                    return false;
+                }
+            }
+            if (nameEnd == nameStart) {
+                fail("variable without a name");
+                return false;
+            }
+            closeSegment(0);
+            memcpy(&decoded[out], &data[nameStart], nameEnd - nameStart);
+            out += nameEnd - nameStart;
+            closeSegment(token);
+            i = end - 1;
+            continue;
+        }
+        decoded[out++] = c;
+    }
+    if (space) {
+        decoded[out++] = ' ';
+    }
+    closeSegment(0);
+    return state != FAILED;
+}
+
+void WMLCCompiler::flushText(bool raw) {
+    if (runLen == 0) {
+        return;
+    }
+    if (depth == 0) {
+        // Only whitespace around the root element
+        for (size_t i = 0; i < runLen; i++) {
+            if (!isSpace(run[i])) {
+                fail("text outside the root element");
+                return;
+            }
+        }
+        runLen = 0;
+        return;
+    }
+    bool ok = decodeRun(run, runLen, !raw, raw);
+    runLen = 0;
+    if (!ok) {
+        return;
+    }
+    for (size_t i = 0; i < segmentCount; i++) {
+        const Segment& seg = segments[i];
+        int s = addString(&decoded[seg.start], seg.len, seg.var != 0);
+        if (s < 0) {
+            return;
+        }
+        addOp(seg.var ? OP_VARIABLE : OP_STRING, seg.var, s);
+    }
+}
+
+void WMLCCompiler::startElement() {
+    if (depth >= WMLC_MAX_DEPTH) {
+        fail("elements nested too deeply");
+        return;
+    }
+    int token = -1;
+    for (int t = 0x05; t <= 0x3F && token < 0; t++) {
+        const WMLCToken& elem = WMLCDecompiler::element((uint8_t)t);
+        if (elem.name && elem.nameLen == nameLen && memcmp(elem.name, name, nameLen) == 0) {
+            token = t;
+        }
+    }
+    openTag[depth] = (uint16_t)opCount;
+    if (token >= 0) {
+        addOp(OP_TOKEN, (uint8_t)token);
+    } else {
+        // Element without a token, named from the string table
+        int s = addString(name, nameLen, true);
+        if (s < 0) {
+            return;
+        }
+        strings[s].literal = 1;
+        addOp(OP_LITERAL, WMLCDecompiler::WBXML_LITERAL, s);
+    }
+    openContent[depth] = 0;
+    depth++;
+}
+
+void WMLCCompiler::attribute() {
+    Op& tag = ops[openTag[depth - 1]];
+    tag.token |= WMLCDecompiler::TAG_HAS_ATTRS;
+
+    bool ok = decodeRun(run, runLen, false, false);
+    runLen = 0;
+    if (!ok) {
+        return;
+    }
+
+    // Attribute start: the token of this name whose value prefix is the longest match
+    const char* first = segmentCount > 0 && segments[0].var == 0 ? &decoded[segments[0].start] : nullptr;
+    size_t firstLen = first ? segments[0].len : 0;
+    int start = -1;
+    size_t prefixLen = 0;
+    for (int t = 0x05; t < 0x80; t++) {
+        const WMLCToken& attr = WMLCDecompiler::attribute((uint8_t)t);
+        if (!attr.name || attr.nameLen != attrNameLen || memcmp(attr.name, attrName, attrNameLen) != 0) {
+            continue;
+        }
+        if (attr.value == nullptr) {
+            if (start < 0) start = t;
+        } else if (attr.valueLen <= firstLen && memcmp(attr.value, first, attr.valueLen) == 0 &&
+                   (start < 0 || attr.valueLen > prefixLen)) {
+            start = t;
+            prefixLen = attr.valueLen;
+        }
+    }
+    if (start >= 0) {
+        addOp(OP_TOKEN, (uint8_t)start);
+    } else {
+        // Attribute without a token, named from the string table
+        int s = addString(attrName, attrNameLen, true);
+        if (s < 0) {
+            return;
+        }
+        strings[s].literal = 1;
+        addOp(OP_LITERAL, WMLCDecompiler::WBXML_LITERAL, s);
+    }
+
+    // Value tokens (e.g. "http://www.") at the start of the rest of the value
+    size_t skip = prefixLen;
+    while (first && skip < firstLen) {
+        int best = -1;
+        size_t bestLen = 0;
+        for (int t = 0x85; t <= 0xFF; t++) {
+            const WMLCToken& val = WMLCDecompiler::attribute((uint8_t)t);
+            if (val.value && val.valueLen > bestLen && val.valueLen <= firstLen - skip &&
+                memcmp(val.value, first + skip, val.valueLen) == 0) {
+                best = t;
+                bestLen = val.valueLen;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        addOp(OP_TOKEN, (uint8_t)best);
+        skip += bestLen;
+    }
+
+    for (size_t i = 0; i < segmentCount; i++) {
+        const Segment& seg = segments[i];
+        size_t from = i == 0 ? skip : 0;
+        if (seg.len <= from && seg.var == 0) {
+            continue;
+        }
+        int s = addString(&decoded[seg.start + from], seg.len - from, seg.var != 0);
+        if (s < 0) {
+            return;
+        }
+        addOp(seg.var ? OP_VARIABLE : OP_STRING, seg.var, s);
+    }
+}
+
+void WMLCCompiler::closeStartTag(bool selfClosing) {
+    if (state == FAILED) {
+        return;
+    }
+    Op& tag = ops[openTag[depth - 1]];
+    if (tag.token & WMLCDecompiler::TAG_HAS_ATTRS) {
+        addOp(OP_TOKEN, WMLCDecompiler::WBXML_END);
+    }
+    if (selfClosing) {
+        depth--;
+        return;
+    }
+    // Content until the end tag shows there is none
+    tag.token |= WMLCDecompiler::TAG_HAS_CONTENT;
+    openContent[depth - 1] = (uint16_t)opCount;
+}
+
+void WMLCCompiler::endElement() {
+    if (depth == 0) {
+        fail("end tag without start tag");
+        return;
+    }
+    Op& tag = ops[openTag[depth - 1]];
+    const char* open;
+    size_t openLen;
+    if (tag.kind == OP_LITERAL) {
+        open = &text[strings[tag.str].offset];
+        openLen = strings[tag.str].len;
+    } else {
+        const WMLCToken& elem = WMLCDecompiler::element(tag.token);
+        open = elem.name;
+        openLen = elem.nameLen;
+    }
+    if (openLen != nameLen || memcmp(open, name, nameLen) != 0) {
+        fail("end tag does not match the open element");
+        return;
+    }
+    if (opCount == openContent[depth - 1]) {
+        tag.token &= ~WMLCDecompiler::TAG_HAS_CONTENT;
+    } else {
+        addOp(OP_TOKEN, WMLCDecompiler::WBXML_END);
+    }
+    depth--;
+}
+
+void WMLCCompiler::buildStringTable() {
+    // Candidates: every string, and the prefixes strings share (neighbours in sorted order)
+    candidateCount = 0;
+    uint16_t order[WMLC_COMPILER_MAX_STRINGS];
+    size_t textStrings = 0;
+    for (size_t i = 0; i < stringCount; i++) {
+        candidates[candidateCount].str = (uint16_t)i;
+        candidates[candidateCount].len = strings[i].len;
+        candidates[candidateCount].offset = NO_COST;
+        candidateCount++;
+        if (strings[i].textUses > 0) {
+            // Insertion sort, pages have a few dozen strings
+            size_t j = textStrings++;
+            while (j > 0) {
+                const String& a = strings[order[j - 1]];
+                const String& b = strings[i];
+                size_t n = a.len < b.len ? a.len : b.len;
+                int cmp = memcmp(&text[a.offset], &text[b.offset], n);
+                if (cmp < 0 || (cmp == 0 && a.len <= b.len)) break;
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = (uint16_t)i;
+        }
+    }
+    for (size_t i = 0; i + 1 < textStrings; i++) {
+        const String& a = strings[order[i]];
+        const String& b = strings[order[i + 1]];
+        size_t n = 0;
+        while (n < a.len && n < b.len && text[a.offset + n] == text[b.offset + n]) {
+            n++;
+        }
+        bool known = n < WMLC_COMPILER_MIN_PREFIX || n == a.len;
+        for (size_t c = stringCount; c < candidateCount && !known; c++) {
+            known = candidates[c].len == n &&
+                    memcmp(&text[strings[candidates[c].str].offset], &text[a.offset], n) == 0;
+        }
+        if (!known && candidateCount < WMLC_COMPILER_MAX_STRINGS * 2) {
+            candidates[candidateCount].str = order[i];
+            candidates[candidateCount].len = (uint16_t)n;
+            candidates[candidateCount].offset = NO_COST;
+            candidateCount++;
+        }
+    }
+
+    // Every use inline to start with
+    uint16_t textCost[WMLC_COMPILER_MAX_STRINGS];
+    uint16_t wholeCost[WMLC_COMPILER_MAX_STRINGS];
+    for (size_t i = 0; i < stringCount; i++) {
+        strings[i].textForm = INLINE;
+        strings[i].wholeForm = INLINE;
+        textCost[i] = wholeCost[i] = strings[i].len + 2;
+    }
+    tableLen = 0;
+    entryCount = 0;
+
+    // Add the candidate that saves the most bytes until none saves any,
+    // names of literal elements and attributes go in first as they must
+    for (size_t round = 0; round < candidateCount; round++) {
+        int best = -1;
+        long bestGain = 0;
+        for (size_t c = 0; c < candidateCount; c++) {
+            Candidate& cand = candidates[c];
+            if (cand.offset != NO_COST) {
+                continue;
+            }
+            const char* ct = &text[strings[cand.str].offset];
+            bool forced = cand.len == strings[cand.str].len && strings[cand.str].literal &&
+                          strings[cand.str].wholeForm == INLINE;
+
+            // In the table already as the end of an entry, or appended
+            size_t offset = tableLen;
+            size_t cost = cand.len + 1;
+            for (size_t e = 0; e < candidateCount; e++) {
+                const Candidate& entry = candidates[e];
+                if (entry.offset != NO_COST && entry.len >= cand.len &&
+                    memcmp(&text[strings[entry.str].offset] + entry.len - cand.len, ct, cand.len) == 0) {
+                    offset = entry.offset + entry.len - cand.len;
+                    cost = 0;
+                    break;
+                }
+            }
+            long gain = -(long)cost - (long)(mbLen(tableLen + cost) - mbLen(tableLen));
+            for (size_t i = 0; i < stringCount; i++) {
+                const String& s = strings[i];
+                const char* st = &text[s.offset];
+                if (s.len <= cand.len && memcmp(ct + cand.len - s.len, st, s.len) == 0) {
+                    long ref = 1 + (long)mbLen(offset + cand.len - s.len);
+                    if (ref < textCost[i]) gain += (textCost[i] - ref) * s.textUses;
+                    if (ref < wholeCost[i]) gain += (wholeCost[i] - ref) * s.wholeUses;
+                } else if (cand.len < s.len && s.textUses > 0 && memcmp(st, ct, cand.len) == 0) {
+                    long ref = 1 + (long)mbLen(offset) + (s.len - cand.len) + 2;
+                    if (ref < textCost[i]) gain += (textCost[i] - ref) * s.textUses;
+                }
+            }
+            if (forced) {
+                gain += 0x10000;
+            }
+            if (gain > bestGain) {
+                best = (int)c;
+                bestGain = gain;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        // Take it, and move every string it makes smaller over to it
+        Candidate& cand = candidates[best];
+        const char* ct = &text[strings[cand.str].offset];
+        bool appended = true;
+        for (size_t e = 0; e < candidateCount && appended; e++) {
+            const Candidate& entry = candidates[e];
+            if (entry.offset != NO_COST && entry.len >= cand.len &&
+                memcmp(&text[strings[entry.str].offset] + entry.len - cand.len, ct, cand.len) == 0) {
+                cand.offset = entry.offset + entry.len - cand.len;
+                appended = false;
+            }
+        }
+        if (appended) {
+            cand.offset = (uint16_t)tableLen;
+            entries[entryCount++] = (uint16_t)best;
+            tableLen += cand.len + 1;
+        }
+        for (size_t i = 0; i < stringCount; i++) {
+            String& s = strings[i];
+            const char* st = &text[s.offset];
+            if (s.len <= cand.len && memcmp(ct + cand.len - s.len, st, s.len) == 0) {
+                uint16_t at = cand.offset + cand.len - s.len;
+                uint16_t ref = 1 + mbLen(at);
+                if (ref < textCost[i]) {
+                    textCost[i] = ref;
+                    s.textForm = TABLE;
+                    s.textRef = at;
+                }
+                if (ref < wholeCost[i] || s.literal) {
+                    wholeCost[i] = ref;
+                    s.wholeForm = TABLE;
+                    s.wholeRef = at;
+                }
+            } else if (cand.len < s.len && s.textUses > 0 && memcmp(st, ct, cand.len) == 0) {
+                uint16_t ref = 1 + mbLen(cand.offset) + (s.len - cand.len) + 2;
+                if (ref < textCost[i]) {
+                    textCost[i] = ref;
+                    s.textForm = TABLE_PREFIX;
+                    s.textRef = cand.offset;
+                    s.prefixLen = cand.len;
+                }
+            }
+        }
+    }
+}
+
+size_t WMLCCompiler::finish(uint8_t* output, size_t outputSize) {
+    if (state != FAILED && state != TEXT) {
+        fail("document ends inside markup");
+    }
+    flushText(false);
+    if (state != FAILED && depth > 0) {
+        fail("element not closed");
+    }
+    if (state != FAILED && opCount == 0) {
+        fail("no elements");
+    }
+    if (state == FAILED) {
+        return 0;
+    }
+
+    buildStringTable();
+
+    WMLCWriter out = { output, outputSize, 0, false };
+    out.byte(WBXML_VERSION_1_3);
+    out.mb(publicId);
+    out.mb(CHARSET_UTF8);
+    out.mb(tableLen);
+    for (size_t e = 0; e < entryCount; e++) {
+        const Candidate& entry = candidates[entries[e]];
+        out.bytes(&text[strings[entry.str].offset], entry.len);
+        out.byte(0x00);
+    }
+
+    for (size_t i = 0; i < opCount; i++) {
+        const Op& op = ops[i];
+        const String& s = strings[op.str];
+        const char* data = &text[s.offset];
+        switch (op.kind) {
+            case OP_TOKEN:
+                out.byte(op.token);
+                break;
+
+            case OP_STRING:
+                if (s.textForm == INLINE) {
+                    out.byte(WMLCDecompiler::WBXML_STR_I);
+                    out.bytes(data, s.len);
+                    out.byte(0x00);
+                } else {
+                    out.byte(WMLCDecompiler::WBXML_STR_T);
+                    out.mb(s.textRef);
+                    if (s.textForm == TABLE_PREFIX) {
+                        out.byte(WMLCDecompiler::WBXML_STR_I);
+                        out.bytes(data + s.prefixLen, s.len - s.prefixLen);
+                        out.byte(0x00);
+                    }
+                }
+                break;
+
+            case OP_VARIABLE:
+                if (s.wholeForm == INLINE) {
+                    out.byte(op.token);
+                    out.bytes(data, s.len);
+                    out.byte(0x00);
+                } else {
+                    // EXT_T_n is EXT_I_n with the high bits of a table reference
+                    out.byte(op.token - WMLCDecompiler::WBXML_EXT_I_0 + WMLCDecompiler::WBXML_EXT_T_0);
+                    out.mb(s.wholeRef);
+                }
+                break;
+
+            case OP_LITERAL:
+                out.byte(op.token);
+                out.mb(s.wholeRef);
+                break;
+        }
+    }
+
+    if (out.full) {
+        fail("output buffer too small");
+        return 0;
+    }
+    return out.len;
+}
+
+size_t WMLCCompiler::compile(const char* wml, size_t wmlLen, uint8_t* output, size_t outputSize) {
+    if (wml == nullptr || output == nullptr) {
+        return 0;
+    }
+
+    // Static to keep the buffers off the stack
+    static WMLCCompiler compiler;
+    compiler.reset();
+    compiler.feed(wml, wmlLen);
+    return compiler.finish(output, outputSize);
+}
@@ -0,0 +1,200 @@
+/**
+ * wmlc_compiler.h - WML to WMLC (Compiled WML) Compiler
+ *
+ * Encodes WML text as WBXML 1.3 (UTF-8), using the decompiler's token tables
+ * for elements, attribute starts and attribute values.
+ *
+ * The text is fed in chunks of any size and parsed as it arrives; only the
+ * current tag or text run is held as text. Every string is kept once however
+ * often it occurs, and the document is written by finish(), since the string
+ * table comes before the body: strings used more than once, and prefixes that
+ * strings share (e.g. the host of a site's links), go in the table when a
+ * reference is smaller than repeating them inline.
+ *
+ * Usage:
+ *   static WMLCCompiler compiler;               // About 15 KB
+ *   compiler.feed(text, textLen);               // ... for every chunk, in order
+ *   size_t len = compiler.finish(wmlc, sizeof(wmlc));
+ */
+
+#ifndef WMLC_COMPILER_H
+#define WMLC_COMPILER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#ifndef WMLC_COMPILER_MAX_RUN
+#define WMLC_COMPILER_MAX_RUN 1024      // Longest text run or attribute value
+#endif
+
+#ifndef WMLC_COMPILER_MAX_STRINGS
+#define WMLC_COMPILER_MAX_STRINGS 128   // Distinct strings (text, attribute values, variable names)
+#endif
+
+#ifndef WMLC_COMPILER_MAX_TEXT
+#define WMLC_COMPILER_MAX_TEXT 4096     // Bytes of distinct strings
+#endif
+
+#ifndef WMLC_COMPILER_MAX_OPS
+#define WMLC_COMPILER_MAX_OPS 1024      // Tokens and string references in the body
+#endif
+
+#ifndef WMLC_COMPILER_MAX_SEGMENTS
+#define WMLC_COMPILER_MAX_SEGMENTS 32   // Strings and variables in one text run or attribute value
+#endif
+
+#ifndef WMLC_COMPILER_MIN_PREFIX
+#define WMLC_COMPILER_MIN_PREFIX 4      // Shortest shared prefix tried as a table entry
+#endif
+
+enum WMLCCompileStatus {
+    WMLC_COMPILE_OK,            // Everything fed so far parsed
+    WMLC_COMPILE_ERROR          // Malformed WML, or a document larger than the buffers
+};
+
+class WMLCCompiler {
+public:
+    WMLCCompiler();
+
+    /**
+     * Start over for a new document
+     */
+    void reset();
+
+    /**
+     * Parse the next chunk of WML text
+     *
+     * @return Status, stays WMLC_COMPILE_ERROR until reset()
+     */
+    WMLCCompileStatus feed(const char* text, size_t len);
+
+    /**
+     * End of the WML text: build the string table and write the WMLC document
+     *
+     * @param output Output buffer for WMLC binary
+     * @param outputSize Size of output buffer
+     * @return Number of bytes written, or 0 on error (see error())
+     */
+    size_t finish(uint8_t* output, size_t outputSize);
+
+    /**
+     * Compile a whole WML document
+     *
+     * @return Number of bytes written to output, or 0 on error
+     */
+    static size_t compile(const char* wml, size_t wmlLen, uint8_t* output, size_t outputSize);
+
+    WMLCCompileStatus result() const { return state == FAILED ? WMLC_COMPILE_ERROR : WMLC_COMPILE_OK; }
+
+    /**
+     * String table size of the last document finish() wrote
+     */
+    size_t stringTableSize() const { return tableLen; }
+
+    const char* error() const { return errorText ? errorText : ""; }
+
+private:
+    // Where in the markup the next character is
+    enum State {
+        TEXT, TAG_START, TAG_NAME, ATTRS, ATTR_NAME, ATTR_AFTER_NAME, ATTR_EQ, ATTR_VALUE,
+        SELF_CLOSE, END_TAG, MARKUP_DECL, COMMENT, CDATA, DOCTYPE, PI, FAILED
+    };
+
+    enum OpKind {
+        OP_TOKEN,               // Token byte as is
+        OP_STRING,              // String data: inline, table reference, or table prefix and inline rest
+        OP_VARIABLE,            // Variable (EXT_I_n or EXT_T_n), token is EXT_I_n
+        OP_LITERAL              // Element or attribute name from the string table, token is LITERAL*
+    };
+
+    struct Op {
+        uint8_t kind;
+        uint8_t token;
+        uint16_t str;
+    };
+
+    // How a string is written (chosen by buildStringTable)
+    enum Form { INLINE, TABLE, TABLE_PREFIX };
+
+    // Piece of a decoded run: string data, or a variable name (var is its EXT_I_n token)
+    struct Segment {
+        uint16_t start;
+        uint16_t len;
+        uint8_t var;
+    };
+
+    struct String {
+        uint16_t offset;        // In text
+        uint16_t len;
+        uint16_t textUses;      // As string data (may be split)
+        uint16_t wholeUses;     // As a variable or literal name (needs all of it)
+        uint8_t literal;        // Element or attribute name, must be in the table
+        uint8_t textForm;
+        uint8_t wholeForm;
+        uint16_t textRef;       // Table offset of the string, or of its prefix
+        uint16_t prefixLen;
+        uint16_t wholeRef;
+    };
+
+    State state;
+    const char* errorText;
+    unsigned long publicId;
+
+    char name[32];              // Tag or attribute name being read
+    size_t nameLen;
+    char attrName[32];
+    size_t attrNameLen;
+    char quote;
+    uint8_t markupMatch;        // Characters of "--", "[CDATA[" or "DOCTYPE" matched, or end marker progress
+
+    char run[WMLC_COMPILER_MAX_RUN];        // Text or attribute value being read
+    size_t runLen;
+    char decoded[WMLC_COMPILER_MAX_RUN];    // Run with entities and variables resolved
+    Segment segments[WMLC_COMPILER_MAX_SEGMENTS];
+    size_t segmentCount;
+
+    char text[WMLC_COMPILER_MAX_TEXT];
+    size_t textLen;
+    String strings[WMLC_COMPILER_MAX_STRINGS];
+    size_t stringCount;
+
+    Op ops[WMLC_COMPILER_MAX_OPS];
+    size_t opCount;
+
+    // Open elements: their tag op and the op their content starts at
+    uint16_t openTag[32];
+    uint16_t openContent[32];
+    int depth;
+
+    // String table entries to choose from: strings, and prefixes of them
+    struct Candidate {
+        uint16_t str;
+        uint16_t len;           // Prefix of str that is the entry
+        uint16_t offset;        // In the table, NO_COST until chosen
+    };
+
+    Candidate candidates[WMLC_COMPILER_MAX_STRINGS * 2];
+    size_t candidateCount;
+    uint16_t entries[WMLC_COMPILER_MAX_STRINGS * 2];   // Candidates written to the table, in order
+    size_t entryCount;
+    size_t tableLen;
+
+    void fail(const char* text);
+    void addOp(uint8_t kind, uint8_t token, size_t str = 0);
+    int addString(const char* data, size_t len, bool whole);
+    bool appendRun(char c);
+    bool isNameChar(char c) const;
+
+    void markupChar(char c);
+    void flushText(bool raw);
+    bool decodeRun(const char* data, size_t len, bool collapse, bool raw);
+    void startElement();
+    void attribute();
+    void closeStartTag(bool selfClosing);
+    void endElement();
+    void doctype();
+
+    void buildStringTable();
+};
+
+#endif // WMLC_COMPILER_H
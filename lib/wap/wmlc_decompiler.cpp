@@ -15,7 +15,7 @@ struct WMLElement {
     const char* name;
 };
 
-static const WMLElement wml_elements[] = {
+static constexpr WMLElement wml_elements[] = {
     { 0x1C, "a" },
     { 0x1D, "td" },
     { 0x1E, "tr" },
@@ -61,7 +61,7 @@ struct WMLAttribute {
     const char* value;  // nullptr if no value prefix
 };
 
-static const WMLAttribute wml_attributes[] = {
+static constexpr WMLAttribute wml_attributes[] = {
     { 0x05, "accept-charset", nullptr },
     { 0x06, "align", "bottom" },
     { 0x07, "align", "center" },
@@ -156,7 +156,7 @@ struct WMLAttrValue {
     const char* value;
 };
 
-static const WMLAttrValue wml_attr_values[] = {
+static constexpr WMLAttrValue wml_attr_values[] = {
     { 0x85, ".com/" },
     { 0x86, ".edu/" },
     { 0x87, ".net/" },
@@ -187,38 +187,114 @@ static const WMLAttrValue wml_attr_values[] = {
     { 0, nullptr }
 };
 
-const char* WMLCDecompiler::getElementName(uint8_t token) {
+// Direct-indexed token tables, generated from the lists above at compile time
+// Constant data, so they stay in flash on the ESP32
+template <size_t... I> struct TokenIndices { };
+template <size_t N, size_t... I> struct MakeTokenIndices : MakeTokenIndices<N - 1, N - 1, I...> { };
+template <size_t... I> struct MakeTokenIndices<0, I...> { typedef TokenIndices<I...> type; };
+
+template <size_t N>
+struct WMLCTokenTable {
+    WMLCToken at[N];
+};
+
+static constexpr WMLCToken unknownToken = { nullptr, nullptr, 0, 0 };
+
+static constexpr uint8_t textLen(const char* s) {
+    return (s == nullptr || *s == '\0') ? 0 : 1 + textLen(s + 1);
+}
+
+static constexpr WMLCToken elementEntry(size_t token, size_t i) {
+    return wml_elements[i].name == nullptr ? unknownToken :
+           wml_elements[i].token == token ?
+               WMLCToken{ wml_elements[i].name, nullptr, textLen(wml_elements[i].name), 0 } :
+           elementEntry(token, i + 1);
+}
+
+static constexpr WMLCToken attrStartEntry(size_t token, size_t i) {
+    return wml_attributes[i].name == nullptr ? unknownToken :
+           wml_attributes[i].token == token ?
+               WMLCToken{ wml_attributes[i].name, wml_attributes[i].value,
+                          textLen(wml_attributes[i].name), textLen(wml_attributes[i].value) } :
+           attrStartEntry(token, i + 1);
+}
+
+static constexpr WMLCToken attrValueEntry(size_t token, size_t i) {
+    return wml_attr_values[i].value == nullptr ? unknownToken :
+           wml_attr_values[i].token == token ?
+               WMLCToken{ nullptr, wml_attr_values[i].value, 0, textLen(wml_attr_values[i].value) } :
+           attrValueEntry(token, i + 1);
+}
+
+template <size_t... I>
+static constexpr WMLCTokenTable<sizeof...(I)> makeElementTable(TokenIndices<I...>) {
+    return WMLCTokenTable<sizeof...(I)>{ { elementEntry(I, 0)... } };
+}
+
+template <size_t... I>
+static constexpr WMLCTokenTable<sizeof...(I)> makeAttributeTable(TokenIndices<I...>) {
+    return WMLCTokenTable<sizeof...(I)>{ { (I < 0x80 ? attrStartEntry(I, 0) : attrValueEntry(I, 0))... } };
+}
+
+// Tag tokens by their low 6 bits, attribute start and value tokens by the whole byte
+static constexpr WMLCTokenTable<64> wml_element_table = makeElementTable(MakeTokenIndices<64>::type());
+static constexpr WMLCTokenTable<256> wml_attribute_table = makeAttributeTable(MakeTokenIndices<256>::type());
+
+#ifndef WMLC_LINEAR_LOOKUP
+
+const WMLCToken& WMLCDecompiler::element(uint8_t token) {
     // Strip content and attribute bits
-    uint8_t baseToken = token & 0x3F;
-    
+    return wml_element_table.at[token & 0x3F];
+}
+
+const WMLCToken& WMLCDecompiler::attribute(uint8_t token) {
+    return wml_attribute_table.at[token];
+}
+
+#else
+
+// Search the lists for every token, as the decompiler did before the tables
+// were generated (only built for bench_wmlc's comparison)
+const WMLCToken& WMLCDecompiler::element(uint8_t token) {
+    static WMLCToken found;
+    found = unknownToken;
     for (int i = 0; wml_elements[i].name != nullptr; i++) {
-        if (wml_elements[i].token == baseToken) {
-            return wml_elements[i].name;
+        if (wml_elements[i].token == (token & 0x3F)) {
+            found.name = wml_elements[i].name;
+            found.nameLen = (uint8_t)strlen(found.name);
+            break;
         }
     }
-    return nullptr;
+    return found;
 }
 
-const char* WMLCDecompiler::getAttributeName(uint8_t token, const char** value) {
-    for (int i = 0; wml_attributes[i].name != nullptr; i++) {
-        if (wml_attributes[i].token == token) {
-            if (value) *value = wml_attributes[i].value;
-            return wml_attributes[i].name;
+const WMLCToken& WMLCDecompiler::attribute(uint8_t token) {
+    static WMLCToken found;
+    found = unknownToken;
+    if (token < 0x80) {
+        for (int i = 0; wml_attributes[i].name != nullptr; i++) {
+            if (wml_attributes[i].token == token) {
+                found.name = wml_attributes[i].name;
+                found.nameLen = (uint8_t)strlen(found.name);
+                found.value = wml_attributes[i].value;
+                found.valueLen = found.value ? (uint8_t)strlen(found.value) : 0;
+                break;
+            }
         }
+        return found;
     }
-    if (value) *value = nullptr;
-    return nullptr;
-}
-
-const char* WMLCDecompiler::getAttributeValue(uint8_t token) {
     for (int i = 0; wml_attr_values[i].value != nullptr; i++) {
         if (wml_attr_values[i].token == token) {
-            return wml_attr_values[i].value;
+            found.value = wml_attr_values[i].value;
+            found.valueLen = (uint8_t)strlen(found.value);
+            break;
         }
     }
-    return nullptr;
+    return found;
 }
 
+#endif
+
 size_t WMLCDecompiler::decodeMbUint(const uint8_t* data, size_t len, unsigned long* value) {
     if (data == nullptr || len == 0 || value == nullptr) {
         return 0;
@@ -252,458 +328,520 @@ unsigned long WMLCDecompiler::getPublicId(const uint8_t* wmlc, size_t wmlcLen) {
     return publicId;
 }
 
-size_t WMLCDecompiler::decompileBody(const uint8_t* data, size_t len,
-                                      const char* stringTable, size_t stringTableLen,
-                                      char* output, size_t outputSize, int indent) {
-    if (data == nullptr || output == nullptr || len == 0) {
+size_t WMLCDecompiler::decompile(const uint8_t* wmlc, size_t wmlcLen,
+                                  char* output, size_t outputSize) {
+    if (output == nullptr || outputSize < 100) {
+        if (output && outputSize > 0) output[0] = '\0';
         return 0;
     }
     
-    size_t pos = 0;      // Input position
-    size_t outPos = 0;   // Output position
+    WMLBufferSink buffer(output, outputSize);
+    if (!decompile(wmlc, wmlcLen, buffer) || buffer.overflowed()) {
+        output[0] = '\0';
+        return 0;
+    }
+    return buffer.length();
+}
+
+bool WMLCDecompiler::decompile(const uint8_t* wmlc, size_t wmlcLen, WMLSink& output) {
+    if (wmlc == nullptr || wmlcLen < 4) {
+        return false;
+    }
     
-    // Helper to append string safely
-    auto appendStr = [&](const char* str) {
-        size_t slen = strlen(str);
-        if (outPos + slen < outputSize) {
-            memcpy(&output[outPos], str, slen);
-            outPos += slen;
+    // Static to keep the string table off the stack
+    static WMLCStreamDecompiler decoder;
+    decoder.reset(&output);
+    decoder.feed(wmlc, wmlcLen);
+    return decoder.finish() == WMLC_STREAM_OK;
+}
+
+// ============================================================================
+// WMLCStreamDecompiler
+// ============================================================================
+
+WMLCStreamDecompiler::WMLCStreamDecompiler(WMLSink* output) {
+    reset(output);
+}
+
+void WMLCStreamDecompiler::reset(WMLSink* output) {
+    out = output;
+    written = 0;
+    errorText = nullptr;
+    stage = VERSION;
+    context = CONTENT;
+    operand = NONE;
+    pendingToken = 0;
+    numberBytes = 0;
+    number = 0;
+    publicId = 0;
+    skipLeft = 0;
+    openName = nullptr;
+    openNameLen = 0;
+    openHasContent = false;
+    depth = 0;
+    stringTableLen = 0;
+    stringTableGot = 0;
+    stringTable[0] = '\0';
+}
+
+void WMLCStreamDecompiler::fail(const char* text) {
+    stage = FAILED;
+    errorText = text;
+}
+
+void WMLCStreamDecompiler::emit(const char* text, size_t len) {
+    if (len > 0 && out) {
+        out->write(text, len);
+    }
+    written += len;
+}
+
+void WMLCStreamDecompiler::emitString(const char* text) {
+    emit(text, strlen(text));
+}
+
+void WMLCStreamDecompiler::emitEscaped(const char* text, size_t len) {
+    // Characters of string data that WML text must escape ($ starts a variable)
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+        switch (text[i]) {
+            case '&': emit(&text[start], i - start); emit("&amp;"); break;
+            case '<': emit(&text[start], i - start); emit("&lt;"); break;
+            case '>': emit(&text[start], i - start); emit("&gt;"); break;
+            case '"': emit(&text[start], i - start); emit("&quot;"); break;
+            case '$': emit(&text[start], i - start); emit("$$"); break;
+            default: continue;
         }
-    };
+        start = i + 1;
+    }
+    emit(&text[start], len - start);
+}
+
+const char* WMLCStreamDecompiler::tableString(unsigned long offset) const {
+    return offset < stringTableLen ? &stringTable[offset] : nullptr;
+}
+
+bool WMLCStreamDecompiler::readNumber(uint8_t b) {
+    // mb_u_int32, 7 bits per byte, continuation bit set on all but the last
+    number = (number << 7) | (b & 0x7F);
+    if (++numberBytes > 5) {
+        fail("invalid multi-byte integer");
+        return false;
+    }
+    if (b & 0x80) {
+        return false;
+    }
+    numberBytes = 0;
+    return true;
+}
+
+void WMLCStreamDecompiler::headerByte(uint8_t b) {
+    switch (stage) {
+        case VERSION:
+            // WBXML version, not used in output
+            stage = PUBLIC_ID;
+            break;
+            
+        case PUBLIC_ID:
+            if (readNumber(b)) {
+                publicId = number;
+                number = 0;
+                // If publicId is 0, a string table index for the DTD follows
+                stage = publicId == 0 ? PUBLIC_ID_INDEX : CHARSET;
+            }
+            break;
+            
+        case PUBLIC_ID_INDEX:
+        case CHARSET:
+            if (readNumber(b)) {
+                number = 0;
+                stage = stage == PUBLIC_ID_INDEX ? CHARSET : STRING_TABLE_LEN;
+            }
+            break;
+            
+        case STRING_TABLE_LEN:
+            if (readNumber(b)) {
+                if (number > WMLC_MAX_STRING_TABLE) {
+                    fail("string table larger than the buffer");
+                    break;
+                }
+                stringTableLen = number;
+                number = 0;
+                if (stringTableLen > 0) {
+                    stage = STRING_TABLE;
+                } else {
+                    startBody();
+                }
+            }
+            break;
+            
+        default:
+            break;
+    }
+}
+
+void WMLCStreamDecompiler::startBody() {
+    stringTable[stringTableLen] = '\0';
+    stage = BODY;
     
-    // Helper to append char safely
-    auto appendChar = [&](char c) {
-        if (outPos + 1 < outputSize) {
-            output[outPos++] = c;
-        }
-    };
+    // Write XML declaration
+    emit("<?xml version=\"1.0\"?>\n");
     
-    // Helper for indentation
-    auto appendIndent = [&](int level) {
-        for (int i = 0; i < level && outPos + 1 < outputSize; i++) {
-            output[outPos++] = ' ';
+    // Write DOCTYPE based on public ID
+    // WML 1.1 = 0x04, WML 1.2 = 0x09, WML 1.3 = 0x0A
+    if (publicId == 0x04) {
+        emit("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.1//EN\" \"http://www.wapforum.org/DTD/wml_1.1.xml\">\n");
+    } else if (publicId == 0x09) {
+        emit("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.2//EN\" \"http://www.wapforum.org/DTD/wml12.dtd\">\n");
+    } else if (publicId == 0x0A) {
+        emit("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.3//EN\" \"http://www.wapforum.org/DTD/wml13.dtd\">\n");
+    }
+}
+
+WMLCStreamStatus WMLCStreamDecompiler::feed(const uint8_t* data, size_t len) {
+    size_t pos = 0;
+    while (pos < len && stage != FAILED && stage != DONE) {
+        if (stage == STRING_TABLE) {
+            // Copy as much of the string table as this chunk holds
+            size_t n = stringTableLen - stringTableGot;
+            if (n > len - pos) {
+                n = len - pos;
+            }
+            memcpy(&stringTable[stringTableGot], &data[pos], n);
+            stringTableGot += n;
+            pos += n;
+            if (stringTableGot == stringTableLen) {
+                startBody();
+            }
+            continue;
+        }
+        if (stage != BODY) {
+            headerByte(data[pos++]);
+            continue;
         }
-    };
-    
-    // Stack for tracking open elements
-    const char* elementStack[32];
-    int stackDepth = 0;
-    
-    while (pos < len) {
-        uint8_t token = data[pos++];
         
-        // Global tokens
-        switch (token) {
-            case WBXML_SWITCH_PAGE:
-                // Code page switch - skip the page number
-                if (pos < len) pos++;
-                continue;
-                
-            case WBXML_END:
-                // End of element
-                if (stackDepth > 0) {
-                    stackDepth--;
-                    appendStr("</");
-                    appendStr(elementStack[stackDepth]);
-                    appendChar('>');
+        switch (operand) {
+            case INLINE: {
+                // Inline string (null-terminated), written as far as this chunk holds it
+                const uint8_t* end = (const uint8_t*)memchr(&data[pos], 0, len - pos);
+                size_t n = end ? (size_t)(end - &data[pos]) : len - pos;
+                if (pendingToken == WMLCDecompiler::WBXML_STR_I) {
+                    emitEscaped((const char*)&data[pos], n);
+                } else {
+                    emit((const char*)&data[pos], n);
                 }
-                continue;
-                
-            case WBXML_ENTITY:
-                // Character entity
-                if (pos < len) {
-                    unsigned long entity;
-                    size_t consumed = decodeMbUint(&data[pos], len - pos, &entity);
-                    if (consumed > 0) {
-                        pos += consumed;
-                        char entityBuf[16];
-                        snprintf(entityBuf, sizeof(entityBuf), "&#%lu;", entity);
-                        appendStr(entityBuf);
-                    }
+                pos += n;
+                if (end) {
+                    pos++;  // Skip null terminator
+                    inlineDone();
                 }
-                continue;
-                
-            case WBXML_STR_I:
-                // Inline string (null-terminated)
-                while (pos < len && data[pos] != 0) {
-                    appendChar((char)data[pos++]);
-                }
-                if (pos < len) pos++;  // Skip null terminator
-                continue;
-                
-            case WBXML_STR_T:
-                // String table reference
-                if (pos < len) {
-                    unsigned long offset;
-                    size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                    if (consumed > 0) {
-                        pos += consumed;
-                        if (stringTable && offset < stringTableLen) {
-                            appendStr(&stringTable[offset]);
-                        }
-                    }
-                }
-                continue;
+                break;
+            }
                 
-            case WBXML_EXT_I_0:
-            case WBXML_EXT_I_1:
-            case WBXML_EXT_I_2:
-                // Extension with inline string - output as variable
-                {
-                    appendStr("$(");
-                    while (pos < len && data[pos] != 0) {
-                        appendChar((char)data[pos++]);
-                    }
-                    if (pos < len) pos++;
-                    // Add escape suffix based on extension type
-                    if (token == WBXML_EXT_I_1) appendStr(":e");
-                    else if (token == WBXML_EXT_I_2) appendStr(":u");
-                    appendChar(')');
+            case NUMBER:
+                if (readNumber(data[pos++])) {
+                    numberDone();
                 }
-                continue;
+                break;
                 
-            case WBXML_EXT_T_0:
-            case WBXML_EXT_T_1:
-            case WBXML_EXT_T_2:
-                // Extension with string table reference - output as variable
-                if (pos < len) {
-                    unsigned long offset;
-                    size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                    if (consumed > 0) {
-                        pos += consumed;
-                        appendStr("$(");
-                        if (stringTable && offset < stringTableLen) {
-                            appendStr(&stringTable[offset]);
-                        }
-                        if (token == WBXML_EXT_T_1) appendStr(":e");
-                        else if (token == WBXML_EXT_T_2) appendStr(":u");
-                        appendChar(')');
-                    }
-                }
-                continue;
+            case SKIP_BYTE:
+                pos++;
+                operand = NONE;
+                break;
                 
-            case WBXML_OPAQUE:
-                // Opaque data
-                if (pos < len) {
-                    unsigned long opaqueLen;
-                    size_t consumed = decodeMbUint(&data[pos], len - pos, &opaqueLen);
-                    if (consumed > 0) {
-                        pos += consumed;
-                        // Skip opaque data for now (could be image data, etc.)
-                        pos += opaqueLen;
-                    }
+            case SKIP_OPAQUE: {
+                size_t n = skipLeft < len - pos ? skipLeft : len - pos;
+                pos += n;
+                skipLeft -= n;
+                if (skipLeft == 0) {
+                    operand = NONE;
                 }
-                continue;
-                
-            case WBXML_PI:
-                // Processing instruction - skip
-                continue;
+                break;
+            }
                 
-            case WBXML_LITERAL:
-            case WBXML_LITERAL_A:
-            case WBXML_LITERAL_C:
-            case WBXML_LITERAL_AC:
-                // Literal element from string table
-                if (pos < len) {
-                    unsigned long offset;
-                    size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                    if (consumed > 0) {
-                        pos += consumed;
-                        const char* elemName = (stringTable && offset < stringTableLen) 
-                                               ? &stringTable[offset] : "unknown";
-                        
-                        bool hasAttrs = (token == WBXML_LITERAL_A || token == WBXML_LITERAL_AC);
-                        bool hasContent = (token == WBXML_LITERAL_C || token == WBXML_LITERAL_AC);
-                        
-                        appendChar('<');
-                        appendStr(elemName);
-                        
-                        // Parse attributes if present
-                        if (hasAttrs) {
-                            while (pos < len && data[pos] != WBXML_END) {
-                                // Similar attribute parsing as below
-                                pos++;
-                            }
-                            if (pos < len) pos++;  // Skip END
-                        }
-                        
-                        if (hasContent) {
-                            appendChar('>');
-                            if (stackDepth < 32) {
-                                elementStack[stackDepth++] = elemName;
-                            }
-                        } else {
-                            appendStr("/>");
-                        }
-                    }
-                }
-                continue;
+            case NONE:
+                token(data[pos++]);
+                break;
         }
-        
-        // Check for element token (0x05-0x3F range, with possible bits set)
-        if (token >= 0x05) {
-            bool hasAttrs = (token & TAG_HAS_ATTRS) != 0;
-            bool hasContent = (token & TAG_HAS_CONTENT) != 0;
-            uint8_t baseToken = token & 0x3F;
+    }
+    return result();
+}
+
+void WMLCStreamDecompiler::token(uint8_t t) {
+    switch (context) {
+        case CONTENT:
+            contentToken(t);
+            break;
+        case ATTRS:
+            attrToken(t);
+            break;
+        case ATTR_VALUE:
+            attrValueToken(t);
+            break;
+    }
+}
+
+void WMLCStreamDecompiler::contentToken(uint8_t t) {
+    switch (t) {
+        case WMLCDecompiler::WBXML_SWITCH_PAGE:
+            // Code page switch - skip the page number
+            operand = SKIP_BYTE;
+            return;
             
-            const char* elemName = getElementName(baseToken);
-            if (elemName == nullptr) {
-                // Unknown token - skip
-                continue;
-            }
+        case WMLCDecompiler::WBXML_END:
+            closeElement();
+            return;
             
-            appendChar('<');
-            appendStr(elemName);
+        case WMLCDecompiler::WBXML_STR_I:
+            operand = INLINE;
+            pendingToken = t;
+            return;
             
-            // Parse attributes
-            if (hasAttrs) {
-                while (pos < len) {
-                    uint8_t attrToken = data[pos];
-                    
-                    if (attrToken == WBXML_END) {
-                        pos++;
-                        break;
-                    }
-                    
-                    if (attrToken == WBXML_STR_I) {
-                        // Inline string in attributes
-                        pos++;
-                        while (pos < len && data[pos] != 0) {
-                            appendChar((char)data[pos++]);
-                        }
-                        if (pos < len) pos++;
-                        continue;
-                    }
-                    
-                    if (attrToken == WBXML_STR_T) {
-                        // String table reference
-                        pos++;
-                        unsigned long offset;
-                        size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                        if (consumed > 0) {
-                            pos += consumed;
-                            if (stringTable && offset < stringTableLen) {
-                                appendStr(&stringTable[offset]);
-                            }
-                        }
-                        continue;
-                    }
-                    
-                    // Check for attribute value token (0x80+)
-                    if (attrToken >= 0x80) {
-                        const char* attrVal = getAttributeValue(attrToken);
-                        if (attrVal) {
-                            appendStr(attrVal);
-                        }
-                        pos++;
-                        continue;
-                    }
-                    
-                    // Attribute start token
-                    const char* attrValuePrefix = nullptr;
-                    const char* attrName = getAttributeName(attrToken, &attrValuePrefix);
-                    
-                    if (attrName) {
-                        appendChar(' ');
-                        appendStr(attrName);
-                        appendStr("=\"");
-                        if (attrValuePrefix) {
-                            appendStr(attrValuePrefix);
-                        }
-                        pos++;
-                        
-                        // Read attribute value continuation
-                        while (pos < len) {
-                            uint8_t valToken = data[pos];
-                            
-                            // End of attributes or next attribute
-                            if (valToken == WBXML_END || (valToken < 0x80 && valToken >= 0x05)) {
-                                break;
-                            }
-                            
-                            if (valToken == WBXML_STR_I) {
-                                pos++;
-                                while (pos < len && data[pos] != 0) {
-                                    appendChar((char)data[pos++]);
-                                }
-                                if (pos < len) pos++;
-                            } else if (valToken == WBXML_STR_T) {
-                                pos++;
-                                unsigned long offset;
-                                size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                                if (consumed > 0) {
-                                    pos += consumed;
-                                    if (stringTable && offset < stringTableLen) {
-                                        appendStr(&stringTable[offset]);
-                                    }
-                                }
-                            } else if (valToken >= WBXML_EXT_I_0 && valToken <= WBXML_EXT_I_2) {
-                                // Variable in attribute (inline string)
-                                pos++;
-                                appendStr("$(");
-                                while (pos < len && data[pos] != 0) {
-                                    appendChar((char)data[pos++]);
-                                }
-                                if (pos < len) pos++;
-                                if (valToken == WBXML_EXT_I_1) appendStr(":e");
-                                else if (valToken == WBXML_EXT_I_2) appendStr(":u");
-                                appendChar(')');
-                            } else if (valToken >= WBXML_EXT_T_0 && valToken <= WBXML_EXT_T_2) {
-                                // Variable in attribute (string table reference)
-                                pos++;
-                                unsigned long offset;
-                                size_t consumed = decodeMbUint(&data[pos], len - pos, &offset);
-                                if (consumed > 0) {
-                                    pos += consumed;
-                                    appendStr("$(");
-                                    if (stringTable && offset < stringTableLen) {
-                                        appendStr(&stringTable[offset]);
-                                    }
-                                    if (valToken == WBXML_EXT_T_1) appendStr(":e");
-                                    else if (valToken == WBXML_EXT_T_2) appendStr(":u");
-                                    appendChar(')');
-                                }
-                            } else if (valToken >= 0x80) {
-                                const char* attrVal = getAttributeValue(valToken);
-                                if (attrVal) {
-                                    appendStr(attrVal);
-                                }
-                                pos++;
-                            } else {
-                                pos++;
-                            }
-                        }
-                        
-                        appendChar('"');
-                    } else {
-                        pos++;
-                    }
-                }
-            }
+        case WMLCDecompiler::WBXML_EXT_I_0:
+        case WMLCDecompiler::WBXML_EXT_I_1:
+        case WMLCDecompiler::WBXML_EXT_I_2:
+            // Extension with inline string - output as variable
+            emit("$(");
+            operand = INLINE;
+            pendingToken = t;
+            return;
             
-            if (hasContent) {
-                appendChar('>');
-                if (stackDepth < 32) {
-                    elementStack[stackDepth++] = elemName;
-                }
-            } else {
-                appendStr("/>");
-            }
-        }
+        case WMLCDecompiler::WBXML_ENTITY:
+        case WMLCDecompiler::WBXML_STR_T:
+        case WMLCDecompiler::WBXML_EXT_T_0:
+        case WMLCDecompiler::WBXML_EXT_T_1:
+        case WMLCDecompiler::WBXML_EXT_T_2:
+        case WMLCDecompiler::WBXML_OPAQUE:
+        case WMLCDecompiler::WBXML_LITERAL:
+        case WMLCDecompiler::WBXML_LITERAL_A:
+        case WMLCDecompiler::WBXML_LITERAL_C:
+        case WMLCDecompiler::WBXML_LITERAL_AC:
+            // Token with a multi-byte integer
+            operand = NUMBER;
+            pendingToken = t;
+            number = 0;
+            return;
+            
+        case WMLCDecompiler::WBXML_PI:
+            // Processing instruction - skip
+            return;
     }
     
-    // Close any remaining open elements
-    while (stackDepth > 0) {
-        stackDepth--;
-        appendStr("</");
-        appendStr(elementStack[stackDepth]);
-        appendChar('>');
+    // Check for element token (0x05-0x3F range, with possible bits set)
+    if (t < 0x05) {
+        return;
     }
-    
-    // Null terminate
-    if (outPos < outputSize) {
-        output[outPos] = '\0';
-    } else if (outputSize > 0) {
-        output[outputSize - 1] = '\0';
+    const WMLCToken& elem = WMLCDecompiler::element(t);
+    if (elem.name == nullptr) {
+        // Unknown token - skip
+        return;
+    }
+    emit("<");
+    emit(elem.name, elem.nameLen);
+    openName = elem.name;
+    openNameLen = elem.nameLen;
+    openHasContent = (t & WMLCDecompiler::TAG_HAS_CONTENT) != 0;
+    if (t & WMLCDecompiler::TAG_HAS_ATTRS) {
+        context = ATTRS;
+    } else {
+        openDone();
     }
-    
-    return outPos;
 }
 
-size_t WMLCDecompiler::decompile(const uint8_t* wmlc, size_t wmlcLen,
-                                  char* output, size_t outputSize) {
-    if (wmlc == nullptr || output == nullptr || wmlcLen < 4 || outputSize < 100) {
-        if (output && outputSize > 0) output[0] = '\0';
-        return 0;
+void WMLCStreamDecompiler::attrToken(uint8_t t) {
+    if (t == WMLCDecompiler::WBXML_END) {
+        openDone();
+        return;
     }
-    
-    size_t pos = 0;
-    size_t outPos = 0;
-    
-    // Helper to append
-    auto append = [&](const char* str) {
-        size_t slen = strlen(str);
-        if (outPos + slen < outputSize) {
-            memcpy(&output[outPos], str, slen);
-            outPos += slen;
-        }
-    };
-    
-    // 1. Version byte
-    uint8_t version = wmlc[pos++];
-    (void)version;  // WBXML version, not used in output
-    
-    // 2. Public ID (mb_u_int32)
-    unsigned long publicId;
-    size_t consumed = decodeMbUint(&wmlc[pos], wmlcLen - pos, &publicId);
-    if (consumed == 0) {
-        output[0] = '\0';
-        return 0;
+    if (t == WMLCDecompiler::WBXML_STR_I || t == WMLCDecompiler::WBXML_STR_T ||
+        t == WMLCDecompiler::WBXML_LITERAL) {
+        // Strings, or an attribute whose name is in the string table
+        operand = t == WMLCDecompiler::WBXML_STR_I ? INLINE : NUMBER;
+        pendingToken = t;
+        number = 0;
+        return;
     }
-    pos += consumed;
     
-    // If publicId is 0, there's a string table index for DTD
-    if (publicId == 0 && pos < wmlcLen) {
-        // Skip string table index for public ID
-        consumed = decodeMbUint(&wmlc[pos], wmlcLen - pos, &publicId);
-        if (consumed > 0) pos += consumed;
+    // Attribute value token (0x80+), or attribute start token with its value prefix
+    const WMLCToken& attr = WMLCDecompiler::attribute(t);
+    if (attr.name) {
+        emit(" ");
+        emit(attr.name, attr.nameLen);
+        emit("=\"");
+        context = ATTR_VALUE;
     }
-    
-    // 3. Charset (mb_u_int32)
-    unsigned long charset = 0;
-    consumed = decodeMbUint(&wmlc[pos], wmlcLen - pos, &charset);
-    if (consumed == 0) {
-        output[0] = '\0';
-        return 0;
+    if (attr.value) {
+        emit(attr.value, attr.valueLen);
     }
-    pos += consumed;
+}
+
+void WMLCStreamDecompiler::attrValueToken(uint8_t t) {
+    bool variable = t >= WMLCDecompiler::WBXML_EXT_I_0 && t <= WMLCDecompiler::WBXML_EXT_I_2;
     
-    // 4. String table length (mb_u_int32)
-    unsigned long stringTableLen = 0;
-    consumed = decodeMbUint(&wmlc[pos], wmlcLen - pos, &stringTableLen);
-    if (consumed == 0) {
-        output[0] = '\0';
-        return 0;
+    // End of attributes or next attribute
+    if (!variable && (t == WMLCDecompiler::WBXML_END || t == WMLCDecompiler::WBXML_LITERAL ||
+                      (t < 0x80 && t >= 0x05))) {
+        emit("\"");
+        context = ATTRS;
+        attrToken(t);
+        return;
     }
-    pos += consumed;
     
-    // 5. String table
-    const char* stringTable = nullptr;
-    if (stringTableLen > 0) {
-        if (pos + stringTableLen > wmlcLen) {
-            output[0] = '\0';
-            return 0;
+    if (t == WMLCDecompiler::WBXML_STR_I || variable) {
+        if (variable) {
+            // Variable in attribute (inline string)
+            emit("$(");
+        }
+        operand = INLINE;
+        pendingToken = t;
+    } else if (t == WMLCDecompiler::WBXML_STR_T || t == WMLCDecompiler::WBXML_ENTITY ||
+               (t >= WMLCDecompiler::WBXML_EXT_T_0 && t <= WMLCDecompiler::WBXML_EXT_T_2)) {
+        operand = NUMBER;
+        pendingToken = t;
+        number = 0;
+    } else if (t >= 0x80) {
+        const WMLCToken& attr = WMLCDecompiler::attribute(t);
+        if (attr.value) {
+            emit(attr.value, attr.valueLen);
         }
-        stringTable = (const char*)&wmlc[pos];
-        pos += stringTableLen;
     }
+}
+
+void WMLCStreamDecompiler::numberDone() {
+    unsigned long value = number;
+    number = 0;
+    operand = NONE;
     
-    // Write XML declaration
-    append("<?xml version=\"1.0\"?>\n");
-    
-    // Write DOCTYPE based on public ID
-    // WML 1.1 = 0x04, WML 1.2 = 0x09, WML 1.3 = 0x0A
-    if (publicId == 0x04) {
-        append("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.1//EN\" \"http://www.wapforum.org/DTD/wml_1.1.xml\">\n");
-    } else if (publicId == 0x09) {
-        append("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.2//EN\" \"http://www.wapforum.org/DTD/wml12.dtd\">\n");
-    } else if (publicId == 0x0A) {
-        append("<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.3//EN\" \"http://www.wapforum.org/DTD/wml13.dtd\">\n");
+    switch (pendingToken) {
+        case WMLCDecompiler::WBXML_ENTITY: {
+            // Character entity
+            char entityBuf[16];
+            int n = snprintf(entityBuf, sizeof(entityBuf), "&#%lu;", value);
+            emit(entityBuf, (size_t)n);
+            break;
+        }
+            
+        case WMLCDecompiler::WBXML_STR_T: {
+            // String table reference
+            const char* str = tableString(value);
+            if (str) {
+                emitEscaped(str, strlen(str));
+            }
+            break;
+        }
+            
+        case WMLCDecompiler::WBXML_EXT_T_0:
+        case WMLCDecompiler::WBXML_EXT_T_1:
+        case WMLCDecompiler::WBXML_EXT_T_2: {
+            // Extension with string table reference - output as variable
+            const char* str = tableString(value);
+            emit("$(");
+            if (str) {
+                emitString(str);
+            }
+            if (pendingToken == WMLCDecompiler::WBXML_EXT_T_1) emit(":e");
+            else if (pendingToken == WMLCDecompiler::WBXML_EXT_T_2) emit(":u");
+            emit(")");
+            break;
+        }
+            
+        case WMLCDecompiler::WBXML_OPAQUE:
+            // Skip opaque data for now (could be image data, etc.)
+            if (value > 0) {
+                skipLeft = value;
+                operand = SKIP_OPAQUE;
+            }
+            break;
+            
+        default: {
+            if (context == ATTRS) {
+                // Attribute whose name is in the string table
+                const char* attrName = tableString(value);
+                emit(" ");
+                emitString(attrName ? attrName : "unknown");
+                emit("=\"");
+                context = ATTR_VALUE;
+                break;
+            }
+            
+            // Literal element from string table
+            const char* elemName = tableString(value);
+            openName = elemName ? elemName : "unknown";
+            openNameLen = strlen(openName);
+            emit("<");
+            emit(openName, openNameLen);
+            openHasContent = pendingToken == WMLCDecompiler::WBXML_LITERAL_C ||
+                             pendingToken == WMLCDecompiler::WBXML_LITERAL_AC;
+            if (pendingToken == WMLCDecompiler::WBXML_LITERAL_A ||
+                pendingToken == WMLCDecompiler::WBXML_LITERAL_AC) {
+                context = ATTRS;
+            } else {
+                openDone();
+            }
+            break;
+        }
     }
-    
-    // 6. Body - decompile the rest
-    if (pos < wmlcLen) {
-        outPos += decompileBody(&wmlc[pos], wmlcLen - pos, 
-                                stringTable, stringTableLen,
-                                &output[outPos], outputSize - outPos, 0);
+}
+
+void WMLCStreamDecompiler::inlineDone() {
+    operand = NONE;
+    // Add escape suffix based on extension type
+    if (pendingToken == WMLCDecompiler::WBXML_EXT_I_1) emit(":e)");
+    else if (pendingToken == WMLCDecompiler::WBXML_EXT_I_2) emit(":u)");
+    else if (pendingToken == WMLCDecompiler::WBXML_EXT_I_0) emit(")");
+}
+
+void WMLCStreamDecompiler::openDone() {
+    context = CONTENT;
+    if (!openHasContent) {
+        emit("/>");
+        return;
+    }
+    if (depth >= WMLC_MAX_DEPTH) {
+        fail("elements nested too deeply");
+        return;
+    }
+    emit(">");
+    elementStack[depth] = openName;
+    elementLen[depth++] = openNameLen;
+}
+
+void WMLCStreamDecompiler::closeElement() {
+    if (depth > 0) {
+        depth--;
+        emit("</");
+        emit(elementStack[depth], elementLen[depth]);
+        emit(">");
+    }
+}
+
+WMLCStreamStatus WMLCStreamDecompiler::finish() {
+    if (stage == FAILED || stage == DONE) {
+        return result();
+    }
+    if (stage != BODY) {
+        fail(stage == STRING_TABLE ? "string table truncated" : "header truncated");
+        return result();
     }
     
-    // Ensure null termination
-    if (outPos < outputSize) {
-        output[outPos] = '\0';
-    } else if (outputSize > 0) {
-        output[outputSize - 1] = '\0';
+    // A token cut off at the end is written as far as it came
+    if (operand == INLINE) {
+        inlineDone();
+    }
+    if (context == ATTR_VALUE) {
+        emit("\"");
+        context = ATTRS;
+    }
+    if (context != CONTENT) {
+        openDone();
     }
     
-    return outPos;
+    // Close any remaining open elements
+    while (stage != FAILED && depth > 0) {
+        closeElement();
+    }
+    if (stage != FAILED) {
+        stage = DONE;
+    }
+    return result();
 }
@@ -20,6 +20,24 @@
 #include <cstdint>
 #include <cstddef>
 
+#include "wml_sink.h"
+
+#ifndef WMLC_MAX_STRING_TABLE
+#define WMLC_MAX_STRING_TABLE 1024  // Largest string table kept while streaming (Kannel's are a few hundred bytes)
+#endif
+
+#define WMLC_MAX_DEPTH 32           // Deepest element nesting
+
+/**
+ * Text of a WML tag or attribute token, with its length
+ */
+struct WMLCToken {
+    const char* name;           // Element or attribute name, nullptr for attribute values and unknown tokens
+    const char* value;          // Attribute value (or the start of it), nullptr if none
+    uint8_t nameLen;
+    uint8_t valueLen;
+};
+
 /**
  * WMLC (Compiled WML) Decompiler
  * 
@@ -35,11 +53,22 @@ public:
      * @param wmlcLen Length of WMLC data
      * @param output Output buffer for WML text
      * @param outputSize Size of output buffer
-     * @return Number of bytes written to output, or 0 on error
+     * @return Number of bytes written to output, or 0 on error or if the text doesn't fit
      */
     static size_t decompile(const uint8_t* wmlc, size_t wmlcLen, 
                             char* output, size_t outputSize);
     
+    /**
+     * Decompile WMLC binary to WML text, written to a sink as it is decoded.
+     * A WMLCountingSink gives the exact length of the text without keeping it.
+     * 
+     * @param wmlc Input WMLC binary data
+     * @param wmlcLen Length of WMLC data
+     * @param output Where the text goes (may have received part of it on error)
+     * @return false on error
+     */
+    static bool decompile(const uint8_t* wmlc, size_t wmlcLen, WMLSink& output);
+    
     /**
      * Get the WBXML version from WMLC header.
      * 
@@ -59,6 +88,9 @@ public:
     static unsigned long getPublicId(const uint8_t* wmlc, size_t wmlcLen);
 
 private:
+    friend class WMLCStreamDecompiler;
+    friend class WMLCCompiler;
+
     // WBXML global tokens
     static const uint8_t WBXML_SWITCH_PAGE = 0x00;
     static const uint8_t WBXML_END = 0x01;
@@ -88,19 +120,139 @@ private:
     // Helper to decode multibyte integer (like uintvar)
     static size_t decodeMbUint(const uint8_t* data, size_t len, unsigned long* value);
     
-    // Get element name from token
-    static const char* getElementName(uint8_t token);
-    
-    // Get attribute name from token
-    static const char* getAttributeName(uint8_t token, const char** value);
+    // Element of a tag token (content and attribute bits ignored)
+    static const WMLCToken& element(uint8_t token);
     
-    // Get attribute value token string
-    static const char* getAttributeValue(uint8_t token);
-    
-    // Decompile body content
-    static size_t decompileBody(const uint8_t* data, size_t len, 
-                                const char* stringTable, size_t stringTableLen,
-                                char* output, size_t outputSize, int indent);
+    // Attribute start (< 0x80) or attribute value (>= 0x80) token
+    static const WMLCToken& attribute(uint8_t token);
+};
+
+enum WMLCStreamStatus {
+    WMLC_STREAM_OK,             // Everything fed so far decoded, text written up to the last complete token
+    WMLC_STREAM_ERROR           // Malformed header, string table larger than the buffer, or nesting too deep
+};
+
+/**
+ * Push-style WMLC decompiler
+ *
+ * Takes a WMLC document in chunks of any size (e.g. WDP parts as they come off
+ * the mesh) and writes the WML text of every token as soon as the token is
+ * complete. Keeps only the string table, the open elements and the part of a
+ * multi-byte integer a chunk ended in; inline strings go out as they arrive.
+ *
+ * Usage:
+ *   WMLCStreamDecompiler wml(&sink);
+ *   wml.feed(chunk, chunkLen);                  // ... for every chunk, in order
+ *   wml.finish();                               // Closes the elements left open
+ */
+class WMLCStreamDecompiler {
+public:
+    /**
+     * @param output Where the text goes, nullptr only counts it (see bytesOut())
+     */
+    explicit WMLCStreamDecompiler(WMLSink* output = nullptr);
+
+    /**
+     * Start over for a new document
+     */
+    void reset(WMLSink* output);
+
+    /**
+     * Decompile the next bytes of the document
+     *
+     * @return Status, stays WMLC_STREAM_ERROR until reset()
+     */
+    WMLCStreamStatus feed(const uint8_t* data, size_t len);
+
+    /**
+     * End of the document: finishes a cut-off token and closes the open elements
+     *
+     * @return WMLC_STREAM_ERROR if the header or string table never completed
+     */
+    WMLCStreamStatus finish();
+
+    WMLCStreamStatus result() const { return stage == FAILED ? WMLC_STREAM_ERROR : WMLC_STREAM_OK; }
+
+    /**
+     * Header and string table are in, body tokens are being decoded
+     */
+    bool started() const { return stage >= BODY && stage != FAILED; }
+
+    /**
+     * Bytes of WML text written so far
+     */
+    size_t bytesOut() const { return written; }
+
+    const char* error() const { return errorText ? errorText : ""; }
+
+private:
+    enum Stage { VERSION, PUBLIC_ID, PUBLIC_ID_INDEX, CHARSET, STRING_TABLE_LEN, STRING_TABLE,
+                 BODY, DONE, FAILED };
+
+    // Where in the body the next token is
+    enum Context {
+        CONTENT,                // Element content
+        ATTRS,                  // Attribute list of an element, between attributes
+        ATTR_VALUE              // Value of an attribute
+    };
+
+    // What the next body bytes belong to
+    enum Operand {
+        NONE,                   // Next byte is a token
+        NUMBER,                 // Multi-byte integer of pendingToken
+        INLINE,                 // Inline string of pendingToken (STR_I or EXT_I_*)
+        SKIP_BYTE,              // Code page of SWITCH_PAGE
+        SKIP_OPAQUE             // Data of OPAQUE
+    };
+
+    WMLSink* out;
+    size_t written;
+    const char* errorText;
+
+    Stage stage;
+    Context context;
+    Operand operand;
+    uint8_t pendingToken;
+    uint8_t numberBytes;
+    unsigned long number;       // Multi-byte integer being read, carried across chunks
+    unsigned long publicId;
+    unsigned long skipLeft;
+
+    // Element whose attribute list is being read
+    const char* openName;
+    size_t openNameLen;
+    bool openHasContent;
+
+    const char* elementStack[WMLC_MAX_DEPTH];
+    size_t elementLen[WMLC_MAX_DEPTH];
+    int depth;
+
+    size_t stringTableLen;
+    size_t stringTableGot;
+    char stringTable[WMLC_MAX_STRING_TABLE + 1];    // Terminated, so a bad offset can't run off the end
+
+    void fail(const char* text);
+    void emit(const char* text, size_t len);
+    void emitString(const char* text);
+    void emitEscaped(const char* text, size_t len);     // String data, escaped for WML
+
+    // Literal text, length known at compile time
+    template <size_t N>
+    void emit(const char (&text)[N]) { emit(text, N - 1); }
+
+    const char* tableString(unsigned long offset) const;
+
+    bool readNumber(uint8_t b);
+    void headerByte(uint8_t b);
+    void startBody();
+    void token(uint8_t t);
+    void contentToken(uint8_t t);
+    void attrToken(uint8_t t);
+    void attrValueToken(uint8_t t);
+    void numberDone();
+    void inlineDone();
+    void openDone();
+    void closeElement();
 };
 
 #endif // WMLC_DECOMPILER_H
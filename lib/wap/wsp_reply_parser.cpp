@@ -0,0 +1,128 @@
+/**
+ * wsp_reply_parser.cpp - Resumable WSP Reply PDU parser implementation
+ *
+ * Reply PDU layout (WAP-230-WSP 8.2.3.3):
+ *   [TID] Type(0x04) Status HeadersLen(uintvar) ContentType+Headers Data
+ */
+
+#include "wsp_reply_parser.h"
+#include "wap_request.h"
+#include "wap_response.h"
+#include <cstring>
+
+WSPReplyParser::WSPReplyParser(bool withTID) {
+    reset(withTID);
+}
+
+void WSPReplyParser::reset(bool withTID) {
+    stage = withTID ? TID : PDU_TYPE;
+    statusKnown = false;
+    status = 0;
+    uintvarBytes = 0;
+    headersLen = 0;
+    headersGot = 0;
+    offset = 0;
+    errorText = nullptr;
+}
+
+void WSPReplyParser::fail(const char* text) {
+    stage = FAILED;
+    errorText = text;
+}
+
+WSPReplyStatus WSPReplyParser::result() const {
+    return stage == BODY ? WSP_REPLY_HEADERS :
+           stage == FAILED ? WSP_REPLY_ERROR : WSP_REPLY_NEED_MORE;
+}
+
+int WSPReplyParser::statusCode() const {
+    return statusKnown ? WAPRequest::wspStatusToHttp(status) : 0;
+}
+
+WSPReplyStatus WSPReplyParser::feed(const uint8_t* data, size_t len, size_t* used) {
+    size_t pos = 0;
+    while (pos < len && stage != BODY && stage != FAILED) {
+        uint8_t b = data[pos];
+        switch (stage) {
+            case TID:
+                pos++;
+                stage = PDU_TYPE;
+                break;
+
+            case PDU_TYPE:
+                pos++;
+                if (b != WSP_PDU_REPLY) {
+                    fail("not a Reply PDU");
+                    break;
+                }
+                stage = STATUS;
+                break;
+
+            case STATUS:
+                pos++;
+                status = b;
+                statusKnown = true;
+                stage = HEADERS_LEN;
+                break;
+
+            case HEADERS_LEN:
+                // uintvar, 7 bits per byte, continuation bit set on all but the last
+                pos++;
+                headersLen = (headersLen << 7) | (b & 0x7F);
+                if (++uintvarBytes > 5) {
+                    fail("invalid headers length");
+                    break;
+                }
+                if (b & 0x80) {
+                    break;
+                }
+                if (headersLen > sizeof(headers)) {
+                    fail("header block larger than the buffer");
+                    break;
+                }
+                stage = headersLen > 0 ? HEADERS : BODY;
+                break;
+
+            case HEADERS: {
+                // Copy as much of the header block as this chunk holds
+                size_t n = headersLen - headersGot;
+                if (n > len - pos) {
+                    n = len - pos;
+                }
+                memcpy(&headers[headersGot], &data[pos], n);
+                headersGot += n;
+                pos += n;
+                if (headersGot == headersLen) {
+                    stage = BODY;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    offset += pos;
+    if (used) {
+        *used = pos;
+    }
+    return result();
+}
+
+bool WSPReplyParser::decode(HTTPResponse* response) const {
+    if (stage != BODY || response == nullptr) {
+        return false;
+    }
+
+    memset(response, 0, sizeof(HTTPResponse));
+    response->wspStatus = status;
+    response->statusCode = WAPRequest::wspStatusToHttp(status);
+    strncpy(response->statusText, WAPResponse::httpStatusToText(response->statusCode),
+            sizeof(response->statusText) - 1);
+    response->rawHeaders = headers;
+    response->rawHeadersLen = headersLen;
+    if (headersLen > 0) {
+        WAPResponse::parseHeaders(headers, headersLen, response);
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+/**
+ * wsp_reply_parser.h - Resumable WSP Reply PDU parser
+ *
+ * Takes a WSP Reply PDU in chunks of any size (e.g. WDP parts as they come
+ * off the mesh) and reports exactly when the status and the complete header
+ * block are in, and where the body starts. The header block is kept in a
+ * fixed buffer until it is complete, the body is never copied.
+ *
+ * Usage:
+ *   WSPReplyParser reply;                       // PDU starts with the transaction ID
+ *   size_t used;
+ *   if (reply.feed(part, partLen, &used) == WSP_REPLY_HEADERS) {
+ *       reply.decode(&response);                // Status and headers
+ *       ... body starts at part + used, and continues in the following parts
+ *   }
+ */
+
+#ifndef WSP_REPLY_PARSER_H
+#define WSP_REPLY_PARSER_H
+
+#include "wap_types.h"
+
+#ifndef WSP_REPLY_MAX_HEADERS
+#define WSP_REPLY_MAX_HEADERS 256   // Largest header block kept (WAPBox replies use < 100 bytes)
+#endif
+
+enum WSPReplyStatus {
+    WSP_REPLY_NEED_MORE,        // Header block not complete yet, feed more bytes
+    WSP_REPLY_HEADERS,          // Status and headers are in, the body follows
+    WSP_REPLY_ERROR             // Not a Reply PDU, or a header block larger than the buffer
+};
+
+class WSPReplyParser {
+public:
+    /**
+     * @param withTID PDU starts with the transaction ID (as WAPBox sends it)
+     */
+    explicit WSPReplyParser(bool withTID = true);
+
+    /**
+     * Start over for a new PDU
+     */
+    void reset(bool withTID = true);
+
+    /**
+     * Parse the next bytes of the PDU
+     *
+     * @param data Next bytes of the PDU
+     * @param len Number of bytes
+     * @param used Set to the bytes that belong to the status and headers,
+     *             data + used is the start of the body on WSP_REPLY_HEADERS
+     *             (0 once the headers were complete before this call)
+     * @return Status, stays WSP_REPLY_HEADERS or WSP_REPLY_ERROR until reset()
+     */
+    WSPReplyStatus feed(const uint8_t* data, size_t len, size_t* used = nullptr);
+
+    WSPReplyStatus result() const;
+
+    /**
+     * Status byte parsed (available before the headers are complete)
+     */
+    bool hasStatus() const { return statusKnown; }
+
+    /**
+     * HTTP status code, 0 until hasStatus()
+     */
+    int statusCode() const;
+
+    uint8_t wspStatus() const { return status; }
+
+    /**
+     * Offset of the body from the start of the PDU, once the headers are complete
+     */
+    size_t bodyOffset() const { return offset; }
+
+    /**
+     * Fill status and headers of a response (body left empty)
+     *
+     * @return false until the headers are complete
+     */
+    bool decode(HTTPResponse* response) const;
+
+    const char* error() const { return errorText ? errorText : ""; }
+
+private:
+    enum Stage { TID, PDU_TYPE, STATUS, HEADERS_LEN, HEADERS, BODY, FAILED };
+
+    Stage stage;
+    bool statusKnown;
+    uint8_t status;
+    uint8_t uintvarBytes;
+    unsigned long headersLen;
+    size_t headersGot;
+    size_t offset;              // PDU bytes parsed
+    const char* errorText;
+    uint8_t headers[WSP_REPLY_MAX_HEADERS];
+
+    void fail(const char* text);
+};
+
+#endif // WSP_REPLY_PARSER_H
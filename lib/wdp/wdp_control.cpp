@@ -0,0 +1,110 @@
+/**
+ * wdp_control.cpp - Control frames between the WDP gateways
+ * 
+ */
+
+#include "wdp_control.h"
+#include "wdp_fec.h"
+
+#include <cstring>
+
+static size_t bitmapLen(uint8_t totalParts) {
+    return ((size_t)totalParts + 7) / 8;
+}
+
+size_t WDPControl::writeNack(uint8_t* out, const WDPNack& nack) {
+    size_t len = bitmapLen(nack.totalParts);
+    out[0] = WDP_CONTROL_NACK;
+    out[1] = nack.refNum;
+    out[2] = nack.totalParts;
+    out[3] = (nack.port >> 8) & 0xFF;
+    out[4] = nack.port & 0xFF;
+    memcpy(&out[5], nack.missing, len);
+    if ((nack.totalParts & 7) != 0) {
+        out[5 + len - 1] &= (uint8_t)((1 << (nack.totalParts & 7)) - 1);  // No bits beyond the last part
+    }
+    return 5 + len;
+}
+
+bool WDPControl::parseNack(const uint8_t* data, size_t len, WDPNack& nack, const char** error) {
+    const char* reason = nullptr;
+    if (data == nullptr || len < 5 || data[0] != WDP_CONTROL_NACK) {
+        reason = "not a NACK frame";
+    } else if (data[2] == 0) {
+        reason = "NACK for zero parts";
+    } else if (len != 5 + bitmapLen(data[2])) {
+        reason = "NACK bitmap length does not match part count";
+    } else if (((data[3] << 8) | data[4]) == 0) {
+        reason = "zero port number";
+    }
+    if (reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    }
+
+    nack.refNum = data[1];
+    nack.totalParts = data[2];
+    nack.port = (data[3] << 8) | data[4];
+    memset(nack.missing, 0, sizeof(nack.missing));
+    memcpy(nack.missing, &data[5], bitmapLen(nack.totalParts));
+    if ((nack.totalParts & 7) != 0) {
+        nack.missing[bitmapLen(nack.totalParts) - 1] &= (uint8_t)((1 << (nack.totalParts & 7)) - 1);
+    }
+    return true;
+}
+
+int WDPControl::missingCount(const WDPNack& nack) {
+    int count = 0;
+    for (int part = 1; part <= nack.totalParts; part++) {
+        if (isMissing(nack, (uint8_t)part)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t WDPControl::writeParityHeader(uint8_t* out, const WDPParity& parity) {
+    out[0] = WDP_CONTROL_PARITY;
+    out[1] = parity.refNum;
+    out[2] = parity.totalParts;
+    out[3] = (parity.port >> 8) & 0xFF;
+    out[4] = parity.port & 0xFF;
+    out[5] = parity.firstPart;
+    out[6] = parity.groupSize;
+    out[7] = (uint8_t)((parity.index << 4) | (parity.count & 0x0F));
+    return WDP_PARITY_HEADER_LEN;
+}
+
+size_t WDPControl::parseParity(const uint8_t* data, size_t len, WDPParity& parity, const char** error) {
+    const char* reason = nullptr;
+    if (data == nullptr || len < WDP_PARITY_HEADER_LEN || data[0] != WDP_CONTROL_PARITY) {
+        reason = "not a parity frame";
+    } else if (len < WDP_PARITY_HEADER_LEN + 2 || len > WDP_PARITY_HEADER_LEN + WDP_FEC_MAX_BLOCK) {
+        reason = "parity block length out of range";
+    } else {
+        parity.refNum = data[1];
+        parity.totalParts = data[2];
+        parity.port = (data[3] << 8) | data[4];
+        parity.firstPart = data[5];
+        parity.groupSize = data[6];
+        parity.index = data[7] >> 4;
+        parity.count = data[7] & 0x0F;
+        if (parity.port == 0) {
+            reason = "zero port number";
+        } else if (parity.firstPart == 0 || parity.groupSize == 0 || parity.groupSize > WDP_FEC_MAX_GROUP ||
+                   parity.firstPart + parity.groupSize - 1 > parity.totalParts) {
+            reason = "parity group out of range";
+        } else if (parity.count == 0 || parity.count > WDP_FEC_MAX_PARITY || parity.index >= parity.count) {
+            reason = "invalid parity index";
+        }
+    }
+    if (reason) {
+        if (error) {
+            *error = reason;
+        }
+        return 0;
+    }
+    return WDP_PARITY_HEADER_LEN;
+}
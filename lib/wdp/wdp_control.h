@@ -0,0 +1,114 @@
+/**
+ * wdp_control.h - Control frames between the WDP gateways
+ * 
+ * Control frames travel over the mesh like WDP messages (Base91 or COBS) and
+ * start with a byte no WDP header uses (0xA8..0xAF), so receivers can tell
+ * them apart before parsing a header.
+ * 
+ * NACK (AP -> proxy, asks for the parts of a response that never arrived):
+ *   [0xA8] [ref] [total] [port_hi port_lo] [missing bitmap, (total + 7) / 8 bytes]
+ *   port is the client port the response was sent to,
+ *   bit (part - 1) is set for every missing part (LSB first)
+ * 
+ * PARITY (proxy -> AP, FEC over a group of parts, see wdp_fec.h):
+ *   [0xA9] [ref] [total] [port_hi port_lo] [first part] [group size] [index << 4 | count] [parity block]
+ *   the group is parts first..first+size-1, the block is index of count parity blocks
+ */
+
+#ifndef WDP_CONTROL_H
+#define WDP_CONTROL_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define WDP_CONTROL_MASK        0xF8
+#define WDP_CONTROL_PREFIX      0xA8    // First byte of every control frame, low bits are the type
+#define WDP_CONTROL_NACK        0xA8
+#define WDP_CONTROL_PARITY      0xA9
+
+#define WDP_NACK_BITMAP_LEN     32      // Up to 255 parts
+#define WDP_NACK_MAX_LEN        (5 + WDP_NACK_BITMAP_LEN)
+#define WDP_PARITY_HEADER_LEN   8
+
+/**
+ * Missing parts of a concatenated message
+ */
+struct WDPNack {
+    uint8_t refNum;
+    uint8_t totalParts;
+    uint16_t port;                          // Destination (client) port of the message
+    uint8_t missing[WDP_NACK_BITMAP_LEN];   // Bit (part - 1) set = part missing
+};
+
+/**
+ * Parity block of a group of parts (the block itself follows the header)
+ */
+struct WDPParity {
+    uint8_t refNum;
+    uint8_t totalParts;
+    uint16_t port;                          // Destination (client) port of the message
+    uint8_t firstPart;                      // First part of the group
+    uint8_t groupSize;                      // Parts in the group
+    uint8_t index;                          // Parity block index in the group
+    uint8_t count;                          // Parity blocks sent for the group
+};
+
+class WDPControl {
+public:
+    /**
+     * Check whether a message is a control frame rather than a WDP message
+     */
+    static bool isControl(const uint8_t* data, size_t len) {
+        return len > 0 && (data[0] & WDP_CONTROL_MASK) == WDP_CONTROL_PREFIX;
+    }
+
+    /**
+     * Write a NACK frame
+     * 
+     * @param out Output buffer of at least WDP_NACK_MAX_LEN bytes
+     * @param nack Missing parts
+     * @return Frame length
+     */
+    static size_t writeNack(uint8_t* out, const WDPNack& nack);
+
+    /**
+     * Parse and validate a NACK frame
+     * 
+     * @param data Frame
+     * @param len Length of frame
+     * @param nack Decoded missing parts (bits beyond totalParts are cleared)
+     * @param error If not nullptr, set to a description when the frame is invalid
+     * @return true if valid
+     */
+    static bool parseNack(const uint8_t* data, size_t len, WDPNack& nack,
+                          const char** error = nullptr);
+
+    static bool isMissing(const WDPNack& nack, uint8_t part) {
+        uint8_t index = part - 1;
+        return part > 0 && (nack.missing[index >> 3] & (1 << (index & 7)));
+    }
+
+    static int missingCount(const WDPNack& nack);
+
+    /**
+     * Write a parity frame header, the parity block goes right after it
+     * 
+     * @param out Output buffer of at least WDP_PARITY_HEADER_LEN bytes
+     * @return Header length
+     */
+    static size_t writeParityHeader(uint8_t* out, const WDPParity& parity);
+
+    /**
+     * Parse and validate a parity frame
+     * 
+     * @param data Frame
+     * @param len Length of frame
+     * @param parity Decoded header
+     * @param error If not nullptr, set to a description when the frame is invalid
+     * @return Header length (the block is the rest of the frame), or 0 if invalid
+     */
+    static size_t parseParity(const uint8_t* data, size_t len, WDPParity& parity,
+                              const char** error = nullptr);
+};
+
+#endif // WDP_CONTROL_H
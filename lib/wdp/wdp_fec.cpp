@@ -0,0 +1,156 @@
+/**
+ * wdp_fec.cpp - Forward error correction for concatenated WDP messages
+ * 
+ */
+
+#include "wdp_fec.h"
+
+#include <cstring>
+
+// GF(256) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D), generator 2
+static uint8_t GF_EXP[512];
+static uint8_t GF_LOG[256];
+static bool gfReady = false;
+
+static void gfInit() {
+    if (gfReady) {
+        return;
+    }
+    uint16_t x = 1;
+    for (int i = 0; i < 255; i++) {
+        GF_EXP[i] = (uint8_t)x;
+        GF_LOG[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11D;
+        }
+    }
+    for (int i = 255; i < 512; i++) {
+        GF_EXP[i] = GF_EXP[i - 255];  // mul() skips the mod 255
+    }
+    gfReady = true;
+}
+
+uint8_t WDPFec::mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    gfInit();
+    return GF_EXP[GF_LOG[a] + GF_LOG[b]];
+}
+
+uint8_t WDPFec::inv(uint8_t a) {
+    gfInit();
+    return GF_EXP[255 - GF_LOG[a]];  // a is never 0 here
+}
+
+void WDPFec::mulAdd(uint8_t* block, uint8_t c, const uint8_t* data, size_t len) {
+    if (c == 0) {
+        return;
+    }
+    gfInit();
+    const uint8_t* expc = &GF_EXP[GF_LOG[c]];
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0) {
+            block[i] ^= expc[GF_LOG[data[i]]];
+        }
+    }
+}
+
+void WDPFec::encode(const uint8_t* const* parts, const size_t* lens, int groupSize,
+                    int index, uint8_t* block, size_t blockLen) {
+    memset(block, 0, blockLen);
+    for (int i = 0; i < groupSize; i++) {
+        uint8_t c = coefficient(index, i);
+        uint8_t len = (uint8_t)lens[i];
+        block[0] ^= mul(c, len);
+        mulAdd(&block[1], c, parts[i], lens[i]);
+    }
+}
+
+bool WDPFec::decode(uint8_t* const* parts, size_t* lens, const bool* present, int groupSize,
+                    const uint8_t* const* blocks, const uint8_t* indexes, int blockCount,
+                    size_t blockLen) {
+    int missing[WDP_FEC_MAX_PARITY];
+    int r = 0;
+    for (int i = 0; i < groupSize; i++) {
+        if (!present[i]) {
+            if (r == WDP_FEC_MAX_PARITY || r == blockCount) {
+                return false;
+            }
+            missing[r++] = i;
+        }
+    }
+    if (r == 0) {
+        return true;
+    }
+    if (blockLen < 2 || blockLen > WDP_FEC_MAX_BLOCK) {
+        return false;
+    }
+
+    // Remove the received parts from the first r parity blocks:
+    // syndrome[a] = sum over missing parts b of C[indexes[a]][missing[b]] * block_b
+    uint8_t syndrome[WDP_FEC_MAX_PARITY][WDP_FEC_MAX_BLOCK];
+    for (int a = 0; a < r; a++) {
+        memcpy(syndrome[a], blocks[a], blockLen);
+        for (int i = 0; i < groupSize; i++) {
+            if (present[i]) {
+                uint8_t c = coefficient(indexes[a], i);
+                syndrome[a][0] ^= mul(c, (uint8_t)lens[i]);
+                mulAdd(&syndrome[a][1], c, parts[i], lens[i]);
+            }
+        }
+    }
+
+    // Invert the r x r submatrix by Gauss-Jordan elimination
+    uint8_t m[WDP_FEC_MAX_PARITY][WDP_FEC_MAX_PARITY];
+    uint8_t minv[WDP_FEC_MAX_PARITY][WDP_FEC_MAX_PARITY];
+    for (int a = 0; a < r; a++) {
+        for (int b = 0; b < r; b++) {
+            m[a][b] = coefficient(indexes[a], missing[b]);
+            minv[a][b] = (a == b) ? 1 : 0;
+        }
+    }
+    for (int col = 0; col < r; col++) {
+        int pivot = col;
+        while (pivot < r && m[pivot][col] == 0) {
+            pivot++;
+        }
+        if (pivot == r) {
+            return false;  // Duplicate parity block indexes
+        }
+        for (int b = 0; b < r; b++) {
+            uint8_t t = m[col][b]; m[col][b] = m[pivot][b]; m[pivot][b] = t;
+            t = minv[col][b]; minv[col][b] = minv[pivot][b]; minv[pivot][b] = t;
+        }
+        uint8_t scale = inv(m[col][col]);
+        for (int b = 0; b < r; b++) {
+            m[col][b] = mul(m[col][b], scale);
+            minv[col][b] = mul(minv[col][b], scale);
+        }
+        for (int a = 0; a < r; a++) {
+            if (a != col && m[a][col] != 0) {
+                uint8_t f = m[a][col];
+                for (int b = 0; b < r; b++) {
+                    m[a][b] ^= mul(f, m[col][b]);
+                    minv[a][b] ^= mul(f, minv[col][b]);
+                }
+            }
+        }
+    }
+
+    // block_b = sum over a of minv[b][a] * syndrome[a]
+    uint8_t block[WDP_FEC_MAX_BLOCK];
+    for (int b = 0; b < r; b++) {
+        memset(block, 0, blockLen);
+        for (int a = 0; a < r; a++) {
+            mulAdd(block, minv[b][a], syndrome[a], blockLen);
+        }
+        if (block[0] > blockLen - 1) {
+            return false;  // Parity blocks don't belong to these parts
+        }
+        lens[missing[b]] = block[0];
+        memcpy(parts[missing[b]], &block[1], block[0]);
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * wdp_fec.h - Forward error correction for concatenated WDP messages
+ * 
+ * Systematic Reed-Solomon style erasure code over GF(256): the data parts of
+ * a group are sent as is, followed by up to WDP_FEC_MAX_PARITY parity blocks.
+ * Any r lost data parts of the group can be rebuilt from any r parity blocks.
+ * 
+ * Parts differ in length, so every part is coded as a block of
+ *   [part length] [part data] [zero padding]
+ * where the block length is one more than the longest part of the group.
+ * Parity block j is sum(C[j][i] * block_i) with the Cauchy matrix
+ *   C[j][i] = 1 / (i + (WDP_FEC_MAX_GROUP + j))     (+ is XOR in GF(256))
+ * Every square submatrix of a Cauchy matrix is invertible, so which parts
+ * and which parity blocks were lost doesn't matter, only how many.
+ */
+
+#ifndef WDP_FEC_H
+#define WDP_FEC_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define WDP_FEC_MAX_GROUP       16      // Data parts per group
+#define WDP_FEC_MAX_PARITY      4       // Parity blocks per group
+#define WDP_FEC_MAX_BLOCK       256     // Length byte + longest part
+
+class WDPFec {
+public:
+    /**
+     * Compute one parity block over a group of parts
+     * 
+     * @param parts Data of each part in the group
+     * @param lens Length of each part (at most blockLen - 1)
+     * @param groupSize Number of parts (1..WDP_FEC_MAX_GROUP)
+     * @param index Parity block index (0..WDP_FEC_MAX_PARITY-1)
+     * @param block Output parity block
+     * @param blockLen Length of the longest part + 1
+     */
+    static void encode(const uint8_t* const* parts, const size_t* lens, int groupSize,
+                       int index, uint8_t* block, size_t blockLen);
+
+    /**
+     * Rebuild the missing parts of a group
+     * 
+     * @param parts Data of each part, for missing parts a buffer of blockLen - 1 bytes
+     *              that receives the rebuilt data
+     * @param lens Length of each part, set for the rebuilt parts
+     * @param present Which parts were received
+     * @param groupSize Number of parts
+     * @param blocks Received parity blocks
+     * @param indexes Parity block index of each received block
+     * @param blockCount Number of received parity blocks
+     * @param blockLen Parity block length
+     * @return true if nothing was missing or every missing part was rebuilt,
+     *         false if more parts are missing than parity blocks were received
+     */
+    static bool decode(uint8_t* const* parts, size_t* lens, const bool* present, int groupSize,
+                       const uint8_t* const* blocks, const uint8_t* indexes, int blockCount,
+                       size_t blockLen);
+
+private:
+    static uint8_t mul(uint8_t a, uint8_t b);
+    static uint8_t inv(uint8_t a);
+    static uint8_t coefficient(int index, int part) {
+        return inv((uint8_t)(part ^ (WDP_FEC_MAX_GROUP + index)));
+    }
+    // block ^= c * data
+    static void mulAdd(uint8_t* block, uint8_t c, const uint8_t* data, size_t len);
+};
+
+#endif // WDP_FEC_H
@@ -0,0 +1,177 @@
+/**
+ * wdp_header.cpp - WDP datagram headers on the MeshCore bearer
+ * 
+ */
+
+#include "wdp_header.h"
+
+static size_t fail(const char** error, const char* message) {
+    if (error) {
+        *error = message;
+    }
+    return 0;
+}
+
+size_t WDPHeader::parse(const uint8_t* data, size_t len, WDPHeaderInfo& info, const char** error) {
+    if (data == nullptr || len == 0) {
+        return fail(error, "message too short");
+    }
+
+    info.concat = false;
+    info.refNum = 0;
+    info.totalParts = 1;
+    info.part = 1;
+
+    size_t hdrLen = isCompact(data, len) ? parseCompact(data, len, info, error)
+                                         : parseLegacy(data, len, info, error);
+    if (hdrLen == 0) {
+        return 0;
+    }
+
+    if (info.dstPort == 0 || info.srcPort == 0) {
+        return fail(error, "zero port number");
+    }
+    if (info.concat && (info.totalParts == 0 || info.part == 0 || info.part > info.totalParts)) {
+        return fail(error, "invalid concat part info");
+    }
+    return hdrLen;
+}
+
+size_t WDPHeader::parseLegacy(const uint8_t* data, size_t len, WDPHeaderInfo& info, const char** error) {
+    info.compact = false;
+
+    // Simple UDH: [0x06] [0x05] [0x04] [dest_hi] [dest_lo] [src_hi] [src_lo]
+    if (data[0] == WDP_HEADER_LEGACY_SIMPLE) {
+        if (len < 7) {
+            return fail(error, "message too short for UDH");
+        }
+        if (data[1] != 0x05) {
+            return fail(error, "unexpected element ID (expected 0x05 for port addressing)");
+        }
+        if (data[2] != 0x04) {
+            return fail(error, "unexpected element length (expected 0x04)");
+        }
+        info.dstPort = (data[3] << 8) | data[4];
+        info.srcPort = (data[5] << 8) | data[6];
+        return 7;
+    }
+
+    // Concatenated UDH: [0x0B] [0x00] [0x03] [ref] [total] [current] [0x05] [0x04] [dest_hi] [dest_lo] [src_hi] [src_lo]
+    if (data[0] == WDP_HEADER_LEGACY_CONCAT) {
+        if (len < 12) {
+            return fail(error, "message too short for UDH");
+        }
+        if (data[1] != 0x00 || data[2] != 0x03) {
+            return fail(error, "unexpected concat header");
+        }
+        if (data[6] != 0x05 || data[7] != 0x04) {
+            return fail(error, "unexpected port addressing header");
+        }
+        info.concat = true;
+        info.refNum = data[3];
+        info.totalParts = data[4];
+        info.part = data[5];
+        info.dstPort = (data[8] << 8) | data[9];
+        info.srcPort = (data[10] << 8) | data[11];
+        return 12;
+    }
+
+    return fail(error, "unexpected UDH header length (expected 0x06 or 0x0B)");
+}
+
+size_t WDPHeader::parseCompact(const uint8_t* data, size_t len, WDPHeaderInfo& info, const char** error) {
+    info.compact = true;
+
+    uint8_t flags = data[0] & ~WDP_HEADER_COMPACT_MASK;
+    if ((flags & WDP_COMPACT_DST_WSP) && (flags & WDP_COMPACT_SRC_WSP)) {
+        return fail(error, "compact header with both ports implied");
+    }
+
+    size_t pos = 1;
+    if (flags & WDP_COMPACT_CONCAT) {
+        if (len < pos + 2) {
+            return fail(error, "message too short for compact header");
+        }
+        info.concat = true;
+        info.refNum = data[pos];
+        info.part = (data[pos + 1] >> 4) + 1;
+        info.totalParts = (data[pos + 1] & 0x0F) + 1;
+        pos += 2;
+    }
+
+    bool impliedPort = (flags & (WDP_COMPACT_DST_WSP | WDP_COMPACT_SRC_WSP)) != 0;
+    if (len < pos + (impliedPort ? 2 : 4)) {
+        return fail(error, "message too short for compact header");
+    }
+    uint16_t port = (data[pos] << 8) | data[pos + 1];
+    if (flags & WDP_COMPACT_DST_WSP) {
+        info.dstPort = WDP_PORT_WSP;
+        info.srcPort = port;
+        return pos + 2;
+    }
+    if (flags & WDP_COMPACT_SRC_WSP) {
+        info.srcPort = WDP_PORT_WSP;
+        info.dstPort = port;
+        return pos + 2;
+    }
+    info.dstPort = port;
+    info.srcPort = (data[pos + 2] << 8) | data[pos + 3];
+    return pos + 4;
+}
+
+size_t WDPHeader::write(uint8_t* out, const WDPHeaderInfo& info) {
+    bool compact = info.compact && (!info.concat || info.totalParts <= WDP_COMPACT_MAX_PARTS);
+
+    if (!compact) {
+        if (!info.concat) {
+            out[0] = WDP_HEADER_LEGACY_SIMPLE;  // UDH length
+            out[1] = 0x05;  // Application Port Addressing, 16-bit
+            out[2] = 0x04;  // Length of port data
+            out[3] = (info.dstPort >> 8) & 0xFF;
+            out[4] = info.dstPort & 0xFF;
+            out[5] = (info.srcPort >> 8) & 0xFF;
+            out[6] = info.srcPort & 0xFF;
+            return 7;
+        }
+        out[0] = WDP_HEADER_LEGACY_CONCAT;  // UDH length
+        out[1] = 0x00;  // Concatenation IE identifier
+        out[2] = 0x03;  // Concatenation IE length
+        out[3] = info.refNum;
+        out[4] = info.totalParts;
+        out[5] = info.part;
+        out[6] = 0x05;  // Application Port Addressing, 16-bit
+        out[7] = 0x04;  // Length of port data
+        out[8] = (info.dstPort >> 8) & 0xFF;
+        out[9] = info.dstPort & 0xFF;
+        out[10] = (info.srcPort >> 8) & 0xFF;
+        out[11] = info.srcPort & 0xFF;
+        return 12;
+    }
+
+    uint8_t flags = 0;
+    size_t pos = 1;
+    if (info.concat) {
+        flags |= WDP_COMPACT_CONCAT;
+        out[pos++] = info.refNum;
+        out[pos++] = (uint8_t)(((info.part - 1) << 4) | ((info.totalParts - 1) & 0x0F));
+    }
+
+    if (info.dstPort == WDP_PORT_WSP && info.srcPort != WDP_PORT_WSP) {
+        flags |= WDP_COMPACT_DST_WSP;
+        out[pos++] = (info.srcPort >> 8) & 0xFF;
+        out[pos++] = info.srcPort & 0xFF;
+    } else if (info.srcPort == WDP_PORT_WSP && info.dstPort != WDP_PORT_WSP) {
+        flags |= WDP_COMPACT_SRC_WSP;
+        out[pos++] = (info.dstPort >> 8) & 0xFF;
+        out[pos++] = info.dstPort & 0xFF;
+    } else {
+        // Port override
+        out[pos++] = (info.dstPort >> 8) & 0xFF;
+        out[pos++] = info.dstPort & 0xFF;
+        out[pos++] = (info.srcPort >> 8) & 0xFF;
+        out[pos++] = info.srcPort & 0xFF;
+    }
+
+    out[0] = WDP_HEADER_COMPACT | flags;
+    return pos;
+}
@@ -0,0 +1,93 @@
+/**
+ * wdp_header.h - WDP datagram headers on the MeshCore bearer
+ * 
+ * Every WDP message sent over the mesh starts with a header carrying the
+ * port pair and, for messages split over several MeshCore messages, the
+ * concatenation info. Two formats exist:
+ * 
+ * Legacy (SMS-style UDH, understood by every node):
+ *   [0x06] [0x05 0x04 dst_hi dst_lo src_hi src_lo]                        7 bytes
+ *   [0x0B] [0x00 0x03 ref total part] [0x05 0x04 dst_hi dst_lo src_hi src_lo]  12 bytes
+ * 
+ * Compact (only sent to peers that advertised support):
+ *   [0xA0 | flags] [ref] [(part-1) << 4 | (total-1)] [port...]
+ *   flags: 0x01 CONCAT   - ref and part/total bytes present (max 16 parts)
+ *          0x02 DST_WSP  - destination is the WSP port (9200), port field is the source
+ *          0x04 SRC_WSP  - source is the WSP port (9200), port field is the destination
+ *          neither       - port override: destination and source ports follow (4 bytes)
+ *   Requests to and replies from the WAPBox take 3 bytes, or 5 bytes per part.
+ * 
+ * The first byte tells the formats apart: 0x06/0x0B vs 0xA0..0xA7.
+ */
+
+#ifndef WDP_HEADER_H
+#define WDP_HEADER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define WDP_PORT_WSP                9200    // Connectionless WSP (wap-wsp)
+
+#define WDP_HEADER_LEGACY_SIMPLE    0x06    // First byte (UDH length) of the 7-byte UDH
+#define WDP_HEADER_LEGACY_CONCAT    0x0B    // First byte (UDH length) of the 12-byte UDH
+#define WDP_HEADER_COMPACT          0xA0    // First byte of a compact header, low bits are flags
+#define WDP_HEADER_COMPACT_MASK     0xF8
+
+#define WDP_COMPACT_CONCAT          0x01
+#define WDP_COMPACT_DST_WSP         0x02
+#define WDP_COMPACT_SRC_WSP         0x04
+
+#define WDP_HEADER_MAX_LEN          12      // Legacy concat UDH
+#define WDP_HEADER_MIN_CONCAT_LEN   5       // Compact concat header with one implied port
+#define WDP_COMPACT_MAX_PARTS       16
+
+/**
+ * Decoded WDP header (either format)
+ */
+struct WDPHeaderInfo {
+    uint16_t srcPort;
+    uint16_t dstPort;
+    bool concat;            // Part of a concatenated message
+    uint8_t refNum;         // Concatenation reference (concat only)
+    uint8_t totalParts;     // 1..255 (concat only)
+    uint8_t part;           // 1..totalParts (concat only)
+    bool compact;           // Parsed from / to be written as a compact header
+};
+
+class WDPHeader {
+public:
+    /**
+     * Parse and validate the header at the start of a WDP message
+     * 
+     * @param data Message (header + payload)
+     * @param len Length of message
+     * @param info Decoded header
+     * @param error If not nullptr, set to a description when the header is invalid
+     * @return Header length (payload starts at data + length), or 0 if invalid
+     */
+    static size_t parse(const uint8_t* data, size_t len, WDPHeaderInfo& info,
+                        const char** error = nullptr);
+
+    /**
+     * Write a header, compact if info.compact is set and the message fits the
+     * compact format (at most 16 parts), legacy otherwise
+     * 
+     * @param out Output buffer of at least WDP_HEADER_MAX_LEN bytes
+     * @param info Header to write
+     * @return Header length
+     */
+    static size_t write(uint8_t* out, const WDPHeaderInfo& info);
+
+    /**
+     * Check whether a message starts with a compact header
+     */
+    static bool isCompact(const uint8_t* data, size_t len) {
+        return len > 0 && (data[0] & WDP_HEADER_COMPACT_MASK) == WDP_HEADER_COMPACT;
+    }
+
+private:
+    static size_t parseLegacy(const uint8_t* data, size_t len, WDPHeaderInfo& info, const char** error);
+    static size_t parseCompact(const uint8_t* data, size_t len, WDPHeaderInfo& info, const char** error);
+};
+
+#endif // WDP_HEADER_H
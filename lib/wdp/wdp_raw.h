@@ -0,0 +1,60 @@
+/**
+ * wdp_raw.h - Raw WDP frames, sent as MeshCore contact requests
+ *
+ * MeshCore decrypts a request to a whole AES block, so the receiver gets the
+ * frame followed by up to 15 zero bytes. The frame carries its own length:
+ *   [0xD7] [length] [WDP header + payload], length counts the bracketed WDP message
+ * Other requests (MeshCore status, telemetry, ...) use small type numbers
+ * and are not for the gateway.
+ */
+
+#ifndef WDP_RAW_H
+#define WDP_RAW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#define RAW_REQ_TYPE_WDP        0xD7
+#define WDP_RAW_HEADER_LEN      2       // Type byte and length byte
+
+class WDPRawFrame {
+public:
+    /**
+     * Write a raw frame, the header and payload are passed separately
+     *
+     * @param out Output buffer of at least WDP_RAW_HEADER_LEN + hdrLen + len bytes
+     * @return Frame length, or 0 if the WDP message is longer than 255 bytes
+     */
+    static size_t write(uint8_t* out, const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+        if (hdrLen + len > 0xFF) {
+            return 0;
+        }
+        out[0] = RAW_REQ_TYPE_WDP;
+        out[1] = (uint8_t)(hdrLen + len);
+        memcpy(&out[WDP_RAW_HEADER_LEN], hdr, hdrLen);
+        if (len > 0) {
+            memcpy(&out[WDP_RAW_HEADER_LEN + hdrLen], data, len);
+        }
+        return WDP_RAW_HEADER_LEN + hdrLen + len;
+    }
+
+    /**
+     * Find the WDP message in a decrypted request, block padding is dropped
+     *
+     * @param data Request as received
+     * @param len Length of request
+     * @param msgLen Length of the WDP message
+     * @return The WDP message, or nullptr if the request is not a (complete) raw frame
+     */
+    static const uint8_t* parse(const uint8_t* data, size_t len, size_t& msgLen) {
+        if (len < WDP_RAW_HEADER_LEN + 1 || data[0] != RAW_REQ_TYPE_WDP ||
+            data[1] == 0 || data[1] > len - WDP_RAW_HEADER_LEN) {
+            return nullptr;
+        }
+        msgLen = data[1];
+        return &data[WDP_RAW_HEADER_LEN];
+    }
+};
+
+#endif // WDP_RAW_H
@@ -0,0 +1,273 @@
+/**
+ * wdp_reassembler.h - Reassembly of concatenated WDP messages
+ *
+ * Parts of a concatenated message may arrive out of order and with different
+ * sizes (they are sized to fill each MeshCore message for the sender's codec).
+ * Each part is appended to its slot's buffer as it arrives, and the parts are
+ * put back in order in place once all of them are in. Parts that arrive in
+ * order are never moved.
+ *
+ * Slots are keyed by (sender prefix, reference number). A key's home slot is
+ * picked by hash, so lookups normally take one probe.
+ *
+ * Usage:
+ *   WDPReassembler<8192, 4> reassembler;
+ *   WDPReassembler<8192, 4>::Message* msg;
+ *   if (reassembler.addPart(sender, hdr, payload, len, millis(), &msg) == WDP_REASSEMBLY_COMPLETE) {
+ *       size_t total = reassembler.assemble(msg);   // msg->data[0..total)
+ *       ...
+ *       reassembler.release(msg);
+ *   }
+ */
+
+#ifndef WDP_REASSEMBLER_H
+#define WDP_REASSEMBLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include "wdp_header.h"
+
+#define WDP_MAX_PARTS   255     // Part numbers are one byte in the legacy UDH
+
+enum WDPReassemblyStatus {
+    WDP_REASSEMBLY_STORED,      // Part stored, more parts to come
+    WDP_REASSEMBLY_COMPLETE,    // Part stored and all parts are in, call assemble()
+    WDP_REASSEMBLY_DUPLICATE,   // Part was already received, ignored
+    WDP_REASSEMBLY_NO_SLOT,     // All slots busy with other messages
+    WDP_REASSEMBLY_OVERFLOW,    // Message does not fit the slot buffer
+    WDP_REASSEMBLY_INVALID      // Not a concat part, or part info out of range
+};
+
+template <size_t BufferSize, int Slots>
+class WDPReassembler {
+    static_assert(BufferSize <= 0x10000, "part offsets are 16-bit");
+
+public:
+    struct Message {
+        bool active;
+        uint32_t sender;                    // Sender node ID prefix
+        uint8_t refNum;
+        uint8_t totalParts;
+        uint8_t receivedParts;
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint32_t lastUpdate;
+        uint8_t repairs;                    // Retransmission requests sent for this message
+        size_t used;                        // Bytes stored in data, in arrival order
+        uint8_t received[(WDP_MAX_PARTS + 7) / 8];  // Bitmap of received parts
+        uint16_t partOffset[WDP_MAX_PARTS];
+        uint8_t partLen[WDP_MAX_PARTS];
+        uint8_t data[BufferSize];
+    };
+
+    WDPReassembler() {
+        for (int i = 0; i < Slots; i++) {
+            slots[i].active = false;
+        }
+    }
+
+    /**
+     * Store one part of a concatenated message
+     *
+     * A part whose total doesn't match the message with the same key starts
+     * that message over (the sender reused the reference number).
+     *
+     * @param sender Sender node ID (meshNodeId() of its public key)
+     * @param hdr Parsed header of the part
+     * @param payload Part payload (after the header)
+     * @param len Length of payload
+     * @param now Current time in ms
+     * @param message Set to the message the part belongs to (nullptr if not stored)
+     * @return Status, the message is complete on WDP_REASSEMBLY_COMPLETE
+     */
+    WDPReassemblyStatus addPart(uint32_t sender, const WDPHeaderInfo& hdr,
+                                const uint8_t* payload, size_t len, uint32_t now,
+                                Message** message) {
+        *message = nullptr;
+        if (!hdr.concat || hdr.totalParts == 0 || hdr.part == 0 || hdr.part > hdr.totalParts ||
+            len > 0xFF) {
+            return WDP_REASSEMBLY_INVALID;
+        }
+
+        Message* msg = find(sender, hdr.refNum);
+        if (msg && msg->totalParts != hdr.totalParts) {
+            release(msg);
+            msg = nullptr;
+        }
+        if (!msg) {
+            msg = allocate(sender, hdr.refNum);
+            if (!msg) {
+                return WDP_REASSEMBLY_NO_SLOT;
+            }
+            msg->totalParts = hdr.totalParts;
+            msg->srcPort = hdr.srcPort;
+            msg->dstPort = hdr.dstPort;
+        }
+        *message = msg;
+
+        uint8_t index = hdr.part - 1;
+        if (msg->received[index >> 3] & (1 << (index & 7))) {
+            return WDP_REASSEMBLY_DUPLICATE;
+        }
+        if (msg->used + len > BufferSize) {
+            return WDP_REASSEMBLY_OVERFLOW;
+        }
+
+        memcpy(&msg->data[msg->used], payload, len);
+        msg->partOffset[index] = (uint16_t)msg->used;
+        msg->partLen[index] = (uint8_t)len;
+        msg->used += len;
+        msg->received[index >> 3] |= (1 << (index & 7));
+        msg->receivedParts++;
+        msg->lastUpdate = now;
+
+        return (msg->receivedParts == msg->totalParts) ? WDP_REASSEMBLY_COMPLETE : WDP_REASSEMBLY_STORED;
+    }
+
+    /**
+     * Put the parts of a complete message in order at the start of its buffer
+     *
+     * @return Total message length
+     */
+    size_t assemble(Message* msg) {
+        size_t pos = 0;
+        for (int p = 0; p < msg->totalParts; p++) {
+            size_t offset = msg->partOffset[p];
+            size_t len = msg->partLen[p];
+            if (offset != pos) {
+                // Move the part down to pos, the parts in between shift up by its length
+                std::rotate(&msg->data[pos], &msg->data[offset], &msg->data[offset + len]);
+                for (int q = p + 1; q < msg->totalParts; q++) {
+                    if (msg->partOffset[q] >= pos && msg->partOffset[q] < offset) {
+                        msg->partOffset[q] += len;
+                    }
+                }
+                msg->partOffset[p] = (uint16_t)pos;
+            }
+            pos += len;
+        }
+        return pos;
+    }
+
+    /**
+     * Bitmap of the parts not received yet (bit part - 1 set = missing)
+     *
+     * @param bitmap Output of at least (WDP_MAX_PARTS + 7) / 8 bytes
+     * @param below Only parts numbered below this (e.g. highestPart(), gaps only)
+     * @return Number of missing parts
+     */
+    static int missingParts(const Message* msg, uint8_t* bitmap, int below = WDP_MAX_PARTS + 1) {
+        memset(bitmap, 0, sizeof(msg->received));
+        int missing = 0;
+        int end = below - 1 < msg->totalParts ? below - 1 : msg->totalParts;
+        for (int index = 0; index < end; index++) {
+            if (!(msg->received[index >> 3] & (1 << (index & 7)))) {
+                bitmap[index >> 3] |= (1 << (index & 7));
+                missing++;
+            }
+        }
+        return missing;
+    }
+
+    /**
+     * Highest part number received so far (0 if none)
+     */
+    static int highestPart(const Message* msg) {
+        for (int index = msg->totalParts - 1; index >= 0; index--) {
+            if (msg->received[index >> 3] & (1 << (index & 7))) {
+                return index + 1;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Check whether a part of a message was received
+     */
+    static bool hasPart(const Message* msg, uint8_t part) {
+        uint8_t index = part - 1;
+        return part > 0 && (msg->received[index >> 3] & (1 << (index & 7)));
+    }
+
+    void release(Message* msg) {
+        msg->active = false;
+    }
+
+    /**
+     * Release messages that haven't received a part for timeoutMs
+     *
+     * @return Number of messages released
+     */
+    int expire(uint32_t now, uint32_t timeoutMs) {
+        int expired = 0;
+        for (int i = 0; i < Slots; i++) {
+            if (slots[i].active && (now - slots[i].lastUpdate > timeoutMs)) {
+                release(&slots[i]);
+                expired++;
+            }
+        }
+        return expired;
+    }
+
+    /**
+     * Message in progress for (sender, ref), or nullptr
+     */
+    Message* find(uint32_t sender, uint8_t refNum) {
+        int home = homeSlot(sender, refNum);
+        for (int i = 0; i < Slots; i++) {
+            Message* msg = &slots[(home + i) % Slots];
+            if (msg->active && msg->sender == sender && msg->refNum == refNum) {
+                return msg;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Message in slot i, or nullptr if the slot is free (for iterating over messages in progress)
+     */
+    Message* at(int i) {
+        return (i >= 0 && i < Slots && slots[i].active) ? &slots[i] : nullptr;
+    }
+
+    int activeCount() const {
+        int count = 0;
+        for (int i = 0; i < Slots; i++) {
+            if (slots[i].active) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    Message slots[Slots];
+
+    static int homeSlot(uint32_t sender, uint8_t refNum) {
+        uint32_t h = (sender ^ ((uint32_t)refNum << 24) ^ refNum) * 0x9E3779B1u;
+        return (int)((h >> 16) % Slots);
+    }
+
+    Message* allocate(uint32_t sender, uint8_t refNum) {
+        int home = homeSlot(sender, refNum);
+        for (int i = 0; i < Slots; i++) {
+            Message* msg = &slots[(home + i) % Slots];
+            if (!msg->active) {
+                msg->active = true;
+                msg->sender = sender;
+                msg->refNum = refNum;
+                msg->receivedParts = 0;
+                msg->repairs = 0;
+                msg->used = 0;
+                memset(msg->received, 0, sizeof(msg->received));
+                return msg;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif // WDP_REASSEMBLER_H
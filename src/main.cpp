@@ -21,6 +21,13 @@
 #include <Wire.h>
 
 #include "base91.h"
+#include "cobs.h"
+#include "wdp_header.h"
+#include "wdp_control.h"
+#include "wdp_raw.h"
+#include "rtt_estimator.h"
+#include "spsc_ring.h"
+#include "node_id.h"
 
 // WiFi and UDP for ESP32 (WDP Gateway)
 #ifdef ESP32
@@ -63,6 +70,25 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0, /* reset=*/ 21, /* clock=*/
 #define MESHCORE_MAX_BYTES  150             // MeshCore message limit in bytes
 // With Base91 encoding: max binary = (MESHCORE_MAX_BYTES - 1) * 13 / 16 ≈ 121 bytes, 120 to be sure
 #define MESHCORE_MAX_BINARY_PAYLOAD  120    // Max binary bytes per message (after Base91 encoding)
+// With COBS framing: max binary = (MESHCORE_MAX_BYTES - 1) - 2 bytes worst-case overhead = 147 bytes
+#define MESHCORE_MAX_COBS_PAYLOAD    147    // Max binary bytes per message (after COBS framing)
+// As a contact request: createDatagram() takes up to 184 - 2 MAC - 15 (AES block rounding) = 167
+// plaintext bytes, less the 4-byte request tag and the raw frame's type and length bytes (wdp_raw.h)
+#define MESHCORE_MAX_RAW_PAYLOAD     (MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE - 1) - 4 - WDP_RAW_HEADER_LEN)  // 161, max binary bytes per message
+
+// WDP messages in flight (sent, not ACKed or timed out) per recipient, the rest wait in the send queue
+// 1 is stop-and-wait, larger windows fill long direct paths but collide more on busy ones
+#ifndef WDP_TX_WINDOW
+  #define WDP_TX_WINDOW     2
+#endif
+
+// Peer capabilities, exchanged as "ping caps=XX" / "ping ok caps=XX" (hex bitmask)
+#define PEER_CAP_COBS       0x01            // Peer decodes COBS-framed WDP messages
+#define PEER_CAP_COMPACT_HDR 0x02           // Peer parses the compact WDP header (see wdp_header.h)
+#define PEER_CAP_NACK       0x04            // Peer resends concat parts reported missing (see wdp_control.h)
+#define PEER_CAP_FEC        0x08            // Peer rebuilds lost concat parts from parity frames (see wdp_fec.h)
+#define PEER_CAP_RAW        0x10            // Peer takes WDP messages as raw binary contact requests
+#define LOCAL_PEER_CAPS     (PEER_CAP_COBS | PEER_CAP_COMPACT_HDR | PEER_CAP_NACK | PEER_CAP_FEC | PEER_CAP_RAW)
 
 // EU868 Long Range Settings
 #ifndef LORA_FREQ
@@ -84,6 +110,9 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0, /* reset=*/ 21, /* clock=*/
 #ifndef MAX_CONTACTS
   #define MAX_CONTACTS         100
 #endif
+#ifndef CONTACT_INDEX_SLOTS
+  #define CONTACT_INDEX_SLOTS  256      // Node ID -> contact cache, power of two >= 2 * MAX_CONTACTS
+#endif
 
 #include <helpers/BaseChatMesh.h>
 
@@ -91,6 +120,7 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0, /* reset=*/ 21, /* clock=*/
 #define FLOOD_SEND_TIMEOUT_FACTOR         16.0f
 #define DIRECT_SEND_PERHOP_FACTOR         6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS   250
+#define MAX_SEND_TIMEOUT_MILLIS           60000   // Cap for learned (and backed off) timeouts
 
 #define  PUBLIC_GROUP_PSK  "izOH6cXN6mrJ5e26oRXNcg=="
 #define  MCRADAR_GROUP_PSK "8nrPC/GFwuxLn9Nr8S+h7g=="
@@ -108,6 +138,23 @@ static uint32_t _atoi(const char* sp) {
 }
 
 
+// Packet pool that counts the packets queued for transmit
+// MeshCore queues the ACK for a message right after onMessageRecv (or the reply after
+// onContactRequest) returns, so once the count moves past a received message its ACK is on its way
+class TxCountingPacketManager : public StaticPoolPacketManager {
+  uint32_t queued;
+public:
+  TxCountingPacketManager(int pool_size) : StaticPoolPacketManager(pool_size), queued(0) { }
+
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override {
+    StaticPoolPacketManager::queueOutbound(packet, priority, scheduled_for);
+    queued++;
+  }
+
+  uint32_t getQueuedCount() const { return queued; }
+};
+
+
 // Forward declaration of display function
 void displayStatus(const char* line1, const char* line2 = nullptr, const char* line3 = nullptr, const char* line4 = nullptr);
 
@@ -124,50 +171,435 @@ struct NodePrefs {  // persisted to file
 class MyMesh : public BaseChatMesh, ContactVisitor {
   FILESYSTEM* _fs;
   NodePrefs _prefs;
-  uint32_t expected_ack_crc;
   ChannelDetails* _public;
   ChannelDetails* _radar; //for mc-radar
-  unsigned long last_msg_sent;
   ContactInfo* curr_recipient;
   char command[512+10];
   uint8_t tmp_buf[256];
   char hex_buf[512];
 
   // we store pending messages here to not lock up the threads of the MeshCore (ACK) logic
-  static const int MAX_PENDING_INBOX = 16;
-  struct PendingInbox {
-    bool active;
+  // Records in a byte ring in arrival order, each message is handled from loop() as soon as its ACK is queued
+  static const size_t INBOX_RING_BYTES = 4096;       // Power of two
+  static const size_t MAX_INBOX_MESSAGE = 256;
+  static const unsigned long INBOX_ACK_WAIT_MS = 100;  // Handle anyway if no ACK got queued (pool empty)
+  struct PendingInbox {      // Record header, the message bytes follow
     unsigned long time;
-    char senderIdStr[20];    // pub_key prefix as hex string
-    uint8_t wdpData[256];    // WDP binary data
-    size_t wdpLen;
+    uint32_t txMark;         // Packets queued for transmit before it arrived
+    uint32_t wdpLen;
+    MeshNodeId sender;
+    bool raw;                // Came as a contact request, already binary
+
+    // Received text, decoded in place to WDP binary data
+    uint8_t* wdpData() { return (uint8_t*)(this + 1); }
   };
-  PendingInbox pending_inbox[MAX_PENDING_INBOX];
+  SpscRing<INBOX_RING_BYTES> inbox_ring;
 
-  // Clear/reset a pending inbox slot
-  void clearPendingInbox(PendingInbox* msg) {
-    msg->active = false;
-    msg->time = 0;
-    memset(msg->senderIdStr, 0, sizeof(msg->senderIdStr));
-    memset(msg->wdpData, 0, sizeof(msg->wdpData));
-    msg->wdpLen = 0;
+  uint32_t getTxQueuedCount() const {
+    return static_cast<const TxCountingPacketManager*>(_mgr)->getQueuedCount();
   }
 
-  static const int MAX_PENDING_REPLIES = 16;
-  struct PendingReply {
-    bool active;
+  // Queue a received message at the end of the ring
+  // Returns false if the ring is full
+  bool pushPendingInbox(const ContactInfo& from, const uint8_t* data, size_t len, bool raw) {
+    if (len > MAX_INBOX_MESSAGE) {
+      len = MAX_INBOX_MESSAGE;
+    }
+    PendingInbox* msg = (PendingInbox*)inbox_ring.reserve(sizeof(PendingInbox) + len);
+    if (!msg) {
+      return false;
+    }
+    msg->time = _ms->getMillis();
+    msg->txMark = getTxQueuedCount();
+    msg->wdpLen = len;
+    msg->sender = meshNodeId(from.id.pub_key);
+    msg->raw = raw;
+    // Length-delimited, decoded in place later - no null terminator needed
+    memcpy(msg->wdpData(), data, len);
+    inbox_ring.commit(sizeof(PendingInbox) + len);
+    Serial.printf("   (queued message, %zu %s, inbox %zu/%zu bytes)\n", len, raw ? "bytes" : "chars",
+                  inbox_ring.used(), inbox_ring.capacity());
+    return true;
+  }
+
+  // Oldest message once its ACK has been queued, it stays in the ring until inbox_ring.pop()
+  PendingInbox* frontPendingInbox() {
+    size_t len;
+    PendingInbox* msg = (PendingInbox*)inbox_ring.front(&len);
+    if (!msg || (getTxQueuedCount() == msg->txMark && _ms->getMillis() - msg->time <= INBOX_ACK_WAIT_MS)) {
+      return NULL;
+    }
+    return msg;
+  }
+
+  // Decode a pending message in its own buffer (COBS frame or Base91 text)
+  // Returns false if it is neither and should be tried as raw binary
+  bool decodePendingInbox(PendingInbox* msg) {
+    bool isCobs = Cobs::isFrame((const char*)msg->wdpData());
+    size_t textLen = msg->wdpLen;
+    size_t decodedLen = isCobs ? Cobs::decodeInPlace(msg->wdpData(), msg->wdpLen)
+                               : Base91::decodeInPlace(msg->wdpData(), msg->wdpLen);
+    if (decodedLen == 0) {
+      // A failed Base91 decode leaves the buffer untouched, a broken COBS frame is never valid WDP
+      Serial.printf("   %s decode failed, trying as raw binary\n", isCobs ? "COBS" : "Base91");
+      return false;
+    }
+    Serial.printf("   %s-decoded: %zu chars -> %zu bytes\n", isCobs ? "COBS" : "Base91", textLen, decodedLen);
+    msg->wdpLen = decodedLen;
+    return true;
+  }
+
+  // Replies sent after the ACK of the message they answer, records in a byte ring
+  static const size_t REPLY_RING_BYTES = 1024;       // Power of two
+  struct PendingReply {      // Record header, the null-terminated reply text follows
     unsigned long time;
     uint8_t senderPubKey[PUB_KEY_SIZE];
-    char replyText[256];
+
+    char* replyText() { return (char*)(this + 1); }
+  };
+  SpscRing<REPLY_RING_BYTES> reply_ring;
+
+  // Queue a reply to a contact, returns false if the ring is full
+  bool pushPendingReply(const ContactInfo& to, const char* text) {
+    size_t len = strlen(text) + 1;
+    PendingReply* reply = (PendingReply*)reply_ring.reserve(sizeof(PendingReply) + len);
+    if (!reply) {
+      return false;
+    }
+    reply->time = _ms->getMillis();
+    memcpy(reply->senderPubKey, to.id.pub_key, PUB_KEY_SIZE);
+    memcpy(reply->replyText(), text, len);
+    reply_ring.commit(sizeof(PendingReply) + len);
+    return true;
+  }
+
+  // Node ID -> contact, see lookupContactByNodeId
+  NodeIdIndex<ContactInfo, CONTACT_INDEX_SLOTS> contact_index;
+
+  // Per-contact capabilities, learned from the ping handshake and from inbound frames
+  // Contacts without an entry are assumed to be old nodes (Base91 only)
+  static const int MAX_PEER_CAPS = 16;
+  struct PeerCaps {
+    bool active;
+    uint8_t pubKeyPrefix[4];
+    uint8_t caps;
+  };
+  PeerCaps peer_caps[MAX_PEER_CAPS];
+
+  PeerCaps* findPeerCaps(const uint8_t* pub_key, bool create) {
+    for (int i = 0; i < MAX_PEER_CAPS; i++) {
+      if (peer_caps[i].active && memcmp(peer_caps[i].pubKeyPrefix, pub_key, 4) == 0) {
+        return &peer_caps[i];
+      }
+    }
+    if (!create) return NULL;
+    for (int i = 0; i < MAX_PEER_CAPS; i++) {
+      if (!peer_caps[i].active) {
+        peer_caps[i].active = true;
+        memcpy(peer_caps[i].pubKeyPrefix, pub_key, 4);
+        peer_caps[i].caps = 0;
+        return &peer_caps[i];
+      }
+    }
+    return NULL;
+  }
+
+  // Codec WDP messages to a peer are sent with (raw takes precedence over COBS)
+  static const char* peerCodecName(uint8_t caps) {
+    return (caps & PEER_CAP_RAW) ? "raw" : (caps & PEER_CAP_COBS) ? "cobs" : "base91";
+  }
+
+  uint8_t getPeerCaps(const uint8_t* pub_key) {
+    PeerCaps* peer = findPeerCaps(pub_key, false);
+    return peer ? peer->caps : 0;
+  }
+
+  void setPeerCaps(const uint8_t* pub_key, uint8_t caps) {
+    PeerCaps* peer = findPeerCaps(pub_key, true);
+    if (!peer) {
+      Serial.println("   WARNING: Peer caps table full");
+      return;
+    }
+    if (peer->caps != caps) {
+      Serial.printf("   Peer %02x%02x%02x%02x caps: %02x -> %02x (codec: %s, header: %s)\n",
+                    pub_key[0], pub_key[1], pub_key[2], pub_key[3], peer->caps, caps,
+                    peerCodecName(caps), (caps & PEER_CAP_COMPACT_HDR) ? "compact" : "udh");
+    }
+    peer->caps = caps;
+  }
+
+  // Sent messages by ACK CRC, one entry per message (every WDP part has its own)
+  // Entries stay after the ACK or timeout so senders can look up the outcome by handle
+  static const int MAX_PENDING_ACKS = 16;
+  enum AckStatus {
+    ACK_UNKNOWN,             // Handle not (or no longer) in the table
+    ACK_PENDING,
+    ACK_DELIVERED,
+    ACK_TIMED_OUT
+  };
+  struct PendingAck {
+    AckStatus status;
+    uint32_t ackCrc;          // ACK CRC, or the request tag for raw messages
+    uint32_t handle;
+    uint8_t pubKeyPrefix[4];  // Recipient
+    const char* kind;         // What was sent, for the logs
+    int8_t route;             // Path length it was sent on (-1 = flood)
+    unsigned long sentTime;
+    uint32_t timeout;         // Estimated timeout from sendMessage
+    uint32_t rtt;             // Round trip once delivered
+  };
+  PendingAck pending_acks[MAX_PENDING_ACKS];
+  uint32_t next_ack_handle;
+
+  // Round trip estimate per contact, learned from ACKs on the route it was taken on
+  // (a flood and a 3-hop direct path have nothing in common)
+  static const int MAX_PEER_RTT = 16;
+  struct PeerRtt {
+    bool active;
+    uint8_t pubKeyPrefix[4];
+    int8_t route;             // Path length of the samples (-1 = flood)
+    RttEstimator rtt;
+    unsigned long lastUsed;
+  };
+  PeerRtt peer_rtt[MAX_PEER_RTT];
+  const ContactInfo* send_contact;  // Recipient while sendMessage runs, for the timeout callbacks
+
+  // Estimate for a contact on a route (the least recently used one is recycled when creating)
+  PeerRtt* findPeerRtt(const uint8_t* pub_key, int8_t route, bool create) {
+    PeerRtt* slot = &peer_rtt[0];
+    for (int i = 0; i < MAX_PEER_RTT; i++) {
+      PeerRtt* p = &peer_rtt[i];
+      if (p->active && memcmp(p->pubKeyPrefix, pub_key, 4) == 0) {
+        if (p->route != route) {
+          if (!create) return NULL;
+          p->route = route;
+          p->rtt.reset();
+        }
+        return p;
+      }
+      if (!p->active || (slot->active && (long)(p->lastUsed - slot->lastUsed) < 0)) {
+        slot = p;
+      }
+    }
+    if (!create) return NULL;
+    slot->active = true;
+    memcpy(slot->pubKeyPrefix, pub_key, 4);
+    slot->route = route;
+    slot->rtt = RttEstimator(SEND_TIMEOUT_BASE_MILLIS, MAX_SEND_TIMEOUT_MILLIS);
+    slot->lastUsed = _ms->getMillis();
+    return slot;
+  }
+
+  // Timeout for the message being sent: the learned estimate once there is one,
+  // never below the time the ACK needs over the air
+  uint32_t adaptSendTimeout(uint32_t fixedTimeout, uint32_t minTimeout, int8_t route) const {
+    if (!send_contact) {
+      return fixedTimeout;
+    }
+    for (int i = 0; i < MAX_PEER_RTT; i++) {
+      const PeerRtt* p = &peer_rtt[i];
+      if (p->active && p->route == route && memcmp(p->pubKeyPrefix, send_contact->id.pub_key, 4) == 0) {
+        uint32_t t = p->rtt.timeout(fixedTimeout);
+        return (t < minTimeout) ? minTimeout : t;
+      }
+    }
+    return fixedTimeout;
+  }
+
+  // Send a text message and track its ACK
+  // Returns the message handle, or 0 if the send failed
+  uint32_t sendTracked(ContactInfo& contact, const char* text, const char* kind, int* result = NULL) {
+    uint32_t ack_crc;
+    uint32_t est_timeout;
+    send_contact = &contact;
+    int sent = sendMessage(contact, getRTCClock()->getCurrentTime(), 0, text, ack_crc, est_timeout);
+    send_contact = NULL;
+    if (result) {
+      *result = sent;
+    }
+    return trackAck(contact, sent, ack_crc, est_timeout, kind);
+  }
+
+  // Send binary data as a contact request, the recipient's response (echoing the
+  // request tag) counts as its ACK
+  uint32_t sendTrackedRaw(ContactInfo& contact, const uint8_t* data, size_t len, const char* kind, int* result = NULL) {
+    uint32_t tag;
+    uint32_t est_timeout;
+    if (len > MESHCORE_MAX_RAW_PAYLOAD + WDP_RAW_HEADER_LEN) {
+      // Longer than createDatagram() takes (and than the length byte of sendRequest())
+      if (result) {
+        *result = MSG_SEND_FAILED;
+      }
+      return 0;
+    }
+    send_contact = &contact;
+    int sent = sendRequest(contact, data, (uint8_t)len, tag, est_timeout);
+    send_contact = NULL;
+    if (result) {
+      *result = sent;
+    }
+    return trackAck(contact, sent, tag, est_timeout, kind);
+  }
+
+  // Add a sent message to the ACK table, returns its handle (0 if it wasn't sent)
+  uint32_t trackAck(const ContactInfo& contact, int sent, uint32_t ack_crc, uint32_t est_timeout, const char* kind) {
+    if (sent == MSG_SEND_FAILED) {
+      return 0;
+    }
+
+    // Free entry, else the oldest finished one, else the oldest still pending
+    PendingAck* slot = &pending_acks[0];
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      PendingAck* a = &pending_acks[i];
+      if (a->status == ACK_UNKNOWN) {
+        slot = a;
+        break;
+      }
+      bool older = (long)(a->sentTime - slot->sentTime) < 0;
+      if ((a->status != ACK_PENDING && (slot->status == ACK_PENDING || older)) ||
+          (a->status == ACK_PENDING && slot->status == ACK_PENDING && older)) {
+        slot = a;
+      }
+    }
+    if (slot->status == ACK_PENDING) {
+      Serial.printf("   WARNING: ACK table full, no longer tracking %s #%lu\n",
+                    slot->kind, (unsigned long)slot->handle);
+    }
+
+    if (++next_ack_handle == 0) {
+      next_ack_handle = 1;
+    }
+    slot->status = ACK_PENDING;
+    slot->ackCrc = ack_crc;
+    slot->handle = next_ack_handle;
+    memcpy(slot->pubKeyPrefix, contact.id.pub_key, 4);
+    slot->kind = kind;
+    slot->route = (sent == MSG_SEND_SENT_FLOOD) ? -1 : contact.out_path_len;
+    slot->sentTime = _ms->getMillis();
+    slot->timeout = est_timeout;
+    slot->rtt = 0;
+    return slot->handle;
+  }
+
+  PendingAck* findAck(uint32_t handle) {
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      if (handle != 0 && pending_acks[i].status != ACK_UNKNOWN && pending_acks[i].handle == handle) {
+        return &pending_acks[i];
+      }
+    }
+    return NULL;
+  }
+
+  // Mark messages whose ACK is overdue as timed out
+  void expireAcks() {
+    unsigned long now = _ms->getMillis();
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      PendingAck* a = &pending_acks[i];
+      if (a->status == ACK_PENDING && now - a->sentTime > a->timeout) {
+        a->status = ACK_TIMED_OUT;
+        Serial.printf("   ERROR: timed out, no ACK for %s #%lu to %02x%02x%02x%02x (%lu millis)\n",
+                      a->kind, (unsigned long)a->handle, a->pubKeyPrefix[0], a->pubKeyPrefix[1],
+                      a->pubKeyPrefix[2], a->pubKeyPrefix[3], (unsigned long)a->timeout);
+        PeerRtt* peer = findPeerRtt(a->pubKeyPrefix, a->route, true);
+        peer->rtt.timedOut();
+        peer->lastUsed = now;
+      }
+    }
+  }
+
+  // Messages still pending an ACK to a recipient
+  int pendingAckCount(const uint8_t* pub_key) {
+    int count = 0;
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      if (pending_acks[i].status == ACK_PENDING && memcmp(pending_acks[i].pubKeyPrefix, pub_key, 4) == 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  // Encoded WDP messages waiting for room in their recipient's transmit window
+  // (or for a free packet, sends are retried rather than dropped when the pool runs out)
+  // The gateways only queue what hasSendRoom() allows and keep the rest of a
+  // response themselves, so the queue never fills up with one long response
+  static const int MAX_PENDING_SENDS = 16;
+  static const unsigned long SEND_RETRY_MS = 250;
+  struct PendingSend {
+    bool active;
+    bool raw;                 // Binary contact request, else a text message
+    uint32_t seq;             // Queue order
+    uint8_t pubKeyPrefix[4];  // Recipient
+    size_t len;
+    uint8_t frame[(MESHCORE_MAX_RAW_PAYLOAD + WDP_RAW_HEADER_LEN > MESHCORE_MAX_BYTES + 1 ?
+                   MESHCORE_MAX_RAW_PAYLOAD + WDP_RAW_HEADER_LEN : MESHCORE_MAX_BYTES + 1)];  // Text + NUL, or raw frame
   };
-  PendingReply pending_replies[MAX_PENDING_REPLIES];
+  PendingSend pending_sends[MAX_PENDING_SENDS];
+  uint32_t next_send_seq;
+  unsigned long send_retry_time;  // No sends before this after a failed one
+  bool send_retry_wait;
+
+  // Free send queue slot, NULL when the queue is full (never waits)
+  PendingSend* allocPendingSend() {
+    for (int i = 0; i < MAX_PENDING_SENDS; i++) {
+      if (!pending_sends[i].active) {
+        return &pending_sends[i];
+      }
+    }
+    return NULL;
+  }
 
-  // Clear/reset a pending reply slot
-  void clearPendingReply(PendingReply* msg) {
-    msg->active = false;
-    msg->time = 0;
-    memset(msg->senderPubKey, 0, sizeof(msg->senderPubKey));
-    memset(msg->replyText, 0, sizeof(msg->replyText));
+  int pendingSendCount(const uint8_t* pubKeyPrefix) const {
+    int count = 0;
+    for (int i = 0; i < MAX_PENDING_SENDS; i++) {
+      if (pending_sends[i].active && memcmp(pending_sends[i].pubKeyPrefix, pubKeyPrefix, 4) == 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  // Send queued messages, oldest first, while their recipients' windows have room
+  void pumpPendingSends() {
+    unsigned long now = _ms->getMillis();
+    if (send_retry_wait && (long)(now - send_retry_time) < 0) {
+      return;
+    }
+    send_retry_wait = false;
+
+    while (true) {
+      PendingSend* next = NULL;
+      for (int i = 0; i < MAX_PENDING_SENDS; i++) {
+        PendingSend* s = &pending_sends[i];
+        if (s->active && (!next || (long)(s->seq - next->seq) < 0) &&
+            pendingAckCount(s->pubKeyPrefix) < WDP_TX_WINDOW) {
+          next = s;
+        }
+      }
+      if (!next) {
+        return;
+      }
+
+      ContactInfo* contact = lookupContactByNodeId(meshNodeId(next->pubKeyPrefix));
+      if (!contact) {
+        Serial.println("WDP->Mesh: Contact gone, dropping queued message");
+        next->active = false;
+        continue;
+      }
+      int result;
+      uint32_t handle = next->raw ? sendTrackedRaw(*contact, next->frame, next->len, "wdp", &result)
+                                  : sendTracked(*contact, (const char*)next->frame, "wdp", &result);
+      if (handle == 0) {
+        // Most likely out of packets, leave it queued and give the radio time to drain
+        Serial.printf("WDP->Mesh: Send failed, retrying in %lu millis\n", SEND_RETRY_MS);
+        send_retry_time = now + SEND_RETRY_MS;
+        send_retry_wait = true;
+        return;
+      }
+      Serial.printf("WDP->Mesh: Sent #%lu %s to %s (%d %s, %d in flight)\n", (unsigned long)handle,
+                    result == MSG_SEND_SENT_FLOOD ? "FLOOD" : "DIRECT", contact->name, (int)next->len,
+                    next->raw ? "bytes" : "chars", pendingAckCount(next->pubKeyPrefix));
+      next->active = false;
+    }
   }
 
   // Message counter for display
@@ -180,43 +612,85 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
     return "??";  // unknown
   }
 
-  void loadContacts() {
-    if (_fs->exists("/contacts")) {
-    #if defined(RP2040_PLATFORM)
-      File file = _fs->open("/contacts", "r");
-    #else
-      File file = _fs->open("/contacts");
-    #endif
-      if (file) {
-        bool full = false;
-        while (!full) {
-          ContactInfo c;
-          uint8_t pub_key[32];
-          uint8_t unused;
-          uint32_t reserved;
-
-          bool success = (file.read(pub_key, 32) == 32);
-          success = success && (file.read((uint8_t *) &c.name, 32) == 32);
-          success = success && (file.read(&c.type, 1) == 1);
-          success = success && (file.read(&c.flags, 1) == 1);
-          success = success && (file.read(&unused, 1) == 1);
-          success = success && (file.read((uint8_t *) &reserved, 4) == 4);
-          success = success && (file.read((uint8_t *) &c.out_path_len, 1) == 1);
-          success = success && (file.read((uint8_t *) &c.last_advert_timestamp, 4) == 4);
-          success = success && (file.read(c.out_path, 64) == 64);
-          c.gps_lat = c.gps_lon = 0;   // not yet supported
-
-          if (!success) break;  // EOF
-
-          c.id = mesh::Identity(pub_key);
-          c.lastmod = 0;
-          if (!addContact(c)) full = true;
-        }
-        file.close();
+  // Contacts are kept as a snapshot (/contacts) plus a journal of changed contacts (/contacts.jnl)
+  // Both hold the same fixed-size records, a later record for a key replaces the earlier one
+  // Changes are collected and appended to the journal in batches, once adverts and path updates
+  // have settled, and the journal is folded into a new snapshot when it gets long
+  static const size_t CONTACT_RECORD_LEN = 140;
+  static const int MAX_DIRTY_CONTACTS = 16;                   // More changes in a batch rewrite the snapshot
+  static const int CONTACTS_JOURNAL_MAX = 64;                 // Records before compaction
+  static const unsigned long CONTACTS_FLUSH_DELAY_MS = 2000;  // Quiet time before a batch is written
+  static const unsigned long CONTACTS_FLUSH_MAX_DELAY_MS = 10000;
+  MeshNodeId contacts_dirty[MAX_DIRTY_CONTACTS];
+  int contacts_dirty_count;
+  bool contacts_dirty_all;                // Changes didn't fit the list, compact on the next flush
+  unsigned long contacts_dirty_since;     // First change of the batch
+  unsigned long contacts_changed_at;      // Latest change of the batch
+  int contacts_journal_records;
+
+  // Record layout: pub_key[32], name[32], type, flags, unused, reserved[4], out_path_len,
+  // last_advert_timestamp[4], out_path[64]
+  void packContact(const ContactInfo& c, uint8_t* rec) {
+    memset(rec, 0, CONTACT_RECORD_LEN);
+    memcpy(&rec[0], c.id.pub_key, 32);
+    memcpy(&rec[32], c.name, 32);
+    rec[64] = c.type;
+    rec[65] = c.flags;
+    rec[71] = (uint8_t)c.out_path_len;
+    memcpy(&rec[72], &c.last_advert_timestamp, 4);
+    memcpy(&rec[76], c.out_path, 64);
+  }
+
+  void unpackContact(const uint8_t* rec, ContactInfo& c) {
+    memcpy(c.name, &rec[32], 32);
+    c.type = rec[64];
+    c.flags = rec[65];
+    c.out_path_len = (int8_t)rec[71];
+    memcpy(&c.last_advert_timestamp, &rec[72], 4);
+    memcpy(c.out_path, &rec[76], 64);
+  }
+
+  // Read contact records from a file, a record for a known contact updates it
+  // Returns the number of records read
+  int readContactRecords(const char* path) {
+    if (!_fs->exists(path)) {
+      return 0;
+    }
+  #if defined(RP2040_PLATFORM)
+    File file = _fs->open(path, "r");
+  #else
+    File file = _fs->open(path);
+  #endif
+    if (!file) {
+      return 0;
+    }
+    int records = 0;
+    uint8_t rec[CONTACT_RECORD_LEN];
+    while (file.read(rec, CONTACT_RECORD_LEN) == CONTACT_RECORD_LEN) {
+      records++;
+      ContactInfo* known = lookupContactByPubKey(rec, PUB_KEY_SIZE);
+      if (known) {
+        unpackContact(rec, *known);
+        continue;
       }
+      ContactInfo c;
+      memset(&c, 0, sizeof(c));
+      unpackContact(rec, c);
+      c.id = mesh::Identity(rec);
+      c.lastmod = 0;
+      c.gps_lat = c.gps_lon = 0;   // not yet supported
+      if (!addContact(c)) break;   // full
     }
+    file.close();
+    return records;
+  }
+
+  void loadContacts() {
+    readContactRecords("/contacts");
+    contacts_journal_records = readContactRecords("/contacts.jnl");
   }
 
+  // Write all contacts as a new snapshot, the journal is folded into it
   void saveContacts() {
 #if defined(NRF52_PLATFORM)
     _fs->remove("/contacts");
@@ -226,27 +700,91 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
 #else
     File file = _fs->open("/contacts", "w", true);
 #endif
-    if (file) {
-      ContactsIterator iter;
-      ContactInfo c;
-      uint8_t unused = 0;
-      uint32_t reserved = 0;
-
-      while (iter.hasNext(this, c)) {
-        bool success = (file.write(c.id.pub_key, 32) == 32);
-        success = success && (file.write((uint8_t *) &c.name, 32) == 32);
-        success = success && (file.write(&c.type, 1) == 1);
-        success = success && (file.write(&c.flags, 1) == 1);
-        success = success && (file.write(&unused, 1) == 1);
-        success = success && (file.write((uint8_t *) &reserved, 4) == 4);
-        success = success && (file.write((uint8_t *) &c.out_path_len, 1) == 1);
-        success = success && (file.write((uint8_t *) &c.last_advert_timestamp, 4) == 4);
-        success = success && (file.write(c.out_path, 64) == 64);
-
-        if (!success) break;  // write failed
+    if (!file) {
+      return;
+    }
+    ContactsIterator iter;
+    ContactInfo c;
+    uint8_t rec[CONTACT_RECORD_LEN];
+    bool success = true;
+    while (success && iter.hasNext(this, c)) {
+      packContact(c, rec);
+      success = (file.write(rec, CONTACT_RECORD_LEN) == CONTACT_RECORD_LEN);
+    }
+    file.close();
+    if (success) {
+      _fs->remove("/contacts.jnl");
+      contacts_journal_records = 0;
+    }
+  }
+
+  // Append changed contacts to the journal
+  bool appendContactsJournal() {
+#if defined(NRF52_PLATFORM)
+    File file = _fs->open("/contacts.jnl", FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+    File file = _fs->open("/contacts.jnl", "a");
+#else
+    File file = _fs->open("/contacts.jnl", "a", true);
+#endif
+    if (!file) {
+      return false;
+    }
+    uint8_t rec[CONTACT_RECORD_LEN];
+    bool success = true;
+    for (int i = 0; success && i < contacts_dirty_count; i++) {
+      ContactInfo* c = lookupContactByNodeId(contacts_dirty[i]);
+      if (c) {
+        packContact(*c, rec);
+        success = (file.write(rec, CONTACT_RECORD_LEN) == CONTACT_RECORD_LEN);
+        contacts_journal_records++;
       }
-      file.close();
     }
+    file.close();
+    return success;
+  }
+
+  // Remember a changed contact for the next flush (NULL: all of them)
+  void markContactDirty(const ContactInfo* contact) {
+    unsigned long now = _ms->getMillis();
+    if (contacts_dirty_count == 0 && !contacts_dirty_all) {
+      contacts_dirty_since = now;
+    }
+    contacts_changed_at = now;
+    if (!contact || contacts_dirty_all) {
+      contacts_dirty_all = true;
+      return;
+    }
+    MeshNodeId id = meshNodeId(contact->id.pub_key);
+    for (int i = 0; i < contacts_dirty_count; i++) {
+      if (contacts_dirty[i] == id) {
+        return;
+      }
+    }
+    if (contacts_dirty_count == MAX_DIRTY_CONTACTS) {
+      contacts_dirty_all = true;
+      return;
+    }
+    contacts_dirty[contacts_dirty_count++] = id;
+  }
+
+  // Write the changed contacts once changes have settled (or have waited long enough),
+  // or right away with immediate (before sleeping)
+  void flushContacts(bool immediate = false) {
+    if (contacts_dirty_count == 0 && !contacts_dirty_all) {
+      return;
+    }
+    unsigned long now = _ms->getMillis();
+    if (!immediate && now - contacts_changed_at < CONTACTS_FLUSH_DELAY_MS &&
+        now - contacts_dirty_since < CONTACTS_FLUSH_MAX_DELAY_MS) {
+      return;
+    }
+    if (contacts_dirty_all || contacts_journal_records + contacts_dirty_count > CONTACTS_JOURNAL_MAX ||
+        !appendContactsJournal()) {
+      saveContacts();
+    }
+    contacts_dirty_count = 0;
+    contacts_dirty_all = false;
   }
 
   void setClock(uint32_t timestamp) {
@@ -299,28 +837,53 @@ protected:
     Serial.printf("  type: %s\n", getTypeName(contact.type));
     Serial.print("   public key: "); mesh::Utils::printHex(Serial, contact.id.pub_key, PUB_KEY_SIZE); Serial.println();
 
-    saveContacts();
+    markContactDirty(&contact);
   }
 
   void onContactPathUpdated(const ContactInfo& contact) override {
     Serial.printf("PATH to: %s, path_len=%d\n", contact.name, (int32_t) contact.out_path_len);
-    saveContacts();
+    // New path, round trips learned on the old one no longer apply
+    PeerRtt* peer = findPeerRtt(contact.id.pub_key, contact.out_path_len, false);
+    if (peer) {
+      peer->rtt.reset();
+    }
+    markContactDirty(&contact);
   }
 
   ContactInfo* processAck(const uint8_t *data) override {
-    if (memcmp(data, &expected_ack_crc, 4) == 0) {     // got an ACK from recipient
-      Serial.printf("   Got ACK! (round trip: %d millis)\n", _ms->getMillis() - last_msg_sent);
-      // NOTE: the same ACK can be received multiple times!
-      expected_ack_crc = 0;  // reset our expected hash, now that we have received ACK
-      return NULL;  // TODO: really should return ContactInfo pointer 
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      PendingAck* a = &pending_acks[i];
+      if (a->status != ACK_UNKNOWN && memcmp(data, &a->ackCrc, 4) == 0) {   // got an ACK from recipient
+        ackReceived(a);
+        return lookupContactByNodeId(meshNodeId(a->pubKeyPrefix));
+      }
     }
 
     //uint32_t crc;
     //memcpy(&crc, data, 4);
-    //MESH_DEBUG_PRINTLN("unknown ACK received: %08X (expected: %08X)", crc, expected_ack_crc);
+    //MESH_DEBUG_PRINTLN("unknown ACK received: %08X", crc);
     return NULL;
   }
 
+  // Mark a message delivered and take its round trip as an RTT sample
+  void ackReceived(PendingAck* a) {
+    // NOTE: the same ACK can be received multiple times!
+    if (a->status != ACK_DELIVERED) {
+      a->rtt = _ms->getMillis() - a->sentTime;
+      Serial.printf("   Got ACK for %s #%lu! (round trip: %lu millis%s)\n", a->kind, (unsigned long)a->handle,
+                    (unsigned long)a->rtt, a->status == ACK_TIMED_OUT ? ", after timeout" : "");
+      a->status = ACK_DELIVERED;
+      // A late ACK is a sample too, it says the timeout was too short
+      PeerRtt* peer = findPeerRtt(a->pubKeyPrefix, a->route, true);
+      peer->rtt.sample(a->rtt);
+      peer->lastUsed = _ms->getMillis();
+      Serial.printf("   RTT to %02x%02x%02x%02x: srtt %lu, rttvar %lu, timeout %lu millis\n",
+                    a->pubKeyPrefix[0], a->pubKeyPrefix[1], a->pubKeyPrefix[2], a->pubKeyPrefix[3],
+                    (unsigned long)peer->rtt.srtt(), (unsigned long)peer->rtt.rttvar(),
+                    (unsigned long)peer->rtt.timeout(0));
+    }
+  }
+
   // Helper: Check if string is valid hex
   bool isValidHex(const char* str, size_t len) {
     for (size_t i = 0; i < len; i++) {
@@ -350,125 +913,56 @@ protected:
     return byteLen;
   }
 
-  // Helper: Encode bytes to hex string
-  void hexEncode(const uint8_t* data, size_t len, char* out) {
-    static const char hexChars[] = "0123456789abcdef";
-    for (size_t i = 0; i < len; i++) {
-      out[i*2] = hexChars[(data[i] >> 4) & 0x0F];
-      out[i*2 + 1] = hexChars[data[i] & 0x0F];
-    }
-    out[len*2] = '\0';
-  }
-
   // Helper: Validate sender node ID - checks if pub_key prefix matches a known contact
-  // Returns true if sender is a known contact, false otherwise
-  bool isValidSenderNodeId(const char* senderIdStr) {
-    size_t idLen = strlen(senderIdStr);
-    if (idLen < 8 || !isValidHex(senderIdStr, idLen)) {
-      Serial.printf("   Invalid sender ID format: %s\n", senderIdStr);
-      return false;
-    }
-    
-    // Decode the hex node ID to bytes
-    uint8_t senderPrefix[4];
-    hexDecode(senderIdStr, 8, senderPrefix, 4);
-    
-    // Look up contact by pub_key prefix
-    ContactInfo* contact = lookupContactByPubKey(senderPrefix, 4);
+  // Returns the contact, or NULL if the sender is unknown
+  ContactInfo* validateSender(MeshNodeId sender) {
+    ContactInfo* contact = lookupContactByNodeId(sender);
     if (!contact) {
-      Serial.printf("   Unknown sender node: %s (not in contacts)\n", senderIdStr);
-      return false;
+      Serial.printf("   Unknown sender node: %08lx (not in contacts)\n", (unsigned long)sender);
+      return NULL;
     }
     
-    Serial.printf("   Sender verified: %s (%s)\n", senderIdStr, contact->name);
-    return true;
+    Serial.printf("   Sender verified: %08lx (%s)\n", (unsigned long)sender, contact->name);
+    return contact;
   }
 
   // Helper: Validate WDP message format
-  // Checks basic UDH structure and minimum length requirements
+  // Checks the header (legacy UDH or compact) and minimum length requirements,
+  // or the control frames (NACK, parity) the gateways exchange
   // Returns true if message appears to be valid WDP data
   bool isValidWDPMessage(const uint8_t* data, size_t len) {
-    // Minimum UDH length: 7 bytes for simple UDH (headerLen + EI + eiLen + 2x port)
-    // Or 12 bytes for concatenated UDH
-    if (len < 7) {
-      Serial.printf("   Invalid WDP: message too short (%zu bytes, min 7)\n", len);
-      return false;
-    }
-    
-    uint8_t headerLen = data[0];
-    
-    // Simple UDH: headerLen should be 0x06 (6 bytes following)
-    // Concatenated UDH: headerLen should be 0x0B (11 bytes following)
-    if (headerLen != 0x06 && headerLen != 0x0B) {
-      Serial.printf("   Invalid WDP: unexpected UDH header length 0x%02X (expected 0x06 or 0x0B)\n", headerLen);
-      return false;
-    }
-    
-    // Verify message is long enough for the declared UDH
-    if (len < (size_t)(headerLen + 1)) {
-      Serial.printf("   Invalid WDP: message too short for UDH (%zu bytes, need %d)\n", len, headerLen + 1);
-      return false;
-    }
-    
-    // Simple UDH validation (0x06)
-    if (headerLen == 0x06) {
-      // Expected format: [0x06] [0x05] [0x04] [dest_hi] [dest_lo] [src_hi] [src_lo]
-      uint8_t ei = data[1];      // Element Identifier
-      uint8_t eiLen = data[2];   // Element length
-      
-      if (ei != 0x05) {
-        Serial.printf("   Invalid WDP: unexpected element ID 0x%02X (expected 0x05 for port addressing)\n", ei);
-        return false;
-      }
-      
-      if (eiLen != 0x04) {
-        Serial.printf("   Invalid WDP: unexpected element length 0x%02X (expected 0x04)\n", eiLen);
-        return false;
-      }
-      
-      // Extract and validate ports (should be non-zero)
-      uint16_t destPort = (data[3] << 8) | data[4];
-      uint16_t srcPort = (data[5] << 8) | data[6];
-      
-      if (destPort == 0 || srcPort == 0) {
-        Serial.printf("   Invalid WDP: zero port number (dest=%d, src=%d)\n", destPort, srcPort);
+    const char* error = nullptr;
+    if (WDPControl::isControl(data, len)) {
+      WDPNack nack;
+      WDPParity parity;
+      bool valid = (data[0] == WDP_CONTROL_PARITY) ? WDPControl::parseParity(data, len, parity, &error) > 0
+                                                   : WDPControl::parseNack(data, len, nack, &error);
+      if (!valid) {
+        Serial.printf("   Invalid WDP control frame: %s (%zu bytes)\n", error, len);
         return false;
       }
+      return true;
     }
     
-    // Concatenated UDH validation (0x0B)
-    if (headerLen == 0x0B) {
-      // Expected format: [0x0B] [0x00] [0x03] [ref] [total] [current] [0x05] [0x04] [dest_hi] [dest_lo] [src_hi] [src_lo]
-      if (data[1] != 0x00 || data[2] != 0x03) {
-        Serial.printf("   Invalid WDP: unexpected concat header (0x%02X 0x%02X)\n", data[1], data[2]);
-        return false;
-      }
-      
-      uint8_t totalParts = data[4];
-      uint8_t currentPart = data[5];
-      
-      if (totalParts == 0 || currentPart == 0 || currentPart > totalParts) {
-        Serial.printf("   Invalid WDP: invalid concat part info (part %d/%d)\n", currentPart, totalParts);
-        return false;
-      }
-      
-      if (data[6] != 0x05 || data[7] != 0x04) {
-        Serial.printf("   Invalid WDP: unexpected port addressing header (0x%02X 0x%02X)\n", data[6], data[7]);
-        return false;
-      }
-      
-      uint16_t destPort = (data[8] << 8) | data[9];
-      uint16_t srcPort = (data[10] << 8) | data[11];
-      
-      if (destPort == 0 || srcPort == 0) {
-        Serial.printf("   Invalid WDP: zero port number (dest=%d, src=%d)\n", destPort, srcPort);
-        return false;
-      }
+    WDPHeaderInfo hdr;
+    if (WDPHeader::parse(data, len, hdr, &error) == 0) {
+      Serial.printf("   Invalid WDP: %s (%zu bytes)\n", error, len);
+      return false;
     }
-    
     return true;
   }
 
+  // A compact header means the sender also parses them, reply the same way
+  void learnPeerHeaderCaps(const ContactInfo* contact, const uint8_t* data, size_t len) {
+    if (!WDPHeader::isCompact(data, len)) {
+      return;
+    }
+    uint8_t caps = getPeerCaps(contact->id.pub_key);
+    if (!(caps & PEER_CAP_COMPACT_HDR)) {
+      setPeerCaps(contact->id.pub_key, caps | PEER_CAP_COMPACT_HDR);
+    }
+  }
+
   void onMessageRecv(const ContactInfo& from, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override {
     Serial.printf("(%s) MSG -> from %s\n", pkt->isRouteDirect() ? "DIRECT" : "FLOOD", from.name);
     
@@ -476,46 +970,53 @@ protected:
     size_t textLen = strlen(text);
     
     // Check for "ping" command BEFORE base91 decoding (ping is sent as raw text, not base91)
-    if (textLen == 4 && memcmp(text, "ping", 4) == 0) {
+    // Newer nodes append their capabilities: "ping caps=XX"
+    if ((textLen == 4 && memcmp(text, "ping", 4) == 0) || strncmp(text, "ping caps=", 10) == 0) {
       char senderIdStr[16];
       snprintf(senderIdStr, sizeof(senderIdStr), "%02x%02x%02x%02x", 
                from.id.pub_key[0], from.id.pub_key[1], from.id.pub_key[2], from.id.pub_key[3]);
       Serial.printf("   Ping received from %s, queuing reply\n", senderIdStr);
+      if (textLen >= 12 && isValidHex(&text[10], 2)) {
+        setPeerCaps(from.id.pub_key, (hexToNibble(text[10]) << 4) | hexToNibble(text[11]));
+      }
       
       // Queue ping reply for sending after ACK
-      for (int i = 0; i < MAX_PENDING_REPLIES; i++) {
-        if (!pending_replies[i].active) {
-          pending_replies[i].active = true;
-          pending_replies[i].time = _ms->getMillis();
-          memcpy(pending_replies[i].senderPubKey, from.id.pub_key, PUB_KEY_SIZE);
-          snprintf(pending_replies[i].replyText, sizeof(pending_replies[i].replyText), "ping ok");
-          Serial.printf("   (queued ping reply #%d for sending after ACK)\n", i);
-          break;
-        }
+      char replyText[20];
+      snprintf(replyText, sizeof(replyText), "ping ok caps=%02x", LOCAL_PEER_CAPS);
+      if (pushPendingReply(from, replyText)) {
+        Serial.println("   (queued ping reply for sending after ACK)");
+      }
+      messages_handled++;
+      updateDisplay();
+      return;
+    }
+    
+    // Ping reply, newer nodes append their capabilities: "ping ok caps=XX"
+    if (strncmp(text, "ping ok", 7) == 0) {
+      if (textLen >= 15 && strncmp(&text[7], " caps=", 6) == 0 && isValidHex(&text[13], 2)) {
+        setPeerCaps(from.id.pub_key, (hexToNibble(text[13]) << 4) | hexToNibble(text[14]));
       }
+      Serial.println("   Ping reply received");
       messages_handled++;
       updateDisplay();
       return;
     }
     
-    // Check if this looks like Base91-encoded WDP data
+    // A COBS frame means the sender also decodes COBS, reply the same way
+    if (Cobs::isFrame(text)) {
+      uint8_t caps = getPeerCaps(from.id.pub_key);
+      if (!(caps & PEER_CAP_COBS)) {
+        setPeerCaps(from.id.pub_key, caps | PEER_CAP_COBS);
+      }
+    }
+    
+    // Check if this looks like Base91-encoded or COBS-framed WDP data
     if (textLen > 0) {
-      // Queue the message for Base91 decoding and processing
-      for (int i = 0; i < MAX_PENDING_INBOX; i++) {
-        if (!pending_inbox[i].active) {
-          pending_inbox[i].active = true;
-          pending_inbox[i].time = _ms->getMillis();
-          snprintf(pending_inbox[i].senderIdStr, sizeof(pending_inbox[i].senderIdStr), "%02x%02x%02x%02x", 
-                   from.id.pub_key[0], from.id.pub_key[1], from.id.pub_key[2], from.id.pub_key[3]);
-          // Leave room for null terminator - Base91::decode expects null-terminated string!
-          pending_inbox[i].wdpLen = (textLen < sizeof(pending_inbox[i].wdpData) - 1) ? textLen : sizeof(pending_inbox[i].wdpData) - 1;
-          memcpy(pending_inbox[i].wdpData, text, pending_inbox[i].wdpLen);
-          pending_inbox[i].wdpData[pending_inbox[i].wdpLen] = '\0';  // Null-terminate for Base91::decode
-          Serial.printf("   (queued message #%d for Base91 decode, %zu chars)\n", i, textLen);
-          messages_handled++;
-          updateDisplay();
-          return;
-        }
+      // Queue the message for decoding and processing
+      if (pushPendingInbox(from, (const uint8_t*)text, textLen, false)) {
+        messages_handled++;
+        updateDisplay();
+        return;
       }
       Serial.println("   WARNING: Pending inbox full, dropping message");
       return;
@@ -550,31 +1051,69 @@ protected:
     Serial.printf("   %s\n", text);
   }
 
+  // Raw binary WDP message (PEER_CAP_RAW), queued like a decoded text message
+  // The reply echoes the request tag and is the sender's ACK
   uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override {
+#ifdef ESP32
+    // The request is padded to an AES block, the frame says how much of it is WDP
+    size_t msgLen;
+    const uint8_t* msg = WDPRawFrame::parse(data, len, msgLen);
+    if (!msg) {
+      return 0;  // Not WDP (or truncated), left unanswered
+    }
+    Serial.printf("RAW REQ -> from %s (%d bytes)\n", contact.name, (int)msgLen);
+    
+    // A raw WDP request means the sender also takes them, reply the same way
+    uint8_t caps = getPeerCaps(contact.id.pub_key);
+    if (!(caps & PEER_CAP_RAW)) {
+      setPeerCaps(contact.id.pub_key, caps | PEER_CAP_RAW);
+    }
+    
+    if (pushPendingInbox(contact, msg, msgLen, true)) {
+      messages_handled++;
+      updateDisplay();
+      memcpy(reply, &sender_timestamp, 4);
+      return 4;
+    }
+    // No ACK, the sender times out and the part is NACKed later
+    Serial.println("   WARNING: Pending inbox full, dropping message");
+#endif
     return 0;  // unknown
   }
 
+  // Response to a raw request, the request tag comes first
   void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override {
-    // not supported
+    if (len < 4) {
+      return;
+    }
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      PendingAck* a = &pending_acks[i];
+      if (a->status != ACK_UNKNOWN && memcmp(data, &a->ackCrc, 4) == 0 &&
+          memcmp(a->pubKeyPrefix, contact.id.pub_key, 4) == 0) {
+        ackReceived(a);
+        return;
+      }
+    }
   }
 
+  // The constants are the timeouts until the recipient's round trips are known on the route
   uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override {
-    return SEND_TIMEOUT_BASE_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
+    uint32_t fixed = SEND_TIMEOUT_BASE_MILLIS + (FLOOD_SEND_TIMEOUT_FACTOR * pkt_airtime_millis);
+    return adaptSendTimeout(fixed, SEND_TIMEOUT_BASE_MILLIS + 2 * pkt_airtime_millis, -1);
   }
   uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override {
-    return SEND_TIMEOUT_BASE_MILLIS + 
+    uint32_t fixed = SEND_TIMEOUT_BASE_MILLIS + 
          ( (pkt_airtime_millis*DIRECT_SEND_PERHOP_FACTOR + DIRECT_SEND_PERHOP_EXTRA_MILLIS) * (path_len + 1));
+    return adaptSendTimeout(fixed, SEND_TIMEOUT_BASE_MILLIS + 2 * pkt_airtime_millis * (path_len + 1), path_len);
   }
 
   void onSendTimeout() override {
-    if (expected_ack_crc != 0) {  // Only show error if we're still waiting for ACK
-      Serial.println("   ERROR: timed out, no ACK.");
-    }
+    expireAcks();  // Only shows an error for messages still waiting for their ACK
   }
 
 public:
   MyMesh(mesh::Radio& radio, StdRNG& rng, mesh::RTCClock& rtc, SimpleMeshTables& tables)
-     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables)
+     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new TxCountingPacketManager(16), tables)
   {
     // defaults
     memset(&_prefs, 0, sizeof(_prefs));
@@ -589,14 +1128,30 @@ public:
 
     command[0] = 0;
     curr_recipient = NULL;
-    // Initialize pending inbox queue
-    for (int i = 0; i < MAX_PENDING_INBOX; i++) {
-      pending_inbox[i].active = false;
+    contacts_dirty_count = 0;
+    contacts_dirty_all = false;
+    contacts_journal_records = 0;
+    // Initialize peer capabilities table
+    for (int i = 0; i < MAX_PEER_CAPS; i++) {
+      peer_caps[i].active = false;
     }
-    // Initialize pending replies queue
-    for (int i = 0; i < MAX_PENDING_REPLIES; i++) {
-      pending_replies[i].active = false;
+    // Initialize ACK tracking table
+    for (int i = 0; i < MAX_PENDING_ACKS; i++) {
+      pending_acks[i].status = ACK_UNKNOWN;
     }
+    next_ack_handle = 0;
+    // Initialize RTT estimates
+    for (int i = 0; i < MAX_PEER_RTT; i++) {
+      peer_rtt[i].active = false;
+    }
+    send_contact = NULL;
+    // Initialize send queue
+    for (int i = 0; i < MAX_PENDING_SENDS; i++) {
+      pending_sends[i].active = false;
+    }
+    next_send_seq = 0;
+    send_retry_time = 0;
+    send_retry_wait = false;
     messages_handled = 0;
   }
 
@@ -610,6 +1165,7 @@ public:
   // On startup the AP will ping the proxy node to discover a path
   bool proxy_ping_pending = false;
   unsigned long proxy_ping_sent_time = 0;
+  uint32_t proxy_ping_handle = 0;
   static const unsigned long PROXY_PING_TIMEOUT_MS = 8000;  // 8 second timeout per attempt
 
   // Get proxy contact by public key
@@ -632,7 +1188,7 @@ public:
       return false;
     }
     resetPathTo(*proxy);
-    saveContacts();
+    markContactDirty(proxy);
     Serial.printf("AP-Discovery: Reset path to proxy %s\n", proxy->name);
     return true;
   }
@@ -645,9 +1201,13 @@ public:
       return false;
     }
     
-    uint32_t est_timeout;
-    int result = sendMessage(*proxy, getRTCClock()->getCurrentTime(), 0, "ping", expected_ack_crc, est_timeout);
-    if (result == MSG_SEND_FAILED) {
+    // Advertise our capabilities, the proxy replies with its own ("ping ok caps=XX")
+    char pingText[16];
+    snprintf(pingText, sizeof(pingText), "ping caps=%02x", LOCAL_PEER_CAPS);
+    
+    int result;
+    proxy_ping_handle = sendTracked(*proxy, pingText, "ping", &result);
+    if (proxy_ping_handle == 0) {
       Serial.println("AP-Discovery: Ping send failed");
       return false;
     }
@@ -671,8 +1231,9 @@ public:
 
   // Called when we receive an ACK - check if it's from proxy
   void checkProxyPingAck() {
-    if (proxy_ping_pending && expected_ack_crc == 0) {
-      // ACK was received (expected_ack_crc is cleared in processAck)
+    PendingAck* ack = findAck(proxy_ping_handle);
+    if (proxy_ping_pending && ack && ack->status == ACK_DELIVERED) {
+      // ACK was received (marked in processAck)
       proxy_ping_pending = false;
       
       // Get updated path length
@@ -728,7 +1289,7 @@ public:
         newContact.gps_lon = 0;
         
         if (addContact(newContact)) {
-          saveContacts();
+          markContactDirty(&newContact);
           Serial.println("AP-Discovery: Proxy contact added successfully");
           proxy = getProxyContact();  // Re-fetch the contact
         } else {
@@ -765,51 +1326,133 @@ public:
   }
 #endif // OPERATION_MODE == MODE_AP
 
+  // Find contact by node ID (pub_key prefix, as used by the WDP gateways)
+  // Served from the index, a miss falls back to a scan of the contacts and caches the result
+  // Index entries are checked against the contact, removing contacts moves the others in the table
+  ContactInfo* lookupContactByNodeId(MeshNodeId id) {
+    ContactInfo* contact = contact_index.find(id);
+    if (contact && meshNodeId(contact->id.pub_key) == id) {
+      return contact;
+    }
+    uint8_t prefix[MESH_NODE_ID_PREFIX_LEN];
+    meshNodePrefix(id, prefix);
+    contact = lookupContactByPubKey(prefix, MESH_NODE_ID_PREFIX_LEN);
+    if (contact) {
+      contact_index.put(id, contact);
+    } else {
+      contact_index.remove(id);
+    }
+    return contact;
+  }
+
+  // Number of leading payload bytes that fit after the UDH in one message to a recipient
+  // COBS has a fixed limit, Base91 packs 13 or 14 bits per char pair depending on the data
+  size_t fitWDPMessage(MeshNodeId recipientId, const uint8_t* udh, size_t udhLen,
+                       const uint8_t* data, size_t len) {
+    ContactInfo* contact = lookupContactByNodeId(recipientId);
+    uint8_t caps = contact ? getPeerCaps(contact->id.pub_key) : 0;
+    if (caps & (PEER_CAP_RAW | PEER_CAP_COBS)) {
+      size_t maxLen = ((caps & PEER_CAP_RAW) ? MESHCORE_MAX_RAW_PAYLOAD : MESHCORE_MAX_COBS_PAYLOAD) - udhLen;
+      return (len < maxLen) ? len : maxLen;
+    }
+    Base91::Encoder encoder(nullptr, 0);  // Count only
+    encoder.update(udh, udhLen);
+    return encoder.fit(data, len, MESHCORE_MAX_BYTES - 1);
+  }
+
+  // Whether the compact WDP header can be used towards a recipient
+  bool supportsCompactHeader(MeshNodeId recipientId) {
+    ContactInfo* contact = lookupContactByNodeId(recipientId);
+    return contact && (getPeerCaps(contact->id.pub_key) & PEER_CAP_COMPACT_HDR);
+  }
+
+  // Whether a recipient resends the parts reported missing in a NACK
+  bool supportsNack(MeshNodeId recipientId) {
+    ContactInfo* contact = lookupContactByNodeId(recipientId);
+    return contact && (getPeerCaps(contact->id.pub_key) & PEER_CAP_NACK);
+  }
+
+  // Whether a recipient rebuilds lost parts from parity frames
+  bool supportsFec(MeshNodeId recipientId) {
+    ContactInfo* contact = lookupContactByNodeId(recipientId);
+    return contact && (getPeerCaps(contact->id.pub_key) & PEER_CAP_FEC);
+  }
+
+  // Whether the send queue takes another WDP message to a recipient: a free slot,
+  // and no more than a window's worth already waiting behind the messages in flight
+  bool hasSendRoom(MeshNodeId recipientId) {
+    uint8_t prefix[4];
+    meshNodePrefix(recipientId, prefix);
+    return allocPendingSend() != NULL && pendingSendCount(prefix) < WDP_TX_WINDOW;
+  }
+
   // Send WDP data to a MeshCore recipient (for WDP Gateway responses)
-  // Recipient is identified by pub_key prefix hex string
+  // Recipient is identified by its node ID (pub_key prefix)
   // NOTE: MeshCore sendMessage uses strlen() and WDP contains a lot of 0x00
-  // so we must Base91-encode binary data to avoid null bytes truncating the message!
-  // Base91 uses all ASCII characters not causing issues, much more efficient than hex or base64.
-  void sendWDPToMesh(const String& recipientId, const uint8_t* data, size_t len) {
-    Serial.printf("WDP->Mesh: Sending %d bytes to %s\n", len, recipientId.c_str());
+  // so we must encode binary data to avoid null bytes truncating the message!
+  // Peers that support it get COBS framing (1-2 bytes overhead), older nodes
+  // get Base91 (~23% overhead, but all ASCII characters not causing issues).
+  // Peers that take raw binary contact requests skip the text message altogether
+  // (no encoding, and up to MESHCORE_MAX_RAW_PAYLOAD bytes per packet).
+  // The UDH and the payload slice are encoded straight from their buffers into the text frame,
+  // which is queued and goes out once the recipient's transmit window has room (WDP_TX_WINDOW)
+  // Returns false if nothing was queued
+  bool sendWDPToMesh(MeshNodeId recipientId, const uint8_t* udh, size_t udhLen,
+                     const uint8_t* data, size_t len) {
+    Serial.printf("WDP->Mesh: Sending %d bytes to %08lx\n", udhLen + len, (unsigned long)recipientId);
     
-    // Find contact by pub_key prefix
-    uint8_t targetPrefix[4];
-    for (int i = 0; i < 4 && i*2 < (int)recipientId.length(); i++) {
-      targetPrefix[i] = (hexToNibble(recipientId.charAt(i*2)) << 4) | 
-                        hexToNibble(recipientId.charAt(i*2 + 1));
-    }
-    
-    ContactInfo* contact = lookupContactByPubKey(targetPrefix, 4);
+    ContactInfo* contact = lookupContactByNodeId(recipientId);
     if (!contact) {
-      Serial.printf("WDP->Mesh: Contact not found for %s\n", recipientId.c_str());
-      return;
+      Serial.printf("WDP->Mesh: Contact not found for %08lx\n", (unsigned long)recipientId);
+      return false;
     }
     
-    const size_t maxBinaryLen = ((MESHCORE_MAX_BYTES - 1) * 13) / 16;
-    if (len > maxBinaryLen) {
-      Serial.printf("WDP->Mesh: Data too large (%d bytes), truncating to %d\n", len, maxBinaryLen);
-      len = maxBinaryLen;
+    uint8_t caps = getPeerCaps(contact->id.pub_key);
+    bool useRaw = (caps & PEER_CAP_RAW) != 0;
+    bool useCobs = (caps & PEER_CAP_COBS) != 0;
+    const char* codecName = useRaw ? "raw" : useCobs ? "COBS" : "Base91";
+    const size_t maxPayloadLen = fitWDPMessage(recipientId, udh, udhLen, data, len);
+    if (len > maxPayloadLen) {
+      Serial.printf("WDP->Mesh: Data too large (%d bytes), truncating to %d\n", udhLen + len, udhLen + maxPayloadLen);
+      len = maxPayloadLen;
     }
     
-    // Base91-encode
-    char encodedMsg[MESHCORE_MAX_BYTES + 1];
-    size_t encodedLen = Base91::encode(data, len, encodedMsg, sizeof(encodedMsg));
-    if (encodedLen == 0) {
-      Serial.println("WDP->Mesh: Base91 encoding failed");
-      return;
+    PendingSend* slot = allocPendingSend();
+    if (!slot) {
+      Serial.println("WDP->Mesh: Send queue full, dropping message");
+      return false;
     }
     
-    // Send as regular message
-    uint32_t est_timeout;
-    int result = sendMessage(*contact, getRTCClock()->getCurrentTime(), 0, encodedMsg, expected_ack_crc, est_timeout);
-    if (result == MSG_SEND_FAILED) {
-      Serial.println("WDP->Mesh: Send failed");
+    // Copy as is, Base91-encode or COBS-frame into the queue slot
+    char* encodedMsg = (char*)slot->frame;
+    size_t encodedLen;
+    if (useRaw) {
+      encodedLen = WDPRawFrame::write(slot->frame, udh, udhLen, data, len);
+    } else if (useCobs) {
+      Cobs::Encoder encoder(encodedMsg, MESHCORE_MAX_BYTES + 1);
+      encoder.update(udh, udhLen);
+      encoder.update(data, len);
+      encodedLen = encoder.finish();
     } else {
-      last_msg_sent = _ms->getMillis();
-      Serial.printf("WDP->Mesh: Sent %s (%d bytes Base91-encoded as %d chars)\n", 
-                    result == MSG_SEND_SENT_FLOOD ? "FLOOD" : "DIRECT", len, encodedLen);
+      Base91::Encoder encoder(encodedMsg, MESHCORE_MAX_BYTES + 1);
+      encoder.update(udh, udhLen);
+      encoder.update(data, len);
+      encodedLen = encoder.finish();
     }
+    if (encodedLen == 0) {
+      Serial.printf("WDP->Mesh: %s encoding failed\n", codecName);
+      return false;
+    }
+    
+    // Queue as regular message, sent right away if the window has room
+    slot->active = true;
+    slot->raw = useRaw;
+    slot->len = encodedLen;
+    slot->seq = next_send_seq++;
+    memcpy(slot->pubKeyPrefix, contact->id.pub_key, 4);
+    Serial.printf("WDP->Mesh: Queued %d bytes %s-encoded as %d chars\n", udhLen + len, codecName, encodedLen);
+    pumpPendingSends();
+    return true;
   }
 #endif
 
@@ -954,13 +1597,11 @@ public:
     if (memcmp(command, "send ", 5) == 0) {
       if (curr_recipient) {
         const char *text = &command[5];
-        uint32_t est_timeout;
+        int result;
 
-        int result = sendMessage(*curr_recipient, getRTCClock()->getCurrentTime(), 0, text, expected_ack_crc, est_timeout);
-        if (result == MSG_SEND_FAILED) {
+        if (sendTracked(*curr_recipient, text, "text", &result) == 0) {
           Serial.println("   ERROR: unable to send.");
         } else {
-          last_msg_sent = _ms->getMillis();
           Serial.printf("   (message sent - %s)\n", result == MSG_SEND_SENT_FLOOD ? "FLOOD" : "DIRECT");
         }
       } else {
@@ -1037,9 +1678,29 @@ public:
     } else if (strcmp(command, "reset path") == 0) {
       if (curr_recipient) {
         resetPathTo(*curr_recipient);
-        saveContacts();
+        markContactDirty(curr_recipient);
         Serial.println("   Done.");
       }
+    } else if (memcmp(command, "codec", 5) == 0) {  // show/set WDP codec for current recipient
+      if (!curr_recipient) {
+        Serial.println("   ERROR: no recipient selected (use 'to' cmd).");
+      } else if (command[5] == ' ') {
+        uint8_t caps = getPeerCaps(curr_recipient->id.pub_key);
+        if (strcmp(&command[6], "raw") == 0) {
+          setPeerCaps(curr_recipient->id.pub_key, caps | PEER_CAP_RAW);
+          Serial.println("  OK");
+        } else if (strcmp(&command[6], "cobs") == 0) {
+          setPeerCaps(curr_recipient->id.pub_key, (caps & ~PEER_CAP_RAW) | PEER_CAP_COBS);
+          Serial.println("  OK");
+        } else if (strcmp(&command[6], "base91") == 0) {
+          setPeerCaps(curr_recipient->id.pub_key, caps & ~(PEER_CAP_RAW | PEER_CAP_COBS));
+          Serial.println("  OK");
+        } else {
+          Serial.printf("  ERROR: unknown codec: %s\n", &command[6]);
+        }
+      } else {
+        Serial.printf("   %s: %s\n", curr_recipient->name, peerCodecName(getPeerCaps(curr_recipient->id.pub_key)));
+      }
     } else if (memcmp(command, "card", 4) == 0) {
       Serial.printf("Hello %s\n", _prefs.node_name);
       auto pkt = createSelfAdvert(_prefs.node_name, _prefs.node_lat, _prefs.node_lon);
@@ -1100,6 +1761,7 @@ public:
       Serial.println("   send <text>");
       Serial.println("   advert");
       Serial.println("   reset path");
+      Serial.println("   codec {base91|cobs|raw}");
       Serial.println("   public <text>");
       Serial.println("   mc-radar <text>");
     } else {
@@ -1107,72 +1769,65 @@ public:
     }
   }
 
+#ifdef ESP32
+  // Handle every queued WDP message that is ready, oldest first
+  // Each is decoded and handled in place, it stays in the ring until we are done
+  // (the handlers may run the mesh loop, which can queue new messages behind it)
+  void processPendingInbox() {
+    PendingInbox* msg;
+    while ((msg = frontPendingInbox()) != NULL) {
+      Serial.printf("   Processing queued WDP message from %08lx\n", (unsigned long)msg->sender);
+      
+      // Validate sender node ID before processing
+      ContactInfo* sender = validateSender(msg->sender);
+      if (!sender) {
+        Serial.println("   REJECTED: Message from unknown/invalid node ID");
+        inbox_ring.pop();
+        continue;
+      }
+      
+      // Decode the message in place, or fall back to raw binary (for backward compatibility)
+      bool decoded = msg->raw || decodePendingInbox(msg);
+      
+      // Validate WDP message format before forwarding
+      if (!isValidWDPMessage(msg->wdpData(), msg->wdpLen)) {
+        Serial.println(decoded ? "   REJECTED: Invalid WDP message format"
+                               : "   REJECTED: Invalid WDP message format (raw binary)");
+        inbox_ring.pop();
+        continue;
+      }
+      learnPeerHeaderCaps(sender, msg->wdpData(), msg->wdpLen);
+      
+      // Forward decoded binary to the WDP gateway or the AP
+    #if (OPERATION_MODE == MODE_PROXY)
+      proxy_handleIncomingMesh(msg->sender, msg->wdpData(), msg->wdpLen);
+    #elif (OPERATION_MODE == MODE_AP)
+      ap_handleIncomingMesh(msg->sender, msg->wdpData(), msg->wdpLen);
+    #endif
+      
+      inbox_ring.pop();
+    }
+  }
+#endif
+
+  // Write pending contact changes without waiting for them to settle
+  void flushContactsNow() {
+    flushContacts(true);
+  }
+
   void loop() {
     BaseChatMesh::loop();
+    expireAcks();
+    pumpPendingSends();
+    flushContacts();
 
 #ifdef ESP32
   #if (OPERATION_MODE == MODE_PROXY)
     // Check for UDP responses from WAPBOX 
     proxy_loop();
     
-    // Process pending WDP messages (after 100ms to allow ACK to be sent first)
-    for (int i = 0; i < MAX_PENDING_INBOX; i++) {
-      if (pending_inbox[i].active && (_ms->getMillis() - pending_inbox[i].time > 100)) {
-        // Copy data before clearing
-        char senderIdStr[20];
-        uint8_t wdpData[256];
-        size_t wdpLen = pending_inbox[i].wdpLen;
-        strncpy(senderIdStr, pending_inbox[i].senderIdStr, sizeof(senderIdStr));
-        memcpy(wdpData, pending_inbox[i].wdpData, sizeof(wdpData));
-        
-        // Clear the slot
-        clearPendingInbox(&pending_inbox[i]);
-        
-        Serial.printf("   Processing queued WDP message from %s\n", senderIdStr);
-        
-        // Validate sender node ID before processing
-        if (!isValidSenderNodeId(senderIdStr)) {
-          Serial.println("   REJECTED: Message from unknown/invalid node ID");
-          break;
-        }
-        
-        // Base91-decode the message
-        uint8_t decodedData[256];
-        size_t decodedLen = Base91::decode((const char*)wdpData, 
-                                            decodedData, sizeof(decodedData));
-        
-        if (decodedLen > 0) {
-          Serial.printf("   Base91-decoded: %zu chars -> %zu bytes\n", 
-                        strlen((const char*)wdpData), decodedLen);
-          
-          // Validate WDP message format before forwarding
-          if (!isValidWDPMessage(decodedData, decodedLen)) {
-            Serial.println("   REJECTED: Invalid WDP message format");
-            break;
-          }
-          
-          // Forward decoded binary to WDP gateway
-          proxy_handleIncomingMesh(String(senderIdStr), 
-                                   decodedData, 
-                                   decodedLen);
-        } else {
-          Serial.println("   Base91 decode failed, trying as raw binary");
-          
-          // Validate WDP message format before forwarding (raw binary)
-          if (!isValidWDPMessage(wdpData, wdpLen)) {
-            Serial.println("   REJECTED: Invalid WDP message format (raw binary)");
-            break;
-          }
-          
-          // Fallback: try as raw binary (for backward compatibility)
-          proxy_handleIncomingMesh(String(senderIdStr), 
-                                   wdpData, 
-                                   wdpLen);
-        }
-        
-        break;  // Only process one per loop iteration
-      }
-    }
+    // Handle the WDP messages whose ACK is on its way
+    processPendingInbox();
   #elif (OPERATION_MODE == MODE_AP)
     // Handle HTTP clients and response timeouts
     ap_loop();
@@ -1208,92 +1863,30 @@ public:
       }
     }
     
-    // Process pending WDP messages for AP mode
-    for (int i = 0; i < MAX_PENDING_INBOX; i++) {
-      if (pending_inbox[i].active && (_ms->getMillis() - pending_inbox[i].time > 100)) {
-        // Copy data before clearing
-        char senderIdStr[20];
-        uint8_t wdpData[256];
-        size_t wdpLen = pending_inbox[i].wdpLen;
-        strncpy(senderIdStr, pending_inbox[i].senderIdStr, sizeof(senderIdStr));
-        memcpy(wdpData, pending_inbox[i].wdpData, sizeof(wdpData));
-        
-        // Clear the slot
-        clearPendingInbox(&pending_inbox[i]);
-        
-        Serial.printf("   Processing queued message from %s (AP mode)\n", senderIdStr);
-        
-        // Validate sender node ID before processing
-        if (!isValidSenderNodeId(senderIdStr)) {
-          Serial.println("   REJECTED: Message from unknown/invalid node ID (AP mode)");
-          break;
-        }
-        
-        // Base91-decode the message
-        uint8_t decodedData[256];
-        size_t decodedLen = Base91::decode((const char*)wdpData, 
-                                            decodedData, sizeof(decodedData));
-        
-        if (decodedLen > 0) {
-          Serial.printf("   Base91-decoded: %zu chars -> %zu bytes\n", 
-                        strlen((const char*)wdpData), decodedLen);
-          
-          // Validate WDP message format before forwarding
-          if (!isValidWDPMessage(decodedData, decodedLen)) {
-            Serial.println("   REJECTED: Invalid WDP message format (AP mode)");
-            break;
-          }
-          
-          // Forward decoded binary to AP mode handler
-          ap_handleIncomingMesh(String(senderIdStr), 
-                                decodedData, 
-                                decodedLen);
-        } else {
-          Serial.println("   Base91 decode failed, trying as raw binary");
-          
-          // Validate WDP message format before forwarding (raw binary)
-          if (!isValidWDPMessage(wdpData, wdpLen)) {
-            Serial.println("   REJECTED: Invalid WDP message format (raw binary, AP mode)");
-            break;
-          }
-          
-          // Fallback: try as raw binary (for backward compatibility)
-          ap_handleIncomingMesh(String(senderIdStr), 
-                                wdpData, 
-                                wdpLen);
-        }
-        
-        break;  // Only process one per loop iteration
-      }
-    }
+    // Handle the WDP messages whose ACK is on its way
+    processPendingInbox();
   #endif
     
-    // Process pending replies (after 100ms to allow ACK to be sent first)
-    for (int i = 0; i < MAX_PENDING_REPLIES; i++) {
-      if (pending_replies[i].active && (_ms->getMillis() - pending_replies[i].time > 100)) {
-        // Copy data before clearing
-        uint8_t senderPubKey[PUB_KEY_SIZE];
-        char replyText[256];
-        memcpy(senderPubKey, pending_replies[i].senderPubKey, sizeof(senderPubKey));
-        strncpy(replyText, pending_replies[i].replyText, sizeof(replyText));
-        
-        // Clear the slot
-        clearPendingReply(&pending_replies[i]);
-        
-        Serial.println("   Processing queued welcome reply");
-        
-        ContactInfo* sender = lookupContactByPubKey(senderPubKey, PUB_KEY_SIZE);
-        if (sender) {
-          uint32_t est_timeout;
-          int result = sendMessage(*sender, getRTCClock()->getCurrentTime(), 0, 
-                                   replyText, expected_ack_crc, est_timeout);
-          if (result != MSG_SEND_FAILED) {
-            last_msg_sent = _ms->getMillis();
-            Serial.printf("   Sent welcome reply (%s)\n", result == MSG_SEND_SENT_FLOOD ? "FLOOD" : "DIRECT");
-          }
+    // Process pending replies (after 100ms to allow ACK to be sent first), one per loop iteration
+    size_t replyLen;
+    PendingReply* reply = (PendingReply*)reply_ring.front(&replyLen);
+    if (reply && (_ms->getMillis() - reply->time > 100)) {
+      // Copy data before popping
+      uint8_t senderPubKey[PUB_KEY_SIZE];
+      char replyText[64];
+      memcpy(senderPubKey, reply->senderPubKey, sizeof(senderPubKey));
+      strncpy(replyText, reply->replyText(), sizeof(replyText) - 1);
+      replyText[sizeof(replyText) - 1] = 0;
+      reply_ring.pop();
+      
+      Serial.println("   Processing queued welcome reply");
+      
+      ContactInfo* sender = lookupContactByPubKey(senderPubKey, PUB_KEY_SIZE);
+      if (sender) {
+        int result;
+        if (sendTracked(*sender, replyText, "reply", &result) != 0) {
+          Serial.printf("   Sent welcome reply (%s)\n", result == MSG_SEND_SENT_FLOOD ? "FLOOD" : "DIRECT");
         }
-        
-        break;  // Only process one per loop iteration
       }
     }
 #endif
@@ -1364,6 +1957,7 @@ void displayStatus(const char* line1, const char* line2, const char* line3, cons
 // Deep sleep functions
 void enterDeepSleep() {
   Serial.println("Entering deep sleep...");
+  the_mesh.flushContactsNow();    // Don't lose contact changes still waiting for the debounce
   displayStatus("Deep Sleep", "Press BTN to wake");
   delay(500);  // Let user see the message
   
@@ -1525,8 +2119,20 @@ void setup() {
     if (proxy_isWiFiConnected()) {
       Serial.println("DEBUG: Initializing WDP Gateway (Proxy Mode)...");
       proxy_init(WAPBOX_HOST, WAPBOX_PORT);
-      proxy_begin([](const String& to, const uint8_t* data, size_t len) {
-        the_mesh.sendWDPToMesh(to, data, len);
+      proxy_begin([](MeshNodeId to, const uint8_t* udh, size_t udhLen, const uint8_t* data, size_t len) {
+        the_mesh.sendWDPToMesh(to, udh, udhLen, data, len);
+      });
+      proxy_setMeshFitCallback([](MeshNodeId to, const uint8_t* udh, size_t udhLen, const uint8_t* data, size_t len) {
+        return the_mesh.fitWDPMessage(to, udh, udhLen, data, len);
+      });
+      proxy_setMeshCompactCallback([](MeshNodeId to) {
+        return the_mesh.supportsCompactHeader(to);
+      });
+      proxy_setMeshFecCallback([](MeshNodeId to) {
+        return the_mesh.supportsFec(to);
+      });
+      proxy_setMeshRoomCallback([](MeshNodeId to) {
+        return the_mesh.hasSendRoom(to);
       });
       Serial.printf("DEBUG: WDP Gateway ready, forwarding to %s\n", WAPBOX_HOST);
       displayStatus("MeshAccessProtocol", "Proxy Mode Ready", WAPBOX_HOST);
@@ -1538,13 +2144,24 @@ void setup() {
     if (ap_isInitialized()) {
       Serial.println("DEBUG: AP Mode active, setting up mesh callbacks...");
       // Set mesh callback so AP mode can send requests via mesh to proxy node
-      ap_setMeshCallback([](const String& to, const uint8_t* data, size_t len) {
-        the_mesh.sendWDPToMesh(to, data, len);
+      ap_setMeshCallback([](MeshNodeId to, const uint8_t* udh, size_t udhLen, const uint8_t* data, size_t len) {
+        the_mesh.sendWDPToMesh(to, udh, udhLen, data, len);
+      });
+      // Let the fragmenter fill each message for the proxy's codec (learned from the ping reply)
+      ap_setMeshFitCallback([](MeshNodeId to, const uint8_t* udh, size_t udhLen, const uint8_t* data, size_t len) {
+        return the_mesh.fitWDPMessage(to, udh, udhLen, data, len);
+      });
+      // Compact WDP headers once the proxy advertised them
+      ap_setMeshCompactCallback([](MeshNodeId to) {
+        return the_mesh.supportsCompactHeader(to);
+      });
+      // Ask for lost response parts once the proxy advertised it resends them
+      ap_setMeshNackCallback([](MeshNodeId to) {
+        return the_mesh.supportsNack(to);
       });
-      // Set mesh loop callback so AP mode can process mesh during blocking HTTP waits
-      // This is CRITICAL - without it, the AP cannot receive responses or send ACKs!
-      ap_setMeshLoopCallback([]() {
-        the_mesh.loop();
+      // Request parts go out from ap_loop() as the send queue has room
+      ap_setMeshRoomCallback([](MeshNodeId to) {
+        return the_mesh.hasSendRoom(to);
       });
       Serial.println("DEBUG: AP Mode mesh callbacks configured");
       
@@ -12,6 +12,10 @@
 #include <wap_request.h>
 #include <wap_response.h>
 #include <wmlc_decompiler.h>
+#include <wsp_reply_parser.h>
+#include "rtt_estimator.h"
+#include "spsc_ring.h"
+#include "http_request_parser.h"
 
 // Forward declaration - defined in main.cpp
 extern void displayStatus(const char* line1, const char* line2, const char* line3, const char* line4);
@@ -42,38 +46,70 @@ extern void displayStatus(const char* line1, const char* line2, const char* line
   #define WAPBOX_PORT 9200  // Standard WAP gateway port
 #endif
 
-// UDH (User Data Header) structure for datagram
-struct AP_UDH {
-  uint8_t headerLen;
-  uint8_t ei;         // Element Identifier (0x05 = Application Port Addressing 16-bit)
-  uint8_t eiLength;   // Length of element data (0x04 for 16-bit ports)
-  uint16_t source;    // Source port
-  uint16_t dest;      // Destination port
+// WAP requests in flight at once (WiFi clients, or one browser fetching a page and its images)
+#ifndef AP_MAX_TRANSACTIONS
+  #define AP_MAX_TRANSACTIONS 4
+#endif
+
+// Bytes of an HTTP request a transaction keeps (request line, Host and Content-Type),
+// other headers are skipped as they are read
+#ifndef AP_REQUEST_BUFFER_SIZE
+  #define AP_REQUEST_BUFFER_SIZE 512
+#endif
+
+typedef HttpRequestParser<AP_REQUEST_BUFFER_SIZE> ApHttpRequest;
+
+// Bytes per write of decompiled WML to a client (one TCP segment)
+#ifndef AP_WML_CHUNK_SIZE
+  #define AP_WML_CHUNK_SIZE 1436
+#endif
+
+typedef WMLClientSink<WiFiClient, AP_WML_CHUNK_SIZE> ApWMLSink;
+
+// Life of a transaction, moved on once per ap_loop() (see ap_stepTransaction)
+// and by the response events the mesh side posts (see ap_dispatchEvents)
+enum ApTxState {
+  AP_TX_FREE,           // Slot unused
+  AP_TX_READING,        // Reading the HTTP request from the client
+  AP_TX_AWAITING,       // WAP request sent over the mesh, no HTTP headers sent yet
+  AP_TX_STREAMING,      // HTTP headers sent, body going out as parts arrive
+  AP_TX_CLOSING         // Response written, client closed after a short linger
 };
 
-// Concatenated message tracking for reassembly (responses from proxy)
-struct AP_ConcatMessage {
-  bool active;
-  uint8_t refNum;           // Reference number
-  uint8_t totalParts;
-  uint8_t receivedParts;
-  uint8_t partReceived[16]; // Bitmask for which parts received (max 16 parts)
-  uint8_t data[4096];       // Reassembled data buffer (larger for WAP responses)
-  uint16_t partSizes[16];   // Size of each part
-  uint16_t sourcePort;
-  uint16_t destPort;
-  String senderMeshId;
-  unsigned long lastUpdate;
+// WAP request from a WiFi client, keyed by the WDP source port the request went out
+// from once it is sent, which the proxy sends the response back to
+struct ApTransaction {
+  ApTxState state;
+  unsigned long stateTime;      // Entered the current state
+  uint16_t port;                // WDP source port of the request
+  uint8_t tid;
+  WiFiClient client;            // Client waiting for the response
+  unsigned long sentTime;       // Request sent, 0 once the response started arriving
+  unsigned long lastPartTime;   // Request sent or last part received (for the quiet timeout)
+  unsigned long waitMs;         // Quiet time allowed before giving up
+  WSPReplyParser reply;         // Status and headers of the response, fed its parts in order
+  bool isWMLC;                  // Response is WMLC, decompiled as its parts stream out
+  WMLCStreamDecompiler wml;     // Decompiler of a streamed WMLC body
+  uint8_t streamedParts;        // Leading parts handled (fed to reply, or written to the client)
+  size_t bodyBytesSent;
+  ApHttpRequest request;        // Parsed as the client sends it
+  WDPOutgoing out;              // WAP request on its way to the proxy (see ap_sendRequestParts)
+  size_t wapRequestLen;
+  uint8_t wapRequest[512];      // WSP request, kept until all its parts are sent
 };
 
-// Pending WAP request tracking (waiting for mesh response)
-struct AP_PendingRequest {
-  bool active;
-  uint8_t transactionId;
-  uint16_t sourcePort;
-  uint16_t destPort;
-  WiFiClient* client;       // Client waiting for response (nullptr if timed out)
-  unsigned long timestamp;
+// Response events from the mesh side, handled by their transaction in ap_loop()
+// so the mesh handlers never write to a client
+enum ApEventType {
+  AP_EVENT_PARTS,       // New parts of a concatenated response are in its reassembly slot
+  AP_EVENT_RESPONSE     // Whole response in one message, carried in the event
+};
+
+struct ApEvent {
+  uint8_t type;
+  uint16_t port;
+  uint16_t len;
+  const uint8_t* data() const { return (const uint8_t*)(this + 1); }
 };
 
 // AP Mode state
@@ -95,28 +131,74 @@ static DNSServer dnsServer;
 // HTTP Server instance
 static WiFiServer httpServer(HTTP_PORT);
 
+// Node ID of the proxy all requests go to
+static const MeshNodeId ap_proxyNode = meshNodeIdFromHex(PROXY_NODE_PUBKEY);
+
 // Mesh communication callback
-static std::function<void(const String&, const uint8_t*, size_t)> ap_sendMeshCallback = nullptr;
+static WDPSendCallback ap_sendMeshCallback = nullptr;
+
+// Max binary bytes per mesh message to a recipient (depends on the codec it supports)
+static WDPFitCallback ap_meshFitCallback = nullptr;
+
+// Whether a recipient understands the compact WDP header
+static WDPCompactCallback ap_meshCompactCallback = nullptr;
+
+// Whether a recipient resends the parts reported missing in a NACK
+static WDPNackCallback ap_meshNackCallback = nullptr;
 
-// Mesh loop callback - MUST be set to keep mesh alive during blocking waits
-static std::function<void()> ap_meshLoopCallback = nullptr;
+// Whether the send queue takes another message to a recipient right now
+static WDPRoomCallback ap_meshRoomCallback = nullptr;
 
 // Concatenated message reassembly for incoming mesh responses
-static const int AP_MAX_CONCAT_MESSAGES = 4;
-static AP_ConcatMessage ap_concatMessages[AP_MAX_CONCAT_MESSAGES];
-
-// Response buffer for completed mesh responses
-static uint8_t ap_meshResponseBuffer[4096];
-static size_t ap_meshResponseLen = 0;
-static bool ap_meshResponseReady = false;
-static uint8_t ap_meshResponseTid = 0;
-
-// Early header sending state - send HTTP headers when first packet arrives
-static WiFiClient* ap_waitingClient = nullptr;    // Client waiting for mesh response
-static bool ap_headersSent = false;               // Have we already sent HTTP headers?
-static HTTPResponse ap_earlyResponse;             // Decoded response headers from first packet
-static bool ap_isWMLC = false;                    // Is response WMLC that needs decompilation?
-static size_t ap_bodyBytesReceived = 0;           // Track body bytes for progress
+// Responses are answered from their reassembly slot once complete, no copy is kept
+static WDPMeshReassembler ap_reassembler;
+
+// Requests being read, waiting for their response or closing
+static ApTransaction ap_transactions[AP_MAX_TRANSACTIONS];
+
+// Response events waiting for ap_loop()
+static SpscRing<1024> ap_events;
+
+// Decoded response (headers from the first part, or the whole response once complete)
+static HTTPResponse ap_wapResponse;
+
+// Decompiled WML on its way to a client, collected into TCP segment sized writes
+// rather than one per token, and flushed after each part (see ap_streamBody)
+static ApWMLSink ap_wmlSink;
+
+// Quiet time before asking the proxy for missing parts of a response, and how often to ask
+static const unsigned long AP_NACK_DELAY_MS = 5000;
+static const uint8_t AP_MAX_NACKS = 3;
+
+// Parity frames kept until their group is complete or can be rebuilt
+static const int AP_MAX_PARITY_BLOCKS = 8;
+static const unsigned long AP_PARITY_TIMEOUT_MS = 30000;
+struct ApParityBlock {
+  bool active;
+  MeshNodeId sender;
+  WDPParity parity;
+  size_t blockLen;
+  uint8_t block[WDP_FEC_MAX_BLOCK];
+  unsigned long timestamp;
+};
+static ApParityBlock ap_parityBlocks[AP_MAX_PARITY_BLOCKS];
+
+// Parts rebuilt from parity (at most one per parity block of a group)
+static uint8_t ap_rebuiltParts[WDP_FEC_MAX_PARITY][WDP_FEC_MAX_BLOCK];
+
+// Time from sending a request to the first part of its response (WAPBox fetch plus
+// the mesh both ways), learned per request, sets how long to wait for a quiet response
+// Never below two NACK delays, so a lost part can still be asked for
+static const unsigned long AP_MIN_WAIT_MS = 2 * AP_NACK_DELAY_MS;
+static const unsigned long AP_MAX_WAIT_MS = 60000;
+static RttEstimator ap_responseRtt(AP_MIN_WAIT_MS, AP_MAX_WAIT_MS);
+
+// Quiet time allowed until response latencies have been learned
+static const unsigned long AP_RESPONSE_TIMEOUT_MS = 15000;
+
+// Time a client gets to send its request, and to take the response before it is closed
+static const unsigned long AP_REQUEST_TIMEOUT_MS = 5000;
+static const unsigned long AP_CLOSE_LINGER_MS = 10;
 
 // Keep-alive interval for HTTP clients waiting for mesh response (ms)
 static const unsigned long AP_KEEPALIVE_INTERVAL_MS = 2000;
@@ -129,454 +211,618 @@ static bool ap_wdpSessionActive = false;
 static size_t ap_wdpBytesSent = 0;
 static int ap_wdpTotalParts = 0;
 static int ap_wdpReceivedParts = 0;
-static unsigned long ap_lastPartReceivedTime = 0;  // Timestamp of last received part (for timeout extension)
 
 // Flag to indicate display needs refresh (WiFi client count changed)
 static bool ap_displayNeedsUpdate = false;
 
-// Current request source port for response matching
-static uint16_t ap_currentRequestPort = 0;
+// Transaction waiting for the response to a source port, or nullptr
+static ApTransaction* ap_findTransaction(uint16_t port) {
+  for (int i = 0; i < AP_MAX_TRANSACTIONS; i++) {
+    ApTransaction* tx = &ap_transactions[i];
+    if ((tx->state == AP_TX_AWAITING || tx->state == AP_TX_STREAMING) && tx->port == port) {
+      return tx;
+    }
+  }
+  return nullptr;
+}
 
-// Flag to track if a request is currently being processed via mesh
-static bool ap_requestInProgress = false;
+static ApTransaction* ap_freeTransaction() {
+  for (int i = 0; i < AP_MAX_TRANSACTIONS; i++) {
+    if (ap_transactions[i].state == AP_TX_FREE) {
+      return &ap_transactions[i];
+    }
+  }
+  return nullptr;
+}
 
-// Generate random source port (1024-9999)
-static uint16_t ap_generateSourcePort() {
-  return 1024 + (esp_random() % (9999 - 1024 + 1));
+static int ap_activeTransactions() {
+  int count = 0;
+  for (int i = 0; i < AP_MAX_TRANSACTIONS; i++) {
+    if (ap_transactions[i].state != AP_TX_FREE) {
+      count++;
+    }
+  }
+  return count;
 }
 
-/**
- * HTTP Request structure for parsing incoming requests
- * Note: Reduced buffer sizes to save memory
- */
-struct HTTPRequest {
-  char method[16];      // GET, POST, etc.
-  char path[256];       // Request path
-  char host[128];       // Host header
-  char contentType[64]; // Content-Type (for POST)
-  size_t contentLength; // Content-Length
-  uint8_t body[512];    // Request body for POST (reduced from 2048)
-  size_t bodyLen;
-};
+static void ap_setState(ApTransaction* tx, ApTxState state) {
+  tx->state = state;
+  tx->stateTime = millis();
+}
+
+// Generate random source port (1024-9999), not used by a request in flight
+static uint16_t ap_generateSourcePort() {
+  uint16_t port;
+  do {
+    port = 1024 + (esp_random() % (9999 - 1024 + 1));
+  } while (ap_findTransaction(port));
+  return port;
+}
 
 // Static buffers to avoid stack overflow
-static uint8_t http_wapRequest[512];
-static uint8_t http_wapResponse[4096];
-static char http_decompiled[8192];
 static char http_url[512];
-static HTTPRequest http_req;
 
 /**
- * Parse HTTP request from client
+ * Update display during WDP session
  */
-bool parseHTTPRequest(WiFiClient& client, HTTPRequest* req) {
-  memset(req, 0, sizeof(HTTPRequest));
-  
-  // Read request line with timeout
-  String requestLine = "";
-  unsigned long startTime = millis();
-  while (client.connected() && (millis() - startTime < 5000)) {
-    if (client.available()) {
-      char c = client.read();
-      if (c == '\n') break;
-      if (c != '\r') requestLine += c;
-    }
-  }
-  
-  if (requestLine.length() == 0) {
-    Serial.println("HTTP: Empty request line");
-    return false;
-  }
-  
-  Serial.printf("HTTP Request: %s\n", requestLine.c_str());
+void ap_updateWDPDisplay() {
+  char line2[32];
+  char line3[32];
+  char line4[32];
   
-  // Parse method and path
-  int firstSpace = requestLine.indexOf(' ');
-  int secondSpace = requestLine.indexOf(' ', firstSpace + 1);
+  snprintf(line2, sizeof(line2), "WDP Session");
+  snprintf(line3, sizeof(line3), "Sent: %d bytes", (int)ap_wdpBytesSent);
   
-  if (firstSpace < 0 || secondSpace < 0) {
-    Serial.println("HTTP: Invalid request line format");
-    return false;
+  if (ap_wdpTotalParts > 0) {
+    snprintf(line4, sizeof(line4), "Recv: %d/%d parts", ap_wdpReceivedParts, ap_wdpTotalParts);
+  } else {
+    snprintf(line4, sizeof(line4), "Waiting for reply...");
   }
   
-  String method = requestLine.substring(0, firstSpace);
-  String path = requestLine.substring(firstSpace + 1, secondSpace);
-  
-  strncpy(req->method, method.c_str(), sizeof(req->method) - 1);
-  strncpy(req->path, path.c_str(), sizeof(req->path) - 1);
-  
-  // Read headers
-  startTime = millis();
-  while (client.connected() && (millis() - startTime < 5000)) {
-    String line = "";
-    while (client.connected() && (millis() - startTime < 5000)) {
-      if (client.available()) {
-        char c = client.read();
-        if (c == '\n') break;
-        if (c != '\r') line += c;
+  displayStatus("MeshAccessProtocol", line2, line3, line4);
+}
+
+/**
+ * Restore normal display after WDP session
+ */
+void ap_restoreNormalDisplay() {
+  ap_wdpSessionActive = false;
+  ap_wdpBytesSent = 0;
+  ap_wdpTotalParts = 0;
+  ap_wdpReceivedParts = 0;
+}
+
+/**
+ * First part of the response to a request arrived, sample its latency
+ */
+void ap_noteResponseStarted(ApTransaction* tx) {
+  if (tx->sentTime == 0) {
+    return;
+  }
+  ap_responseRtt.sample(millis() - tx->sentTime);
+  tx->sentTime = 0;
+  Serial.printf("AP-WDP: Response latency srtt %lu, rttvar %lu millis\n",
+                (unsigned long)ap_responseRtt.srtt(), (unsigned long)ap_responseRtt.rttvar());
+}
+
+/**
+ * Send the parts of the requests waiting to go out while the send queue has room,
+ * the rest follow on later ap_loop()s as the proxy's ACKs free it up
+ */
+void ap_sendRequestParts() {
+  for (int i = 0; i < AP_MAX_TRANSACTIONS; i++) {
+    ApTransaction* tx = &ap_transactions[i];
+    while (tx->state == AP_TX_AWAITING && tx->out.active &&
+           (!ap_meshRoomCallback || ap_meshRoomCallback(tx->out.to))) {
+      int part = wdpSendNextPart(tx->out, tx->wapRequest, tx->wapRequestLen, ap_sendMeshCallback);
+      if (part == 0) {
+        break;
+      }
+      if (tx->out.totalParts == 0) {
+        Serial.printf("AP-WDP: Sent simple message (%d bytes) to %08lx\n",
+                      (int)tx->wapRequestLen, (unsigned long)tx->out.to);
+      } else {
+        Serial.printf("AP-WDP: Sent part %d/%d (%d bytes)\n", part, tx->out.totalParts,
+                      (int)tx->out.partLens[part - 1]);
       }
-    }
-    
-    if (line.length() == 0) {
-      // Empty line = end of headers
-      break;
-    }
-    
-    // Parse header
-    int colonPos = line.indexOf(':');
-    if (colonPos > 0) {
-      String headerName = line.substring(0, colonPos);
-      String headerValue = line.substring(colonPos + 1);
-      headerValue.trim();
-      
-      headerName.toLowerCase();
       
-      if (headerName == "host") {
-        strncpy(req->host, headerValue.c_str(), sizeof(req->host) - 1);
-      } else if (headerName == "content-type") {
-        strncpy(req->contentType, headerValue.c_str(), sizeof(req->contentType) - 1);
-      } else if (headerName == "content-length") {
-        req->contentLength = headerValue.toInt();
+      // The wait for the response starts once the whole request is out
+      tx->lastPartTime = millis();
+      if (!tx->out.active) {
+        tx->sentTime = tx->lastPartTime;
       }
     }
   }
+}
+
+/**
+ * Ask the proxy to resend the parts missing from pending responses
+ * once no part has arrived for AP_NACK_DELAY_MS
+ * Only gaps below the highest part received are reported: later parts may
+ * still be queued at the proxy, lost ones at the end are left to the response timeout
+ */
+void ap_checkMissingParts() {
+  if (!ap_sendMeshCallback || !ap_meshNackCallback || !ap_meshNackCallback(ap_proxyNode)) {
+    return;
+  }
   
-  // Read body if present (for POST)
-  if (req->contentLength > 0 && req->contentLength < sizeof(req->body)) {
-    size_t bytesRead = 0;
-    startTime = millis();
-    while (bytesRead < req->contentLength && (millis() - startTime < 5000)) {
-      if (client.available()) {
-        req->body[bytesRead++] = client.read();
-      }
+  unsigned long now = millis();
+  for (int i = 0; i < WDP_REASSEMBLY_SLOTS; i++) {
+    WDPMeshReassembler::Message* concat = ap_reassembler.at(i);
+    if (!concat || concat->repairs >= AP_MAX_NACKS || now - concat->lastUpdate < AP_NACK_DELAY_MS) {
+      continue;
+    }
+    ApTransaction* tx = ap_findTransaction(concat->dstPort);
+    if (!tx) {
+      continue;
     }
-    req->bodyLen = bytesRead;
+    
+    WDPNack nack;
+    nack.refNum = concat->refNum;
+    nack.totalParts = concat->totalParts;
+    nack.port = concat->dstPort;
+    int missing = WDPMeshReassembler::missingParts(concat, nack.missing,
+                                                   WDPMeshReassembler::highestPart(concat));
+    if (missing == 0) {
+      continue;
+    }
+    
+    // No room for the NACK right now, asked again on a later loop
+    if (ap_meshRoomCallback && !ap_meshRoomCallback(ap_proxyNode)) {
+      return;
+    }
+    
+    uint8_t frame[WDP_NACK_MAX_LEN];
+    size_t frameLen = WDPControl::writeNack(frame, nack);
+    Serial.printf("AP-WDP: %d of %d parts missing (ref: %d), sending NACK\n", missing, nack.totalParts, nack.refNum);
+    ap_sendMeshCallback(ap_proxyNode, frame, frameLen, nullptr, 0);
+    
+    // Give the resent parts as long as the original ones to arrive
+    concat->repairs++;
+    concat->lastUpdate = now;
+    tx->lastPartTime = now;
   }
-  
-  Serial.printf("HTTP: Method=%s Path=%s Host=%s\n", req->method, req->path, req->host);
-  
-  return true;
 }
 
 /**
- * Parse UDH from incoming mesh message
+ * Send a short plain text response (errors)
  */
-bool ap_parseUDH(const uint8_t* data, size_t len, AP_UDH& udh) {
-  if (len < 7) {
-    Serial.println("AP-WDP: Invalid UDH - too short");
-    return false;
-  }
-  
-  udh.headerLen = data[0];
-  udh.ei = data[1];
-  udh.eiLength = data[2];
-  udh.dest = (data[3] << 8) | data[4];    // Destination port first
-  udh.source = (data[5] << 8) | data[6];  // Source port second
-  
-  return true;
+void ap_sendPlainResponse(WiFiClient& client, const char* status, const char* text) {
+  client.printf("HTTP/1.1 %s\r\n", status);
+  client.println("Content-Type: text/plain");
+  client.println("Connection: close");
+  client.println();
+  client.println(text);
 }
 
 /**
- * Parse concatenated message UDH (0x0B header length indicates concat)
+ * Send the WAP request in tx->wapRequest via mesh to proxy node
+ * The transaction keeps the client until the response is in (see ap_completeTransaction)
+ * or no part arrived for the wait time (see ap_stepTransaction), the AP keeps
+ * serving other clients and the mesh meanwhile
+ * Its parts go out from ap_loop() as the send queue has room (see ap_sendRequestParts)
+ * timeoutMs is the quiet time allowed until response latencies have been learned
+ * Returns false if the request cannot go out at all, the client has been answered
  */
-bool ap_parseConcatUDH(const uint8_t* data, size_t len, uint8_t& refNum, uint8_t& totalParts, 
-                       uint8_t& currentPart, AP_UDH& udh) {
-  if (len < 12 || data[0] != 0x0B) {
+bool ap_startTransaction(ApTransaction* tx, uint8_t tid, size_t requestLen, unsigned long timeoutMs) {
+  // A local failure is answered right away rather than timing out like a lost response
+  if (!ap_sendMeshCallback) {
+    Serial.println("AP-WDP: No mesh callback configured!");
+    ap_sendPlainResponse(tx->client, "502 Bad Gateway", "Mesh not ready");
     return false;
   }
   
-  // Concatenated header format:
-  // [0] = 0x0B (header length)
-  // [1] = 0x00 (concat IE identifier)
-  // [2] = 0x03 (concat IE length)
-  // [3] = reference number
-  // [4] = total parts
-  // [5] = current part number
-  // [6] = 0x05 (port addressing IE)
-  // [7] = 0x04 (port IE length)
-  // [8-9] = destination port
-  // [10-11] = source port
+  ap_setState(tx, AP_TX_AWAITING);
+  tx->port = ap_generateSourcePort();
+  tx->tid = tid;
+  tx->sentTime = tx->stateTime;
+  tx->lastPartTime = tx->sentTime;
+  tx->waitMs = ap_responseRtt.timeout(timeoutMs);
+  tx->reply.reset();
+  tx->isWMLC = false;
+  tx->streamedParts = 0;
+  tx->bodyBytesSent = 0;
+  
+  tx->wapRequestLen = requestLen;
+  
+  Serial.printf("AP-HTTP: Sending %zu bytes WAP request via mesh to proxy %s\n", 
+                requestLen, PROXY_NODE_PUBKEY);
   
-  if (data[1] != 0x00 || data[2] != 0x03) {
+  // Send request via mesh with WDP headers
+  // Use random source port and WAPBOX_PORT as destination, the response comes back to the source port
+  // MeshCore text limit is 150 chars, Base91 expands by ~1.23x (depending on the data)
+  // while COBS adds at most 2 bytes, the fit callback knows the proxy's codec
+  bool compact = ap_meshCompactCallback && ap_meshCompactCallback(ap_proxyNode);
+  if (!wdpPlanOutgoing(tx->out, ap_meshFitCallback, compact, ap_proxyNode, tx->port, WAPBOX_PORT,
+                       tx->wapRequest, requestLen)) {
+    Serial.printf("AP-WDP: Message too large to fragment (%d bytes)\n", (int)requestLen);
+    ap_sendPlainResponse(tx->client, "500 Internal Server Error", "WAP request too large");
     return false;
   }
+  if (tx->out.totalParts > 0) {
+    Serial.printf("AP-WDP: Fragmenting %d bytes into %d parts\n", (int)requestLen, tx->out.totalParts);
+  }
+  Serial.printf("AP-HTTP: Using source port %d for request tracking (%d in flight)\n",
+                tx->port, ap_activeTransactions());
   
-  refNum = data[3];
-  totalParts = data[4];
-  currentPart = data[5];
-  
-  udh.headerLen = data[0];
-  udh.ei = data[6];
-  udh.eiLength = data[7];
-  udh.dest = (data[8] << 8) | data[9];
-  udh.source = (data[10] << 8) | data[11];
+  // Start WDP session display
+  ap_wdpSessionActive = true;
+  ap_wdpBytesSent = requestLen;
+  ap_wdpTotalParts = 0;
+  ap_wdpReceivedParts = 0;
+  ap_updateWDPDisplay();
   
+  Serial.printf("AP-HTTP: Waiting up to %lu ms between response parts\n", tx->waitMs);
   return true;
 }
 
 /**
- * Clear/reset a concat message slot
+ * Done with a transaction's response: free any part of it, the client is closed
+ * once it had a moment to take the data (see ap_stepTransaction)
  */
-void ap_clearConcatMessage(AP_ConcatMessage* msg) {
-  msg->active = false;
-  msg->refNum = 0;
-  msg->totalParts = 0;
-  msg->receivedParts = 0;
-  memset(msg->partReceived, 0, sizeof(msg->partReceived));
-  memset(msg->data, 0, sizeof(msg->data));
-  memset(msg->partSizes, 0, sizeof(msg->partSizes));
-  msg->sourcePort = 0;
-  msg->destPort = 0;
-  msg->senderMeshId = "";
-  msg->lastUpdate = 0;
+void ap_closeTransaction(ApTransaction* tx) {
+  for (int i = 0; i < WDP_REASSEMBLY_SLOTS; i++) {
+    WDPMeshReassembler::Message* concat = ap_reassembler.at(i);
+    if (concat && concat->dstPort == tx->port) {
+      ap_reassembler.release(concat);
+    }
+  }
+  ap_setState(tx, AP_TX_CLOSING);
 }
 
 /**
- * Update display during WDP session
+ * Send body bytes of a response whose headers went out early, WMLC is decompiled
+ * as it goes so the browser can render the page while later parts are on the air
  */
-void ap_updateWDPDisplay() {
-  char line2[32];
-  char line3[32];
-  char line4[32];
+static void ap_streamBody(ApTransaction* tx, const uint8_t* body, size_t bodyLen) {
+  if (!tx->isWMLC) {
+    tx->client.write(body, bodyLen);
+    tx->bodyBytesSent += bodyLen;
+    return;
+  }
   
-  snprintf(line2, sizeof(line2), "WDP Session");
-  snprintf(line3, sizeof(line3), "Sent: %d bytes", (int)ap_wdpBytesSent);
+  bool ok = tx->wml.result() == WMLC_STREAM_OK;
+  ap_wmlSink.begin(&tx->client);
+  if (tx->wml.feed(body, bodyLen) != WMLC_STREAM_OK && ok) {
+    Serial.printf("HTTP: WMLC decompilation failed (%s), rest of the body dropped\n", tx->wml.error());
+  }
+  ap_wmlSink.flush();
+  tx->bodyBytesSent = tx->wml.bytesOut();
+}
+
+/**
+ * Send the complete response of a transaction to its client
+ * response points into the reassembly buffer (or the received packet)
+ */
+void ap_completeTransaction(ApTransaction* tx, const uint8_t* response, size_t responseLen) {
+  Serial.printf("AP-HTTP: Received %zu bytes response via mesh (port %d)\n", responseLen, tx->port);
+  WiFiClient& client = tx->client;
   
-  if (ap_wdpTotalParts > 0) {
-    snprintf(line4, sizeof(line4), "Recv: %d/%d parts", ap_wdpReceivedParts, ap_wdpTotalParts);
-  } else {
-    snprintf(line4, sizeof(line4), "Waiting for reply...");
+  // Check if headers were already sent early (when first packet arrived)
+  if (tx->state == AP_TX_STREAMING) {
+    // Headers already sent - just need to send remaining body
+    Serial.println("HTTP: Headers already sent early, sending body now");
+    
+    // The body was already streamed as packets arrived, WMLC only needs its open elements closed
+    if (tx->isWMLC) {
+      ap_wmlSink.begin(&tx->client);
+      tx->wml.finish();
+      ap_wmlSink.flush();
+      Serial.printf("HTTP: Decompiled %zu bytes WMLC to %zu bytes WML\n", 
+                    responseLen - tx->reply.bodyOffset(), tx->wml.bytesOut());
+    }
+    
+    Serial.printf("HTTP: Response complete (headers sent early)\n");
+    ap_closeTransaction(tx);
+    return;
   }
   
-  displayStatus("MeshAccessProtocol", line2, line3, line4);
+  // Normal path - headers not sent yet, decode and send everything
+  HTTPResponse& wapResp = ap_wapResponse;
+  if (!WAPResponse::decode(response, responseLen, &wapResp)) {
+    ap_sendPlainResponse(client, "502 Bad Gateway", "Failed to decode WAPBOX response");
+    ap_closeTransaction(tx);
+    return;
+  }
+  
+  Serial.printf("HTTP: WAP response status=%d type=%s bodyLen=%zu\n", 
+                wapResp.statusCode, wapResp.contentType, wapResp.bodyLen);
+  
+  // Check if response is WMLC and needs decompilation
+  bool isWMLC = (strstr(wapResp.contentType, "wmlc") != nullptr);
+  
+  bool decompile = false;
+  size_t responseBodyLen = wapResp.bodyLen;
+  const char* responseContentType = wapResp.contentType;
+  
+  if (isWMLC && wapResp.body != nullptr && wapResp.bodyLen > 0) {
+    // Count the WML first for an exact Content-Length, the text itself is
+    // decompiled straight to the client once the headers are out
+    WMLCountingSink counter;
+    if (WMLCDecompiler::decompile(wapResp.body, wapResp.bodyLen, counter)) {
+      Serial.printf("HTTP: Decompiling %zu bytes WMLC to %zu bytes WML\n", 
+                    wapResp.bodyLen, counter.count());
+      decompile = true;
+      responseBodyLen = counter.count();
+      responseContentType = "text/vnd.wap.wml; charset=utf-8";
+    } else {
+      Serial.println("HTTP: WMLC decompilation failed, sending raw");
+    }
+  }
+  
+  // Send HTTP response to client
+  client.printf("HTTP/1.1 %d %s\r\n", wapResp.statusCode, wapResp.statusText);
+  client.printf("Content-Type: %s\r\n", responseContentType);
+  client.printf("Content-Length: %zu\r\n", responseBodyLen);
+  client.println("Connection: close");
+  
+  // Add original server header if present
+  if (strlen(wapResp.server) > 0) {
+    client.printf("Server: %s\r\n", wapResp.server);
+  }
+  
+  client.println();  // End of headers
+  
+  // Send body
+  if (decompile) {
+    ap_wmlSink.begin(&client);
+    WMLCDecompiler::decompile(wapResp.body, wapResp.bodyLen, ap_wmlSink);
+    ap_wmlSink.flush();
+  } else if (wapResp.body != nullptr && responseBodyLen > 0) {
+    client.write(wapResp.body, responseBodyLen);
+  }
+  
+  Serial.printf("HTTP: Sent response %d with %zu bytes\n", wapResp.statusCode, responseBodyLen);
+  ap_closeTransaction(tx);
 }
 
 /**
- * Restore normal display after WDP session
+ * Parts of the response to a transaction's port waiting in reassembly, or nullptr
  */
-void ap_restoreNormalDisplay() {
-  ap_wdpSessionActive = false;
-  ap_wdpBytesSent = 0;
-  ap_wdpTotalParts = 0;
-  ap_wdpReceivedParts = 0;
+static WDPMeshReassembler::Message* ap_findResponseParts(uint16_t port) {
+  for (int i = 0; i < WDP_REASSEMBLY_SLOTS; i++) {
+    WDPMeshReassembler::Message* concat = ap_reassembler.at(i);
+    if (concat && concat->dstPort == port) {
+      return concat;
+    }
+  }
+  return nullptr;
 }
 
+void ap_sendEarlyHeaders(ApTransaction* tx, const uint8_t* body, size_t bodyLen);
+
 /**
- * Send WDP message via mesh with fragmentation if needed
+ * Move a transaction on with the parts of its response now in reassembly
+ * Sends the HTTP headers once the part their block ends in is in, streams the body
+ * in part order and answers the client from the reassembly buffer once the last part is in
  */
-void ap_sendWDPViaMesh(const String& to, uint16_t srcPort, uint16_t dstPort, 
-                       const uint8_t* data, size_t len) {
-  if (!ap_sendMeshCallback) {
-    Serial.println("AP-WDP: No mesh callback configured!");
+void ap_streamResponse(ApTransaction* tx) {
+  WDPMeshReassembler::Message* concat = ap_findResponseParts(tx->port);
+  if (!concat) {
     return;
   }
   
-  // Start WDP session display
-  ap_wdpSessionActive = true;
-  ap_wdpBytesSent = len;
-  ap_wdpTotalParts = 0;
-  ap_wdpReceivedParts = 0;
-  ap_updateWDPDisplay();
+  // Feed the parts in order until the WSP header block is complete, whichever part it
+  // ends in, then send the HTTP headers early and the body that followed them
+  // this will stop browsers from timing out
+  while (tx->state == AP_TX_AWAITING && tx->reply.result() == WSP_REPLY_NEED_MORE &&
+         tx->streamedParts < concat->totalParts &&
+         WDPMeshReassembler::hasPart(concat, tx->streamedParts + 1)) {
+    uint8_t index = tx->streamedParts++;
+    const uint8_t* part = &concat->data[concat->partOffset[index]];
+    size_t used;
+    WSPReplyStatus status = tx->reply.feed(part, concat->partLen[index], &used);
+    if (status == WSP_REPLY_HEADERS) {
+      ap_sendEarlyHeaders(tx, part + used, concat->partLen[index] - used);
+    } else if (status == WSP_REPLY_ERROR) {
+      Serial.printf("AP-WDP: Could not decode early headers (%s)\n", tx->reply.error());
+    }
+  }
+  if (tx->state == AP_TX_STREAMING && tx->client.connected()) {
+    // Stream body data as it arrives, WMLC decompiled on the way
+    // Parts go out in order, a part that arrived early waits for the gap to be filled
+    uint8_t streamed = tx->streamedParts;
+    while (tx->streamedParts < concat->totalParts &&
+           WDPMeshReassembler::hasPart(concat, tx->streamedParts + 1)) {
+      uint8_t index = tx->streamedParts++;
+      ap_streamBody(tx, &concat->data[concat->partOffset[index]], concat->partLen[index]);
+      Serial.printf("AP-WDP: Streamed %d body bytes (part %d)\n", concat->partLen[index], index + 1);
+    }
+    if (tx->streamedParts != streamed) {
+      tx->client.flush();
+    }
+  }
   
-  // MeshCore text limit is 150 chars, Base91 expands by ~1.23x
-  // So max binary bytes per message is ~121, minus UDH overhead
-  const size_t maxPayloadSimple = MESHCORE_MAX_BINARY_PAYLOAD - 7;   // Simple UDH is 7 bytes = 114 bytes payload
-  const size_t maxPayloadConcat = MESHCORE_MAX_BINARY_PAYLOAD - 12;  // Concat UDH is 12 bytes = 109 bytes payload
-  
-  if (len <= maxPayloadSimple) {
-    // Simple message (no fragmentation needed)
-    uint8_t msg[MESHCORE_MAX_BINARY_PAYLOAD];
-    msg[0] = 0x06;  // UDH length
-    msg[1] = 0x05;  // Application Port Addressing, 16-bit
-    msg[2] = 0x04;  // Length of port data
-    msg[3] = (dstPort >> 8) & 0xFF;
-    msg[4] = dstPort & 0xFF;
-    msg[5] = (srcPort >> 8) & 0xFF;
-    msg[6] = srcPort & 0xFF;
-    memcpy(&msg[7], data, len);
-    
-    Serial.printf("AP-WDP: Sending simple message (%d bytes) to %s\n", 7 + len, to.c_str());
-    ap_sendMeshCallback(to, msg, 7 + len);
-  } else {
-    // Concatenated message (fragmentation needed)
-    int totalParts = (len + maxPayloadConcat - 1) / maxPayloadConcat;
-    uint8_t refNum = (millis() & 0xFF);  // Simple reference number
-    
-    Serial.printf("AP-WDP: Fragmenting %d bytes into %d parts\n", len, totalParts);
+  if (concat->receivedParts == concat->totalParts) {
+    Serial.printf("AP-WDP: Concat message complete\n");
     
-    for (int part = 1; part <= totalParts; part++) {
-      uint8_t msg[MESHCORE_MAX_BINARY_PAYLOAD];
-      
-      // Concatenated UDH header
-      msg[0] = 0x0B;  // UDH length
-      msg[1] = 0x00;  // Concatenation IE identifier
-      msg[2] = 0x03;  // Concatenation IE length
-      msg[3] = refNum;
-      msg[4] = (uint8_t)totalParts;
-      msg[5] = (uint8_t)part;
-      msg[6] = 0x05;  // Application Port Addressing, 16-bit
-      msg[7] = 0x04;  // Length of port data
-      msg[8] = (dstPort >> 8) & 0xFF;
-      msg[9] = dstPort & 0xFF;
-      msg[10] = (srcPort >> 8) & 0xFF;
-      msg[11] = srcPort & 0xFF;
-      
-      // Copy payload fragment
-      size_t offset = (part - 1) * maxPayloadConcat;
-      size_t partLen = (len - offset < maxPayloadConcat) ? (len - offset) : maxPayloadConcat;
-      memcpy(&msg[12], &data[offset], partLen);
-      
-      Serial.printf("AP-WDP: Sending part %d/%d (%d bytes)\n", part, totalParts, 12 + partLen);
-      ap_sendMeshCallback(to, msg, 12 + partLen);
+    // Put the parts in order and answer the client straight from the reassembly buffer
+    size_t totalSize = ap_reassembler.assemble(concat);
+    Serial.printf("AP-WDP: Response ready (%zu bytes)\n", totalSize);
+    ap_completeTransaction(tx, concat->data, totalSize);
+  }
+}
+
+/**
+ * Queue a response event for the transaction on port (data is copied)
+ */
+static void ap_postEvent(ApEventType type, uint16_t port, const uint8_t* data, size_t len) {
+  uint8_t* rec = ap_events.reserve(sizeof(ApEvent) + len);
+  if (!rec) {
+    Serial.printf("AP-WDP: Event queue full, dropping event for port %d\n", port);
+    return;
+  }
+  ApEvent* event = (ApEvent*)rec;
+  event->type = type;
+  event->port = port;
+  event->len = (uint16_t)len;
+  if (len > 0) {
+    memcpy(rec + sizeof(ApEvent), data, len);
+  }
+  ap_events.commit(sizeof(ApEvent) + len);
+}
+
+/**
+ * Hand the queued response events to their transactions
+ */
+void ap_dispatchEvents() {
+  size_t len;
+  uint8_t* rec;
+  while ((rec = ap_events.front(&len)) != nullptr) {
+    const ApEvent* event = (const ApEvent*)rec;
+    // The transaction may have timed out or lost its client since
+    ApTransaction* tx = ap_findTransaction(event->port);
+    if (tx && event->type == AP_EVENT_PARTS) {
+      ap_streamResponse(tx);
+    } else if (tx && event->type == AP_EVENT_RESPONSE) {
+      // The whole response is in this event, answer the client straight from it
+      ap_completeTransaction(tx, event->data(), event->len);
     }
+    ap_events.pop();
   }
 }
 
+bool handleHTTPRequest(ApTransaction* tx);
+
 /**
- * Send WAP request via mesh to proxy node and wait for response
- * It will deny any futher HTTP requests as browsers will retry because they deem us too slow
+ * Move a transaction on from its current state, called once per ap_loop()
  */
-bool sendWAPRequestViaMesh(const uint8_t* request, size_t requestLen,
-                           uint8_t* response, size_t* responseLen, size_t responseMaxLen,
-                           int timeoutMs = 40000, WiFiClient* keepAliveClient = nullptr) {
-  
-  Serial.printf("AP-HTTP: Sending %zu bytes WAP request via mesh to proxy %s\n", 
-                requestLen, PROXY_NODE_PUBKEY);
-  
-  // Mark request as in progress and stop HTTP server to refuse new SYNs
-  ap_requestInProgress = true;
-  httpServer.end();
-  Serial.println("AP-HTTP: Stopped HTTP server during mesh request");
-  
-  // Clear any previous response and early header state
-  ap_meshResponseReady = false;
-  ap_meshResponseLen = 0;
-  ap_waitingClient = keepAliveClient;
-  ap_headersSent = false;
-  ap_isWMLC = false;
-  ap_bodyBytesReceived = 0;
-  memset(&ap_earlyResponse, 0, sizeof(ap_earlyResponse));
-  
-  // Generate random source port for this request (used for response routing)
-  ap_currentRequestPort = ap_generateSourcePort();
-  
-  // Send request via mesh with WDP headers
-  // Use random source port and WAPBOX_PORT as destination
-  Serial.printf("AP-HTTP: Using source port %d for request tracking\n", ap_currentRequestPort);
-  ap_sendWDPViaMesh(String(PROXY_NODE_PUBKEY), ap_currentRequestPort, WAPBOX_PORT, request, requestLen);
-  
-  // Wait for response with timeout
-  unsigned long startTime = millis();
-  unsigned long lastKeepAlive = startTime;
-  ap_lastPartReceivedTime = startTime;  // Initialize last part time
-  
-  while ((millis() - ap_lastPartReceivedTime) < (unsigned long)timeoutMs) {
-    // Call mesh loop to process incoming packets and send ACKs
-    if (ap_meshLoopCallback) {
-      ap_meshLoopCallback();
+void ap_stepTransaction(ApTransaction* tx) {
+  unsigned long now = millis();
+  switch (tx->state) {
+    case AP_TX_READING: {
+      // Parse whatever the client sent so far, the request is handled once its headers are in
+      uint8_t chunk[128];
+      HttpParseStatus status = tx->request.result();
+      int avail;
+      while (status == HTTP_PARSE_NEED_MORE && (avail = tx->client.available()) > 0) {
+        int n = tx->client.read(chunk, (size_t)avail < sizeof(chunk) ? avail : sizeof(chunk));
+        if (n <= 0) {
+          break;
+        }
+        status = tx->request.feed(chunk, n);
+      }
+      
+      if (status == HTTP_PARSE_DONE) {
+        if (!handleHTTPRequest(tx)) {
+          ap_closeTransaction(tx);
+        }
+      } else if (status == HTTP_PARSE_ERROR) {
+        int code = tx->request.errorStatus();
+        Serial.printf("HTTP: Bad request (%d, %s)\n", code, tx->request.error());
+        ap_sendPlainResponse(tx->client, code == 414 ? "414 URI Too Long" :
+                             code == 431 ? "431 Request Header Fields Too Large" : "400 Bad Request",
+                             "Bad Request");
+        ap_closeTransaction(tx);
+      } else if (!tx->client.connected() || now - tx->stateTime > AP_REQUEST_TIMEOUT_MS) {
+        Serial.println("HTTP: Client sent no complete request");
+        ap_closeTransaction(tx);
+      }
+      break;
     }
     
-    // Check if client disconnected while waiting
-    if (keepAliveClient && !keepAliveClient->connected()) {
-      Serial.println("AP-HTTP: Client disconnected while waiting for mesh response");
-      ap_meshResponseReady = false;
-      ap_currentRequestPort = 0;
-      ap_requestInProgress = false;
-      ap_waitingClient = nullptr;
-      ap_headersSent = false;
-      ap_restoreNormalDisplay();
-      httpServer.begin();  // Restart HTTP server
-      Serial.println("AP-HTTP: Restarted HTTP server after client disconnect");
-      return false;
-    }
+    case AP_TX_AWAITING:
+    case AP_TX_STREAMING:
+      // Check if client disconnected while waiting
+      if (!tx->client.connected()) {
+        Serial.printf("AP-HTTP: Client disconnected while waiting for mesh response (port %d)\n", tx->port);
+        ap_closeTransaction(tx);
+        break;
+      }
+      if (now - tx->lastPartTime < tx->waitMs) {
+        break;
+      }
+      
+      // Nothing at all came back, wait longer next time until a response does
+      if (tx->sentTime != 0) {
+        ap_responseRtt.timedOut();
+      }
+      Serial.printf("AP-HTTP: Timeout waiting for mesh response from proxy (port %d)\n", tx->port);
+      if (tx->state == AP_TX_AWAITING) {
+        ap_sendPlainResponse(tx->client, "504 Gateway Timeout", "Mesh proxy did not respond");
+      }
+      ap_closeTransaction(tx);
+      break;
     
-    // Send keep-alive to prevent client timeout (send a space periodically)
-    // Note: This works because we haven't sent headers yet, and leading whitespace
-    // before HTTP response is tolerated by UC Browser, we should revisit this to see
-    // if our SYN no reply is enough as this does upset any proper browser.
-    //if (keepAliveClient && (millis() - lastKeepAlive) >= AP_KEEPALIVE_INTERVAL_MS) {
-    //  // Send a single space as keep-alive
-    //  keepAliveClient->write(' ');
-    //  keepAliveClient->flush();
-    //  lastKeepAlive = millis();
-    //}
+    case AP_TX_CLOSING:
+      // Give client time to receive data
+      if (now - tx->stateTime < AP_CLOSE_LINGER_MS) {
+        break;
+      }
+      tx->client.stop();
+      tx->client = WiFiClient();
+      ap_setState(tx, AP_TX_FREE);
+      Serial.println("HTTP: Client disconnected");
+      if (ap_activeTransactions() == 0) {
+        ap_restoreNormalDisplay();
+      }
+      break;
     
-    // Check if response has arrived via mesh
-    if (ap_meshResponseReady) {
-      size_t copyLen = (ap_meshResponseLen < responseMaxLen) ? ap_meshResponseLen : responseMaxLen;
-      memcpy(response, ap_meshResponseBuffer, copyLen);
-      *responseLen = copyLen;
-      ap_meshResponseReady = false;
-      ap_requestInProgress = false;
-      ap_waitingClient = nullptr;  // Clear client reference
-      httpServer.begin();  // Restart HTTP server
-      Serial.println("AP-HTTP: Restarted HTTP server after mesh response");
-      Serial.printf("AP-HTTP: Received %zu bytes response via mesh\n", copyLen);
-      return true;
-    }
-    delay(10);
-    yield();  // Allow other tasks to run
+    case AP_TX_FREE:
+      break;
   }
+}
+
+/**
+ * Run the transactions: response events first, then timeouts, reads and closes
+ */
+void ap_serviceTransactions() {
+  // Send what the send queue has room for of the requests
+  ap_sendRequestParts();
   
-  ap_requestInProgress = false;
-  ap_waitingClient = nullptr;  // Clear client reference
-  ap_headersSent = false;
-  ap_restoreNormalDisplay();
-  httpServer.begin();  // Restart HTTP server
-  Serial.println("AP-HTTP: Restarted HTTP server after timeout");
-  Serial.println("AP-HTTP: Timeout waiting for mesh response from proxy");
-  return false;
+  // Ask for lost parts instead of waiting out the timeout
+  ap_checkMissingParts();
+  
+  ap_dispatchEvents();
+  for (int i = 0; i < AP_MAX_TRANSACTIONS; i++) {
+    ap_stepTransaction(&ap_transactions[i]);
+  }
 }
 
 /**
  * Build full URL from host and path
  */
-void buildURL(const HTTPRequest* req, char* url, size_t urlSize) {
+void buildURL(const ApHttpRequest* req, char* url, size_t urlSize) {
   // If path already contains http://, use as-is
-  if (strncmp(req->path, "http://", 7) == 0 || strncmp(req->path, "https://", 8) == 0) {
-    strncpy(url, req->path, urlSize - 1);
+  if (strncmp(req->path(), "http://", 7) == 0 || strncmp(req->path(), "https://", 8) == 0) {
+    strncpy(url, req->path(), urlSize - 1);
     url[urlSize - 1] = '\0';
     return;
   }
   
   // Build URL from host and path
-  if (strlen(req->host) > 0) {
-    snprintf(url, urlSize, "http://%s%s", req->host, req->path);
+  if (strlen(req->host()) > 0) {
+    snprintf(url, urlSize, "http://%s%s", req->host(), req->path());
   } else {
     // No host header - use bevelgacom WAP as fallback
-    snprintf(url, urlSize, "http://wap.bevelgacom.be%s", req->path);
+    snprintf(url, urlSize, "http://wap.bevelgacom.be%s", req->path());
   }
 }
 
 /**
- * Handle HTTP request and proxy to WAP
+ * Handle the HTTP request parsed by transaction tx and proxy it to WAP
  * Uses static buffers to avoid stack overflow
+ * The WAP request goes out in transaction tx, which keeps the client until the response is in
+ * Returns false if the client was answered (or dropped) right away
  */
-void handleHTTPRequest(WiFiClient& client) {
-  // Use static buffer for request parsing
-  if (!parseHTTPRequest(client, &http_req)) {
-    // Send error response
-    client.println("HTTP/1.1 400 Bad Request");
-    client.println("Content-Type: text/plain");
-    client.println("Connection: close");
-    client.println();
-    client.println("Bad Request");
-    return;
-  }
+bool handleHTTPRequest(ApTransaction* tx) {
+  WiFiClient& client = tx->client;
+  const ApHttpRequest& req = tx->request;
+  Serial.printf("HTTP: Method=%s Path=%s Host=%s\n", req.method(), req.path(), req.host());
   
   // Block connectivity check requests - don't forward to mesh
-  if (strstr(http_req.host, "connectivitycheck.gstatic.com") != nullptr ||
-      strstr(http_req.host, "connectivitycheck.android.com") != nullptr ||
-      strstr(http_req.host, "clients3.google.com") != nullptr ||
-      strstr(http_req.host, "captive.apple.com") != nullptr ||
-      strstr(http_req.host, "detectportal.firefox.com") != nullptr) {
-    Serial.printf("HTTP: Blocking connectivity check to %s\n", http_req.host);
+  if (strstr(req.host(), "connectivitycheck.gstatic.com") != nullptr ||
+      strstr(req.host(), "connectivitycheck.android.com") != nullptr ||
+      strstr(req.host(), "clients3.google.com") != nullptr ||
+      strstr(req.host(), "captive.apple.com") != nullptr ||
+      strstr(req.host(), "detectportal.firefox.com") != nullptr) {
+    Serial.printf("HTTP: Blocking connectivity check to %s\n", req.host());
     // we do not send a 204 as that makes Anroid very angry, just close the connection act like we are broken WiFi
-    return;
+    return false;
   }
   
   // Build URL for WAP request (using static buffer)
-  buildURL(&http_req, http_url, sizeof(http_url));
+  buildURL(&req, http_url, sizeof(http_url));
   
   Serial.printf("HTTP: Proxying to WAP URL: %s\n", http_url);
   
@@ -584,15 +830,15 @@ void handleHTTPRequest(WiFiClient& client) {
   size_t wapRequestLen = 0;
   uint8_t tid = transactionCounter++;
   
-  if (strcmp(http_req.method, "GET") == 0 || strcmp(http_req.method, "HEAD") == 0) {
+  if (strcmp(req.method(), "GET") == 0 || strcmp(req.method(), "HEAD") == 0) {
     // Create GET request with host header
-    wapRequestLen = WAPRequest::createGetRequest(http_url, tid, http_wapRequest, sizeof(http_wapRequest), true);
+    wapRequestLen = WAPRequest::createGetRequest(http_url, tid, tx->wapRequest, sizeof(tx->wapRequest), true);
     
     // Debug: Print the generated request
     Serial.printf("AP-HTTP: Created WAP request (%zu bytes), TID=%02X\n", wapRequestLen, tid);
     Serial.print("AP-HTTP: Request hex: ");
     for (size_t i = 0; i < wapRequestLen && i < 80; i++) {
-      Serial.printf("%02X ", http_wapRequest[i]);
+      Serial.printf("%02X ", tx->wapRequest[i]);
     }
     Serial.println();
   } else {
@@ -603,132 +849,23 @@ void handleHTTPRequest(WiFiClient& client) {
     client.println("Content-Type: text/plain");
     client.println("Connection: close");
     client.println();
-    client.printf("Method %s not implemented for WAP proxy\n", http_req.method);
-    return;
+    client.printf("Method %s not implemented for WAP proxy\n", req.method());
+    return false;
   }
   
   if (wapRequestLen == 0) {
-    client.println("HTTP/1.1 500 Internal Server Error");
-    client.println("Content-Type: text/plain");
-    client.println("Connection: close");
-    client.println();
-    client.println("Failed to create WAP request");
-    return;
-  }
-  
-  // Send WAP request via mesh and receive response (using static buffer)
-  // Pass client reference to keep connection alive during mesh wait
-  size_t wapResponseLen = 0;
-  
-  if (!sendWAPRequestViaMesh(http_wapRequest, wapRequestLen, http_wapResponse, &wapResponseLen, sizeof(http_wapResponse), 15000, &client)) {
-    client.println("HTTP/1.1 504 Gateway Timeout");
-    client.println("Content-Type: text/plain");
-    client.println("Connection: close");
-    client.println();
-    client.println("Mesh proxy did not respond");
-    return;
-  }
-  
-  // Check if headers were already sent early (when first packet arrived)
-  if (ap_headersSent) {
-    // Headers already sent - just need to send remaining body
-    Serial.println("HTTP: Headers already sent early, sending body now");
-    
-    // For WMLC, we need to decompile the complete body
-    if (ap_isWMLC && ap_meshResponseLen > 0) {
-      // Get body from the complete response buffer
-      HTTPResponse wapResp;
-      if (WAPResponse::decode(http_wapResponse, wapResponseLen, &wapResp) && 
-          wapResp.body != nullptr && wapResp.bodyLen > 0) {
-        size_t decompiledLen = WMLCDecompiler::decompile(wapResp.body, wapResp.bodyLen, 
-                                                          http_decompiled, sizeof(http_decompiled));
-        if (decompiledLen > 0) {
-          Serial.printf("HTTP: Decompiled %zu bytes WMLC to %zu bytes WML\n", 
-                        wapResp.bodyLen, decompiledLen);
-          client.write((const uint8_t*)http_decompiled, decompiledLen);
-        } else {
-          // Decompilation failed, send raw
-          client.write(wapResp.body, wapResp.bodyLen);
-        }
-      }
-    } else {
-      // Non-WMLC: body was already streamed as packets arrived
-      // Nothing more to send
-    }
-    
-    ap_headersSent = false;
-    Serial.printf("HTTP: Response complete (headers sent early)\n");
-  } else {
-    // Normal path - headers not sent yet, decode and send everything
-    HTTPResponse wapResp;
-    if (!WAPResponse::decode(http_wapResponse, wapResponseLen, &wapResp)) {
-      client.println("HTTP/1.1 502 Bad Gateway");
-      client.println("Content-Type: text/plain");
-      client.println("Connection: close");
-      client.println();
-      client.println("Failed to decode WAPBOX response");
-      return;
-    }
-    
-    Serial.printf("HTTP: WAP response status=%d type=%s bodyLen=%zu\n", 
-                  wapResp.statusCode, wapResp.contentType, wapResp.bodyLen);
-    
-    // Check if response is WMLC and needs decompilation
-    bool isWMLC = (strstr(wapResp.contentType, "wmlc") != nullptr);
-    
-    size_t decompiledLen = 0;
-    const uint8_t* responseBody = wapResp.body;
-    size_t responseBodyLen = wapResp.bodyLen;
-    const char* responseContentType = wapResp.contentType;
-    
-    if (isWMLC && wapResp.body != nullptr && wapResp.bodyLen > 0) {
-      // Decompile WMLC to WML (using static buffer)
-      decompiledLen = WMLCDecompiler::decompile(wapResp.body, wapResp.bodyLen, 
-                                                 http_decompiled, sizeof(http_decompiled));
-      if (decompiledLen > 0) {
-        Serial.printf("HTTP: Decompiled %zu bytes WMLC to %zu bytes WML\n", 
-                      wapResp.bodyLen, decompiledLen);
-        responseBody = (const uint8_t*)http_decompiled;
-        responseBodyLen = decompiledLen;
-        responseContentType = "text/vnd.wap.wml; charset=utf-8";
-      } else {
-        Serial.println("HTTP: WMLC decompilation failed, sending raw");
-      }
-    }
-    
-    // Send HTTP response to client
-    client.printf("HTTP/1.1 %d %s\r\n", wapResp.statusCode, wapResp.statusText);
-    client.printf("Content-Type: %s\r\n", responseContentType);
-    client.printf("Content-Length: %zu\r\n", responseBodyLen);
-    client.println("Connection: close");
-    
-    // Add original server header if present
-    if (strlen(wapResp.server) > 0) {
-      client.printf("Server: %s\r\n", wapResp.server);
-    }
-    
-    client.println();  // End of headers
-    
-    // Send body
-    if (responseBody != nullptr && responseBodyLen > 0) {
-      client.write(responseBody, responseBodyLen);
-    }
-    
-    Serial.printf("HTTP: Sent response %d with %zu bytes\n", wapResp.statusCode, responseBodyLen);
+    ap_sendPlainResponse(client, "500 Internal Server Error", "Failed to create WAP request");
+    return false;
   }
   
-  // Restore normal display after HTTP response is complete
-  ap_restoreNormalDisplay();
+  // Send WAP request via mesh, the response is handled as its parts arrive
+  return ap_startTransaction(tx, tid, wapRequestLen, AP_RESPONSE_TIMEOUT_MS);
 }
 
 void ap_init() {
   Serial.println("DEBUG: Initializing AP Mode with Mesh Gateway...");
   displayStatus("AP Mode", "Initializing...", nullptr, nullptr);
   
-  // Initialize concat message slots
-  for (int i = 0; i < AP_MAX_CONCAT_MESSAGES; i++) {
-    ap_concatMessages[i].active = false;
-  }
 
   // Configure AP mode only
   WiFi.mode(WIFI_AP);
@@ -774,27 +911,19 @@ void ap_loop() {
   // Process DNS requests
   dnsServer.processNextRequest();
   
-  // Handle HTTP clients (server is stopped during mesh requests, so no new clients while busy)
-  WiFiClient client = httpServer.available();
+  // Handle HTTP clients, new ones wait in the accept backlog while all transactions are busy
+  ApTransaction* tx = ap_freeTransaction();
+  WiFiClient client = tx ? httpServer.available() : WiFiClient();
   if (client) {
     Serial.println("HTTP: New client connected");
-    
-    // Wait for client to send data
-    unsigned long timeout = millis() + 3000;
-    while (client.connected() && !client.available() && millis() < timeout) {
-      delay(1);
-    }
-    
-    if (client.available()) {
-      handleHTTPRequest(client);
-    }
-    
-    // Give client time to receive data
-    delay(10);
-    client.stop();
-    Serial.println("HTTP: Client disconnected");
+    tx->client = client;
+    tx->request.reset();
+    ap_setState(tx, AP_TX_READING);
   }
   
+  // Read requests, hand them their responses, time out and close them
+  ap_serviceTransactions();
+  
   // Check for client count changes
   int currentClients = WiFi.softAPgetStationNum();
   if (currentClients != ap_connected_clients) {
@@ -804,12 +933,9 @@ void ap_loop() {
   }
   
   // Cleanup expired concat messages
-  unsigned long now = millis();
-  for (int i = 0; i < AP_MAX_CONCAT_MESSAGES; i++) {
-    if (ap_concatMessages[i].active && (now - ap_concatMessages[i].lastUpdate > 30000)) {
-      Serial.printf("AP-WDP: Concat message %d timed out\n", ap_concatMessages[i].refNum);
-      ap_clearConcatMessage(&ap_concatMessages[i]);
-    }
+  int expired = ap_reassembler.expire(millis(), 30000);
+  if (expired > 0) {
+    Serial.printf("AP-WDP: %d concat message(s) timed out\n", expired);
   }
 }
 
@@ -840,15 +966,33 @@ IPAddress ap_getIP() {
 }
 
 // Set the mesh send callback - must be called before AP mode can send requests
-void ap_setMeshCallback(std::function<void(const String&, const uint8_t*, size_t)> callback) {
+void ap_setMeshCallback(WDPSendCallback callback) {
   ap_sendMeshCallback = callback;
   Serial.println("AP: Mesh send callback configured");
 }
 
-// Set the mesh loop callback - MUST be called to keep mesh alive during blocking HTTP waits
-void ap_setMeshLoopCallback(std::function<void()> callback) {
-  ap_meshLoopCallback = callback;
-  Serial.println("AP: Mesh loop callback configured");
+// Set the mesh fit callback - lets the fragmenter fill each message for the proxy's codec
+void ap_setMeshFitCallback(WDPFitCallback callback) {
+  ap_meshFitCallback = callback;
+  Serial.println("AP: Mesh fit callback configured");
+}
+
+// Set the mesh compact header callback - lets the fragmenter use the compact header for capable proxies
+void ap_setMeshCompactCallback(WDPCompactCallback callback) {
+  ap_meshCompactCallback = callback;
+  Serial.println("AP: Mesh compact header callback configured");
+}
+
+// Set the mesh NACK callback - lets the AP ask proxies that support it for lost parts
+void ap_setMeshNackCallback(WDPNackCallback callback) {
+  ap_meshNackCallback = callback;
+  Serial.println("AP: Mesh NACK callback configured");
+}
+
+// Set the mesh room callback - lets the AP send requests only as fast as the send queue takes them
+void ap_setMeshRoomCallback(WDPRoomCallback callback) {
+  ap_meshRoomCallback = callback;
+  Serial.println("AP: Mesh room callback configured");
 }
 
 // Get proxy path discovery status
@@ -900,230 +1044,287 @@ bool ap_incrementProxyDiscoveryAttempt() {
 }
 
 /**
- * Try to decode and send HTTP headers early from the first packet
- * Returns true if headers were successfully sent
+ * Send the HTTP headers as soon as the WSP header block is in
+ * body is the start of the body, in the part the header block ended in
  */
-bool ap_trySendEarlyHeaders(const uint8_t* wspData, size_t wspLen) {
-  if (!ap_waitingClient || ap_headersSent) {
-    return false;  // No client waiting or headers already sent
-  }
-  
-  // Try to decode WSP headers from first packet
-  if (!WAPResponse::decode(wspData, wspLen, &ap_earlyResponse)) {
-    Serial.println("AP-WDP: Could not decode headers from first packet");
-    return false;
+void ap_sendEarlyHeaders(ApTransaction* tx, const uint8_t* body, size_t bodyLen) {
+  HTTPResponse& early = ap_wapResponse;
+  if (!tx->reply.decode(&early)) {
+    return;
   }
   
   // Check if this is WMLC that needs decompilation
-  ap_isWMLC = (strstr(ap_earlyResponse.contentType, "wmlc") != nullptr);
+  tx->isWMLC = (strstr(early.contentType, "wmlc") != nullptr);
   
   // Determine content type to send
-  const char* responseContentType = ap_earlyResponse.contentType;
-  if (ap_isWMLC) {
-    // For WMLC, we'll decompile later so advertise WML type
-    // But we can't know the final size, so use chunked or don't send Content-Length yet
-    // Actually, we need to buffer WMLC for decompilation, so don't stream body
+  // WMLC is decompiled as it streams, so advertise WML type
+  const char* responseContentType = early.contentType;
+  if (tx->isWMLC) {
     responseContentType = "text/vnd.wap.wml; charset=utf-8";
+    tx->wml.reset(&ap_wmlSink);
   }
   
   Serial.printf("AP-WDP: Sending early headers - status=%d type=%s\n", 
-                ap_earlyResponse.statusCode, responseContentType);
+                early.statusCode, responseContentType);
   
   // Send HTTP headers immediately
-  ap_waitingClient->printf("HTTP/1.1 %d %s\r\n", ap_earlyResponse.statusCode, ap_earlyResponse.statusText);
-  ap_waitingClient->printf("Content-Type: %s\r\n", responseContentType);
-  
-  // For non-WMLC, we can stream the body as it arrives
-  // For WMLC, we need to buffer and decompile, so omit Content-Length for now
-  // (we'll use Connection: close to signal end)
-  if (!ap_isWMLC && ap_earlyResponse.contentLength > 0) {
-    ap_waitingClient->printf("Content-Length: %zu\r\n", ap_earlyResponse.contentLength);
+  WiFiClient& client = tx->client;
+  client.printf("HTTP/1.1 %d %s\r\n", early.statusCode, early.statusText);
+  client.printf("Content-Type: %s\r\n", responseContentType);
+  
+  // The size of decompiled WMLC isn't known until the end, so omit Content-Length
+  // (Connection: close signals the end)
+  if (!tx->isWMLC && early.contentLength > 0) {
+    client.printf("Content-Length: %zu\r\n", early.contentLength);
   }
   
-  ap_waitingClient->println("Connection: close");
+  client.println("Connection: close");
   
   // Add original server header if present
-  if (strlen(ap_earlyResponse.server) > 0) {
-    ap_waitingClient->printf("Server: %s\r\n", ap_earlyResponse.server);
+  if (strlen(early.server) > 0) {
+    client.printf("Server: %s\r\n", early.server);
   }
   
-  ap_waitingClient->println();  // End of headers
-  ap_waitingClient->flush();
+  client.println();  // End of headers
+  client.flush();
   
-  // If not WMLC and we have body data in this first packet, send it now
-  if (!ap_isWMLC && ap_earlyResponse.body != nullptr && ap_earlyResponse.bodyLen > 0) {
-    ap_waitingClient->write(ap_earlyResponse.body, ap_earlyResponse.bodyLen);
-    ap_waitingClient->flush();
-    ap_bodyBytesReceived = ap_earlyResponse.bodyLen;
-    Serial.printf("AP-WDP: Sent %zu body bytes from first packet\n", ap_earlyResponse.bodyLen);
+  // If the body started in this part, send it now
+  if (bodyLen > 0) {
+    ap_streamBody(tx, body, bodyLen);
+    client.flush();
+    Serial.printf("AP-WDP: Sent %zu body bytes from part %d\n", bodyLen, tx->streamedParts);
   }
   
-  ap_headersSent = true;
-  return true;
+  ap_setState(tx, AP_TX_STREAMING);
 }
 
 /**
  * Handle incoming mesh message (response from proxy node)
  * This handles both simple and concatenated messages
  */
-void ap_handleIncomingMesh(const String& from, const uint8_t* data, size_t len) {
-  Serial.printf("AP-WDP: Received %d bytes from %s\n", len, from.c_str());
-  
-  if (len < 7) {
-    Serial.println("AP-WDP: Message too short for UDH");
+static void ap_recoverParts(MeshNodeId from);
+
+// Store one part of a concatenated response (received, or rebuilt from parity with recover false)
+static void ap_handleConcatPart(MeshNodeId from, const WDPHeaderInfo& hdr,
+                                const uint8_t* payload, size_t payloadLen, bool recover) {
+  uint8_t refNum = hdr.refNum;
+  uint8_t totalParts = hdr.totalParts;
+  Serial.printf("AP-WDP: Concatenated message part %d/%d (ref: %d)\n", hdr.part, totalParts, refNum);
+  
+  // Verify this response matches a pending request by destination port
+  ApTransaction* tx = ap_findTransaction(hdr.dstPort);
+  if (!tx) {
+    Serial.printf("AP-WDP: No pending request for port %d, dropping part\n", hdr.dstPort);
     return;
   }
   
-  AP_UDH udh;
-  const uint8_t* payload;
-  size_t payloadLen;
+  // Store this part, parts may arrive out of order
+  WDPMeshReassembler::Message* concat;
+  WDPReassemblyStatus status = ap_reassembler.addPart(from, hdr,
+                                                      payload, payloadLen, millis(), &concat);
+  if (status == WDP_REASSEMBLY_NO_SLOT) {
+    Serial.println("AP-WDP: No free concat message slots");
+    return;
+  }
+  if (status == WDP_REASSEMBLY_OVERFLOW) {
+    Serial.printf("AP-WDP: Concat message too large (max %d bytes), dropping\n", WDP_REASSEMBLY_BUFFER_SIZE);
+    ap_reassembler.release(concat);
+    return;
+  }
   
-  // Check if this is a concatenated message
-  uint8_t refNum, totalParts, currentPart;
-  if (ap_parseConcatUDH(data, len, refNum, totalParts, currentPart, udh)) {
-    Serial.printf("AP-WDP: Concatenated message part %d/%d (ref: %d)\n", currentPart, totalParts, refNum);
-    
-    // Find or create concat message entry
-    AP_ConcatMessage* concat = nullptr;
-    for (int i = 0; i < AP_MAX_CONCAT_MESSAGES; i++) {
-      if (ap_concatMessages[i].active && 
-          ap_concatMessages[i].refNum == refNum &&
-          ap_concatMessages[i].senderMeshId == from) {
-        concat = &ap_concatMessages[i];
-        break;
-      }
-    }
+  if (status == WDP_REASSEMBLY_STORED || status == WDP_REASSEMBLY_COMPLETE) {
+    // Reset timeout - we're still receiving parts
+    tx->lastPartTime = millis();
+    ap_noteResponseStarted(tx);
+    // Update display with receive progress
+    ap_wdpTotalParts = totalParts;
+    ap_wdpReceivedParts = concat->receivedParts;
+    ap_updateWDPDisplay();
     
-    if (!concat) {
-      // Create new concat entry
-      for (int i = 0; i < AP_MAX_CONCAT_MESSAGES; i++) {
-        if (!ap_concatMessages[i].active) {
-          concat = &ap_concatMessages[i];
-          concat->active = true;
-          concat->refNum = refNum;
-          concat->totalParts = totalParts;
-          concat->receivedParts = 0;
-          concat->sourcePort = udh.source;
-          concat->destPort = udh.dest;
-          concat->senderMeshId = from;
-          concat->lastUpdate = millis();
-          memset(concat->partReceived, 0, sizeof(concat->partReceived));
-          memset(concat->data, 0, sizeof(concat->data));
-          memset(concat->partSizes, 0, sizeof(concat->partSizes));
-          // Update display with total parts info
-          ap_wdpTotalParts = totalParts;
-          ap_wdpReceivedParts = 0;
-          ap_updateWDPDisplay();
-          break;
-        }
-      }
+    // The transaction streams the new part (and completes) in ap_loop()
+    ap_postEvent(AP_EVENT_PARTS, hdr.dstPort, nullptr, 0);
+  }
+  
+  // A lost part of this group may be rebuildable from parity that came earlier
+  if (status == WDP_REASSEMBLY_STORED && recover) {
+    ap_recoverParts(from);
+  }
+}
+
+// Rebuild the missing parts of a group once enough of its parity frames are in
+// Returns true if parts were rebuilt (the message may be complete now)
+static bool ap_recoverGroup(MeshNodeId sender, const WDPParity& group) {
+  WDPMeshReassembler::Message* concat = ap_reassembler.find(sender, group.refNum);
+  if (!concat || concat->totalParts != group.totalParts || concat->dstPort != group.port) {
+    return false;
+  }
+  
+  // This group's parity blocks
+  const uint8_t* blocks[WDP_FEC_MAX_PARITY];
+  uint8_t indexes[WDP_FEC_MAX_PARITY];
+  ApParityBlock* entries[WDP_FEC_MAX_PARITY];
+  int blockCount = 0;
+  for (int i = 0; i < AP_MAX_PARITY_BLOCKS && blockCount < WDP_FEC_MAX_PARITY; i++) {
+    ApParityBlock* p = &ap_parityBlocks[i];
+    if (p->active && p->sender == sender && p->parity.refNum == group.refNum &&
+        p->parity.port == group.port && p->parity.firstPart == group.firstPart &&
+        p->parity.groupSize == group.groupSize) {
+      entries[blockCount] = p;
+      blocks[blockCount] = p->block;
+      indexes[blockCount++] = p->parity.index;
     }
-    
-    if (!concat) {
-      Serial.println("AP-WDP: No free concat message slots");
-      return;
+  }
+  
+  uint8_t* parts[WDP_FEC_MAX_GROUP];
+  size_t lens[WDP_FEC_MAX_GROUP];
+  bool present[WDP_FEC_MAX_GROUP];
+  int missing = 0;
+  for (int i = 0; i < group.groupSize; i++) {
+    uint8_t part = group.firstPart + i;
+    present[i] = WDPMeshReassembler::hasPart(concat, part);
+    if (present[i]) {
+      parts[i] = &concat->data[concat->partOffset[part - 1]];
+      lens[i] = concat->partLen[part - 1];
+    } else if (missing < WDP_FEC_MAX_PARITY) {
+      parts[i] = ap_rebuiltParts[missing++];
+      lens[i] = 0;
+    } else {
+      return false;
     }
-    
-    // Store this part
-    if (currentPart > 0 && currentPart <= 16 && !(concat->partReceived[currentPart - 1])) {
-      size_t partPayloadLen = len - 12;  // Subtract concat UDH size
-      size_t offset = (currentPart - 1) * (MESHCORE_MAX_BINARY_PAYLOAD - 12);
-      
-      if (offset + partPayloadLen < sizeof(concat->data)) {
-        memcpy(&concat->data[offset], &data[12], partPayloadLen);
-        concat->partSizes[currentPart - 1] = partPayloadLen;
-        concat->partReceived[currentPart - 1] = 1;
-        concat->receivedParts++;
-        concat->lastUpdate = millis();
-        // Reset timeout - we're still receiving parts
-        ap_lastPartReceivedTime = millis();
-        // Update display with receive progress
-        ap_wdpReceivedParts = concat->receivedParts;
-        ap_updateWDPDisplay();
-        
-        // On first part, try to decode and send headers early
-        // this will stop browsers from timing out
-        // since WML headers will almost always fit in first part this is a perfect optimization
-        if (currentPart == 1 && !ap_headersSent && ap_waitingClient) {
-          // Verify port match first
-          if (ap_currentRequestPort == 0 || concat->destPort == ap_currentRequestPort) {
-            ap_trySendEarlyHeaders(&data[12], partPayloadLen);
-          }
-        } else if (!ap_isWMLC && ap_headersSent && ap_waitingClient && ap_waitingClient->connected()) {
-          // For non-WMLC responses, stream body data as it arrives
-          // Skip the WSP header bytes (they're in the first packet)
-          if (currentPart > 1) {
-            ap_waitingClient->write(&data[12], partPayloadLen);
-            ap_waitingClient->flush();
-            ap_bodyBytesReceived += partPayloadLen;
-            Serial.printf("AP-WDP: Streamed %zu body bytes (part %d)\n", partPayloadLen, currentPart);
-          }
-        }
+  }
+  if (missing == 0 || missing > blockCount) {
+    if (missing == 0) {
+      for (int i = 0; i < blockCount; i++) {
+        entries[i]->active = false;
       }
     }
-    
-    // Check if complete
-    if (concat->receivedParts == concat->totalParts) {
-      Serial.printf("AP-WDP: Concat message complete\n");
-      
-      // Verify this response matches our pending request by destination port
-      if (ap_currentRequestPort != 0 && concat->destPort != ap_currentRequestPort) {
-        Serial.printf("AP-WDP: Concat port mismatch - expected %d, got %d\n", ap_currentRequestPort, concat->destPort);
-        ap_clearConcatMessage(concat);
-        return;
-      }
-      
-      // Calculate total size
-      size_t totalSize = 0;
-      for (int i = 0; i < concat->totalParts; i++) {
-        totalSize += concat->partSizes[i];
-      }
-      
-      // Copy to response buffer
-      if (totalSize < sizeof(ap_meshResponseBuffer)) {
-        memcpy(ap_meshResponseBuffer, concat->data, totalSize);
-        ap_meshResponseLen = totalSize;
-        ap_meshResponseReady = true;
-        ap_currentRequestPort = 0;  // Clear port after receiving response
-        Serial.printf("AP-WDP: Response ready (%zu bytes)\n", totalSize);
-      }
-      
-      ap_clearConcatMessage(concat);
+    return false;
+  }
+  
+  if (!WDPFec::decode(parts, lens, present, group.groupSize, blocks, indexes, blockCount,
+                      entries[0]->blockLen)) {
+    return false;
+  }
+  for (int i = 0; i < blockCount; i++) {
+    entries[i]->active = false;
+  }
+  
+  Serial.printf("AP-WDP: Rebuilt %d part(s) of %d-%d from parity (ref: %d)\n",
+                missing, group.firstPart, group.firstPart + group.groupSize - 1, group.refNum);
+  WDPHeaderInfo hdr;
+  hdr.srcPort = concat->srcPort;
+  hdr.dstPort = concat->dstPort;
+  hdr.concat = true;
+  hdr.refNum = group.refNum;
+  hdr.totalParts = group.totalParts;
+  hdr.compact = false;
+  for (int i = 0; i < group.groupSize; i++) {
+    if (!present[i]) {
+      hdr.part = group.firstPart + i;
+      ap_handleConcatPart(sender, hdr, parts[i], lens[i], false);
+    }
+  }
+  return true;
+}
+
+// Try every group of the sender that has parity frames waiting
+static void ap_recoverParts(MeshNodeId from) {
+  for (int i = 0; i < AP_MAX_PARITY_BLOCKS; i++) {
+    if (ap_parityBlocks[i].active && ap_parityBlocks[i].sender == from) {
+      WDPParity group = ap_parityBlocks[i].parity;
+      ap_recoverGroup(from, group);
     }
+  }
+}
+
+// Keep a parity frame for its group, then see whether the group can be rebuilt
+static void ap_handleParity(MeshNodeId from, const uint8_t* data, size_t len) {
+  WDPParity parity;
+  const char* error = nullptr;
+  size_t hdrLen = WDPControl::parseParity(data, len, parity, &error);
+  if (hdrLen == 0) {
+    Serial.printf("AP-WDP: Invalid parity frame - %s\n", error);
     return;
   }
   
-  // Simple (non-concatenated) message
-  if (!ap_parseUDH(data, len, udh)) {
+  unsigned long now = millis();
+  ApParityBlock* slot = &ap_parityBlocks[0];
+  for (int i = 0; i < AP_MAX_PARITY_BLOCKS; i++) {
+    ApParityBlock* p = &ap_parityBlocks[i];
+    if (p->active && now - p->timestamp > AP_PARITY_TIMEOUT_MS) {
+      p->active = false;
+    }
+    if (p->active && p->sender == from && memcmp(&p->parity, &parity, sizeof(parity)) == 0) {
+      return;  // Duplicate
+    }
+    if (!p->active || (slot->active && p->timestamp < slot->timestamp)) {
+      slot = p;
+    }
+  }
+  slot->active = true;
+  slot->sender = from;
+  slot->parity = parity;
+  slot->blockLen = len - hdrLen;
+  memcpy(slot->block, data + hdrLen, slot->blockLen);
+  slot->timestamp = now;
+  Serial.printf("AP-WDP: Parity %d/%d for parts %d-%d (ref: %d)\n", parity.index + 1, parity.count,
+                parity.firstPart, parity.firstPart + parity.groupSize - 1, parity.refNum);
+  
+  ApTransaction* tx = ap_findTransaction(parity.port);
+  if (tx) {
+    tx->lastPartTime = now;
+  }
+  ap_recoverGroup(from, parity);
+}
+
+void ap_handleIncomingMesh(MeshNodeId from, const uint8_t* data, size_t len) {
+  Serial.printf("AP-WDP: Received %d bytes from %08lx\n", len, (unsigned long)from);
+  
+  // Parity frames from the proxy (no WDP header)
+  if (WDPControl::isControl(data, len)) {
+    if (data[0] == WDP_CONTROL_PARITY) {
+      ap_handleParity(from, data, len);
+    } else {
+      Serial.printf("AP-WDP: Ignoring control frame 0x%02X\n", data[0]);
+    }
     return;
   }
   
-  // Verify this response matches our pending request by destination port
-  if (ap_currentRequestPort != 0 && udh.dest != ap_currentRequestPort) {
-    Serial.printf("AP-WDP: Port mismatch - expected %d, got %d\n", ap_currentRequestPort, udh.dest);
+  // Legacy UDH or compact header, whichever the proxy used
+  WDPHeaderInfo hdr;
+  const char* error = nullptr;
+  size_t hdrLen = WDPHeader::parse(data, len, hdr, &error);
+  if (hdrLen == 0) {
+    Serial.printf("AP-WDP: Invalid header - %s\n", error);
     return;
   }
   
-  payload = data + 7;  // Skip UDH
-  payloadLen = len - 7;
+  const uint8_t* payload = data + hdrLen;
+  size_t payloadLen = len - hdrLen;
   
-  // For simple messages, try to send headers early too
-  if (!ap_headersSent && ap_waitingClient) {
-    ap_trySendEarlyHeaders(payload, payloadLen);
+  // Check if this is a concatenated message
+  if (hdr.concat) {
+    ap_handleConcatPart(from, hdr, payload, payloadLen, true);
+    return;
   }
   
-  // Copy to response buffer
-  if (payloadLen < sizeof(ap_meshResponseBuffer)) {
-    memcpy(ap_meshResponseBuffer, payload, payloadLen);
-    ap_meshResponseLen = payloadLen;
-    ap_meshResponseReady = true;
-    ap_currentRequestPort = 0;  // Clear port after receiving response
-    // Update display to show single-part response received
-    ap_wdpTotalParts = 1;
-    ap_wdpReceivedParts = 1;
-    ap_updateWDPDisplay();
-    Serial.printf("AP-WDP: Simple response ready (%zu bytes)\n", payloadLen);
+  // Simple (non-concatenated) message
+  // Verify this response matches a pending request by destination port
+  ApTransaction* tx = ap_findTransaction(hdr.dstPort);
+  if (!tx) {
+    Serial.printf("AP-WDP: No pending request for port %d, dropping response\n", hdr.dstPort);
+    return;
   }
+  ap_noteResponseStarted(tx);
+  
+  // Update display to show single-part response received
+  ap_wdpTotalParts = 1;
+  ap_wdpReceivedParts = 1;
+  ap_updateWDPDisplay();
+  Serial.printf("AP-WDP: Simple response ready (%zu bytes)\n", payloadLen);
+  
+  // The transaction answers its client from the event in ap_loop()
+  ap_postEvent(AP_EVENT_RESPONSE, hdr.dstPort, payload, payloadLen);
 }
 
 #endif // ESP32
@@ -6,39 +6,273 @@
 #include <WiFi.h>
 #include <WiFiUdp.h>
 #include <functional>
+#include "wdp_header.h"
+#include "wdp_reassembler.h"
+#include "wdp_control.h"
+#include "wdp_fec.h"
+#include "wdp_raw.h"
+#include "node_id.h"
 
 // Default values if not defined in main
 #ifndef MESHCORE_MAX_BINARY_PAYLOAD
   #define MESHCORE_MAX_BINARY_PAYLOAD 120  // Max binary bytes after Base91 encoding
 #endif
+#ifndef MESHCORE_MAX_COBS_PAYLOAD
+  #define MESHCORE_MAX_COBS_PAYLOAD 147    // Max binary bytes after COBS framing
+#endif
+#ifndef MESHCORE_MAX_RAW_PAYLOAD
+  #define MESHCORE_MAX_RAW_PAYLOAD     (MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE - 1) - 4 - WDP_RAW_HEADER_LEN)  // 161, max binary bytes per message
+#endif
 
-// Forward declaration - defined in main.cpp
-extern void displayStatus(const char* line1, const char* line2, const char* line3, const char* line4);
+// Largest payload one concat part can carry (raw transport, compact header)
+#define WDP_MAX_PART_PAYLOAD    (MESHCORE_MAX_RAW_PAYLOAD - WDP_HEADER_MIN_CONCAT_LEN)
 
-// UDH (User Data Header) structure for WAP over bearer
-struct UDH {
-  uint8_t headerLen;
-  uint8_t ei;         // Element Identifier (0x05 = Application Port Addressing 16-bit)
-  uint8_t eiLength;   // Length of element data (0x04 for 16-bit ports)
-  uint16_t source;    // Source port
-  uint16_t dest;      // Destination port
-};
+// Largest concatenated WDP message either gateway reassembles (and the proxy relays back)
+#ifndef WDP_REASSEMBLY_BUFFER_SIZE
+  #define WDP_REASSEMBLY_BUFFER_SIZE 8192
+#endif
+
+// Concatenated messages being reassembled at once, per gateway
+#define WDP_REASSEMBLY_SLOTS    4
+
+typedef WDPReassembler<WDP_REASSEMBLY_BUFFER_SIZE, WDP_REASSEMBLY_SLOTS> WDPMeshReassembler;
+
+// Parts per FEC group, each group is followed by 0..WDP_FEC_MAX_PARITY parity frames
+#define WDP_FEC_GROUP_SIZE      8
+
+// Callback for sending a WDP message as one MeshCore message: the header and the payload
+// slice are passed separately and encoded straight from their buffers
+typedef std::function<void(MeshNodeId, const uint8_t*, size_t, const uint8_t*, size_t)> WDPSendCallback;
+
+// Callback for how many leading payload bytes fit in one MeshCore message after the header
+// (depends on the recipient's codec and, for Base91, on the data itself)
+typedef std::function<size_t(MeshNodeId, const uint8_t*, size_t, const uint8_t*, size_t)> WDPFitCallback;
+
+// Callback for whether a recipient understands the compact WDP header
+typedef std::function<bool(MeshNodeId)> WDPCompactCallback;
+
+// Callback for whether a recipient retransmits the parts reported missing in a NACK
+typedef std::function<bool(MeshNodeId)> WDPNackCallback;
+
+// Callback for whether a recipient rebuilds lost parts from parity frames
+typedef std::function<bool(MeshNodeId)> WDPFecCallback;
+
+// Callback for whether the send queue takes another message to a recipient right now,
+// the rest of a fragmented message waits with its sender until ACKs make room
+typedef std::function<bool(MeshNodeId)> WDPRoomCallback;
 
-// Concatenated message tracking for reassembly
-struct ConcatMessage {
-  bool active;
-  uint8_t refNum;           // Reference number
-  uint8_t totalParts;
-  uint8_t receivedParts;
-  uint8_t partReceived[16]; // Bitmask for which parts received (max 16 parts)
-  uint8_t data[2048];       // Reassembled data buffer
-  uint16_t partSizes[16];   // Size of each part
-  uint16_t sourcePort;
-  uint16_t destPort;
-  String senderMeshId;
-  unsigned long lastUpdate;
+// WDP message going out over the mesh one part at a time, from the sender's own copy
+// of the data, whenever the send queue has room (see wdpSendNextPart)
+struct WDPOutgoing {
+  bool active;                  // Parts (or resends) left to send
+  MeshNodeId to;
+  uint16_t srcPort;
+  uint16_t dstPort;
+  uint8_t refNum;
+  bool compact;
+  int totalParts;               // 0 = single message
+  uint8_t partLens[WDP_MAX_PARTS];
+  int nextPart;                 // Next part to send for the first time
+  size_t nextOffset;            // Its offset in the data
+  uint8_t resend[WDP_NACK_BITMAP_LEN];  // Parts reported missing, same layout as a NACK
 };
 
+// Payload bytes that fit after the header, worst-case Base91 without a callback
+static size_t wdpFitMessage(const WDPFitCallback& fit, MeshNodeId to,
+                            const uint8_t* hdr, size_t hdrLen, const uint8_t* data, size_t len) {
+  size_t fits = fit ? fit(to, hdr, hdrLen, data, len) : MESHCORE_MAX_BINARY_PAYLOAD - hdrLen;
+  return (fits < len) ? fits : len;
+}
+
+// Write the WDP header for a message or one of its parts (totalParts 0 = not concatenated)
+// Compact if the recipient supports it, the legacy 7/12-byte UDH otherwise
+static size_t wdpWriteHeader(uint8_t* msg, bool compact, uint16_t srcPort, uint16_t dstPort,
+                             uint8_t refNum = 0, uint8_t totalParts = 0, uint8_t part = 0) {
+  WDPHeaderInfo info;
+  info.srcPort = srcPort;
+  info.dstPort = dstPort;
+  info.concat = totalParts > 0;
+  info.refNum = refNum;
+  info.totalParts = totalParts;
+  info.part = part;
+  info.compact = compact;
+  return WDPHeader::write(msg, info);
+}
+
+// Split data into concat parts that each fill a MeshCore message completely
+// The total part count is part of every header (and so of the fit), so plan
+// with a guess and re-plan until the count is stable
+// Returns the number of parts (sizes in partLens), or 0 to fall back to fixed parts
+static int wdpPlanConcatParts(const WDPFitCallback& fit, MeshNodeId to, bool compact, uint8_t refNum,
+                              uint16_t srcPort, uint16_t dstPort, const uint8_t* data, size_t len,
+                              uint8_t* partLens, int maxParts, size_t maxPartLen = WDP_MAX_PART_PAYLOAD) {
+  const size_t fixedPart = MESHCORE_MAX_BINARY_PAYLOAD - 12;
+  int guess = (len + fixedPart - 1) / fixedPart;
+  
+  for (int attempt = 0; attempt < 4; attempt++) {
+    if (guess > maxParts) {
+      return 0;
+    }
+    int parts = 0;
+    size_t offset = 0;
+    while (offset < len) {
+      if (parts == maxParts) {
+        return 0;
+      }
+      uint8_t hdr[WDP_HEADER_MAX_LEN];
+      size_t chunk = (len - offset < maxPartLen) ? (len - offset) : maxPartLen;
+      size_t hdrLen = wdpWriteHeader(hdr, compact, srcPort, dstPort, refNum, (uint8_t)guess, (uint8_t)(parts + 1));
+      size_t fits = wdpFitMessage(fit, to, hdr, hdrLen, &data[offset], chunk);
+      if (fits == 0) {
+        return 0;
+      }
+      partLens[parts++] = (uint8_t)fits;
+      offset += fits;
+    }
+    if (parts == guess) {
+      return parts;
+    }
+    guess = parts;
+  }
+  return 0;
+}
+
+// Longest part whose parity block (length byte + part) still fits one MeshCore message
+// after the parity header, whatever the part data (all 0xFF is the Base91 worst case)
+static size_t wdpFecMaxPartLen(const WDPFitCallback& fit, MeshNodeId to) {
+  uint8_t hdr[WDP_PARITY_HEADER_LEN] = {WDP_CONTROL_PARITY};
+  uint8_t probe[WDP_MAX_PART_PAYLOAD + 1];
+  memset(probe, 0xFF, sizeof(probe));
+  size_t fits = wdpFitMessage(fit, to, hdr, sizeof(hdr), probe, sizeof(probe));
+  return (fits > 1) ? fits - 1 : 0;
+}
+
+// Plan how a message goes out: whole if it fits one MeshCore message, else in concat
+// parts that fill each message (up to maxPartLen payload bytes), or in fixed parts at the
+// worst-case size, which fit any codec, when no plan is stable
+// Returns false if the message is too large to fragment
+static bool wdpPlanOutgoing(WDPOutgoing& out, const WDPFitCallback& fit, bool compact, MeshNodeId to,
+                            uint16_t srcPort, uint16_t dstPort, const uint8_t* data, size_t len,
+                            size_t maxPartLen = WDP_MAX_PART_PAYLOAD) {
+  out.active = false;
+  out.to = to;
+  out.srcPort = srcPort;
+  out.dstPort = dstPort;
+  out.refNum = (millis() & 0xFF);  // Simple reference number
+  out.compact = compact;
+  out.nextPart = 1;
+  out.nextOffset = 0;
+  memset(out.resend, 0, sizeof(out.resend));
+  
+  // Simple header is 3 (compact) or 7 (legacy) bytes, try to fit everything in a single message
+  uint8_t hdr[WDP_HEADER_MAX_LEN];
+  size_t hdrLen = wdpWriteHeader(hdr, compact, srcPort, dstPort);
+  if (len <= MESHCORE_MAX_RAW_PAYLOAD - hdrLen && wdpFitMessage(fit, to, hdr, hdrLen, data, len) == len) {
+    out.totalParts = 0;
+    out.active = true;
+    return true;
+  }
+  
+  // Concat header is 5 (compact) or 12 (legacy) bytes, parts vary in size to fill each message
+  out.totalParts = wdpPlanConcatParts(fit, to, compact, out.refNum, srcPort, dstPort,
+                                      data, len, out.partLens, WDP_MAX_PARTS, maxPartLen);
+  if (out.totalParts == 0) {
+    const size_t fixedPart = MESHCORE_MAX_BINARY_PAYLOAD - 12;
+    int totalParts = (len + fixedPart - 1) / fixedPart;
+    if (totalParts > WDP_MAX_PARTS) {
+      return false;
+    }
+    for (int i = 0; i < totalParts; i++) {
+      out.partLens[i] = fixedPart;
+    }
+    out.partLens[totalParts - 1] = (uint8_t)(len - (totalParts - 1) * fixedPart);
+    out.totalParts = totalParts;
+  }
+  out.active = true;
+  return true;
+}
+
+// Offset of a part in the data of an outgoing message
+static size_t wdpPartOffset(const WDPOutgoing& out, int part) {
+  size_t offset = 0;
+  for (int i = 1; i < part; i++) {
+    offset += out.partLens[i - 1];
+  }
+  return offset;
+}
+
+static bool wdpIsResend(const WDPOutgoing& out, int part) {
+  int index = part - 1;
+  return out.resend[index >> 3] & (1 << (index & 7));
+}
+
+// Send the next part of an outgoing message, the parts reported missing come first
+// Returns the part sent (1 for a single message), or 0 if nothing was left
+static int wdpSendNextPart(WDPOutgoing& out, const uint8_t* data, size_t len, const WDPSendCallback& send) {
+  uint8_t hdr[WDP_HEADER_MAX_LEN];
+  if (!out.active) {
+    return 0;
+  }
+  if (out.totalParts == 0) {
+    out.active = false;
+    size_t hdrLen = wdpWriteHeader(hdr, out.compact, out.srcPort, out.dstPort);
+    if (send) {
+      send(out.to, hdr, hdrLen, data, len);
+    }
+    return 1;
+  }
+  
+  int part = 0;
+  size_t offset = 0;
+  for (int p = 1; p < out.nextPart; p++) {
+    if (wdpIsResend(out, p)) {
+      out.resend[(p - 1) >> 3] &= ~(1 << ((p - 1) & 7));
+      part = p;
+      offset = wdpPartOffset(out, p);
+      break;
+    }
+  }
+  if (part == 0 && out.nextPart <= out.totalParts) {
+    part = out.nextPart++;
+    offset = out.nextOffset;
+    out.nextOffset += out.partLens[part - 1];
+  }
+  
+  if (part != 0) {
+    size_t hdrLen = wdpWriteHeader(hdr, out.compact, out.srcPort, out.dstPort, out.refNum,
+                                   (uint8_t)out.totalParts, (uint8_t)part);
+    if (send) {
+      send(out.to, hdr, hdrLen, &data[offset], out.partLens[part - 1]);
+    }
+  }
+  
+  // Done once every part went out and no resend is left
+  out.active = out.nextPart <= out.totalParts;
+  for (int i = 0; i < WDP_NACK_BITMAP_LEN && !out.active; i++) {
+    out.active = out.resend[i] != 0;
+  }
+  return part;
+}
+
+// Queue the parts a NACK reports missing for resending, only parts already sent count
+// (the rest are still on their way). Returns the number of parts queued
+static int wdpMarkResend(WDPOutgoing& out, const WDPNack& nack) {
+  int count = 0;
+  for (int part = 1; part < out.nextPart; part++) {
+    if (WDPControl::isMissing(nack, (uint8_t)part) && !wdpIsResend(out, part)) {
+      out.resend[(part - 1) >> 3] |= 1 << ((part - 1) & 7);
+      count++;
+    }
+  }
+  if (count > 0) {
+    out.active = true;
+  }
+  return count;
+}
+
+// Forward declaration - defined in main.cpp
+extern void displayStatus(const char* line1, const char* line2, const char* line3, const char* line4);
+
 class WDPGateway {
 private:
   String wapBoxHost;
@@ -50,7 +284,7 @@ private:
     bool active;
     uint16_t clientSourcePort;  // Source port from the mesh client (used for response routing)
     uint16_t wapboxPort;        // WAPBOX port we sent to
-    String meshRecipient;
+    MeshNodeId meshRecipient;   // Node ID of the mesh client
     unsigned long timestamp;
     WiFiUDP udpSocket;          // Per-connection UDP socket bound to clientSourcePort
   };
@@ -63,194 +297,361 @@ private:
     conn->active = false;
     conn->clientSourcePort = 0;
     conn->wapboxPort = 0;
-    conn->meshRecipient = "";
+    conn->meshRecipient = 0;
     conn->timestamp = 0;
   }
   
   // Concatenated message reassembly
-  static const int MAX_CONCAT_MESSAGES = 4;
-  ConcatMessage concatMessages[MAX_CONCAT_MESSAGES];
-  
-  // Clear/reset a concat message slot
-  void clearConcatMessage(ConcatMessage* msg) {
-    msg->active = false;
-    msg->refNum = 0;
-    msg->totalParts = 0;
-    msg->receivedParts = 0;
-    memset(msg->partReceived, 0, sizeof(msg->partReceived));
-    memset(msg->data, 0, sizeof(msg->data));
-    memset(msg->partSizes, 0, sizeof(msg->partSizes));
-    msg->sourcePort = 0;
-    msg->destPort = 0;
-    msg->senderMeshId = "";
-    msg->lastUpdate = 0;
+  WDPMeshReassembler reassembler;
+  
+  // Responses on their way to clients, read straight from the WAPBox into a slot and sent
+  // from there as the send queue has room (see pumpResponses)
+  // Fragmented ones stay after sending, to resend the parts an AP reports missing
+  // A new UDP reply is only read once a slot is free for it
+  static const int MAX_RETAINED_RESPONSES = 4;
+  static const unsigned long RETAINED_RESPONSE_TIMEOUT_MS = 60000;
+  struct RetainedResponse {
+    bool active;
+    WDPOutgoing out;            // Recipient, header fields, part sizes and send cursor
+    bool nacked;                // A NACK came in for it (else it counts as delivered for the loss estimate)
+    int parityPerGroup;         // Parity frames after each group of parts
+    int parityFirst;            // Group whose parity frames are going out
+    int parityGroupSize;
+    int parityLeft;
+    size_t len;
+    uint8_t data[WDP_REASSEMBLY_BUFFER_SIZE];
+    unsigned long timestamp;
+  };
+  RetainedResponse retainedResponses[MAX_RETAINED_RESPONSES];
+  
+  // Part loss rate per client, from the NACKs for its fragmented responses
+  // EWMA in 1/256 units, weight 1/4 for each new response
+  static const int MAX_LOSS_ESTIMATES = 8;
+  struct LossEstimate {
+    bool active;
+    MeshNodeId recipient;
+    uint16_t loss;
+    unsigned long timestamp;
+  };
+  LossEstimate lossEstimates[MAX_LOSS_ESTIMATES];
+  
+  // Parity frame being sent
+  uint8_t parityBlock[WDP_FEC_MAX_BLOCK];
+  
+  LossEstimate* findLossEstimate(MeshNodeId recipient, bool create) {
+    LossEstimate* slot = nullptr;
+    for (int i = 0; i < MAX_LOSS_ESTIMATES; i++) {
+      LossEstimate* e = &lossEstimates[i];
+      if (e->active && e->recipient == recipient) {
+        return e;
+      }
+      if (!slot || !e->active || (slot->active && e->timestamp < slot->timestamp)) {
+        slot = e;
+      }
+    }
+    if (!create) {
+      return nullptr;
+    }
+    slot->active = true;
+    slot->recipient = recipient;
+    slot->loss = 0;
+    return slot;
+  }
+  
+  // Add one response's outcome (lost parts * 256 / parts) to the client's loss estimate
+  void updateLoss(MeshNodeId recipient, uint16_t sample) {
+    LossEstimate* e = findLossEstimate(recipient, sample > 0);
+    if (!e) {
+      return;
+    }
+    e->loss = (uint16_t)(((int)e->loss * 3 + sample) / 4);
+    e->timestamp = millis();
+  }
+  
+  // Parity frames per group of groupSize parts: 1.5x the expected losses, rounded up,
+  // none below ~2% loss
+  int parityCount(MeshNodeId to, int groupSize) {
+    LossEstimate* e = findLossEstimate(to, false);
+    if (!e || e->loss < 5) {
+      return 0;
+    }
+    int count = (3 * e->loss * groupSize + 511) / 512;
+    return (count < WDP_FEC_MAX_PARITY) ? count : WDP_FEC_MAX_PARITY;
+  }
+  
+  // Retained response goes away, no NACK means all parts arrived (or were rebuilt)
+  void dropRetainedResponse(RetainedResponse* r) {
+    if (r->active && !r->nacked && r->out.totalParts > 0) {
+      updateLoss(r->out.to, 0);
+    }
+    r->active = false;
+  }
+  
+  bool isSending(const RetainedResponse* r) {
+    return r->active && (r->out.active || r->parityLeft > 0);
+  }
+  
+  // Slot for a client's next response: its previous one or a free slot, else the oldest
+  // Slots still sending are never taken, nullptr if all are
+  RetainedResponse* responseSlot(MeshNodeId to, uint16_t dstPort) {
+    RetainedResponse* slot = nullptr;
+    for (int i = 0; i < MAX_RETAINED_RESPONSES; i++) {
+      RetainedResponse* r = &retainedResponses[i];
+      if (isSending(r)) {
+        continue;
+      }
+      if (r->active && r->out.to == to && r->out.dstPort == dstPort) {
+        return r;
+      }
+      if (!slot || (slot->active && (!r->active || r->timestamp < slot->timestamp))) {
+        slot = r;
+      }
+    }
+    return slot;
+  }
+  
+  // Resend the parts of a retained response that a NACK reports missing
+  void handleNack(MeshNodeId from, const uint8_t* data, size_t len) {
+    WDPNack nack;
+    const char* error = nullptr;
+    if (!WDPControl::parseNack(data, len, nack, &error)) {
+      Serial.printf("WDP: Invalid NACK - %s\n", error);
+      return;
+    }
+    
+    RetainedResponse* r = nullptr;
+    for (int i = 0; i < MAX_RETAINED_RESPONSES; i++) {
+      const WDPOutgoing& out = retainedResponses[i].out;
+      if (retainedResponses[i].active && out.totalParts > 0 && out.to == from &&
+          out.dstPort == nack.port && out.refNum == nack.refNum && out.totalParts == nack.totalParts) {
+        r = &retainedResponses[i];
+        break;
+      }
+    }
+    if (!r) {
+      Serial.printf("WDP: NACK for unknown response (ref: %d, port: %d)\n", nack.refNum, nack.port);
+      return;
+    }
+    
+    int missing = WDPControl::missingCount(nack);
+    int queued = wdpMarkResend(r->out, nack);
+    Serial.printf("WDP: NACK from %08lx, resending %d of %d parts (ref: %d)\n",
+                  (unsigned long)from, queued, nack.totalParts, nack.refNum);
+    
+    // Only the first NACK of a response is a loss sample, later ones are about the resent parts
+    if (!r->nacked) {
+      r->nacked = true;
+      updateLoss(from, (uint16_t)(missing * 256 / nack.totalParts));
+    }
+    r->timestamp = millis();
   }
   
   // Callback for sending MeshCore messages
-  std::function<void(const String&, const uint8_t*, size_t)> sendMeshCallback;
+  WDPSendCallback sendMeshCallback;
+  
+  // Callback for how much of a WDP message fits in one MeshCore message to a recipient
+  WDPFitCallback meshFitCallback;
+  
+  // Callback for whether a recipient understands the compact header
+  WDPCompactCallback meshCompactCallback;
+  
+  // Callback for whether a recipient rebuilds lost parts from parity frames
+  WDPFecCallback meshFecCallback;
+  
+  // Callback for whether the send queue has room for another message to a recipient
+  WDPRoomCallback meshRoomCallback;
+  
+  // Send parity frame index of the group of parts r->parityFirst.. in flight
+  void sendParityFrame(RetainedResponse* r, int index) {
+    const uint8_t* parts[WDP_FEC_MAX_GROUP];
+    size_t lens[WDP_FEC_MAX_GROUP];
+    size_t blockLen = 0;
+    size_t offset = wdpPartOffset(r->out, r->parityFirst);
+    for (int i = 0; i < r->parityGroupSize; i++) {
+      parts[i] = &r->data[offset];
+      lens[i] = r->out.partLens[r->parityFirst - 1 + i];
+      offset += lens[i];
+      blockLen = (lens[i] + 1 > blockLen) ? lens[i] + 1 : blockLen;
+    }
+    
+    WDPParity parity;
+    parity.refNum = r->out.refNum;
+    parity.totalParts = (uint8_t)r->out.totalParts;
+    parity.port = r->out.dstPort;
+    parity.firstPart = (uint8_t)r->parityFirst;
+    parity.groupSize = (uint8_t)r->parityGroupSize;
+    parity.count = (uint8_t)r->parityPerGroup;
+    parity.index = (uint8_t)index;
+    uint8_t hdr[WDP_PARITY_HEADER_LEN];
+    size_t hdrLen = WDPControl::writeParityHeader(hdr, parity);
+    WDPFec::encode(parts, lens, r->parityGroupSize, index, parityBlock, blockLen);
+    Serial.printf("WDP: Sending parity %d/%d for parts %d-%d (%d bytes)\n", index + 1, r->parityPerGroup,
+                  r->parityFirst, r->parityFirst + r->parityGroupSize - 1, hdrLen + blockLen);
+    if (sendMeshCallback) {
+      sendMeshCallback(r->out.to, hdr, hdrLen, parityBlock, blockLen);
+    }
+  }
+  
+  // Send response parts while the send queue has room for their recipient, parity frames
+  // right after their group and resent parts before new ones
+  // Whatever does not fit goes out from a later loop(), as ACKs free up the queue
+  void pumpResponses() {
+    for (int i = 0; i < MAX_RETAINED_RESPONSES; i++) {
+      RetainedResponse* r = &retainedResponses[i];
+      while (isSending(r) && (!meshRoomCallback || meshRoomCallback(r->out.to))) {
+        r->timestamp = millis();
+        if (r->parityLeft > 0) {
+          sendParityFrame(r, r->parityPerGroup - r->parityLeft);
+          r->parityLeft--;
+          continue;
+        }
+        
+        char toLine[32];
+        snprintf(toLine, sizeof(toLine), "To: %08lx", (unsigned long)r->out.to);
+        int nextPart = r->out.nextPart;
+        int part = wdpSendNextPart(r->out, r->data, r->len, sendMeshCallback);
+        if (part == 0) {
+          continue;
+        }
+        
+        if (r->out.totalParts == 0) {
+          // Simple message, nothing to keep for it
+          Serial.printf("WDP: Sent simple message (%d bytes) to %08lx\n", (int)r->len, (unsigned long)r->out.to);
+          char sizeLine[32];
+          snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)r->len);
+          displayStatus("WDP Sent", toLine, sizeLine, "Complete!");
+          r->active = false;
+          break;
+        }
+        if (r->out.nextPart == nextPart) {
+          Serial.printf("WDP: Resending part %d/%d (%d bytes)\n", part, r->out.totalParts, r->out.partLens[part - 1]);
+          continue;
+        }
+        
+        Serial.printf("WDP: Sent part %d/%d (%d bytes)\n", part, r->out.totalParts, r->out.partLens[part - 1]);
+        char progressLine[32];
+        snprintf(progressLine, sizeof(progressLine), "Part %d/%d (%dB)", part, r->out.totalParts,
+                 (int)r->out.partLens[part - 1]);
+        char sizeLine[32];
+        snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)r->len);
+        displayStatus("WDP Multi-Send", toLine, progressLine, sizeLine);
+        
+        // Group complete, its parity frames go out next
+        int firstPart = ((part - 1) / WDP_FEC_GROUP_SIZE) * WDP_FEC_GROUP_SIZE + 1;
+        if (r->parityPerGroup > 0 && (part - firstPart + 1 == WDP_FEC_GROUP_SIZE || part == r->out.totalParts)) {
+          r->parityFirst = firstPart;
+          r->parityGroupSize = part - firstPart + 1;
+          r->parityLeft = r->parityPerGroup;
+        }
+        if (part == r->out.totalParts) {
+          char doneMsg[32];
+          snprintf(doneMsg, sizeof(doneMsg), "Sent %dB in %d parts", (int)r->len, r->out.totalParts);
+          displayStatus("WDP Multi-Send", toLine, "Complete!", doneMsg);
+        }
+      }
+    }
+  }
 
 public:
   WDPGateway(const char* host, uint16_t port) : wapBoxHost(host), wapBoxPort(port) {
     for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
       pendingConnections[i].active = false;
     }
-    for (int i = 0; i < MAX_CONCAT_MESSAGES; i++) {
-      concatMessages[i].active = false;
+    for (int i = 0; i < MAX_RETAINED_RESPONSES; i++) {
+      retainedResponses[i].active = false;
+    }
+    for (int i = 0; i < MAX_LOSS_ESTIMATES; i++) {
+      lossEstimates[i].active = false;
     }
   }
   
-  void begin(std::function<void(const String&, const uint8_t*, size_t)> callback) {
+  void begin(WDPSendCallback callback) {
     sendMeshCallback = callback;
     Serial.println("WDP Gateway initialized (per-connection UDP sockets)");
   }
   
-  // Parse UDH from incoming MeshCore message
-  bool parseUDH(const uint8_t* data, size_t len, UDH& udh) {
-    if (len < 7) {
-      Serial.println("WDP: Invalid UDH - too short");
-      return false;
-    }
-    
-    udh.headerLen = data[0];
-    udh.ei = data[1];
-    udh.eiLength = data[2];
-    udh.dest = (data[3] << 8) | data[4];    // Destination port first
-    udh.source = (data[5] << 8) | data[6];  // Source port second
-    
-    // Validate: EI should be 0x05 (Application Port Addressing, 16-bit)
-    if (udh.ei != 0x05) {
-      Serial.printf("WDP: Unexpected EI: 0x%02X\n", udh.ei);
-      // Still allow processing - might be concatenated message
-    }
-    
-    return true;
+  void setFitCallback(WDPFitCallback callback) {
+    meshFitCallback = callback;
   }
   
-  // Parse concatenated message UDH (0x0B header length indicates concat)
-  bool parseConcatUDH(const uint8_t* data, size_t len, uint8_t& refNum, uint8_t& totalParts, 
-                      uint8_t& currentPart, UDH& udh) {
-    if (len < 12 || data[0] != 0x0B) {
-      return false;
-    }
-    
-    // Concatenated header format:
-    // [0] = 0x0B (header length)
-    // [1] = 0x00 (concat IE identifier)
-    // [2] = 0x03 (concat IE length)
-    // [3] = reference number
-    // [4] = total parts
-    // [5] = current part number
-    // [6] = 0x05 (port addressing IE)
-    // [7] = 0x04 (port IE length)
-    // [8-9] = destination port
-    // [10-11] = source port
-    
-    if (data[1] != 0x00 || data[2] != 0x03) {
-      return false;
-    }
-    
-    refNum = data[3];
-    totalParts = data[4];
-    currentPart = data[5];
-    
-    udh.headerLen = data[0];
-    udh.ei = data[6];
-    udh.eiLength = data[7];
-    udh.dest = (data[8] << 8) | data[9];
-    udh.source = (data[10] << 8) | data[11];
-    
-    return true;
+  void setCompactCallback(WDPCompactCallback callback) {
+    meshCompactCallback = callback;
+  }
+  
+  void setFecCallback(WDPFecCallback callback) {
+    meshFecCallback = callback;
+  }
+  
+  void setRoomCallback(WDPRoomCallback callback) {
+    meshRoomCallback = callback;
   }
   
   // Handle incoming MeshCore message containing WDP data
-  void handleIncomingMesh(const String& from, const uint8_t* data, size_t len) {
-    Serial.printf("WDP: Received %d bytes from %s\n", len, from.c_str());
+  void handleIncomingMesh(MeshNodeId from, const uint8_t* data, size_t len) {
+    Serial.printf("WDP: Received %d bytes from %08lx\n", len, (unsigned long)from);
     
     // Display status: package received
     char fromLine[32];
-    snprintf(fromLine, sizeof(fromLine), "From: %.20s", from.c_str());
+    snprintf(fromLine, sizeof(fromLine), "From: %08lx", (unsigned long)from);
     char sizeLine[32];
     snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)len);
     displayStatus("WDP Received", fromLine, sizeLine, "Processing...");
     
-    if (len < 7) {
-      Serial.println("WDP: Message too short for UDH");
-      displayStatus("WDP too short", fromLine, (const char*)data, "Ignoring...");
+    // Control frames from the AP (no WDP header)
+    if (WDPControl::isControl(data, len)) {
+      if (data[0] == WDP_CONTROL_NACK) {
+        handleNack(from, data, len);
+      } else {
+        Serial.printf("WDP: Ignoring control frame 0x%02X\n", data[0]);
+      }
       return;
     }
     
-    UDH udh;
-    const uint8_t* payload;
-    size_t payloadLen;
+    // Legacy UDH or compact header, whichever the sender used
+    WDPHeaderInfo hdr;
+    const char* error = nullptr;
+    size_t hdrLen = WDPHeader::parse(data, len, hdr, &error);
+    if (hdrLen == 0) {
+      Serial.printf("WDP: Invalid header - %s\n", error);
+      displayStatus("WDP invalid", fromLine, sizeLine, "Ignoring...");
+      return;
+    }
+    
+    const uint8_t* payload = data + hdrLen;
+    size_t payloadLen = len - hdrLen;
     
     // Check if this is a concatenated message
-    uint8_t refNum, totalParts, currentPart;
-    if (parseConcatUDH(data, len, refNum, totalParts, currentPart, udh)) {
+    if (hdr.concat) {
+      uint8_t refNum = hdr.refNum;
+      uint8_t totalParts = hdr.totalParts;
+      uint8_t currentPart = hdr.part;
       Serial.printf("WDP: Concatenated message part %d/%d (ref: %d)\n", currentPart, totalParts, refNum);
       
       // Display status: multi-part message receiving
       char partLine[32];
-      snprintf(partLine, sizeof(partLine), "Part %d/%d (%dB)", currentPart, totalParts, (int)(len - 12));
+      snprintf(partLine, sizeof(partLine), "Part %d/%d (%dB)", currentPart, totalParts, (int)payloadLen);
       displayStatus("WDP Multi-Recv", fromLine, partLine, sizeLine);
       
-      // Find or create concat message entry
-      ConcatMessage* concat = nullptr;
-      for (int i = 0; i < MAX_CONCAT_MESSAGES; i++) {
-        if (concatMessages[i].active && 
-            concatMessages[i].refNum == refNum &&
-            concatMessages[i].senderMeshId == from) {
-          concat = &concatMessages[i];
-          break;
-        }
-      }
-      
-      if (!concat) {
-        // Create new concat entry
-        for (int i = 0; i < MAX_CONCAT_MESSAGES; i++) {
-          if (!concatMessages[i].active) {
-            concat = &concatMessages[i];
-            concat->active = true;
-            concat->refNum = refNum;
-            concat->totalParts = totalParts;
-            concat->receivedParts = 0;
-            concat->sourcePort = udh.source;
-            concat->destPort = udh.dest;
-            concat->senderMeshId = from;
-            memset(concat->partReceived, 0, sizeof(concat->partReceived));
-            memset(concat->data, 0, sizeof(concat->data));
-            break;
-          }
-        }
-      }
-      
-      if (!concat) {
+      // Store this part, parts may arrive out of order
+      WDPMeshReassembler::Message* concat;
+      WDPReassemblyStatus status = reassembler.addPart(from, hdr,
+                                                       payload, payloadLen, millis(), &concat);
+      if (status == WDP_REASSEMBLY_NO_SLOT) {
         Serial.println("WDP: No free concat message slots");
         return;
       }
-      
-      // Store this part (using hex-decoded binary payload size)
-      if (currentPart > 0 && currentPart <= 16 && !(concat->partReceived[currentPart - 1])) {
-        size_t partPayloadLen = len - 12;  // Subtract concat UDH size
-        size_t offset = (currentPart - 1) * (MESHCORE_MAX_BINARY_PAYLOAD - 12);
-        
-        if (offset + partPayloadLen < sizeof(concat->data)) {
-          memcpy(&concat->data[offset], &data[12], partPayloadLen);
-          concat->partSizes[currentPart - 1] = partPayloadLen;
-          concat->partReceived[currentPart - 1] = 1;
-          concat->receivedParts++;
-          concat->lastUpdate = millis();
-        }
+      if (status == WDP_REASSEMBLY_OVERFLOW) {
+        Serial.printf("WDP: Concat message too large (max %d bytes), dropping\n", WDP_REASSEMBLY_BUFFER_SIZE);
+        reassembler.release(concat);
+        return;
       }
       
       // Check if complete
-      if (concat->receivedParts == concat->totalParts) {
+      if (status == WDP_REASSEMBLY_COMPLETE) {
         Serial.printf("WDP: Concat message complete, forwarding to UDP\n");
         
-        // Calculate total size
-        size_t totalSize = 0;
-        for (int i = 0; i < concat->totalParts; i++) {
-          totalSize += concat->partSizes[i];
-        }
+        // Put the parts in order
+        size_t totalSize = reassembler.assemble(concat);
         
         char completeLine[32];
         snprintf(completeLine, sizeof(completeLine), "Complete: %dB", (int)totalSize);
@@ -258,28 +659,20 @@ public:
         snprintf(partsInfo, sizeof(partsInfo), "%d parts received", concat->totalParts);
         displayStatus("WDP Multi-Recv", fromLine, completeLine, partsInfo);
         
-        forwardToWAPBox(concat->senderMeshId, concat->sourcePort, concat->destPort, 
-                        concat->data, totalSize);
-        clearConcatMessage(concat);
+        forwardToWAPBox(from, concat->srcPort, concat->dstPort, concat->data, totalSize);
+        reassembler.release(concat);
       }
       return;
     }
     
     // Simple (non-concatenated) message
-    if (!parseUDH(data, len, udh)) {
-      return;
-    }
-    
-    payload = data + 7;  // Skip UDH
-    payloadLen = len - 7;
-    
     displayStatus("WDP Received", fromLine, sizeLine, "Forwarding...");
     
-    forwardToWAPBox(from, udh.source, udh.dest, payload, payloadLen);
+    forwardToWAPBox(from, hdr.srcPort, hdr.dstPort, payload, payloadLen);
   }
   
   // Forward WDP payload to WAPBox via UDP
-  void forwardToWAPBox(const String& from, uint16_t srcPort, uint16_t dstPort, 
+  void forwardToWAPBox(MeshNodeId from, uint16_t srcPort, uint16_t dstPort, 
                        const uint8_t* payload, size_t len) {
     Serial.printf("WDP: Forwarding %d bytes to %s:%d (client src port: %d)\n", 
                   len, wapBoxHost.c_str(), dstPort, srcPort);
@@ -289,8 +682,8 @@ public:
       if (pendingConnections[i].active && 
           pendingConnections[i].clientSourcePort == srcPort &&
           pendingConnections[i].meshRecipient == from) {
-        Serial.printf("WDP: Ignoring duplicate request from %s (port %d already pending in slot %d)\n", 
-                      from.c_str(), srcPort, i);
+        Serial.printf("WDP: Ignoring duplicate request from %08lx (port %d already pending in slot %d)\n", 
+                      (unsigned long)from, srcPort, i);
         // Update timestamp to extend timeout for active transaction
         pendingConnections[i].timestamp = millis();
         return;
@@ -331,8 +724,8 @@ public:
           pendingCount++;
         }
       }
-      Serial.printf("WDP: Stored pending connection in slot %d (client port: %d -> mesh: %s, %d pending for port %d)\n", 
-                    slot, srcPort, from.c_str(), pendingCount, dstPort);
+      Serial.printf("WDP: Stored pending connection in slot %d (client port: %d -> mesh: %08lx, %d pending for port %d)\n", 
+                    slot, srcPort, (unsigned long)from, pendingCount, dstPort);
       
       // Send UDP packet to WAPBox from clientSourcePort
       IPAddress wapIP;
@@ -349,89 +742,57 @@ public:
     }
   }
   
-  // Generate UDH and fragment data for MeshCore transmission
-  // Note: Data will be Base91-encoded when sent, limiting binary payload to 120 bytes
-  void sendWDPViaMesh(const String& to, uint16_t srcPort, uint16_t dstPort, 
-                      const uint8_t* data, size_t len) {
-    const size_t maxPayloadSimple = MESHCORE_MAX_BINARY_PAYLOAD - 7;   // Simple UDH is 7 bytes = 114 bytes payload
-    const size_t maxPayloadConcat = MESHCORE_MAX_BINARY_PAYLOAD - 12;  // Concat UDH is 12 bytes = 109 bytes payload
-    
-    // Display status: sending reply
+  // Plan the WDP messages for a response read into slot r, they are sent by pumpResponses()
+  // Note: Data will be Base91-encoded or COBS-framed when sent, depending on what
+  // the recipient supports, parts are sized to fill each message exactly
+  // The send callback queues each part, they go out paced by the recipient's ACKs
+  void sendWDPViaMesh(RetainedResponse* r, MeshNodeId to, uint16_t srcPort, uint16_t dstPort, size_t len) {
     char toLine[32];
-    snprintf(toLine, sizeof(toLine), "To: %.20s", to.c_str());
+    snprintf(toLine, sizeof(toLine), "To: %08lx", (unsigned long)to);
     
-    if (len <= maxPayloadSimple) {
-      // Simple message (no fragmentation needed)
-      uint8_t msg[MESHCORE_MAX_BINARY_PAYLOAD];
-      msg[0] = 0x06;  // UDH length
-      msg[1] = 0x05;  // Application Port Addressing, 16-bit
-      msg[2] = 0x04;  // Length of port data
-      msg[3] = (dstPort >> 8) & 0xFF;
-      msg[4] = dstPort & 0xFF;
-      msg[5] = (srcPort >> 8) & 0xFF;
-      msg[6] = srcPort & 0xFF;
-      memcpy(&msg[7], data, len);
-      
-      char sizeLine[32];
-      snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)(7 + len));
+    // Parity frames per group, by how many parts this client has been losing
+    // Parts are kept short enough for their parity block to fit a message
+    bool compact = meshCompactCallback && meshCompactCallback(to);
+    int parityPerGroup = (meshFecCallback && meshFecCallback(to)) ? parityCount(to, WDP_FEC_GROUP_SIZE) : 0;
+    size_t maxPartLen = parityPerGroup ? wdpFecMaxPartLen(meshFitCallback, to) : WDP_MAX_PART_PAYLOAD;
+    if (maxPartLen == 0) {
+      parityPerGroup = 0;
+      maxPartLen = WDP_MAX_PART_PAYLOAD;
+    }
+    
+    r->len = len;
+    r->nacked = false;
+    r->parityPerGroup = 0;
+    r->parityLeft = 0;
+    r->timestamp = millis();
+    if (!wdpPlanOutgoing(r->out, meshFitCallback, compact, to, srcPort, dstPort, r->data, len, maxPartLen)) {
+      Serial.printf("WDP: Message too large to fragment (%d bytes)\n", len);
+      r->active = false;
+      return;
+    }
+    r->active = true;
+    
+    char sizeLine[32];
+    snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)len);
+    if (r->out.totalParts == 0) {
+      Serial.printf("WDP: Sending simple message (%d bytes) to %08lx\n", len, (unsigned long)to);
       displayStatus("WDP Sending", toLine, sizeLine, "Single packet");
-      
-      Serial.printf("WDP: Sending simple message (%d bytes) to %s\n", 7 + len, to.c_str());
-      if (sendMeshCallback) {
-        sendMeshCallback(to, msg, 7 + len);
-      }
-      
-      displayStatus("WDP Sent", toLine, sizeLine, "Complete!");
-    } else {
-      // Concatenated message (fragmentation needed)
-      int totalParts = (len + maxPayloadConcat - 1) / maxPayloadConcat;
-      uint8_t refNum = (millis() & 0xFF);  // Simple reference number
-      
-      char sizeLine[32];
-      snprintf(sizeLine, sizeof(sizeLine), "Size: %d bytes", (int)len);
-      char partsLine[32];
-      snprintf(partsLine, sizeof(partsLine), "Parts: %d total", totalParts);
-      displayStatus("WDP Multi-Send", toLine, sizeLine, partsLine);
-      
-      Serial.printf("WDP: Fragmenting %d bytes into %d parts\n", len, totalParts);
-      
-      for (int part = 1; part <= totalParts; part++) {
-        uint8_t msg[MESHCORE_MAX_BINARY_PAYLOAD];
-        
-        // Concatenated UDH header
-        msg[0] = 0x0B;  // UDH length
-        msg[1] = 0x00;  // Concatenation IE identifier
-        msg[2] = 0x03;  // Concatenation IE length
-        msg[3] = refNum;
-        msg[4] = (uint8_t)totalParts;
-        msg[5] = (uint8_t)part;
-        msg[6] = 0x05;  // Application Port Addressing, 16-bit
-        msg[7] = 0x04;  // Length of port data
-        msg[8] = (dstPort >> 8) & 0xFF;
-        msg[9] = dstPort & 0xFF;
-        msg[10] = (srcPort >> 8) & 0xFF;
-        msg[11] = srcPort & 0xFF;
-        
-        // Copy payload fragment
-        size_t offset = (part - 1) * maxPayloadConcat;
-        size_t partLen = (len - offset < maxPayloadConcat) ? (len - offset) : maxPayloadConcat;
-        memcpy(&msg[12], &data[offset], partLen);
-        
-        // Update display with current part progress
-        char progressLine[32];
-        snprintf(progressLine, sizeof(progressLine), "Part %d/%d (%dB)", part, totalParts, (int)(12 + partLen));
-        displayStatus("WDP Multi-Send", toLine, progressLine, sizeLine);
-        
-        Serial.printf("WDP: Sending part %d/%d (%d bytes)\n", part, totalParts, 12 + partLen);
-        if (sendMeshCallback) {
-          sendMeshCallback(to, msg, 12 + partLen);
-        }
-      }
-      
-      // Show completion status
-      char doneMsg[32];
-      snprintf(doneMsg, sizeof(doneMsg), "Sent %dB in %d parts", (int)len, totalParts);
-      displayStatus("WDP Multi-Send", toLine, "Complete!", doneMsg);
+      return;
+    }
+    
+    // Fixed fallback parts may be too long for a parity block
+    if (r->out.partLens[0] > maxPartLen) {
+      parityPerGroup = 0;
+    }
+    r->parityPerGroup = parityPerGroup;
+    
+    char partsLine[32];
+    snprintf(partsLine, sizeof(partsLine), "Parts: %d total", r->out.totalParts);
+    displayStatus("WDP Multi-Send", toLine, sizeLine, partsLine);
+    
+    Serial.printf("WDP: Fragmenting %d bytes into %d parts\n", len, r->out.totalParts);
+    if (parityPerGroup > 0) {
+      Serial.printf("WDP: Adding %d parity frame(s) per %d parts\n", parityPerGroup, WDP_FEC_GROUP_SIZE);
     }
   }
   
@@ -441,10 +802,17 @@ public:
     for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
       if (!pendingConnections[i].active) continue;
       
+      // Replies wait in the socket until a response slot is free for them
+      RetainedResponse* slot = responseSlot(pendingConnections[i].meshRecipient,
+                                            pendingConnections[i].clientSourcePort);
+      if (!slot) continue;
+      
       int packetSize = pendingConnections[i].udpSocket.parsePacket();
       if (packetSize > 0) {
-        uint8_t buffer[1500];
-        int len = pendingConnections[i].udpSocket.read(buffer, sizeof(buffer));
+        // The previous response in the slot is done with, the reply replaces it
+        dropRetainedResponse(slot);
+        uint8_t* buffer = slot->data;
+        int len = pendingConnections[i].udpSocket.read(buffer, sizeof(slot->data));
         
         if (len > 0) {
           IPAddress remoteIP = pendingConnections[i].udpSocket.remoteIP();
@@ -462,22 +830,22 @@ public:
           Serial.println();
           
           // Response received on this connection's socket - we know exactly which client it's for
-          String meshRecipient = pendingConnections[i].meshRecipient;
+          MeshNodeId meshRecipient = pendingConnections[i].meshRecipient;
           uint16_t srcPort = remotePort;
           uint16_t dstPort = pendingConnections[i].clientSourcePort;
           
-          Serial.printf("WDP: Matched pending connection slot %d (client port: %d, mesh: %s)\n",
-                        i, dstPort, meshRecipient.c_str());
+          Serial.printf("WDP: Matched pending connection slot %d (client port: %d, mesh: %08lx)\n",
+                        i, dstPort, (unsigned long)meshRecipient);
           
           // Display status: UDP response received from WAPBox
           char wapLine[32];
           snprintf(wapLine, sizeof(wapLine), "WAPBox: %d bytes", len);
           char recipLine[32];
-          snprintf(recipLine, sizeof(recipLine), "To: %.20s", meshRecipient.c_str());
+          snprintf(recipLine, sizeof(recipLine), "To: %08lx", (unsigned long)meshRecipient);
           displayStatus("WDP Response", wapLine, recipLine, "Relaying...");
           
-          // Generate WDP messages and send via MeshCore
-          sendWDPViaMesh(meshRecipient, srcPort, dstPort, buffer, len);
+          // Generate WDP messages, sent via MeshCore from the slot
+          sendWDPViaMesh(slot, meshRecipient, srcPort, dstPort, len);
           
           // Deactivate connection after sending response
           clearPendingConnection(&pendingConnections[i]);
@@ -495,13 +863,21 @@ public:
       }
     }
     
-    // Cleanup expired concat messages
-    for (int i = 0; i < MAX_CONCAT_MESSAGES; i++) {
-      if (concatMessages[i].active && (now - concatMessages[i].lastUpdate > 30000)) {
-        Serial.printf("WDP: Concat message %d timed out\n", concatMessages[i].refNum);
-        clearConcatMessage(&concatMessages[i]);
+    // Send what the send queue has room for
+    pumpResponses();
+    
+    // Cleanup retained responses nobody asked parts of
+    for (int i = 0; i < MAX_RETAINED_RESPONSES; i++) {
+      if (retainedResponses[i].active && (now - retainedResponses[i].timestamp > RETAINED_RESPONSE_TIMEOUT_MS)) {
+        dropRetainedResponse(&retainedResponses[i]);
       }
     }
+    
+    // Cleanup expired concat messages
+    int expired = reassembler.expire(now, 30000);
+    if (expired > 0) {
+      Serial.printf("WDP: %d concat message(s) timed out\n", expired);
+    }
   }
 };
 
@@ -512,19 +888,43 @@ void proxy_init(const char* host, uint16_t port) {
   wdpGateway = new WDPGateway(host, port);
 }
 
-void proxy_begin(std::function<void(const String&, const uint8_t*, size_t)> callback) {
+void proxy_begin(WDPSendCallback callback) {
   if (wdpGateway) {
     wdpGateway->begin(callback);
   }
 }
 
+void proxy_setMeshFitCallback(WDPFitCallback callback) {
+  if (wdpGateway) {
+    wdpGateway->setFitCallback(callback);
+  }
+}
+
+void proxy_setMeshCompactCallback(WDPCompactCallback callback) {
+  if (wdpGateway) {
+    wdpGateway->setCompactCallback(callback);
+  }
+}
+
+void proxy_setMeshFecCallback(WDPFecCallback callback) {
+  if (wdpGateway) {
+    wdpGateway->setFecCallback(callback);
+  }
+}
+
+void proxy_setMeshRoomCallback(WDPRoomCallback callback) {
+  if (wdpGateway) {
+    wdpGateway->setRoomCallback(callback);
+  }
+}
+
 void proxy_loop() {
   if (wdpGateway) {
     wdpGateway->loop();
   }
 }
 
-void proxy_handleIncomingMesh(const String& from, const uint8_t* data, size_t len) {
+void proxy_handleIncomingMesh(MeshNodeId from, const uint8_t* data, size_t len) {
   if (wdpGateway) {
     wdpGateway->handleIncomingMesh(from, data, len);
   }
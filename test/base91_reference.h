@@ -0,0 +1,142 @@
+/**
+ * base91_reference.h - Original byte-at-a-time Base91 codec
+ *
+ * Kept for the native tests and benchmark: the optimized lib/base91
+ * implementation must produce identical output.
+ */
+
+#ifndef BASE91_REFERENCE_H
+#define BASE91_REFERENCE_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Base91Reference {
+
+static const char ALPHABET[91] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
+    'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+    'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '!', '#', '$',
+    '%', '&', '(', ')', '*', '+', ',', '.', '/', ':', ';', '<', '=',
+    '>', '?', '@', '[', ']', '^', '_', '`', '{', '|', '}', '~', '-'
+};
+
+// Built from ALPHABET, -1 = invalid character
+struct DecodeTable {
+    int8_t t[256];
+    DecodeTable() {
+        for (int i = 0; i < 256; i++) t[i] = -1;
+        for (int i = 0; i < 91; i++) t[(uint8_t)ALPHABET[i]] = (int8_t)i;
+    }
+    int8_t operator[](uint8_t c) const { return t[c]; }
+};
+static const DecodeTable DECODE_TABLE;
+
+inline size_t encode(const uint8_t* input, size_t inputLen, 
+                     char* output, size_t outputMaxLen) {
+    if (input == nullptr || output == nullptr || outputMaxLen == 0) {
+        return 0;
+    }
+    
+    size_t outPos = 0;
+    uint32_t queue = 0;
+    int numBits = 0;
+    
+    for (size_t i = 0; i < inputLen; i++) {
+        queue |= ((uint32_t)input[i]) << numBits;
+        numBits += 8;
+        
+        if (numBits > 13) {
+            // Extract 13 bits and encode as 2 characters
+            uint32_t val = queue & 8191;  // 8191 = 2^13 - 1
+            
+            if (val > 88) {
+                queue >>= 13;
+                numBits -= 13;
+            } else {
+                // For small values, use 14 bits for better encoding
+                val = queue & 16383;  // 16383 = 2^14 - 1
+                queue >>= 14;
+                numBits -= 14;
+            }
+            
+            if (outPos + 2 > outputMaxLen - 1) {  // -1 for null terminator
+                return 0;  // Buffer too small
+            }
+            
+            output[outPos++] = Base91Reference::ALPHABET[val % 91];
+            output[outPos++] = Base91Reference::ALPHABET[val / 91];
+        }
+    }
+    
+    // Handle remaining bits
+    if (numBits > 0) {
+        if (outPos + 1 > outputMaxLen - 1) {
+            return 0;
+        }
+        output[outPos++] = Base91Reference::ALPHABET[queue % 91];
+        
+        if (numBits > 7 || queue > 90) {
+            if (outPos + 1 > outputMaxLen - 1) {
+                return 0;
+            }
+            output[outPos++] = Base91Reference::ALPHABET[queue / 91];
+        }
+    }
+    
+    output[outPos] = '\0';
+    return outPos;
+}
+
+inline size_t decode(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    if (input == nullptr || output == nullptr || outputMaxLen == 0) {
+        return 0;
+    }
+    
+    size_t outPos = 0;
+    uint32_t queue = 0;
+    int numBits = 0;
+    int val = -1;
+    
+    for (size_t i = 0; i < inputLen; i++) {
+        int8_t d = Base91Reference::DECODE_TABLE[input[i]];
+        if (d == -1) {
+            continue;  // Skip invalid characters
+        }
+        
+        if (val == -1) {
+            val = d;
+        } else {
+            val += d * 91;
+            queue |= ((uint32_t)val) << numBits;
+            numBits += (val & 8191) > 88 ? 13 : 14;
+            
+            while (numBits >= 8) {
+                if (outPos >= outputMaxLen) {
+                    return 0;  // Buffer too small
+                }
+                output[outPos++] = (uint8_t)(queue & 0xFF);
+                queue >>= 8;
+                numBits -= 8;
+            }
+            
+            val = -1;
+        }
+    }
+    
+    // Handle remaining value
+    if (val != -1) {
+        if (outPos >= outputMaxLen) {
+            return 0;
+        }
+        output[outPos++] = (uint8_t)((queue | ((uint32_t)val << numBits)) & 0xFF);
+    }
+    
+    return outPos;
+}
+
+} // namespace Base91Reference
+
+#endif // BASE91_REFERENCE_H
@@ -0,0 +1,84 @@
+/**
+ * bench_base91.cpp - Base91 throughput benchmark (optimized vs byte-at-a-time)
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -O2 -I lib/base91 -I test test/bench_base91.cpp lib/base91/base91.cpp -o bench_base91 && ./bench_base91
+ *
+ * The input is the WMLC corpus repeated, so the mix of 13/14-bit pairs
+ * matches real proxy replies rather than uniform random bytes.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+#include "base91.h"
+#include "base91_reference.h"
+#include "wap_corpus.h"
+
+// Frame-sized chunks, as sendWDPToMesh encodes them
+static const size_t CHUNK = 130;
+static const size_t TOTAL = 4 * 1024 * 1024;
+
+typedef size_t (*EncodeFn)(const uint8_t*, size_t, char*, size_t);
+typedef size_t (*DecodeFn)(const uint8_t*, size_t, uint8_t*, size_t);
+
+static size_t decodeNew(const uint8_t* input, size_t inputLen, uint8_t* output, size_t outputMaxLen) {
+    return Base91::decode((const char*)input, inputLen, output, outputMaxLen);
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double benchEncode(EncodeFn encode, const std::vector<uint8_t>& data, size_t* sink) {
+    char out[CHUNK * 2];
+    auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off + CHUNK <= data.size(); off += CHUNK) {
+        *sink += encode(&data[off], CHUNK, out, sizeof(out));
+    }
+    return data.size() / seconds(start) / 1e6;
+}
+
+static double benchDecode(DecodeFn decode, const std::vector<uint8_t>& text, size_t textChunk, size_t* sink) {
+    uint8_t out[CHUNK * 2];
+    auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off + textChunk <= text.size(); off += textChunk) {
+        *sink += decode(&text[off], textChunk, out, sizeof(out));
+    }
+    return text.size() / seconds(start) / 1e6;
+}
+
+int main() {
+    std::vector<uint8_t> data;
+    while (data.size() < TOTAL) {
+        for (size_t i = 0; i < wap_corpus_count; i++) {
+            data.insert(data.end(), wap_corpus[i].pdu, wap_corpus[i].pdu + wap_corpus[i].pduLen);
+        }
+    }
+    data.resize(TOTAL);
+
+    // Encoded text in fixed-width chunks (worst-case length, padded with skipped spaces)
+    const size_t textChunk = Base91::encodedSize(CHUNK);
+    std::vector<uint8_t> text(TOTAL / CHUNK * textChunk, ' ');
+    for (size_t off = 0, t = 0; off + CHUNK <= data.size(); off += CHUNK, t += textChunk) {
+        char out[CHUNK * 2];
+        size_t n = Base91::encode(&data[off], CHUNK, out, sizeof(out));
+        memcpy(&text[t], out, n);
+    }
+
+    size_t sink = 0;
+    printf("Base91 throughput, %zu KB in %zu-byte chunks\n", TOTAL / 1024, CHUNK);
+    for (int round = 0; round < 3; round++) {
+        double encRef = benchEncode(Base91Reference::encode, data, &sink);
+        double encNew = benchEncode(Base91::encode, data, &sink);
+        double decRef = benchDecode(Base91Reference::decode, text, textChunk, &sink);
+        double decNew = benchDecode(decodeNew, text, textChunk, &sink);
+        printf("  encode: reference %7.1f MB/s, optimized %7.1f MB/s (%.2fx)\n", encRef, encNew, encNew / encRef);
+        printf("  decode: reference %7.1f MB/s, optimized %7.1f MB/s (%.2fx)\n", decRef, decNew, decNew / decRef);
+    }
+    printf("(checksum %zu)\n", sink);
+    return 0;
+}
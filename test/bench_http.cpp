@@ -0,0 +1,162 @@
+/**
+ * bench_http.cpp - HTTP request parsing benchmark (incremental parser vs String lines)
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -O2 -I lib/http -I test test/bench_http.cpp -o bench_http && ./bench_http
+ *
+ * The reference is the AP's former parseHTTPRequest with std::string standing
+ * in for Arduino String: each line built with += per byte, then substring,
+ * lower-casing and trimming. Heap allocations are counted for both.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <new>
+#include <string>
+
+#include "http_request_parser.h"
+#include "http_corpus.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+static const int ROUNDS = 20000;
+
+// TCP segment sized reads, as the AP takes them off the socket
+static const size_t CHUNK = 64;
+
+struct ReferenceRequest {
+    char method[16];
+    char path[256];
+    char host[128];
+    char contentType[64];
+    size_t contentLength;
+};
+
+static bool readLine(const char* data, size_t len, size_t& pos, std::string& line) {
+    if (pos >= len) {
+        return false;
+    }
+    line = "";
+    while (pos < len) {
+        char c = data[pos++];
+        if (c == '\n') break;
+        if (c != '\r') line += c;
+    }
+    return true;
+}
+
+static void trim(std::string& s) {
+    size_t from = s.find_first_not_of(" \t");
+    size_t to = s.find_last_not_of(" \t");
+    s = (from == std::string::npos) ? "" : s.substr(from, to - from + 1);
+}
+
+static bool parseReference(const char* data, size_t len, ReferenceRequest* req) {
+    memset(req, 0, sizeof(*req));
+    std::string requestLine;
+    size_t pos = 0;
+    readLine(data, len, pos, requestLine);
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        return false;
+    }
+    std::string method = requestLine.substr(0, firstSpace);
+    std::string path = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    strncpy(req->method, method.c_str(), sizeof(req->method) - 1);
+    strncpy(req->path, path.c_str(), sizeof(req->path) - 1);
+
+    std::string line;
+    while (readLine(data, len, pos, line)) {
+        if (line.length() == 0) {
+            break;
+        }
+        size_t colonPos = line.find(':');
+        if (colonPos != std::string::npos && colonPos > 0) {
+            std::string headerName = line.substr(0, colonPos);
+            std::string headerValue = line.substr(colonPos + 1);
+            trim(headerValue);
+            std::transform(headerName.begin(), headerName.end(), headerName.begin(), ::tolower);
+            if (headerName == "host") {
+                strncpy(req->host, headerValue.c_str(), sizeof(req->host) - 1);
+            } else if (headerName == "content-type") {
+                strncpy(req->contentType, headerValue.c_str(), sizeof(req->contentType) - 1);
+            } else if (headerName == "content-length") {
+                req->contentLength = atoi(headerValue.c_str());
+            }
+        }
+    }
+    return true;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    size_t corpusBytes = 0;
+    for (size_t i = 0; i < http_corpus_count; i++) {
+        corpusBytes += strlen(http_corpus[i].raw);
+    }
+
+    static HttpRequestParser<512> parser;
+    static ReferenceRequest reference;
+    size_t sink = 0;
+
+    printf("HTTP request parsing, %zu corpus requests (%zu bytes) x %d\n",
+           http_corpus_count, corpusBytes, ROUNDS);
+    for (int round = 0; round < 3; round++) {
+        allocations = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (size_t i = 0; i < http_corpus_count; i++) {
+                const char* raw = http_corpus[i].raw;
+                parseReference(raw, strlen(raw), &reference);
+                sink += strlen(reference.host);
+            }
+        }
+        double refTime = seconds(start);
+        size_t refAllocs = allocations;
+
+        allocations = 0;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (size_t i = 0; i < http_corpus_count; i++) {
+                const char* raw = http_corpus[i].raw;
+                size_t len = strlen(raw);
+                parser.reset();
+                for (size_t off = 0; off < len; off += CHUNK) {
+                    parser.feed((const uint8_t*)raw + off, len - off < CHUNK ? len - off : CHUNK);
+                }
+                sink += strlen(parser.host());
+            }
+        }
+        double newTime = seconds(start);
+        size_t newAllocs = allocations;
+
+        double requests = (double)ROUNDS * http_corpus_count;
+        printf("  String lines: %7.0f k req/s, %5.1f allocations/req\n",
+               requests / refTime / 1e3, refAllocs / requests);
+        printf("  incremental:  %7.0f k req/s, %5.1f allocations/req (%.1fx, %zu-byte chunks)\n",
+               requests / newTime / 1e3, newAllocs / requests, refTime / newTime, CHUNK);
+    }
+    printf("(checksum %zu)\n", sink);
+    return 0;
+}
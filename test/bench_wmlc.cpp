@@ -0,0 +1,63 @@
+/**
+ * bench_wmlc.cpp - WMLC decompile throughput benchmark
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -O2 -I. -I lib/wap -I test test/bench_wmlc.cpp lib/wap/wap_request.cpp \
+ *       lib/wap/wap_response.cpp lib/wap/wsp_reply_parser.cpp lib/wap/wmlc_decompiler.cpp -o bench_wmlc && ./bench_wmlc
+ *
+ * Built with -DWMLC_LINEAR_LOOKUP the decompiler searches the token lists
+ * for every tag and attribute (the former lookups), without it it indexes the
+ * generated tables; `just bench-wmlc` runs both. The input is the WMLC bodies
+ * of the reference corpus, decompiled into a buffer as the AP does.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "wap_response.h"
+#include "wmlc_decompiler.h"
+#include "wap_corpus.h"
+
+static const int ROUNDS = 20000;
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+#ifdef WMLC_LINEAR_LOOKUP
+    const char* lookup = "linear search";
+#else
+    const char* lookup = "direct-indexed";
+#endif
+
+    static HTTPResponse pages[16];
+    size_t wmlcBytes = 0;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        WAPResponse::decode(wap_corpus[i].pdu, wap_corpus[i].pduLen, &pages[i]);
+        wmlcBytes += pages[i].bodyLen;
+    }
+
+    static char out[16384];
+    size_t sink = 0;
+    printf("WMLC decompile, %zu corpus pages (%zu bytes WMLC) x %d, %s token tables\n",
+           wap_corpus_count, wmlcBytes, ROUNDS, lookup);
+    for (int round = 0; round < 3; round++) {
+        size_t wmlBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (size_t i = 0; i < wap_corpus_count; i++) {
+                wmlBytes += WMLCDecompiler::decompile(pages[i].body, pages[i].bodyLen, out, sizeof(out));
+                sink += (uint8_t)out[wmlBytes % 64];
+            }
+        }
+        double elapsed = seconds(start);
+        double decoded = (double)ROUNDS * wap_corpus_count;
+        printf("  %7.1f k pages/s, %6.1f MB/s WMLC in, %6.1f MB/s WML out\n",
+               decoded / elapsed / 1e3, wmlcBytes * (double)ROUNDS / elapsed / 1e6, wmlBytes / elapsed / 1e6);
+    }
+    printf("(checksum %zu)\n", sink);
+    return 0;
+}
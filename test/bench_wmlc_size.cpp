@@ -0,0 +1,61 @@
+/**
+ * bench_wmlc_size.cpp - WML compiler output size benchmark
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -O2 -I. -I lib/wap -I test test/bench_wmlc_size.cpp lib/wap/wap_request.cpp \
+ *       lib/wap/wap_response.cpp lib/wap/wsp_reply_parser.cpp lib/wap/wmlc_decompiler.cpp \
+ *       lib/wap/wmlc_compiler.cpp -o bench_wmlc_size && ./bench_wmlc_size
+ *
+ * Compiles the WML source of every reference corpus page and compares the
+ * WMLC size with the body the gateway sent for it (strings inline, no string
+ * table), and with the WML text itself. Each compiled page is decompiled again
+ * to check it still reads as its source.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "wap_response.h"
+#include "wmlc_compiler.h"
+#include "wmlc_decompiler.h"
+#include "wap_corpus.h"
+
+int main() {
+    static WMLCCompiler compiler;
+    static uint8_t wmlc[8192];
+    static char text[16384];
+    size_t totalWml = 0, totalGateway = 0, totalCompiled = 0;
+    bool allMatch = true;
+
+    printf("WML compiler output, %zu corpus pages\n", wap_corpus_count);
+    printf("  %-10s %8s %8s %8s %8s %9s %s\n", "page", "WML", "gateway", "compiled", "table", "vs gw", "round trip");
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        HTTPResponse response;
+        WAPResponse::decode(page.pdu, page.pduLen, &response);
+
+        size_t wmlLen = strlen(page.wml);
+        compiler.reset();
+        compiler.feed(page.wml, wmlLen);
+        size_t len = compiler.finish(wmlc, sizeof(wmlc));
+
+        bool match = false;
+        if (len > 0 && WMLCDecompiler::decompile(wmlc, len, text, sizeof(text)) > 0) {
+            const char* root = strstr(text, "<wml>");
+            match = root && strcmp(root, page.wml) == 0;
+        }
+        allMatch = allMatch && match;
+
+        printf("  %-10s %8zu %8zu %8zu %8zu %8.1f%% %s\n", page.name, wmlLen, response.bodyLen, len,
+               compiler.stringTableSize(), 100.0 * ((double)len - response.bodyLen) / response.bodyLen,
+               match ? "ok" : "MISMATCH");
+        totalWml += wmlLen;
+        totalGateway += response.bodyLen;
+        totalCompiled += len;
+    }
+    printf("  %-10s %8zu %8zu %8zu %8s %8.1f%%\n", "total", totalWml, totalGateway, totalCompiled, "",
+           100.0 * ((double)totalCompiled - totalGateway) / totalGateway);
+    printf("Compiled WMLC is %.1f%% of the WML text\n", 100.0 * totalCompiled / totalWml);
+    return allMatch ? 0 : 1;
+}
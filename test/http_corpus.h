@@ -0,0 +1,110 @@
+/**
+ * http_corpus.h - Browser HTTP requests for the request parser tests and benchmark
+ *
+ * Requests in the form the AP's clients send them: the headers, their order
+ * and casing follow what UC Browser, Opera Mini, a Nokia S40 WAP browser and
+ * Android's captive portal check put on the wire (proxy-style absolute URIs,
+ * lower-case names, long UA and cookie headers, bare LF line endings).
+ */
+
+#ifndef HTTP_CORPUS_H
+#define HTTP_CORPUS_H
+
+#include <cstddef>
+
+struct HttpCorpusRequest {
+    const char* name;
+    const char* raw;
+    const char* method;     // Expected parse
+    const char* path;
+    const char* host;
+};
+
+static const HttpCorpusRequest http_corpus[] = {
+    {
+        "UC Browser 9 (Android)",
+        "GET /index.wml HTTP/1.1\r\n"
+        "Host: wap.bevelgacom.be\r\n"
+        "Connection: keep-alive\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,text/vnd.wap.wml,*/*;q=0.8\r\n"
+        "User-Agent: Mozilla/5.0 (Linux; U; Android 4.0.4; en-US; GT-S5360 Build/GINGERBREAD) "
+        "AppleWebKit/534.31 (KHTML, like Gecko) UCBrowser/9.5.0.449 U3/0.8.0 Mobile Safari/534.31\r\n"
+        "X-UCBrowser-UA: dv(GT-S5360);pr(UCBrowser/9.5.0.449);ov(Android 4.0.4);ss(240*320);"
+        "pf(Linux);bt(UC);pm(1);bv(1);nm(0);im(0);sr(2);nt(2);\r\n"
+        "Accept-Encoding: gzip\r\n"
+        "Accept-Language: en-US\r\n"
+        "\r\n",
+        "GET", "/index.wml", "wap.bevelgacom.be"
+    },
+    {
+        "UC Browser 8 (J2ME, proxy request)",
+        "GET http://wap.bevelgacom.be/news.wml HTTP/1.1\r\n"
+        "HOST: wap.bevelgacom.be\r\n"
+        "USER-AGENT: UCWEB/2.0 (Java; U; MIDP-2.0; en-US; NokiaC3-00) U2/1.0.0 UCBrowser/8.3.0.154 U2/1.0.0 Mobile\r\n"
+        "ACCEPT: */*\r\n"
+        "X-UCBROWSER-DEVICE-UA: NokiaC3-00/5.0 (08.63) Profile/MIDP-2.1 Configuration/CLDC-1.1\r\n"
+        "PROXY-CONNECTION: keep-alive\r\n"
+        "\r\n",
+        "GET", "http://wap.bevelgacom.be/news.wml", "wap.bevelgacom.be"
+    },
+    {
+        "Opera Mini 4 (J2ME)",
+        "GET /weather.wml?city=Brussels HTTP/1.1\r\n"
+        "User-Agent: Opera/9.80 (J2ME/MIDP; Opera Mini/4.2.14912/870; U; en) Presto/2.4.15\r\n"
+        "Host: wap.bevelgacom.be\r\n"
+        "Accept: text/html, application/xml;q=0.9, application/xhtml+xml, image/png, image/jpeg, "
+        "image/gif, image/x-xbitmap, */*;q=0.1\r\n"
+        "Accept-Language: en\r\n"
+        "Accept-Charset: iso-8859-1, utf-8, utf-16, *;q=0.1\r\n"
+        "Accept-Encoding: deflate, gzip, x-gzip, identity, *;q=0\r\n"
+        "X-OperaMini-Features: advanced, file_system, camera, touch, folding, routing\r\n"
+        "X-OperaMini-Phone-UA: Nokia6300/2.0 (07.21) Profile/MIDP-2.0 Configuration/CLDC-1.1\r\n"
+        "X-OperaMini-Phone: Nokia # 6300\r\n"
+        "Connection: Keep-Alive, TE\r\n"
+        "TE: deflate, gzip, chunked, identity, trailers\r\n"
+        "\r\n",
+        "GET", "/weather.wml?city=Brussels", "wap.bevelgacom.be"
+    },
+    {
+        "Opera Mini 7 (Android, cookies)",
+        "GET /search.wml?q=mesh+radio HTTP/1.1\r\n"
+        "host: wap.bevelgacom.be\r\n"
+        "user-agent: Opera/9.80 (Android; Opera Mini/7.5.33361/191.306; U; en) Presto/2.12.423 Version/12.16\r\n"
+        "accept: text/html, application/xml;q=0.9, application/xhtml+xml, image/png, image/webp, "
+        "image/jpeg, image/gif, image/x-xbitmap, */*;q=0.1\r\n"
+        "accept-language: en-US,en;q=0.9\r\n"
+        "cookie: session=6f1c2d9a8b7e4f3a2c1d0e9f8a7b6c5d; prefs=lang%3Den%26theme%3Dclassic%26font%3Dsmall; "
+        "tracking=GA1.2.1234567890.1400000000; last=%2Fnews.wml%3Fpage%3D2%26sort%3Ddate\r\n"
+        "x-operamini-phone-ua: Mozilla/5.0 (Linux; Android 4.4.2; SM-G350 Build/KOT49H) "
+        "AppleWebKit/537.36 (KHTML, like Gecko) Version/4.0 Chrome/30.0.0.0 Mobile Safari/537.36\r\n"
+        "connection: keep-alive\r\n"
+        "\r\n",
+        "GET", "/search.wml?q=mesh+radio", "wap.bevelgacom.be"
+    },
+    {
+        "Nokia S40 WAP browser",
+        "GET /portal.wml HTTP/1.1\r\n"
+        "Host: wap.bevelgacom.be:80\r\n"
+        "Accept: application/vnd.wap.wmlc, application/vnd.wap.wmlscriptc, text/vnd.wap.wml, "
+        "image/vnd.wap.wbmp, image/gif, */*\r\n"
+        "Accept-Charset: utf-8\r\n"
+        "User-Agent: Nokia6230i/2.0 (03.80) Profile/MIDP-2.0 Configuration/CLDC-1.1\r\n"
+        "x-wap-profile: \"http://nds1.nds.nokia.com/uaprof/N6230ir200.xml\"\r\n"
+        "\r\n",
+        "GET", "/portal.wml", "wap.bevelgacom.be:80"
+    },
+    {
+        "Android captive portal check (bare LF)",
+        "GET /generate_204 HTTP/1.1\n"
+        "Host: connectivitycheck.gstatic.com\n"
+        "User-Agent: Dalvik/2.1.0 (Linux; U; Android 9; Pixel 3 Build/PQ3A.190801.002)\n"
+        "Connection: Keep-Alive\n"
+        "Accept-Encoding: gzip\n"
+        "\n",
+        "GET", "/generate_204", "connectivitycheck.gstatic.com"
+    },
+};
+
+static const size_t http_corpus_count = sizeof(http_corpus) / sizeof(http_corpus[0]);
+
+#endif // HTTP_CORPUS_H
@@ -2,7 +2,7 @@
  * test_base91.cpp - Unit tests for Base91 encoding/decoding
  * 
  * Compile and run with:
- *   g++ -std=c++11 -I lib/base91 test/test_base91.cpp lib/base91/base91.cpp -o test_base91 && ./test_base91
+ *   g++ -std=c++11 -I lib/base91 -I test test/test_base91.cpp lib/base91/base91.cpp -o test_base91 && ./test_base91
  */
 
 #include <cstdio>
@@ -11,6 +11,12 @@
 #include <cstdint>
 
 #include "base91.h"
+#include "base91_reference.h"
+#include "wap_corpus.h"
+
+// Mirrors the frame limits in src/main.cpp
+#define MESHCORE_MAX_BYTES           150
+#define MESHCORE_MAX_BINARY_PAYLOAD  120
 
 static int tests_passed = 0;
 static int tests_failed = 0;
@@ -184,6 +190,252 @@ void testMeshCoreCompatibility() {
     printf("\n");
 }
 
+void testFit() {
+    printf("\n=== Test: Exact Fit ===\n");
+    
+    srand(13);
+    uint8_t input[256];
+    char encoded[512];
+    bool exact = true;
+    bool neverWorse = true;
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t len = 1 + rand() % sizeof(input);
+        int zeroChance = rand() % 3;  // WMLC is full of zeros and small tokens
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (zeroChance && rand() % (zeroChance * 4) == 0) ? 0x00 : (uint8_t)(rand() % 256);
+        }
+        size_t budget = 1 + rand() % (MESHCORE_MAX_BYTES - 1);
+        size_t n = Base91::fit(input, len, budget);
+        
+        // The prefix fits, one more byte does not
+        size_t encodedLen = n ? Base91::encode(input, n, encoded, sizeof(encoded)) : 0;
+        if (encodedLen > budget) exact = false;
+        if (n < len && Base91::encode(input, n + 1, encoded, sizeof(encoded)) <= budget) exact = false;
+        
+        // Never less than the worst-case ratio
+        size_t worstCase = (budget * 13) / 16;
+        if (n < (len < worstCase ? len : worstCase)) neverWorse = false;
+    }
+    TEST_ASSERT(exact, "fit() returns the longest prefix within the budget");
+    TEST_ASSERT(neverWorse, "fit() is never below the worst-case 13/16 ratio");
+    
+    TEST_ASSERT(Base91::fit(input, 0, 10) == 0, "Empty input fits in 0 bytes");
+    TEST_ASSERT(Base91::fit(input, 10, 0) == 0, "Nothing fits in 0 chars");
+    TEST_ASSERT(Base91::fit(nullptr, 10, 10) == 0, "Null input returns 0");
+}
+
+void testLengthDelimitedAndInPlace() {
+    printf("\n=== Test: Length-Delimited and In-Place Decode ===\n");
+    
+    srand(7);
+    uint8_t input[200];
+    char encoded[300];
+    uint8_t decoded[200];
+    uint8_t buffer[300];
+    bool delimitedOk = true;
+    bool inPlaceOk = true;
+    for (int iter = 0; iter < 500; iter++) {
+        size_t len = 1 + rand() % sizeof(input);
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (rand() % 3 == 0) ? 0x00 : (uint8_t)(rand() % 256);
+        }
+        size_t encodedLen = Base91::encode(input, len, encoded, sizeof(encoded));
+        
+        // Garbage after the delimited length must be ignored
+        encoded[encodedLen] = 'X';
+        size_t n = Base91::decode(encoded, encodedLen, decoded, sizeof(decoded));
+        if (n != len || memcmp(input, decoded, len) != 0) delimitedOk = false;
+        
+        memcpy(buffer, encoded, encodedLen);
+        n = Base91::decodeInPlace(buffer, encodedLen);
+        if (n != len || memcmp(input, buffer, len) != 0) inPlaceOk = false;
+    }
+    TEST_ASSERT(delimitedOk, "Length-delimited decode matches input");
+    TEST_ASSERT(inPlaceOk, "In-place decode matches input");
+    
+    uint8_t raw[] = {0x06, 0x05, 0x04, 0x00, 0xF0, 0x22, 0x5C};  // No Base91 characters
+    uint8_t copy[sizeof(raw)];
+    memcpy(copy, raw, sizeof(raw));
+    TEST_ASSERT(Base91::decodeInPlace(raw, sizeof(raw)) == 0, "In-place decode of non-Base91 fails");
+    TEST_ASSERT(memcmp(raw, copy, sizeof(raw)) == 0, "Failed in-place decode leaves buffer untouched");
+}
+
+void testMatchesReference() {
+    printf("\n=== Test: Identical To Byte-At-A-Time Codec ===\n");
+    
+    srand(91);
+    uint8_t input[600];
+    char encoded[800];
+    char refEncoded[800];
+    uint8_t decoded[600];
+    uint8_t refDecoded[600];
+    bool encodeSame = true;
+    bool decodeSame = true;
+    for (int iter = 0; iter < 3000; iter++) {
+        size_t len = rand() % sizeof(input);
+        int zeroChance = rand() % 4;  // Runs of zeros exercise the 14-bit pairs
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (zeroChance && rand() % (zeroChance * 2) == 0) ? 0x00 : (uint8_t)(rand() % 256);
+        }
+        size_t n = Base91::encode(input, len, encoded, sizeof(encoded));
+        size_t refN = Base91Reference::encode(input, len, refEncoded, sizeof(refEncoded));
+        if (n != refN || memcmp(encoded, refEncoded, n + 1) != 0) encodeSame = false;
+        
+        // Decode the text plus some noise characters that must be skipped
+        if (n > 4) encoded[rand() % n] = (char)(rand() % 2 ? ' ' : '\\');
+        n = Base91::decode(encoded, n, decoded, sizeof(decoded));
+        refN = Base91Reference::decode((const uint8_t*)encoded, strlen(encoded), refDecoded, sizeof(refDecoded));
+        if (n != refN || memcmp(decoded, refDecoded, n) != 0) decodeSame = false;
+    }
+    
+    // Every 14-bit value, including the ones past the 8192-entry pair table
+    for (uint32_t v = 0; v < 16384 && encodeSame; v++) {
+        uint8_t bytes[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+        size_t n = Base91::encode(bytes, 2, encoded, sizeof(encoded));
+        size_t refN = Base91Reference::encode(bytes, 2, refEncoded, sizeof(refEncoded));
+        if (n != refN || memcmp(encoded, refEncoded, n + 1) != 0) encodeSame = false;
+    }
+    
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        char pageEncoded[2048];
+        char pageRefEncoded[2048];
+        size_t n = Base91::encode(wap_corpus[i].pdu, wap_corpus[i].pduLen, pageEncoded, sizeof(pageEncoded));
+        size_t refN = Base91Reference::encode(wap_corpus[i].pdu, wap_corpus[i].pduLen, pageRefEncoded, sizeof(pageRefEncoded));
+        if (n == 0 || n != refN || memcmp(pageEncoded, pageRefEncoded, n) != 0) encodeSame = false;
+    }
+    
+    TEST_ASSERT(encodeSame, "Encoder output identical to reference");
+    TEST_ASSERT(decodeSame, "Decoder output identical to reference");
+    
+    // Buffer limits behave the same
+    uint8_t data[40];
+    memset(data, 0xA5, sizeof(data));
+    bool limitsSame = true;
+    for (size_t max = 1; max < 60; max++) {
+        if (Base91::encode(data, sizeof(data), encoded, max) != Base91Reference::encode(data, sizeof(data), refEncoded, max)) limitsSame = false;
+    }
+    size_t n = Base91::encode(data, sizeof(data), encoded, sizeof(encoded));
+    for (size_t max = 1; max < 45; max++) {
+        if (Base91::decode(encoded, n, decoded, max) != Base91Reference::decode((const uint8_t*)encoded, n, refDecoded, max)) limitsSame = false;
+    }
+    TEST_ASSERT(limitsSame, "Output buffer limits identical to reference");
+}
+
+void testStreaming() {
+    printf("\n=== Test: Streaming Encoder/Decoder ===\n");
+    
+    srand(2);
+    uint8_t input[300];
+    char encoded[512];
+    char streamed[512];
+    uint8_t decoded[300];
+    bool encodeSame = true;
+    bool decodeSame = true;
+    bool countSame = true;
+    bool fitSame = true;
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t len = 1 + rand() % sizeof(input);
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (rand() % 3 == 0) ? 0x00 : (uint8_t)(rand() % 256);
+        }
+        size_t n = Base91::encode(input, len, encoded, sizeof(encoded));
+        
+        // Encode in random slices, like a UDH followed by a payload fragment
+        Base91::Encoder encoder(streamed, sizeof(streamed));
+        Base91::Encoder counter(nullptr, 0);
+        for (size_t off = 0; off < len; ) {
+            size_t slice = 1 + rand() % 16;
+            if (slice > len - off) slice = len - off;
+            encoder.update(&input[off], slice);
+            counter.update(&input[off], slice);
+            off += slice;
+        }
+        size_t streamedLen = encoder.finish();
+        if (streamedLen != n || memcmp(encoded, streamed, n + 1) != 0) encodeSame = false;
+        if (counter.finish() != n) countSame = false;
+        
+        // Fit after a header slice equals fit over the whole buffer
+        size_t hdrLen = 1 + rand() % 12;
+        if (hdrLen < len) {
+            Base91::Encoder hdr(nullptr, 0);
+            hdr.update(input, hdrLen);
+            size_t budget = 20 + rand() % 130;
+            if (hdr.fit(&input[hdrLen], len - hdrLen, budget) + hdrLen != Base91::fit(input, len, budget)) fitSame = false;
+        }
+        
+        // Decode in random slices, splitting character pairs
+        Base91::Decoder decoder(decoded, sizeof(decoded));
+        for (size_t off = 0; off < n; ) {
+            size_t slice = 1 + rand() % 16;
+            if (slice > n - off) slice = n - off;
+            decoder.update(&encoded[off], slice);
+            off += slice;
+        }
+        if (decoder.finish() != len || memcmp(input, decoded, len) != 0) decodeSame = false;
+    }
+    TEST_ASSERT(encodeSame, "Sliced Encoder output identical to encode()");
+    TEST_ASSERT(countSame, "Counting Encoder (no output) returns the same length");
+    TEST_ASSERT(fitSame, "Encoder::fit() after a header slice matches fit() on the whole message");
+    TEST_ASSERT(decodeSame, "Sliced Decoder output identical to input");
+    
+    Base91::Encoder small(encoded, 4);
+    TEST_ASSERT(!small.update(input, 10) && small.finish() == 0, "Encoder into small buffer fails");
+}
+
+// Count concat parts for a corpus page, fixed parts as before or filled with fit()
+static int countParts(const uint8_t* pdu, size_t len, bool exactFit) {
+    const size_t fixedPart = MESHCORE_MAX_BINARY_PAYLOAD - 12;
+    uint8_t msg[MESHCORE_MAX_BYTES];
+    
+    // Single message with the 7-byte UDH
+    if (len <= sizeof(msg) - 7) {
+        memset(msg, 0x05, 7);
+        memcpy(&msg[7], pdu, len);
+        size_t fits = exactFit ? Base91::fit(msg, 7 + len, MESHCORE_MAX_BYTES - 1)
+                               : MESHCORE_MAX_BINARY_PAYLOAD;
+        if (7 + len <= fits) {
+            return 1;
+        }
+    }
+    
+    int parts = 0;
+    size_t offset = 0;
+    while (offset < len) {
+        size_t partLen = (len - offset < fixedPart) ? (len - offset) : fixedPart;
+        if (exactFit) {
+            size_t chunk = len - offset;
+            if (chunk > sizeof(msg) - 12) chunk = sizeof(msg) - 12;
+            memset(msg, 0x0B, 12);  // Stand-in for the concat UDH
+            msg[1] = 0x00;
+            memcpy(&msg[12], &pdu[offset], chunk);
+            partLen = Base91::fit(msg, 12 + chunk, MESHCORE_MAX_BYTES - 1) - 12;
+        }
+        offset += partLen;
+        parts++;
+    }
+    return parts;
+}
+
+void benchmarkFitParts() {
+    printf("\n=== Benchmark: Concat Parts Per Corpus Page ===\n");
+    printf("  %-10s %6s | %6s %6s\n", "page", "bytes", "fixed", "fit");
+    
+    int totalFixed = 0;
+    int totalFit = 0;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        int fixed = countParts(page.pdu, page.pduLen, false);
+        int fitted = countParts(page.pdu, page.pduLen, true);
+        totalFixed += fixed;
+        totalFit += fitted;
+        printf("  %-10s %6zu | %6d %6d\n", page.name, page.pduLen, fixed, fitted);
+    }
+    printf("  %-10s %6s | %6d %6d (%.1f%% fewer)\n", "total", "", totalFixed, totalFit,
+           100.0 * (totalFixed - totalFit) / totalFixed);
+    
+    TEST_ASSERT(totalFit <= totalFixed, "Exact fit never needs more parts than fixed parts");
+}
+
 int main() {
     printf("======================================\n");
     printf("  Base91 Encoding Test Suite\n");
@@ -194,6 +446,11 @@ int main() {
     testWDPMessage();
     testEdgeCases();
     testMeshCoreCompatibility();
+    testFit();
+    testLengthDelimitedAndInPlace();
+    testMatchesReference();
+    testStreaming();
+    benchmarkFitParts();
     
     printf("\n======================================\n");
     printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
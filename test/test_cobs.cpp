@@ -0,0 +1,312 @@
+/**
+ * test_cobs.cpp - Unit tests and bytes-on-air benchmark for COBS framing
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -I lib/cobs -I lib/base91 -I test test/test_cobs.cpp lib/cobs/cobs.cpp lib/base91/base91.cpp -o test_cobs && ./test_cobs
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "cobs.h"
+#include "base91.h"
+#include "wap_corpus.h"
+
+// Mirrors the frame limits in src/main.cpp
+#define MESHCORE_MAX_BYTES           150
+#define MESHCORE_MAX_BINARY_PAYLOAD  120   // Base91
+#define MESHCORE_MAX_COBS_PAYLOAD    147   // COBS
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+// Roundtrip helper, returns encoded length or 0 on any mismatch
+static size_t roundtrip(const uint8_t* input, size_t len) {
+    char encoded[1024];
+    uint8_t decoded[1024];
+    size_t encodedLen = Cobs::encode(input, len, encoded, sizeof(encoded));
+    if (encodedLen == 0 || strlen(encoded) != encodedLen || !Cobs::isFrame(encoded)) {
+        return 0;
+    }
+    size_t decodedLen = Cobs::decode(encoded, decoded, sizeof(decoded));
+    if (decodedLen != len || memcmp(input, decoded, len) != 0) {
+        return 0;
+    }
+    return encodedLen;
+}
+
+void testBasicEncodeDecode() {
+    printf("\n=== Test: Basic Encode/Decode ===\n");
+
+    uint8_t input[] = {0x11, 0x22, 0x00, 0x33};
+    char encoded[32];
+    uint8_t decoded[32];
+
+    size_t encodedLen = Cobs::encode(input, sizeof(input), encoded, sizeof(encoded));
+    TEST_ASSERT(encodedLen == sizeof(input) + 1, "Encoded length is input + 1");
+    TEST_ASSERT((uint8_t)encoded[0] == 0x83 && (uint8_t)encoded[3] == 0x02, "Code bytes match COBS with frame marker");
+    TEST_ASSERT(strlen(encoded) == encodedLen, "strlen equals encodedLen (no truncation)");
+
+    size_t decodedLen = Cobs::decode(encoded, decoded, sizeof(decoded));
+    TEST_ASSERT(decodedLen == sizeof(input), "Decoded length matches");
+    TEST_ASSERT(memcmp(input, decoded, sizeof(input)) == 0, "Decoded data matches");
+}
+
+void testWDPMessage() {
+    printf("\n=== Test: Real WDP Message ===\n");
+
+    // Same WDP GET request as test_base91.cpp
+    uint8_t wdpMsg[] = {
+        0x06, 0x05, 0x04, 0x23, 0xF0, 0x1E, 0xAC,
+        0x04, 0x40, 0x19, 0x68, 0x74, 0x74, 0x70, 0x3A,
+        0x2F, 0x2F, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65,
+        0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D,
+        0x2E, 0x62, 0x65, 0x2F, 0x96, 0x77, 0x61, 0x70,
+        0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61,
+        0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x00,
+        0xA9, 0x4D, 0x41, 0x50, 0x2F, 0x31, 0x2E, 0x30, 0x00,
+        0x80, 0x80, 0x80, 0x94, 0x80, 0x88, 0x80, 0xA1, 0x81, 0xEA, 0x81, 0x84
+    };
+
+    size_t encodedLen = roundtrip(wdpMsg, sizeof(wdpMsg));
+    TEST_ASSERT(encodedLen > 0, "WDP message roundtrips");
+
+    char b91[256];
+    size_t b91Len = Base91::encode(wdpMsg, sizeof(wdpMsg), b91, sizeof(b91));
+    printf("  %zu bytes -> COBS %zu chars, Base91 %zu chars\n", sizeof(wdpMsg), encodedLen, b91Len);
+    TEST_ASSERT(encodedLen == sizeof(wdpMsg) + 1, "COBS overhead is 1 byte");
+    TEST_ASSERT(!Cobs::isFrame(b91), "Base91 text is not mistaken for a COBS frame");
+    TEST_ASSERT(!Cobs::isFrame("ping"), "Plain text is not mistaken for a COBS frame");
+}
+
+void testBlockBoundaries() {
+    printf("\n=== Test: Block Boundaries ===\n");
+
+    uint8_t input[512];
+    memset(input, 0x5A, sizeof(input));
+
+    // Lengths around the 126-byte first block and 254-byte later blocks
+    const size_t lengths[] = {1, 125, 126, 127, 128, 147, 253, 254, 380, 381, 382, 500};
+    bool allOk = true;
+    bool overheadOk = true;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        size_t len = lengths[i];
+        size_t encodedLen = roundtrip(input, len);
+        if (encodedLen == 0) {
+            printf("  length %zu failed to roundtrip\n", len);
+            allOk = false;
+        }
+        if (encodedLen > Cobs::encodedSize(len) - 1) {
+            overheadOk = false;
+        }
+    }
+    TEST_ASSERT(allOk, "Non-zero runs roundtrip across block boundaries");
+    TEST_ASSERT(overheadOk, "Encoded length within encodedSize()");
+
+    // Zeros at block edges
+    input[125] = 0x00;
+    input[126] = 0x00;
+    input[380] = 0x00;
+    TEST_ASSERT(roundtrip(input, 381) > 0, "Zero at end of block roundtrips");
+
+    uint8_t zeros[16] = {0};
+    TEST_ASSERT(roundtrip(zeros, sizeof(zeros)) == sizeof(zeros) + 1, "All zeros roundtrip with 1 byte overhead");
+}
+
+void testWorstCaseOverhead() {
+    printf("\n=== Test: Worst-Case Overhead ===\n");
+
+    // Any payload that fits MESHCORE_MAX_COBS_PAYLOAD must fit a 149 char frame
+    srand(91);
+    uint8_t input[MESHCORE_MAX_COBS_PAYLOAD];
+    size_t worst = 0;
+    bool allOk = true;
+    for (int iter = 0; iter < 2000; iter++) {
+        size_t len = 1 + rand() % MESHCORE_MAX_COBS_PAYLOAD;
+        int zeroChance = rand() % 4;  // 0 = no zeros at all
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (zeroChance && rand() % (zeroChance * 8) == 0) ? 0x00 : (uint8_t)(1 + rand() % 255);
+        }
+        size_t encodedLen = roundtrip(input, len);
+        if (encodedLen == 0) allOk = false;
+        if (encodedLen - len > worst) worst = encodedLen - len;
+    }
+    printf("  Worst overhead over 2000 random frames: %zu bytes\n", worst);
+    TEST_ASSERT(allOk, "Random frames roundtrip");
+    TEST_ASSERT(worst <= 2, "Overhead is at most 2 bytes per frame");
+    TEST_ASSERT(Cobs::maxDecodedSize(MESHCORE_MAX_BYTES - 1) == MESHCORE_MAX_COBS_PAYLOAD,
+                "maxDecodedSize(149) matches MESHCORE_MAX_COBS_PAYLOAD");
+}
+
+void testMalformed() {
+    printf("\n=== Test: Malformed Frames ===\n");
+
+    uint8_t decoded[8];
+    TEST_ASSERT(Cobs::decode("abc", decoded, sizeof(decoded)) == 0, "Unmarked text rejected");
+    TEST_ASSERT(Cobs::decode("\x80", decoded, sizeof(decoded)) == 0, "Zero code rejected");
+    TEST_ASSERT(Cobs::decode("\x85" "ab", decoded, sizeof(decoded)) == 0, "Truncated block rejected");
+    TEST_ASSERT(Cobs::decode("\x8A" "123456789", decoded, 4) == 0, "Output overflow rejected");
+
+    char small[4];
+    uint8_t input[] = {1, 2, 3, 4};
+    TEST_ASSERT(Cobs::encode(input, sizeof(input), small, sizeof(small)) == 0, "Encode into small buffer fails");
+    TEST_ASSERT(Cobs::encode(nullptr, 0, small, sizeof(small)) == 0, "Null input returns 0");
+}
+
+void testLengthDelimitedAndInPlace() {
+    printf("\n=== Test: Length-Delimited and In-Place Decode ===\n");
+
+    srand(147);
+    uint8_t input[400];
+    char encoded[512];
+    uint8_t decoded[400];
+    uint8_t buffer[512];
+    bool delimitedOk = true;
+    bool inPlaceOk = true;
+    for (int iter = 0; iter < 500; iter++) {
+        size_t len = 1 + rand() % sizeof(input);
+        int zeroChance = rand() % 4;
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (zeroChance && rand() % (zeroChance * 8) == 0) ? 0x00 : (uint8_t)(1 + rand() % 255);
+        }
+        size_t encodedLen = Cobs::encode(input, len, encoded, sizeof(encoded));
+
+        // Garbage after the delimited length must be ignored
+        encoded[encodedLen] = 'X';
+        size_t n = Cobs::decode(encoded, encodedLen, decoded, sizeof(decoded));
+        if (n != len || memcmp(input, decoded, len) != 0) delimitedOk = false;
+
+        memcpy(buffer, encoded, encodedLen);
+        n = Cobs::decodeInPlace(buffer, encodedLen);
+        if (n != len || memcmp(input, buffer, len) != 0) inPlaceOk = false;
+    }
+    TEST_ASSERT(delimitedOk, "Length-delimited decode matches input");
+    TEST_ASSERT(inPlaceOk, "In-place decode matches input (across block boundaries)");
+
+    uint8_t truncated[] = {0x85, 'a', 'b'};
+    TEST_ASSERT(Cobs::decodeInPlace(truncated, sizeof(truncated)) == 0, "In-place decode of truncated frame fails");
+    TEST_ASSERT(Cobs::decode("\x83" "ab", 2, decoded, sizeof(decoded)) == 0, "Length shorter than block rejected");
+}
+
+void testStreamingEncoder() {
+    printf("\n=== Test: Streaming Encoder ===\n");
+
+    srand(12);
+    uint8_t input[400];
+    char encoded[512];
+    char streamed[512];
+    bool same = true;
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t len = rand() % sizeof(input);
+        int zeroChance = rand() % 4;
+        for (size_t i = 0; i < len; i++) {
+            input[i] = (zeroChance && rand() % (zeroChance * 8) == 0) ? 0x00 : (uint8_t)(1 + rand() % 255);
+        }
+        size_t n = Cobs::encode(input, len, encoded, sizeof(encoded));
+
+        // Encode in random slices, like a UDH followed by a payload fragment
+        Cobs::Encoder encoder(streamed, sizeof(streamed));
+        for (size_t off = 0; off < len; ) {
+            size_t slice = 1 + rand() % 16;
+            if (slice > len - off) slice = len - off;
+            encoder.update(&input[off], slice);
+            off += slice;
+        }
+        if (encoder.finish() != n || memcmp(encoded, streamed, n + 1) != 0) same = false;
+    }
+    TEST_ASSERT(same, "Sliced Encoder output identical to encode()");
+
+    Cobs::Encoder small(encoded, 4);
+    TEST_ASSERT(!small.update(input, 10) && small.finish() == 0, "Encoder into small buffer fails");
+}
+
+// Frame a WSP reply the way sendWDPViaMesh does (7-byte UDH or 12-byte concat UDH)
+// and return the total characters put on air with the given codec
+static size_t bytesOnAir(const uint8_t* pdu, size_t len, size_t maxPayload, bool cobs, int* partsOut) {
+    uint8_t msg[MESHCORE_MAX_BYTES];
+    char encoded[MESHCORE_MAX_BYTES + 16];
+    size_t total = 0;
+    int parts = 0;
+
+    size_t maxSimple = maxPayload - 7;
+    size_t maxConcat = maxPayload - 12;
+    size_t offset = 0;
+    while (offset < len) {
+        size_t hdrLen = (len <= maxSimple) ? 7 : 12;
+        size_t partLen = len - offset;
+        size_t maxPart = (hdrLen == 7) ? maxSimple : maxConcat;
+        if (partLen > maxPart) partLen = maxPart;
+        memset(msg, 0x0B, hdrLen);
+        msg[1] = 0x00;  // Concat IE id is a zero, like the real header
+        memcpy(&msg[hdrLen], &pdu[offset], partLen);
+
+        size_t encodedLen = cobs ? Cobs::encode(msg, hdrLen + partLen, encoded, sizeof(encoded))
+                                 : Base91::encode(msg, hdrLen + partLen, encoded, sizeof(encoded));
+        if (encodedLen == 0 || encodedLen > MESHCORE_MAX_BYTES - 1) {
+            return 0;
+        }
+        total += encodedLen;
+        parts++;
+        offset += partLen;
+    }
+    *partsOut = parts;
+    return total;
+}
+
+void benchmarkCorpus() {
+    printf("\n=== Benchmark: Bytes On Air Per Corpus Page ===\n");
+    printf("  %-10s %6s | %6s %6s | %6s %6s | %6s\n", "page", "bytes", "b91 #", "chars", "cobs #", "chars", "saved");
+
+    size_t totalB91 = 0;
+    size_t totalCobs = 0;
+    bool allFit = true;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        int partsB91 = 0, partsCobs = 0;
+        size_t b91 = bytesOnAir(page.pdu, page.pduLen, MESHCORE_MAX_BINARY_PAYLOAD, false, &partsB91);
+        size_t cobs = bytesOnAir(page.pdu, page.pduLen, MESHCORE_MAX_COBS_PAYLOAD, true, &partsCobs);
+        if (b91 == 0 || cobs == 0) allFit = false;
+        totalB91 += b91;
+        totalCobs += cobs;
+        printf("  %-10s %6zu | %6d %6zu | %6d %6zu | %5.1f%%\n", page.name, page.pduLen,
+               partsB91, b91, partsCobs, cobs, b91 ? 100.0 * (b91 - cobs) / b91 : 0.0);
+    }
+    printf("  %-10s %6s | %6s %6zu | %6s %6zu | %5.1f%%\n", "total", "", "", totalB91, "", totalCobs,
+           100.0 * (totalB91 - totalCobs) / totalB91);
+
+    TEST_ASSERT(allFit, "Every frame fits in a MeshCore message with both codecs");
+    TEST_ASSERT(totalCobs < totalB91, "COBS puts fewer bytes on air than Base91");
+}
+
+int main() {
+    printf("======================================\n");
+    printf("  COBS Framing Test Suite\n");
+    printf("======================================\n");
+
+    testBasicEncodeDecode();
+    testWDPMessage();
+    testBlockBoundaries();
+    testWorstCaseOverhead();
+    testMalformed();
+    testLengthDelimitedAndInPlace();
+    testStreamingEncoder();
+    benchmarkCorpus();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * test_http.cpp - Unit tests for the incremental HTTP request parser
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -I lib/http -I test test/test_http.cpp -o test_http && ./test_http
+ */
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "http_request_parser.h"
+#include "http_corpus.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+typedef HttpRequestParser<512> Parser;
+
+// Feed a request in chunks of the given size, returns the final status
+static HttpParseStatus feedChunks(Parser& parser, const char* raw, size_t len, size_t chunk,
+                                  size_t* consumed = nullptr) {
+    HttpParseStatus status = HTTP_PARSE_NEED_MORE;
+    size_t total = 0;
+    for (size_t off = 0; off < len && status == HTTP_PARSE_NEED_MORE; off += chunk) {
+        size_t n = len - off < chunk ? len - off : chunk;
+        size_t used = 0;
+        status = parser.feed((const uint8_t*)raw + off, n, &used);
+        total += used;
+    }
+    if (consumed) {
+        *consumed = total;
+    }
+    return status;
+}
+
+void testCorpus() {
+    printf("\n=== Test: Browser requests ===\n");
+
+    static Parser parser;
+    for (size_t i = 0; i < http_corpus_count; i++) {
+        const HttpCorpusRequest& req = http_corpus[i];
+        parser.reset();
+        size_t consumed = 0;
+        HttpParseStatus status = feedChunks(parser, req.raw, strlen(req.raw), strlen(req.raw), &consumed);
+        bool ok = status == HTTP_PARSE_DONE && consumed == strlen(req.raw) &&
+                  strcmp(parser.method(), req.method) == 0 &&
+                  strcmp(parser.path(), req.path) == 0 &&
+                  strcmp(parser.host(), req.host) == 0;
+        TEST_ASSERT(ok, req.name);
+    }
+}
+
+void testChunking() {
+    printf("\n=== Test: Any chunking gives the same result ===\n");
+
+    static Parser parser;
+    bool allOk = true;
+    for (size_t i = 0; i < http_corpus_count; i++) {
+        const HttpCorpusRequest& req = http_corpus[i];
+        size_t len = strlen(req.raw);
+        for (size_t chunk = 1; chunk <= 64; chunk++) {
+            parser.reset();
+            HttpParseStatus status = feedChunks(parser, req.raw, len, chunk);
+            allOk = allOk && status == HTTP_PARSE_DONE &&
+                    strcmp(parser.path(), req.path) == 0 && strcmp(parser.host(), req.host) == 0;
+        }
+    }
+    TEST_ASSERT(allOk, "Chunks of 1..64 bytes parse every corpus request");
+
+    parser.reset();
+    const char* partial = "GET /index.wml HTTP/1.1\r\nHost: wap.bevelg";
+    TEST_ASSERT(parser.feed((const uint8_t*)partial, strlen(partial)) == HTTP_PARSE_NEED_MORE,
+                "Incomplete header block needs more");
+    const char* rest = "acom.be\r\n\r";
+    TEST_ASSERT(parser.feed((const uint8_t*)rest, strlen(rest)) == HTTP_PARSE_NEED_MORE,
+                "CR of the empty line alone still needs more");
+    TEST_ASSERT(parser.feed((const uint8_t*)"\n", 1) == HTTP_PARSE_DONE &&
+                strcmp(parser.host(), "wap.bevelgacom.be") == 0, "Host split across chunks");
+}
+
+void testHeaders() {
+    printf("\n=== Test: Header matching ===\n");
+
+    static Parser parser;
+    const char* req =
+        "POST /form HTTP/1.1\r\n"
+        "HoSt:   wap.example.com  \r\n"
+        "Content-TYPE: application/x-www-form-urlencoded\r\n"
+        "content-length: 7\r\n"
+        "Host: other.example.com\r\n"
+        "X-Hosted: no\r\n"
+        "Not a header line\r\n"
+        "\r\n"
+        "a=1&b=2";
+    size_t consumed = 0;
+    HttpParseStatus status = parser.feed((const uint8_t*)req, strlen(req), &consumed);
+    TEST_ASSERT(status == HTTP_PARSE_DONE, "Request parsed");
+    TEST_ASSERT(strcmp(parser.method(), "POST") == 0 && strcmp(parser.path(), "/form") == 0,
+                "Method and path");
+    TEST_ASSERT(strcmp(parser.host(), "wap.example.com") == 0, "Mixed-case name, value trimmed, first Host wins");
+    TEST_ASSERT(strcmp(parser.contentType(), "application/x-www-form-urlencoded") == 0, "Content-Type");
+    TEST_ASSERT(parser.contentLength() == 7, "Content-Length");
+    TEST_ASSERT(strcmp(req + consumed, "a=1&b=2") == 0, "Body left unconsumed");
+    TEST_ASSERT(parser.feed((const uint8_t*)"x", 1) == HTTP_PARSE_DONE, "Stays done until reset");
+
+    parser.reset();
+    const char* noHost = "GET / HTTP/1.0\r\n\r\n";
+    TEST_ASSERT(parser.feed((const uint8_t*)noHost, strlen(noHost)) == HTTP_PARSE_DONE &&
+                strcmp(parser.host(), "") == 0 && parser.contentLength() == 0, "Missing headers are empty");
+
+    parser.reset();
+    const char* leading = "\r\nGET / HTTP/1.1\r\nHost: a\r\n\r\n";
+    TEST_ASSERT(parser.feed((const uint8_t*)leading, strlen(leading)) == HTTP_PARSE_DONE &&
+                strcmp(parser.host(), "a") == 0, "Empty line before the request line ignored");
+}
+
+void testLimits() {
+    printf("\n=== Test: Malformed and oversized requests ===\n");
+
+    static Parser parser;
+
+    // Long headers that aren't kept never touch the buffer
+    std::string cookie = "GET / HTTP/1.1\r\nCookie: " + std::string(3000, 'c') + "\r\nX-" +
+                         std::string(1000, 'n') + ": v\r\nHost: wap.example.com\r\n\r\n";
+    TEST_ASSERT(feedChunks(parser, cookie.c_str(), cookie.size(), 100) == HTTP_PARSE_DONE &&
+                strcmp(parser.host(), "wap.example.com") == 0, "Long skipped header and name fit a 512-byte buffer");
+
+    parser.reset();
+    std::string longPath = "GET /" + std::string(600, 'p') + " HTTP/1.1\r\n\r\n";
+    TEST_ASSERT(feedChunks(parser, longPath.c_str(), longPath.size(), 64) == HTTP_PARSE_ERROR &&
+                parser.errorStatus() == 414, "Request target larger than the buffer is 414");
+
+    parser.reset();
+    std::string longHost = "GET / HTTP/1.1\r\nHost: " + std::string(600, 'h') + "\r\n\r\n";
+    TEST_ASSERT(feedChunks(parser, longHost.c_str(), longHost.size(), 64) == HTTP_PARSE_ERROR &&
+                parser.errorStatus() == 431, "Kept header larger than the buffer is 431");
+
+    parser.reset();
+    std::string flood = "GET / HTTP/1.1\r\n";
+    while (flood.size() <= HTTP_MAX_HEADER_BYTES) {
+        flood += "X-Filler: 0123456789012345678901234567890123456789\r\n";
+    }
+    TEST_ASSERT(feedChunks(parser, flood.c_str(), flood.size(), 256) == HTTP_PARSE_ERROR &&
+                parser.errorStatus() == 431, "Header block over the limit is 431");
+
+    const char* bad[] = {
+        "GET /\r\n\r\n",
+        "GET  HTTP/1.1\r\n\r\n",
+        " / HTTP/1.1\r\n\r\n",
+        "GET / FTP/1.0\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length:\r\n\r\n",
+    };
+    bool allBad = true;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        parser.reset();
+        allBad = allBad && parser.feed((const uint8_t*)bad[i], strlen(bad[i])) == HTTP_PARSE_ERROR &&
+                 parser.errorStatus() == 400 && parser.error()[0] != '\0';
+    }
+    TEST_ASSERT(allBad, "Malformed request lines and Content-Length are 400");
+}
+
+int main() {
+    printf("======================================\n");
+    printf("  HTTP Request Parser Test Suite\n");
+    printf("======================================\n");
+
+    testCorpus();
+    testChunking();
+    testHeaders();
+    testLimits();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
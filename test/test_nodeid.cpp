@@ -0,0 +1,115 @@
+/**
+ * test_nodeid.cpp - Unit tests for mesh node IDs and the node ID index
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -I lib/nodeid test/test_nodeid.cpp -o test_nodeid && ./test_nodeid
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include "node_id.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+struct Contact {
+    uint8_t pubKey[32];
+};
+
+void testNodeId() {
+    printf("\n=== Test: Node IDs ===\n");
+
+    uint8_t pubKey[32] = { 0x21, 0xBD, 0xD7, 0x70, 0x07, 0xF5 };
+    MeshNodeId id = meshNodeId(pubKey);
+    TEST_ASSERT(id == 0x21BDD770u, "Node ID is the big-endian key prefix");
+
+    uint8_t prefix[MESH_NODE_ID_PREFIX_LEN];
+    meshNodePrefix(id, prefix);
+    TEST_ASSERT(memcmp(prefix, pubKey, sizeof(prefix)) == 0, "Prefix round trip");
+
+    TEST_ASSERT(meshNodeIdFromHex("21BDD77007F54EF3C5FE") == id, "From a full hex key (upper case)");
+    TEST_ASSERT(meshNodeIdFromHex("21bdd770") == id, "From a hex prefix (lower case)");
+    TEST_ASSERT(meshNodeIdFromHex("21bdd7") == 0, "Short hex rejected");
+    TEST_ASSERT(meshNodeIdFromHex("21bdx770") == 0, "Non-hex rejected");
+
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08lx", (unsigned long)id);
+    TEST_ASSERT(strcmp(hex, "21bdd770") == 0, "Prints as the hex prefix");
+}
+
+void testIndex() {
+    printf("\n=== Test: Node ID index ===\n");
+
+    static Contact contacts[32];
+    NodeIdIndex<Contact, 64> index;
+    srand(11);
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            contacts[i].pubKey[j] = (uint8_t)rand();
+        }
+    }
+
+    TEST_ASSERT(index.find(meshNodeId(contacts[0].pubKey)) == nullptr, "Empty index misses");
+
+    for (int i = 0; i < 32; i++) {
+        index.put(meshNodeId(contacts[i].pubKey), &contacts[i]);
+    }
+    int found = 0;
+    for (int i = 0; i < 32; i++) {
+        if (index.find(meshNodeId(contacts[i].pubKey)) == &contacts[i]) {
+            found++;
+        }
+    }
+    TEST_ASSERT(found >= 30, "Half-full index keeps (nearly) all entries");
+    TEST_ASSERT(index.find(0x12345678u) == nullptr, "Unknown ID misses");
+
+    MeshNodeId id = meshNodeId(contacts[5].pubKey);
+    index.put(id, &contacts[6]);
+    TEST_ASSERT(index.find(id) == &contacts[6], "Put replaces the entry for the same ID");
+    index.remove(id);
+    TEST_ASSERT(index.find(id) == nullptr, "Removed ID misses");
+
+    index.clear();
+    TEST_ASSERT(index.find(meshNodeId(contacts[7].pubKey)) == nullptr, "Clear empties the index");
+
+    // IDs that share a home slot go to the next free slots, the window overflows into the home slot
+    NodeIdIndex<Contact, 4> tiny;
+    for (int i = 0; i < 4; i++) {
+        tiny.put(100 + i, &contacts[i]);
+    }
+    int tinyFound = 0;
+    for (int i = 0; i < 4; i++) {
+        tinyFound += tiny.find(100 + i) == &contacts[i];
+    }
+    TEST_ASSERT(tinyFound == 4, "Full probe window finds every entry");
+    tiny.put(200, &contacts[4]);
+    TEST_ASSERT(tiny.find(200) == &contacts[4], "Overflow evicts an older entry");
+}
+
+int main() {
+    printf("======================================\n");
+    printf("  Node ID Test Suite\n");
+    printf("======================================\n");
+
+    testNodeId();
+    testIndex();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * test_rtt.cpp - Unit tests for the RTT estimator
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -I lib/rtt test/test_rtt.cpp -o test_rtt && ./test_rtt
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "rtt_estimator.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+void testFirstSample() {
+    printf("\n=== Test: First sample ===\n");
+
+    RttEstimator rtt(500, 60000);
+    TEST_ASSERT(!rtt.hasSamples() && rtt.timeout(15000) == 15000, "Fallback timeout before any sample");
+
+    rtt.sample(2000);
+    TEST_ASSERT(rtt.hasSamples() && rtt.srtt() == 2000 && rtt.rttvar() == 1000, "First sample sets srtt and rttvar/2");
+    TEST_ASSERT(rtt.timeout(15000) == 6000, "Timeout is srtt + 4 * rttvar");
+}
+
+void testConvergence() {
+    printf("\n=== Test: Convergence ===\n");
+
+    // Steady path: timeout tightens towards the RTT
+    RttEstimator rtt(500, 60000);
+    for (int i = 0; i < 50; i++) {
+        rtt.sample(3000);
+    }
+    TEST_ASSERT(rtt.srtt() == 3000, "Steady samples converge to the RTT");
+    TEST_ASSERT(rtt.timeout(15000) < 3200, "Steady path gets a tight timeout");
+
+    // Jittery path: timeout covers the spread
+    RttEstimator jitter(500, 60000);
+    uint32_t maxSample = 0;
+    srand(7);
+    for (int i = 0; i < 200; i++) {
+        uint32_t s = 4000 + rand() % 4000;
+        maxSample = (s > maxSample) ? s : maxSample;
+        jitter.sample(s);
+    }
+    TEST_ASSERT(jitter.srtt() > 5000 && jitter.srtt() < 7000, "Jittery samples average out");
+    TEST_ASSERT(jitter.timeout(15000) >= maxSample, "Jittery path timeout covers the slowest samples");
+
+    // Path got slower: timeout follows within a few samples
+    for (int i = 0; i < 10; i++) {
+        rtt.sample(20000);
+    }
+    TEST_ASSERT(rtt.timeout(15000) > 20000, "Slower path raises the timeout past the fixed constant");
+}
+
+void testBackoffAndClamp() {
+    printf("\n=== Test: Backoff and clamping ===\n");
+
+    RttEstimator rtt(500, 60000);
+    rtt.sample(1000);
+    uint32_t base = rtt.timeout(15000);
+    rtt.timedOut();
+    TEST_ASSERT(rtt.timeout(15000) == base * 2, "Timeout doubles after a timeout");
+    for (int i = 0; i < 10; i++) {
+        rtt.timedOut();
+    }
+    TEST_ASSERT(rtt.timeout(15000) == 60000, "Backoff stops at the maximum");
+    rtt.sample(1000);
+    TEST_ASSERT(rtt.timeout(15000) < base, "Next sample undoes the backoff");
+
+    RttEstimator fast(500, 60000);
+    for (int i = 0; i < 20; i++) {
+        fast.sample(10);
+    }
+    TEST_ASSERT(fast.timeout(15000) == 500, "Timeout never below the minimum");
+    fast.sample(1000000);
+    TEST_ASSERT(fast.timeout(15000) <= 60000, "Huge sample clamped to the maximum");
+
+    RttEstimator noSamples(500, 60000);
+    noSamples.timedOut();
+    TEST_ASSERT(noSamples.timeout(15000) == 30000, "Fallback timeout backs off too");
+    noSamples.sample(1000);
+    noSamples.reset();
+    TEST_ASSERT(!noSamples.hasSamples() && noSamples.timeout(15000) == 15000, "Reset forgets samples and backoff");
+}
+
+int main() {
+    printf("======================================\n");
+    printf("  RTT Estimator Test Suite\n");
+    printf("======================================\n");
+
+    testFirstSample();
+    testConvergence();
+    testBackoffAndClamp();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * test_spsc.cpp - Unit tests for the SPSC record ring
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -pthread -I lib/spsc test/test_spsc.cpp -o test_spsc && ./test_spsc
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "spsc_ring.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+void testPushPop() {
+    printf("\n=== Test: Push and pop ===\n");
+
+    SpscRing<64> ring;
+    size_t len = 0;
+    TEST_ASSERT(ring.empty() && ring.front(&len) == nullptr, "New ring is empty");
+
+    TEST_ASSERT(ring.push("abc", 3), "Push a 3-byte record");
+    TEST_ASSERT(ring.push("hello", 5), "Push a 5-byte record");
+    TEST_ASSERT(ring.used() == 8 + 12, "Records are padded to 4 bytes plus a header");
+
+    uint8_t* rec = ring.front(&len);
+    TEST_ASSERT(rec && len == 3 && memcmp(rec, "abc", 3) == 0, "Oldest record first");
+    TEST_ASSERT(((uintptr_t)rec & 3) == 0, "Record is 4-byte aligned");
+    TEST_ASSERT(ring.front(&len) == rec, "Front stays until pop");
+    ring.pop();
+    rec = ring.front(&len);
+    TEST_ASSERT(rec && len == 5 && memcmp(rec, "hello", 5) == 0, "Second record after pop");
+    ring.pop();
+    TEST_ASSERT(ring.empty() && ring.used() == 0, "Empty after popping everything");
+    ring.pop();
+    TEST_ASSERT(ring.empty(), "Pop on an empty ring does nothing");
+
+    // Reserve more than needed, commit what was written
+    rec = ring.reserve(32);
+    memcpy(rec, "xy", 2);
+    ring.commit(2);
+    rec = ring.front(&len);
+    TEST_ASSERT(rec && len == 2 && memcmp(rec, "xy", 2) == 0, "Commit shorter than reserved");
+    ring.pop();
+}
+
+void testFullAndWrap() {
+    printf("\n=== Test: Full ring and wrap-around ===\n");
+
+    SpscRing<64> ring;
+    uint8_t data[32];
+    memset(data, 0xAB, sizeof(data));
+
+    TEST_ASSERT(ring.push(data, 28) && ring.push(data, 28), "Two 32-byte records fill 64 bytes");
+    TEST_ASSERT(!ring.push(data, 1), "Full ring refuses another record");
+    ring.pop();
+
+    // 32 bytes free at the start only, an 8-byte record fits after the wrap
+    TEST_ASSERT(!ring.push(data, 32), "Record larger than the free space refused");
+    TEST_ASSERT(ring.push("wrapped!", 8), "Record fits after the wrap");
+    size_t len = 0;
+    ring.pop();
+    uint8_t* rec = ring.front(&len);
+    TEST_ASSERT(rec && len == 8 && memcmp(rec, "wrapped!", 8) == 0, "Record read back after the wrap");
+    ring.pop();
+    TEST_ASSERT(ring.empty(), "Empty again");
+
+    // Record that doesn't fit before the end skips to the start
+    SpscRing<64> skip;
+    skip.push(data, 20);            // 24 bytes
+    skip.push(data, 20);            // 48 bytes
+    skip.pop();
+    skip.pop();                     // Empty, write position 48
+    TEST_ASSERT(skip.push(data, 28), "Record skips the 16-byte tail of the arena");
+    rec = skip.front(&len);
+    TEST_ASSERT(rec && len == 28 && rec[0] == 0xAB && rec[27] == 0xAB, "Skipped record read back whole");
+    skip.pop();
+    TEST_ASSERT(skip.empty() && skip.used() == 0, "Wrap marker popped with the record");
+
+    // Half the arena always fits into an empty ring
+    bool allFit = true;
+    SpscRing<64> half;
+    for (int start = 0; start < 64; start += 4) {
+        while (!half.empty()) {
+            half.pop();
+        }
+        for (int i = 0; i < start / 4; i++) {
+            half.push(data, 0);
+            half.pop();
+        }
+        allFit = allFit && half.push(data, 28);
+    }
+    TEST_ASSERT(allFit, "Size / 2 - 4 byte record fits at any position");
+}
+
+void testVariableLengths() {
+    printf("\n=== Test: Variable-length records ===\n");
+
+    SpscRing<256> ring;
+    uint8_t buf[64];
+    uint32_t pushed = 0, popped = 0;
+    bool ok = true;
+    srand(3);
+    for (int round = 0; round < 10000; round++) {
+        if (rand() % 2) {
+            size_t len = rand() % 60;
+            buf[0] = (uint8_t)pushed;
+            memset(buf + 1, (uint8_t)len, len > 1 ? len - 1 : 0);
+            if (len > 0 && ring.push(buf, len)) {
+                pushed++;
+            }
+        } else {
+            size_t len;
+            uint8_t* rec = ring.front(&len);
+            if (rec) {
+                ok = ok && rec[0] == (uint8_t)popped && (len < 2 || rec[len - 1] == (uint8_t)len);
+                ring.pop();
+                popped++;
+            }
+        }
+    }
+    TEST_ASSERT(pushed > 1000 && ok, "Random pushes and pops keep order and contents");
+}
+
+void testThreads() {
+    printf("\n=== Test: Producer and consumer threads ===\n");
+
+    static SpscRing<1024> ring;
+    const uint32_t COUNT = 200000;
+    bool ok = true;
+
+    std::thread producer([]() {
+        uint8_t buf[40];
+        for (uint32_t i = 0; i < COUNT; i++) {
+            size_t len = 4 + i % 36;
+            memcpy(buf, &i, 4);
+            memset(buf + 4, (uint8_t)i, len - 4);
+            while (!ring.push(buf, len)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint32_t i = 0; i < COUNT; ) {
+        size_t len;
+        uint8_t* rec = ring.front(&len);
+        if (!rec) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t seq;
+        memcpy(&seq, rec, 4);
+        ok = ok && seq == i && len == 4 + i % 36 && (len == 4 || rec[len - 1] == (uint8_t)i);
+        ring.pop();
+        i++;
+    }
+    producer.join();
+    TEST_ASSERT(ok && ring.empty(), "Records cross threads intact and in order");
+}
+
+int main() {
+    printf("======================================\n");
+    printf("  SPSC Ring Test Suite\n");
+    printf("======================================\n");
+
+    testPushPop();
+    testFullAndWrap();
+    testVariableLengths();
+    testThreads();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -13,8 +13,13 @@
 #include <cstring>
 #include <cassert>
 #include <cstdint>
+#include <string>
 
 #include "wap_request.h"
+#include "wsp_reply_parser.h"
+#include "wmlc_decompiler.h"
+#include "wmlc_compiler.h"
+#include "test/wap_corpus.h"
 
 // Test result tracking
 static int tests_passed = 0;
@@ -448,6 +453,386 @@ void testHTTPFormatting() {
     TEST_ASSERT(strstr(httpBuffer, "Test") != nullptr, "Contains body");
 }
 
+// Test the resumable Reply parser against whole-PDU decoding, fed in chunks
+void testReplyParserChunks() {
+    printf("\n=== Test: WSP Reply Parser Chunks ===\n");
+    
+    bool allOk = true;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        HTTPResponse whole;
+        WAPResponse::decode(page.pdu, page.pduLen, &whole);
+        size_t wholeOffset = page.pduLen - whole.bodyLen;
+        
+        for (size_t chunk = 1; chunk <= 40; chunk++) {
+            WSPReplyParser reply;
+            size_t bodyStart = 0;
+            bool done = false;
+            for (size_t off = 0; off < page.pduLen && !done; off += chunk) {
+                size_t n = page.pduLen - off < chunk ? page.pduLen - off : chunk;
+                size_t used = 0;
+                done = reply.feed(&page.pdu[off], n, &used) == WSP_REPLY_HEADERS;
+                bodyStart = off + used;
+            }
+            HTTPResponse parsed;
+            allOk = allOk && done && reply.decode(&parsed) &&
+                    reply.bodyOffset() == wholeOffset && bodyStart == wholeOffset &&
+                    parsed.statusCode == whole.statusCode &&
+                    strcmp(parsed.contentType, whole.contentType) == 0 &&
+                    strcmp(parsed.server, whole.server) == 0 && parsed.body == nullptr;
+        }
+    }
+    TEST_ASSERT(allOk, "Corpus pages in chunks of 1..40 bytes match whole-PDU decoding");
+    
+    // Once the headers are complete the rest is body
+    WSPReplyParser reply;
+    size_t used = 99;
+    reply.feed(wap_corpus[0].pdu, wap_corpus[0].pduLen, &used);
+    TEST_ASSERT(reply.feed(wap_corpus[0].pdu, 4, &used) == WSP_REPLY_HEADERS && used == 0,
+                "Bytes after the headers are left to the caller");
+}
+
+// Test the Reply parser on partial and broken PDUs
+void testReplyParserPartial() {
+    printf("\n=== Test: WSP Reply Parser Partial PDUs ===\n");
+    
+    // TID, Reply, 200 OK, 3 header bytes: Content-Type text/vnd.wap.wml, Content-Length 5
+    uint8_t pdu[] = {
+        0x01, 0x04, 0x20, 0x03, 0x88, 0x8D, 0x85,
+        'H', 'e', 'l', 'l', 'o'
+    };
+    
+    WSPReplyParser reply;
+    size_t used = 0;
+    TEST_ASSERT(reply.feed(pdu, 3, &used) == WSP_REPLY_NEED_MORE && used == 3, "Status only, needs more");
+    TEST_ASSERT(reply.hasStatus() && reply.statusCode() == 200, "Status known before the headers");
+    HTTPResponse response;
+    TEST_ASSERT(!reply.decode(&response), "No decode before the headers are complete");
+    TEST_ASSERT(reply.feed(&pdu[3], 3, &used) == WSP_REPLY_NEED_MORE, "Header block cut off, needs more");
+    TEST_ASSERT(reply.feed(&pdu[6], 6, &used) == WSP_REPLY_HEADERS && used == 1, "Headers end inside the chunk");
+    TEST_ASSERT(reply.bodyOffset() == 7, "Body offset in the PDU");
+    TEST_ASSERT(reply.decode(&response) && strcmp(response.contentType, "text/vnd.wap.wml") == 0 &&
+                response.contentLength == 5, "Content-Type and Content-Length decoded");
+    
+    // Whole-PDU decoding no longer pretends a cut-off header block was parsed
+    TEST_ASSERT(!WAPResponse::decode(pdu, 6, &response), "decode() rejects a cut-off header block");
+    
+    uint8_t notReply[] = {0x01, 0x40, 0x20, 0x00};
+    reply.reset();
+    TEST_ASSERT(reply.feed(notReply, sizeof(notReply)) == WSP_REPLY_ERROR, "Non-Reply PDU rejected");
+    
+    uint8_t hugeHeaders[] = {0x01, 0x04, 0x20, 0x84, 0x00};   // 512 header bytes
+    reply.reset();
+    TEST_ASSERT(reply.feed(hugeHeaders, sizeof(hugeHeaders)) == WSP_REPLY_ERROR, "Header block over the buffer rejected");
+    
+    uint8_t noHeaders[] = {0x04, 0x44, 0x00};
+    reply.reset(false);
+    TEST_ASSERT(reply.feed(noHeaders, sizeof(noHeaders), &used) == WSP_REPLY_HEADERS && used == 3 &&
+                reply.statusCode() == 404, "Empty header block, PDU without TID");
+}
+
+struct StringSink : public WMLSink {
+    std::string text;
+    void write(const char* data, size_t len) { text.append(data, len); }
+};
+
+// Stands in for WiFiClient, records the size of every write
+struct FakeClient {
+    std::string received;
+    size_t writes = 0;
+    size_t largest = 0;
+    size_t write(const uint8_t* data, size_t len) {
+        received.append((const char*)data, len);
+        writes++;
+        largest = len > largest ? len : largest;
+        return len;
+    }
+};
+
+// Test the streaming WMLC decompiler against whole-document decompiling
+void testWmlcStreamChunks() {
+    printf("\n=== Test: WMLC Stream Decompiler Chunks ===\n");
+    
+    static char whole[16384];
+    bool allOk = true;
+    bool matchesSource = true;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        HTTPResponse response;
+        WAPResponse::decode(page.pdu, page.pduLen, &response);
+        size_t wholeLen = WMLCDecompiler::decompile(response.body, response.bodyLen, whole, sizeof(whole));
+        const char* wml = strstr(whole, "<wml>");
+        matchesSource = matchesSource && wml && strcmp(wml, page.wml) == 0;
+        
+        for (size_t chunk = 1; chunk <= 64; chunk++) {
+            StringSink sink;
+            std::string& text = sink.text;
+            WMLCStreamDecompiler decoder(&sink);
+            for (size_t off = 0; off < response.bodyLen; off += chunk) {
+                size_t n = response.bodyLen - off < chunk ? response.bodyLen - off : chunk;
+                allOk = allOk && decoder.feed(&response.body[off], n) == WMLC_STREAM_OK;
+            }
+            allOk = allOk && decoder.finish() == WMLC_STREAM_OK &&
+                    text == std::string(whole, wholeLen) && decoder.bytesOut() == wholeLen;
+        }
+    }
+    TEST_ASSERT(matchesSource, "Corpus pages decompile to their WML source");
+    TEST_ASSERT(allOk, "Corpus pages in chunks of 1..64 bytes match whole-document decompiling");
+    
+    // Text goes out as tokens complete, before the document is in
+    HTTPResponse response;
+    WAPResponse::decode(wap_corpus[0].pdu, wap_corpus[0].pduLen, &response);
+    size_t wholeLen = WMLCDecompiler::decompile(response.body, response.bodyLen, whole, sizeof(whole));
+    StringSink sink;
+    std::string& text = sink.text;
+    WMLCStreamDecompiler decoder(&sink);
+    decoder.feed(response.body, response.bodyLen / 2);
+    size_t halfLen = text.size();
+    TEST_ASSERT(decoder.started() && halfLen > wholeLen / 4 && strncmp(whole, text.c_str(), halfLen) == 0,
+                "First half of the document written before the rest arrives");
+    decoder.feed(response.body + response.bodyLen / 2, response.bodyLen - response.bodyLen / 2);
+    TEST_ASSERT(decoder.finish() == WMLC_STREAM_OK && text == whole, "Second half continues the text");
+}
+
+// Test the streaming WMLC decompiler on cut-off and broken documents
+void testWmlcStreamErrors() {
+    printf("\n=== Test: WMLC Stream Decompiler Errors ===\n");
+    
+    // WBXML 1.3, WML 1.3, UTF-8, string table "x\0", <wml><card id="$(v)">text (cut off)
+    uint8_t doc[] = {
+        0x03, 0x0A, 0x6A, 0x02, 'x', 0x00,
+        0x7F, 0xE7, 0x55, 0x40, 'v', 0x00, 0x01,
+        0x03, 't', 'e', 'x', 't'
+    };
+    StringSink sink;
+    std::string& text = sink.text;
+    WMLCStreamDecompiler decoder(&sink);
+    TEST_ASSERT(decoder.feed(doc, 3) == WMLC_STREAM_OK && !decoder.started() && text.empty(),
+                "Nothing written until the string table is in");
+    decoder.feed(&doc[3], 8);
+    TEST_ASSERT(decoder.started() && text.find("<wml><card id=\"$(v") != std::string::npos,
+                "Inline variable written as far as it came");
+    decoder.feed(&doc[11], sizeof(doc) - 11);
+    TEST_ASSERT(decoder.finish() == WMLC_STREAM_OK &&
+                text.find("<wml><card id=\"$(v)\">text</card></wml>") != std::string::npos,
+                "Variable in an attribute value, open elements closed at the end");
+    
+    decoder.reset(&sink);
+    decoder.feed(doc, 5);
+    TEST_ASSERT(decoder.finish() == WMLC_STREAM_ERROR && decoder.error()[0] != '\0',
+                "Cut-off string table is an error");
+    
+    uint8_t hugeTable[] = {0x03, 0x04, 0x6A, 0x90, 0x00};   // 2048 bytes
+    decoder.reset(&sink);
+    TEST_ASSERT(decoder.feed(hugeTable, sizeof(hugeTable)) == WMLC_STREAM_ERROR,
+                "String table over the buffer rejected");
+    
+    uint8_t badNumber[] = {0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F};
+    decoder.reset(&sink);
+    TEST_ASSERT(decoder.feed(badNumber, sizeof(badNumber)) == WMLC_STREAM_ERROR,
+                "Over-long multi-byte integer rejected");
+    
+    uint8_t deep[6 + WMLC_MAX_DEPTH + 1] = {0x03, 0x04, 0x6A, 0x00};
+    memset(&deep[4], 0x60, sizeof(deep) - 4);               // <p> with content, never closed
+    decoder.reset(&sink);
+    TEST_ASSERT(decoder.feed(deep, sizeof(deep)) == WMLC_STREAM_ERROR &&
+                decoder.feed(deep, 4) == WMLC_STREAM_ERROR, "Nesting too deep rejected, stays failed");
+    static char out[256];
+    TEST_ASSERT(WMLCDecompiler::decompile(deep, sizeof(deep), out, sizeof(out)) == 0 && out[0] == '\0',
+                "Whole-document decompiling fails the same way");
+}
+
+// Test the decompiler's output sinks
+void testWmlSinks() {
+    printf("\n=== Test: WML Sinks ===\n");
+    
+    HTTPResponse response;
+    WAPResponse::decode(wap_corpus[2].pdu, wap_corpus[2].pduLen, &response);
+    StringSink text;
+    TEST_ASSERT(WMLCDecompiler::decompile(response.body, response.bodyLen, text), "Decompiled to a sink");
+    
+    WMLCountingSink counter;
+    TEST_ASSERT(WMLCDecompiler::decompile(response.body, response.bodyLen, counter) &&
+                counter.count() == text.text.size(), "Counting sink gives the exact length");
+    
+    static char small[256];
+    WMLBufferSink buffer(small, sizeof(small));
+    WMLCDecompiler::decompile(response.body, response.bodyLen, buffer);
+    TEST_ASSERT(buffer.overflowed() && buffer.length() == sizeof(small) - 1 &&
+                strlen(small) == sizeof(small) - 1 && text.text.compare(0, buffer.length(), small) == 0,
+                "Buffer sink keeps what fits and reports the overflow");
+    TEST_ASSERT(WMLCDecompiler::decompile(response.body, response.bodyLen, small, sizeof(small)) == 0 &&
+                small[0] == '\0', "Text larger than the buffer is an error, not truncated");
+    
+    FakeClient client;
+    WMLClientSink<FakeClient, 128> out;
+    out.begin(&client);
+    WMLCDecompiler::decompile(response.body, response.bodyLen, out);
+    out.flush();
+    TEST_ASSERT(client.received == text.text && out.sent() == text.text.size(), "Client sink sends all of the text");
+    TEST_ASSERT(client.largest == 128 && client.writes == (text.text.size() + 127) / 128,
+                "Client sink combines the pieces into writes of its size");
+    
+    std::string big(300, 'x');
+    client = FakeClient();
+    out.write("<p>", 3);
+    out.write(big.data(), big.size());
+    TEST_ASSERT(client.writes == 2 && client.received.size() == 256, "Long piece split at the write size");
+    out.flush();
+    TEST_ASSERT(client.writes == 3 && client.received == "<p>" + big, "Flush sends the rest, in order");
+}
+
+// Compile WML, decompile it again, and return the text from the root element on
+static std::string wmlcRoundTrip(const char* wml, size_t* wmlcLen = nullptr) {
+    static uint8_t wmlc[8192];
+    static char text[16384];
+    size_t len = WMLCCompiler::compile(wml, strlen(wml), wmlc, sizeof(wmlc));
+    if (wmlcLen) *wmlcLen = len;
+    if (len == 0 || WMLCDecompiler::decompile(wmlc, len, text, sizeof(text)) == 0) {
+        return "";
+    }
+    const char* root = strstr(text, "<wml");
+    return root ? root : "";
+}
+
+// Test the WML compiler against the decompiler and the corpus encoding
+void testWmlcCompilerRoundTrip() {
+    printf("\n=== Test: WMLC Compiler Round Trip ===\n");
+    
+    bool roundTrips = true;
+    bool smaller = true;
+    bool chunksMatch = true;
+    static uint8_t whole[8192];
+    static uint8_t chunked[8192];
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        const WapCorpusPage& page = wap_corpus[i];
+        HTTPResponse response;
+        WAPResponse::decode(page.pdu, page.pduLen, &response);
+        size_t len = 0;
+        roundTrips = roundTrips && wmlcRoundTrip(page.wml, &len) == page.wml;
+        smaller = smaller && len > 0 && len <= response.bodyLen;
+        
+        size_t wholeLen = WMLCCompiler::compile(page.wml, strlen(page.wml), whole, sizeof(whole));
+        for (size_t chunk = 1; chunk <= 64; chunk++) {
+            WMLCCompiler compiler;
+            size_t wmlLen = strlen(page.wml);
+            for (size_t off = 0; off < wmlLen; off += chunk) {
+                size_t n = wmlLen - off < chunk ? wmlLen - off : chunk;
+                chunksMatch = chunksMatch && compiler.feed(&page.wml[off], n) == WMLC_COMPILE_OK;
+            }
+            size_t chunkedLen = compiler.finish(chunked, sizeof(chunked));
+            chunksMatch = chunksMatch && chunkedLen == wholeLen && memcmp(whole, chunked, wholeLen) == 0;
+        }
+    }
+    TEST_ASSERT(roundTrips, "Corpus pages compile and decompile to their WML source");
+    TEST_ASSERT(smaller, "Compiled corpus pages no larger than the gateway's encoding");
+    TEST_ASSERT(chunksMatch, "Text in chunks of 1..64 bytes compiles to the same document");
+    
+    // Shared link prefix goes in the table once, every link refers to it
+    const char* links = "<wml><card><p>"
+        "<a href=\"http://wap.example.org/news/1.wml\">One</a>"
+        "<a href=\"http://wap.example.org/news/2.wml\">Two</a>"
+        "<a href=\"http://wap.example.org/news/3.wml\">Three</a>"
+        "<a href=\"http://wap.example.org/news/3.wml\">Three again</a>"
+        "</p></card></wml>";
+    WMLCCompiler compiler;
+    compiler.feed(links, strlen(links));
+    size_t len = compiler.finish(whole, sizeof(whole));
+    const char* table = (const char*)&whole[4];
+    TEST_ASSERT(len > 0 && whole[0] == 0x03 && whole[2] == 0x6A && compiler.stringTableSize() == whole[3] &&
+                memmem(table, whole[3], "example.org/news/", 17) != nullptr &&
+                memmem(&whole[4 + whole[3]], len - 4 - whole[3], "example.org", 11) == nullptr,
+                "Shared prefix in the string table, not repeated in the body");
+    TEST_ASSERT(wmlcRoundTrip(links) == links, "Table prefixes and inline rests decompile to the links");
+    
+    // A string used once is cheaper inline
+    const char* once = "<wml><card><p>Just once</p></card></wml>";
+    compiler.reset();
+    compiler.feed(once, strlen(once));
+    TEST_ASSERT(compiler.finish(whole, sizeof(whole)) > 0 && compiler.stringTableSize() == 0,
+                "Single strings stay inline");
+}
+
+// Test WML syntax the compiler resolves or keeps
+void testWmlcCompilerSyntax() {
+    printf("\n=== Test: WMLC Compiler Syntax ===\n");
+    
+    TEST_ASSERT(wmlcRoundTrip("<?xml version=\"1.0\"?>\n"
+                              "<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.1//EN\" "
+                              "\"http://www.wapforum.org/DTD/wml_1.1.xml\">\n"
+                              "<wml>\n  <!-- menu -->\n  <card id=\"m\">\n    <p>Hi  there\n    you</p>\n  </card>\n</wml>\n") ==
+                "<wml><card id=\"m\"><p>Hi there you</p></card></wml>",
+                "Declaration, comments and indentation dropped, whitespace collapsed");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card><p>A &amp; B &lt;3&gt; &quot;x&quot; &#65;&#x42;</p></card></wml>") ==
+                "<wml><card><p>A &amp; B &lt;3&gt; &quot;x&quot; AB</p></card></wml>",
+                "Entities resolved");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card><p>Price: $$5, $(name), $(q:e) $(q:unesc) $v</p></card></wml>") ==
+                "<wml><card><p>Price: $$5, $(name), $(q:e) $(q:u) $(v)</p></card></wml>",
+                "Variables and escaped dollars");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card><p><![CDATA[a <b> & $c]]></p></card></wml>") ==
+                "<wml><card><p>a &lt;b&gt; &amp; $$c</p></card></wml>",
+                "CDATA is text as is");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card><p><b>x</b> <i>y</i><br/></p></card></wml>") ==
+                "<wml><card><p><b>x</b> <i>y</i><br/></p></card></wml>",
+                "Space between elements kept, empty elements");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card><p><blink>on</blink><x/><a href=\"x.wml\" rel=\"next\">n</a></p></card></wml>") ==
+                "<wml><card><p><blink>on</blink><x/><a href=\"x.wml\" rel=\"next\">n</a></p></card></wml>",
+                "Unknown elements and attributes named from the string table");
+    TEST_ASSERT(wmlcRoundTrip("<wml><card ordered='true' newcontext=\"false\"><p align=\"left\" mode=\"nowrap\">"
+                              "<go href=\"http://www.example.com/x\" method=\"post\"/></p></card></wml>") ==
+                "<wml><card ordered=\"true\" newcontext=\"false\"><p align=\"left\" mode=\"nowrap\">"
+                "<go href=\"http://www.example.com/x\" method=\"post\"/></p></card></wml>",
+                "Attribute start and value tokens");
+    
+    static uint8_t wmlc[256];
+    const char* wml13 = "<!DOCTYPE wml PUBLIC \"-//WAPFORUM//DTD WML 1.3//EN\" \"x\"><wml/>";
+    TEST_ASSERT(WMLCCompiler::compile(wml13, strlen(wml13), wmlc, sizeof(wmlc)) == 5 && wmlc[1] == 0x0A &&
+                wmlc[4] == 0x3F, "DOCTYPE sets the public ID");
+}
+
+// Test malformed WML and documents over the buffers
+void testWmlcCompilerErrors() {
+    printf("\n=== Test: WMLC Compiler Errors ===\n");
+    
+    const char* bad[] = {
+        "<wml><card></wml>",
+        "<wml><card>",
+        "<wml><p>x</p></card></wml>",
+        "<wml><card id=x></card></wml>",
+        "<wml><card id=\"a<b\"></card></wml>",
+        "<wml><card><p>&bogus;</p></card></wml>",
+        "<wml><card><p>$(x</p></card></wml>",
+        "<wml><card><!ELEMENT x></card></wml>",
+        "<wml><card",
+        "just text",
+    };
+    bool allFail = true;
+    static uint8_t wmlc[1024];
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        WMLCCompiler compiler;
+        compiler.feed(bad[i], strlen(bad[i]));
+        bool failed = compiler.finish(wmlc, sizeof(wmlc)) == 0 && compiler.error()[0] != '\0';
+        if (!failed) printf("  compiled: %s\n", bad[i]);
+        allFail = allFail && failed;
+    }
+    TEST_ASSERT(allFail, "Malformed WML rejected with an error");
+    
+    WMLCCompiler compiler;
+    TEST_ASSERT(compiler.feed("<wml><card></p>", 15) == WMLC_COMPILE_ERROR &&
+                compiler.feed("</card></wml>", 13) == WMLC_COMPILE_ERROR, "Stays failed until reset");
+    compiler.reset();
+    compiler.feed("<wml/>", 6);
+    TEST_ASSERT(compiler.finish(wmlc, sizeof(wmlc)) == 5, "Compiles again after reset");
+    
+    std::string deep = "<wml>";
+    for (int i = 0; i < WMLC_MAX_DEPTH; i++) deep += "<p>";
+    TEST_ASSERT(WMLCCompiler::compile(deep.c_str(), deep.size(), wmlc, sizeof(wmlc)) == 0,
+                "Nesting too deep rejected");
+    
+    TEST_ASSERT(WMLCCompiler::compile(wap_corpus[2].wml, strlen(wap_corpus[2].wml), wmlc, 100) == 0,
+                "Output buffer too small");
+}
+
 int main() {
     printf("======================================\n");
     printf("  WAP Request Builder Test Suite\n");
@@ -469,6 +854,14 @@ int main() {
     testWAPResponseStatus();
     testContentTypeDecoding();
     testHTTPFormatting();
+    testReplyParserChunks();
+    testReplyParserPartial();
+    testWmlcStreamChunks();
+    testWmlcStreamErrors();
+    testWmlSinks();
+    testWmlcCompilerRoundTrip();
+    testWmlcCompilerSyntax();
+    testWmlcCompilerErrors();
     
     printf("\n======================================\n");
     printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
@@ -0,0 +1,561 @@
+/**
+ * test_wdp.cpp - Unit tests for the WDP mesh headers (legacy UDH and compact)
+ *
+ * Compile and run with:
+ *   g++ -std=c++11 -Ilib/wdp -Ilib/cobs -Ilib/nodeid -Itest test/test_wdp.cpp lib/wdp/wdp_header.cpp lib/wdp/wdp_control.cpp lib/wdp/wdp_fec.cpp lib/cobs/cobs.cpp -o test_wdp && ./test_wdp
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "wdp_header.h"
+#include "wdp_reassembler.h"
+#include "wdp_control.h"
+#include "wdp_fec.h"
+#include "wdp_raw.h"
+#include "cobs.h"
+#include "node_id.h"
+#include "wap_corpus.h"
+
+// Mirrors the frame limits in src/main.cpp
+#define MESHCORE_MAX_COBS_PAYLOAD    147
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        printf("  FAIL: %s\n", message); \
+        tests_failed++; \
+    } else { \
+        printf("  PASS: %s\n", message); \
+        tests_passed++; \
+    } \
+} while(0)
+
+typedef WDPReassembler<8192, 4> TestReassembler;
+
+static WDPHeaderInfo makeInfo(uint16_t src, uint16_t dst, bool concat, uint8_t ref,
+                              uint8_t total, uint8_t part, bool compact) {
+    WDPHeaderInfo info;
+    info.srcPort = src;
+    info.dstPort = dst;
+    info.concat = concat;
+    info.refNum = ref;
+    info.totalParts = total;
+    info.part = part;
+    info.compact = compact;
+    return info;
+}
+
+static bool sameHeader(const WDPHeaderInfo& a, const WDPHeaderInfo& b) {
+    return a.srcPort == b.srcPort && a.dstPort == b.dstPort && a.concat == b.concat &&
+           (!a.concat || (a.refNum == b.refNum && a.totalParts == b.totalParts && a.part == b.part));
+}
+
+void testLegacyHeaders() {
+    printf("\n=== Test: Legacy UDH ===\n");
+
+    // Same bytes the fragmenters have always sent
+    uint8_t simple[] = {0x06, 0x05, 0x04, 0x23, 0xF0, 0xC3, 0x50};
+    WDPHeaderInfo info;
+    TEST_ASSERT(WDPHeader::parse(simple, sizeof(simple), info) == 7, "Simple UDH parses to 7 bytes");
+    TEST_ASSERT(info.dstPort == 9200 && info.srcPort == 50000 && !info.concat && !info.compact, "Simple UDH fields");
+
+    uint8_t concat[] = {0x0B, 0x00, 0x03, 0x42, 0x03, 0x02, 0x05, 0x04, 0xC3, 0x50, 0x23, 0xF0};
+    TEST_ASSERT(WDPHeader::parse(concat, sizeof(concat), info) == 12, "Concat UDH parses to 12 bytes");
+    TEST_ASSERT(info.concat && info.refNum == 0x42 && info.totalParts == 3 && info.part == 2 &&
+                info.dstPort == 50000 && info.srcPort == 9200, "Concat UDH fields");
+
+    uint8_t out[WDP_HEADER_MAX_LEN];
+    TEST_ASSERT(WDPHeader::write(out, makeInfo(50000, 9200, false, 0, 1, 1, false)) == 7 &&
+                memcmp(out, simple, 7) == 0, "Simple UDH written byte for byte");
+    TEST_ASSERT(WDPHeader::write(out, makeInfo(9200, 50000, true, 0x42, 3, 2, false)) == 12 &&
+                memcmp(out, concat, 12) == 0, "Concat UDH written byte for byte");
+}
+
+void testCompactHeaders() {
+    printf("\n=== Test: Compact Header ===\n");
+
+    uint8_t out[WDP_HEADER_MAX_LEN];
+    WDPHeaderInfo info;
+
+    // Request to the WAPBox, reply from it, and a port override
+    size_t len = WDPHeader::write(out, makeInfo(50000, WDP_PORT_WSP, false, 0, 1, 1, true));
+    TEST_ASSERT(len == 3 && out[0] == (WDP_HEADER_COMPACT | WDP_COMPACT_DST_WSP), "Request header is 3 bytes");
+    TEST_ASSERT(WDPHeader::parse(out, len, info) == 3 && info.dstPort == WDP_PORT_WSP &&
+                info.srcPort == 50000 && info.compact, "Request header parses back");
+
+    len = WDPHeader::write(out, makeInfo(WDP_PORT_WSP, 50000, true, 7, 16, 16, true));
+    TEST_ASSERT(len == 5, "Reply part header is 5 bytes");
+    TEST_ASSERT(WDPHeader::parse(out, len, info) == 5 && info.srcPort == WDP_PORT_WSP && info.dstPort == 50000 &&
+                info.concat && info.refNum == 7 && info.part == 16 && info.totalParts == 16, "Reply part header parses back");
+
+    len = WDPHeader::write(out, makeInfo(2948, 2949, true, 1, 2, 1, true));
+    TEST_ASSERT(len == 7, "Port override header is 7 bytes");
+    TEST_ASSERT(WDPHeader::parse(out, len, info) == 7 && info.srcPort == 2948 && info.dstPort == 2949,
+                "Port override parses back");
+
+    // Too many parts for the nibbles - falls back to the legacy UDH
+    len = WDPHeader::write(out, makeInfo(WDP_PORT_WSP, 50000, true, 1, 17, 17, true));
+    TEST_ASSERT(len == 12 && out[0] == WDP_HEADER_LEGACY_CONCAT, "More than 16 parts uses the legacy UDH");
+
+    // Every combination roundtrips
+    bool allOk = true;
+    const uint16_t ports[] = {WDP_PORT_WSP, 1, 50000, 65535};
+    for (int c = 0; c < 2; c++) {
+        for (int s = 0; s < 4; s++) {
+            for (int d = 0; d < 4; d++) {
+                for (int total = 1; total <= 16; total++) {
+                    for (int part = 1; part <= total; part++) {
+                        WDPHeaderInfo in = makeInfo(ports[s], ports[d], c == 1, (uint8_t)(total * 13), total, part, true);
+                        size_t n = WDPHeader::write(out, in);
+                        if (WDPHeader::parse(out, n, info) != n || !sameHeader(in, info) || !info.compact) allOk = false;
+                        if (!WDPHeader::isCompact(out, n)) allOk = false;
+                    }
+                }
+            }
+        }
+    }
+    TEST_ASSERT(allOk, "All port/part combinations roundtrip");
+}
+
+void testInvalidHeaders() {
+    printf("\n=== Test: Invalid Headers ===\n");
+
+    WDPHeaderInfo info;
+    const char* error = nullptr;
+    uint8_t shortSimple[] = {0x06, 0x05, 0x04, 0x23};
+    TEST_ASSERT(WDPHeader::parse(shortSimple, sizeof(shortSimple), info, &error) == 0 && error != nullptr,
+                "Truncated UDH rejected with a reason");
+    uint8_t badLen[] = {0x07, 0x05, 0x04, 0x23, 0xF0, 0xC3, 0x50};
+    TEST_ASSERT(WDPHeader::parse(badLen, sizeof(badLen), info) == 0, "Unknown UDH length rejected");
+    uint8_t zeroPort[] = {0x06, 0x05, 0x04, 0x00, 0x00, 0xC3, 0x50};
+    TEST_ASSERT(WDPHeader::parse(zeroPort, sizeof(zeroPort), info) == 0, "Zero port rejected");
+    uint8_t badPart[] = {0x0B, 0x00, 0x03, 0x42, 0x02, 0x03, 0x05, 0x04, 0xC3, 0x50, 0x23, 0xF0};
+    TEST_ASSERT(WDPHeader::parse(badPart, sizeof(badPart), info) == 0, "Part beyond total rejected");
+    uint8_t compactPartBeyond[] = {WDP_HEADER_COMPACT | WDP_COMPACT_CONCAT | WDP_COMPACT_SRC_WSP, 1, 0x31, 0xC3, 0x50};
+    TEST_ASSERT(WDPHeader::parse(compactPartBeyond, sizeof(compactPartBeyond), info) == 0, "Compact part beyond total rejected");
+    uint8_t compactBoth[] = {WDP_HEADER_COMPACT | WDP_COMPACT_SRC_WSP | WDP_COMPACT_DST_WSP, 0xC3, 0x50};
+    TEST_ASSERT(WDPHeader::parse(compactBoth, sizeof(compactBoth), info) == 0, "Compact header with both ports implied rejected");
+    uint8_t compactShort[] = {WDP_HEADER_COMPACT, 0xC3, 0x50};
+    TEST_ASSERT(WDPHeader::parse(compactShort, sizeof(compactShort), info) == 0, "Compact port override too short rejected");
+    TEST_ASSERT(WDPHeader::parse(nullptr, 0, info) == 0, "Empty message rejected");
+}
+
+// Feed parts of data (sizes in partLens) in the given order, returns the final status
+template <typename Reassembler>
+static WDPReassemblyStatus feedParts(Reassembler& reassembler, uint32_t sender, uint8_t ref,
+                                     const uint8_t* data, const size_t* partLens, int totalParts,
+                                     const int* order, typename Reassembler::Message** msg) {
+    size_t offsets[WDP_MAX_PARTS];
+    size_t offset = 0;
+    for (int i = 0; i < totalParts; i++) {
+        offsets[i] = offset;
+        offset += partLens[i];
+    }
+    WDPReassemblyStatus status = WDP_REASSEMBLY_INVALID;
+    for (int i = 0; i < totalParts; i++) {
+        int p = order[i];
+        WDPHeaderInfo hdr = makeInfo(WDP_PORT_WSP, 50000, true, ref, totalParts, p + 1, true);
+        status = reassembler.addPart(sender, hdr, &data[offsets[p]], partLens[p], 1000 + i, msg);
+    }
+    return status;
+}
+
+void testReassembly() {
+    printf("\n=== Test: Reassembly ===\n");
+
+    static TestReassembler reassembler;
+    TestReassembler::Message* msg = nullptr;
+    static uint8_t data[8192];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(rand() & 0xFF);
+    }
+    static const uint8_t pubKey[] = {0xa1, 0xb2, 0xc3, 0xd4, 0x55, 0x66};
+    uint32_t sender = meshNodeId(pubKey);
+    TEST_ASSERT(sender == 0xa1b2c3d4, "Sender ID from the public key prefix");
+
+    // Variable part sizes (as planned for Base91) in order, reversed and shuffled
+    size_t partLens[40];
+    int order[WDP_MAX_PARTS];
+    size_t total = 0;
+    for (int i = 0; i < 40; i++) {
+        partLens[i] = 100 + rand() % 43;
+        total += partLens[i];
+    }
+    const char* orders[] = {"In order", "Reversed", "Shuffled"};
+    for (int mode = 0; mode < 3; mode++) {
+        for (int i = 0; i < 40; i++) {
+            order[i] = (mode == 1) ? 39 - i : i;
+        }
+        if (mode == 2) {
+            for (int i = 39; i > 0; i--) {
+                std::swap(order[i], order[rand() % (i + 1)]);
+            }
+        }
+        WDPReassemblyStatus status = feedParts(reassembler, sender, (uint8_t)mode, data, partLens, 40, order, &msg);
+        bool ok = status == WDP_REASSEMBLY_COMPLETE && msg != nullptr &&
+                  reassembler.assemble(msg) == total && memcmp(msg->data, data, total) == 0;
+        char label[64];
+        snprintf(label, sizeof(label), "%s variable-size parts reassemble", orders[mode]);
+        TEST_ASSERT(ok, label);
+        if (msg) {
+            reassembler.release(msg);
+        }
+    }
+
+    // 255 one-byte-to-sixteen-byte parts, shuffled
+    size_t smallLens[WDP_MAX_PARTS];
+    total = 0;
+    for (int i = 0; i < WDP_MAX_PARTS; i++) {
+        smallLens[i] = 1 + rand() % 16;
+        total += smallLens[i];
+        order[i] = i;
+    }
+    for (int i = WDP_MAX_PARTS - 1; i > 0; i--) {
+        std::swap(order[i], order[rand() % (i + 1)]);
+    }
+    WDPReassemblyStatus status = feedParts(reassembler, sender, 7, data, smallLens, WDP_MAX_PARTS, order, &msg);
+    TEST_ASSERT(status == WDP_REASSEMBLY_COMPLETE && reassembler.assemble(msg) == total &&
+                memcmp(msg->data, data, total) == 0, "255 shuffled parts reassemble");
+    reassembler.release(msg);
+
+    // Duplicates, interleaved senders, overflow, no free slot
+    WDPHeaderInfo hdr = makeInfo(WDP_PORT_WSP, 50000, true, 9, 3, 2, true);
+    reassembler.addPart(1, hdr, data, 100, 0, &msg);
+    TEST_ASSERT(reassembler.addPart(1, hdr, data, 100, 0, &msg) == WDP_REASSEMBLY_DUPLICATE, "Duplicate part ignored");
+    TEST_ASSERT(reassembler.addPart(2, hdr, data, 100, 0, &msg) == WDP_REASSEMBLY_STORED, "Same ref from another sender is separate");
+    hdr.part = 1;
+    TEST_ASSERT(reassembler.addPart(1, hdr, data, 100, 0, &msg) == WDP_REASSEMBLY_STORED && msg->receivedParts == 2,
+                "Parts of interleaved messages go to their own slot");
+    TEST_ASSERT(reassembler.activeCount() == 2, "Two messages in progress");
+    hdr.totalParts = 100;
+    hdr.part = 1;
+    bool overflow = false;
+    for (int p = 1; p <= 100 && !overflow; p++) {
+        hdr.part = p;
+        overflow = reassembler.addPart(3, hdr, data, 142, 0, &msg) == WDP_REASSEMBLY_OVERFLOW;
+    }
+    TEST_ASSERT(overflow, "Message larger than the buffer overflows");
+    hdr.totalParts = 2;
+    hdr.part = 1;
+    reassembler.addPart(4, hdr, data, 10, 0, &msg);
+    TEST_ASSERT(reassembler.addPart(5, hdr, data, 10, 0, &msg) == WDP_REASSEMBLY_NO_SLOT, "No slot when all are busy");
+    hdr.part = 3;
+    TEST_ASSERT(reassembler.addPart(4, hdr, data, 10, 0, &msg) == WDP_REASSEMBLY_INVALID, "Part beyond total rejected");
+
+    TEST_ASSERT(reassembler.expire(30001, 30000) == 4 && reassembler.activeCount() == 0, "Stale messages expire");
+}
+
+void testNack() {
+    printf("\n=== Test: NACK ===\n");
+
+    // Roundtrip every part count with random gaps
+    bool allOk = true;
+    uint8_t frame[WDP_NACK_MAX_LEN];
+    for (int total = 1; total <= WDP_MAX_PARTS; total++) {
+        WDPNack nack;
+        nack.refNum = (uint8_t)total;
+        nack.totalParts = (uint8_t)total;
+        nack.port = 50000;
+        memset(nack.missing, 0, sizeof(nack.missing));
+        int expected = 0;
+        for (int part = 1; part <= total; part++) {
+            if (rand() % 3 == 0) {
+                nack.missing[(part - 1) >> 3] |= (1 << ((part - 1) & 7));
+                expected++;
+            }
+        }
+        size_t len = WDPControl::writeNack(frame, nack);
+        WDPNack parsed;
+        if (len != 5 + (size_t)(total + 7) / 8 || !WDPControl::isControl(frame, len) ||
+            !WDPControl::parseNack(frame, len, parsed) || parsed.refNum != nack.refNum ||
+            parsed.totalParts != total || parsed.port != 50000 || WDPControl::missingCount(parsed) != expected) {
+            allOk = false;
+        }
+        for (int part = 1; part <= total; part++) {
+            if (WDPControl::isMissing(parsed, part) != WDPControl::isMissing(nack, part)) {
+                allOk = false;
+            }
+        }
+    }
+    TEST_ASSERT(allOk, "NACK roundtrips for 1..255 parts");
+    TEST_ASSERT(WDP_NACK_MAX_LEN == 37, "NACK for 255 parts is 37 bytes");
+
+    // Not mistaken for WDP headers (and the other way around)
+    WDPHeaderInfo info;
+    TEST_ASSERT(WDPHeader::parse(frame, 5, info) == 0, "NACK is not a WDP header");
+    uint8_t hdr[WDP_HEADER_MAX_LEN];
+    bool noControl = true;
+    for (int c = 0; c < 2; c++) {
+        for (int compact = 0; compact < 2; compact++) {
+            size_t n = WDPHeader::write(hdr, makeInfo(WDP_PORT_WSP, 50000, c == 1, 1, 2, 1, compact == 1));
+            noControl = noControl && !WDPControl::isControl(hdr, n);
+        }
+    }
+    TEST_ASSERT(noControl, "WDP headers are not control frames");
+
+    WDPNack nack;
+    const char* error = nullptr;
+    uint8_t badLen[] = {WDP_CONTROL_NACK, 1, 9, 0xC3, 0x50, 0xFF};
+    TEST_ASSERT(!WDPControl::parseNack(badLen, sizeof(badLen), nack, &error) && error != nullptr,
+                "NACK with short bitmap rejected");
+    uint8_t zeroParts[] = {WDP_CONTROL_NACK, 1, 0, 0xC3, 0x50};
+    TEST_ASSERT(!WDPControl::parseNack(zeroParts, sizeof(zeroParts), nack), "NACK for zero parts rejected");
+
+    // Lose parts, NACK them from the reassembler state, retransmit only those
+    static TestReassembler reassembler;
+    TestReassembler::Message* msg = nullptr;
+    static uint8_t data[8192];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(rand() & 0xFF);
+    }
+    const int total = 10;
+    const size_t partLen = 135;
+    bool lost[total] = {false, false, true, false, false, false, true, false, false, true};
+    for (int p = 1; p <= total; p++) {
+        if (!lost[p - 1]) {
+            WDPHeaderInfo part = makeInfo(WDP_PORT_WSP, 50000, true, 33, total, p, true);
+            reassembler.addPart(0x1234, part, &data[(p - 1) * partLen], partLen, 0, &msg);
+        }
+    }
+    nack.refNum = msg->refNum;
+    nack.totalParts = msg->totalParts;
+    nack.port = msg->dstPort;
+    uint8_t gaps[WDP_NACK_BITMAP_LEN];
+    TEST_ASSERT(TestReassembler::highestPart(msg) == 9 &&
+                TestReassembler::missingParts(msg, gaps, TestReassembler::highestPart(msg)) == 2 &&
+                gaps[0] == 0x44 && gaps[1] == 0x00, "Gaps below the highest part received exclude the lost tail");
+    TEST_ASSERT(TestReassembler::missingParts(msg, nack.missing) == 3, "Reassembler reports 3 missing parts");
+    size_t len = WDPControl::writeNack(frame, nack);
+    TEST_ASSERT(len == 7, "NACK for 10 parts is 7 bytes");
+
+    WDPNack received;
+    WDPControl::parseNack(frame, len, received);
+    WDPReassemblyStatus status = WDP_REASSEMBLY_INVALID;
+    int resent = 0;
+    for (int p = 1; p <= received.totalParts; p++) {
+        if (WDPControl::isMissing(received, p)) {
+            WDPHeaderInfo part = makeInfo(WDP_PORT_WSP, received.port, true, received.refNum, received.totalParts, p, true);
+            status = reassembler.addPart(0x1234, part, &data[(p - 1) * partLen], partLen, 0, &msg);
+            resent++;
+        }
+    }
+    TEST_ASSERT(resent == 3 && status == WDP_REASSEMBLY_COMPLETE &&
+                reassembler.assemble(msg) == total * partLen && memcmp(msg->data, data, total * partLen) == 0,
+                "Only the missing parts are resent and the message completes");
+    reassembler.release(msg);
+}
+
+void testFec() {
+    printf("\n=== Test: FEC ===\n");
+
+    static uint8_t data[WDP_FEC_MAX_GROUP][WDP_FEC_MAX_BLOCK];
+    static uint8_t rebuilt[WDP_FEC_MAX_GROUP][WDP_FEC_MAX_BLOCK];
+    static uint8_t parity[WDP_FEC_MAX_PARITY][WDP_FEC_MAX_BLOCK];
+
+    // Every group size and parity count, random lengths, random losses among data and parity
+    bool recoverOk = true;
+    bool failOk = true;
+    int trials = 0;
+    for (int k = 1; k <= WDP_FEC_MAX_GROUP; k++) {
+        for (int m = 1; m <= WDP_FEC_MAX_PARITY; m++) {
+            for (int trial = 0; trial < 20; trial++, trials++) {
+                const uint8_t* parts[WDP_FEC_MAX_GROUP];
+                size_t lens[WDP_FEC_MAX_GROUP];
+                size_t maxLen = 0;
+                for (int i = 0; i < k; i++) {
+                    lens[i] = 1 + rand() % 142;
+                    for (size_t t = 0; t < lens[i]; t++) {
+                        data[i][t] = (uint8_t)(rand() & 0xFF);
+                    }
+                    parts[i] = data[i];
+                    maxLen = (lens[i] > maxLen) ? lens[i] : maxLen;
+                }
+                size_t blockLen = maxLen + 1;
+                for (int j = 0; j < m; j++) {
+                    WDPFec::encode(parts, lens, k, j, parity[j], blockLen);
+                }
+
+                // Lose up to m + 1 of the k + m frames
+                bool present[WDP_FEC_MAX_GROUP];
+                bool parityPresent[WDP_FEC_MAX_PARITY];
+                for (int i = 0; i < k; i++) present[i] = true;
+                for (int j = 0; j < m; j++) parityPresent[j] = true;
+                int losses = rand() % (m + 2);
+                for (int l = 0; l < losses; l++) {
+                    int idx = rand() % (k + m);
+                    if (idx < k) present[idx] = false; else parityPresent[idx - k] = false;
+                }
+
+                uint8_t* io[WDP_FEC_MAX_GROUP];
+                size_t ioLens[WDP_FEC_MAX_GROUP];
+                int lostData = 0;
+                for (int i = 0; i < k; i++) {
+                    io[i] = present[i] ? data[i] : rebuilt[i];
+                    ioLens[i] = present[i] ? lens[i] : 0;
+                    lostData += present[i] ? 0 : 1;
+                }
+                const uint8_t* blocks[WDP_FEC_MAX_PARITY];
+                uint8_t indexes[WDP_FEC_MAX_PARITY];
+                int blockCount = 0;
+                for (int j = 0; j < m; j++) {
+                    if (parityPresent[j]) {
+                        blocks[blockCount] = parity[j];
+                        indexes[blockCount++] = (uint8_t)j;
+                    }
+                }
+
+                bool decoded = WDPFec::decode(io, ioLens, present, k, blocks, indexes, blockCount, blockLen);
+                if (lostData <= blockCount) {
+                    for (int i = 0; i < k && decoded; i++) {
+                        if (!present[i] && (ioLens[i] != lens[i] || memcmp(rebuilt[i], data[i], lens[i]) != 0)) {
+                            decoded = false;
+                        }
+                    }
+                    recoverOk = recoverOk && decoded;
+                } else {
+                    failOk = failOk && !decoded;
+                }
+            }
+        }
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "Lost parts rebuilt from parity (%d random groups)", trials);
+    TEST_ASSERT(recoverOk, label);
+    TEST_ASSERT(failOk, "More losses than parity blocks reported as unrecoverable");
+
+    // Parity frame header
+    WDPParity info = {7, 40, 50000, 9, 8, 1, 2};
+    uint8_t frame[WDP_PARITY_HEADER_LEN + 4] = {0};
+    size_t hdrLen = WDPControl::writeParityHeader(frame, info);
+    WDPParity parsed;
+    TEST_ASSERT(hdrLen == WDP_PARITY_HEADER_LEN && WDPControl::isControl(frame, sizeof(frame)) &&
+                WDPControl::parseParity(frame, sizeof(frame), parsed) == WDP_PARITY_HEADER_LEN &&
+                parsed.refNum == 7 && parsed.totalParts == 40 && parsed.port == 50000 && parsed.firstPart == 9 &&
+                parsed.groupSize == 8 && parsed.index == 1 && parsed.count == 2, "Parity header roundtrips");
+    info.firstPart = 35;
+    WDPControl::writeParityHeader(frame, info);
+    TEST_ASSERT(WDPControl::parseParity(frame, sizeof(frame), parsed) == 0, "Parity group beyond the last part rejected");
+    info.firstPart = 9;
+    info.index = 2;
+    WDPControl::writeParityHeader(frame, info);
+    TEST_ASSERT(WDPControl::parseParity(frame, sizeof(frame), parsed) == 0, "Parity index beyond count rejected");
+    WDPNack nack;
+    TEST_ASSERT(!WDPControl::parseNack(frame, sizeof(frame), nack), "Parity frame is not a NACK");
+}
+
+void testRawFrame() {
+    printf("\n=== Test: Raw Frames ===\n");
+
+    uint8_t hdr[WDP_HEADER_MAX_LEN];
+    WDPHeaderInfo info = makeInfo(WDP_PORT_WSP, 50000, true, 0x42, 3, 2, true);
+    size_t hdrLen = WDPHeader::write(hdr, info);
+    uint8_t payload[40];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    // Decrypted requests come padded with zeros to a 16-byte block
+    uint8_t frame[64];
+    memset(frame, 0, sizeof(frame));
+    size_t frameLen = WDPRawFrame::write(frame, hdr, hdrLen, payload, sizeof(payload));
+    TEST_ASSERT(frameLen == WDP_RAW_HEADER_LEN + hdrLen + sizeof(payload), "Raw frame length");
+    size_t padded = (frameLen + 15) / 16 * 16;
+    TEST_ASSERT(padded > frameLen, "Frame is padded");
+
+    size_t msgLen = 0;
+    const uint8_t* msg = WDPRawFrame::parse(frame, padded, msgLen);
+    TEST_ASSERT(msg != nullptr && msgLen == hdrLen + sizeof(payload), "Padding trimmed off");
+    WDPHeaderInfo parsed;
+    size_t parsedLen = msg ? WDPHeader::parse(msg, msgLen, parsed) : 0;
+    TEST_ASSERT(parsedLen == hdrLen && parsed.part == 2 && parsed.totalParts == 3, "Header round-trips");
+    TEST_ASSERT(parsedLen == hdrLen && memcmp(msg + parsedLen, payload, sizeof(payload)) == 0,
+                "Payload round-trips without padding");
+
+    TEST_ASSERT(WDPRawFrame::parse(frame, frameLen - 1, msgLen) == nullptr, "Truncated frame rejected");
+    frame[0] = 0x01;
+    TEST_ASSERT(WDPRawFrame::parse(frame, padded, msgLen) == nullptr, "Other request types ignored");
+}
+
+// Bytes on air for a corpus reply (COBS framing, fixed-size parts)
+static size_t replyOnAir(const WapCorpusPage& page, bool compact, int* partsOut) {
+    uint8_t hdr[WDP_HEADER_MAX_LEN];
+    uint8_t msg[MESHCORE_MAX_COBS_PAYLOAD];
+    char encoded[MESHCORE_MAX_COBS_PAYLOAD + 8];
+
+    WDPHeaderInfo info = makeInfo(WDP_PORT_WSP, 50000, false, 0x42, 1, 1, compact);
+    size_t simpleHdr = WDPHeader::write(hdr, info);
+    info.concat = true;
+    info.totalParts = 16;
+    size_t concatHdr = WDPHeader::write(hdr, info);
+
+    int totalParts = 1;
+    size_t maxPart = MESHCORE_MAX_COBS_PAYLOAD - simpleHdr;
+    if (page.pduLen > maxPart) {
+        maxPart = MESHCORE_MAX_COBS_PAYLOAD - concatHdr;
+        totalParts = (page.pduLen + maxPart - 1) / maxPart;
+    }
+
+    size_t total = 0;
+    for (int part = 1; part <= totalParts; part++) {
+        info.concat = totalParts > 1;
+        info.totalParts = totalParts;
+        info.part = part;
+        size_t hdrLen = WDPHeader::write(msg, info);
+        size_t offset = (part - 1) * maxPart;
+        size_t partLen = (page.pduLen - offset < maxPart) ? page.pduLen - offset : maxPart;
+        memcpy(&msg[hdrLen], &page.pdu[offset], partLen);
+        total += Cobs::encode(msg, hdrLen + partLen, encoded, sizeof(encoded));
+    }
+    *partsOut = totalParts;
+    return total;
+}
+
+void benchmarkCorpus() {
+    printf("\n=== Benchmark: Header Overhead Per Corpus Page (COBS) ===\n");
+    printf("  %-10s %6s | %6s %6s | %6s %6s | %6s\n", "page", "bytes", "udh #", "chars", "cmp #", "chars", "saved");
+
+    size_t totalLegacy = 0;
+    size_t totalCompact = 0;
+    for (size_t i = 0; i < wap_corpus_count; i++) {
+        int partsLegacy = 0, partsCompact = 0;
+        size_t legacy = replyOnAir(wap_corpus[i], false, &partsLegacy);
+        size_t compact = replyOnAir(wap_corpus[i], true, &partsCompact);
+        totalLegacy += legacy;
+        totalCompact += compact;
+        printf("  %-10s %6zu | %6d %6zu | %6d %6zu | %5.1f%%\n", wap_corpus[i].name, wap_corpus[i].pduLen,
+               partsLegacy, legacy, partsCompact, compact, 100.0 * (legacy - compact) / legacy);
+    }
+    printf("  %-10s %6s | %6s %6zu | %6s %6zu | %5.1f%%\n", "total", "", "", totalLegacy, "", totalCompact,
+           100.0 * (totalLegacy - totalCompact) / totalLegacy);
+
+    TEST_ASSERT(totalCompact < totalLegacy, "Compact headers put fewer bytes on air");
+}
+
+int main() {
+    srand(42);
+
+    printf("======================================\n");
+    printf("  WDP Header Test Suite\n");
+    printf("======================================\n");
+
+    testLegacyHeaders();
+    testCompactHeaders();
+    testInvalidHeaders();
+    testReassembly();
+    testNack();
+    testFec();
+    testRawFrame();
+    benchmarkCorpus();
+
+    printf("\n======================================\n");
+    printf("  Results: %d passed, %d failed\n", tests_passed, tests_failed);
+    printf("======================================\n");
+
+    return tests_failed > 0 ? 1 : 0;
+}
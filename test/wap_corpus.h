@@ -0,0 +1,249 @@
+/**
+ * wap_corpus.h - Reference WSP reply corpus for native tests and benchmarks
+ *
+ * Each page is a complete WSP Reply PDU (TID, Reply PDU, 200 OK, headers,
+ * WMLC body) as a WAPBox returns it for a typical portal page. The WMLC
+ * bodies were compiled from the WML sources below with a Kannel-style
+ * WBXML 1.3 / WML 1.1 encoder (string table for repeated text, inline
+ * strings otherwise), so they use the same token tables as the decompiler.
+ */
+
+#ifndef WAP_CORPUS_H
+#define WAP_CORPUS_H
+
+#include <cstdint>
+#include <cstddef>
+
+struct WapCorpusPage {
+    const char* name;
+    const char* url;
+    const char* wml;        // WML source the WMLC body was compiled from
+    const uint8_t* pdu;     // WSP Reply PDU including transaction ID
+    size_t pduLen;
+};
+
+static const uint8_t wap_corpus_portal[] = {
+    0x10, 0x04, 0x20, 0x16, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0x02, 0x01, 0x24, 0x03, 0x04, 0x6A, 0x00, 0x7F, 0xE7,
+    0x55, 0x03, 0x68, 0x6F, 0x6D, 0x65, 0x00, 0x36, 0x03, 0x42, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61,
+    0x63, 0x6F, 0x6D, 0x00, 0x01, 0xE0, 0x07, 0x01, 0x64, 0x03, 0x42, 0x65, 0x76, 0x65, 0x6C, 0x67,
+    0x61, 0x63, 0x6F, 0x6D, 0x20, 0x57, 0x41, 0x50, 0x00, 0x01, 0x26, 0x03, 0x57, 0x65, 0x6C, 0x63,
+    0x6F, 0x6D, 0x65, 0x20, 0x74, 0x6F, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6D, 0x6F, 0x62, 0x69, 0x6C,
+    0x65, 0x20, 0x70, 0x6F, 0x72, 0x74, 0x61, 0x6C, 0x00, 0x01, 0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61,
+    0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F,
+    0x6E, 0x65, 0x77, 0x73, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x4E, 0x65, 0x77, 0x73, 0x00,
+    0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61,
+    0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x77, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x2E, 0x77,
+    0x6D, 0x6C, 0x00, 0x01, 0x03, 0x57, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x00, 0x01, 0x26, 0xDC,
+    0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D,
+    0x2E, 0x62, 0x65, 0x2F, 0x73, 0x65, 0x61, 0x72, 0x63, 0x68, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01,
+    0x03, 0x53, 0x65, 0x61, 0x72, 0x63, 0x68, 0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70,
+    0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x67,
+    0x61, 0x6D, 0x65, 0x73, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x47, 0x61, 0x6D, 0x65, 0x73,
+    0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67,
+    0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x61, 0x62, 0x6F, 0x75, 0x74, 0x2E, 0x77, 0x6D,
+    0x6C, 0x00, 0x01, 0x03, 0x41, 0x62, 0x6F, 0x75, 0x74, 0x00, 0x01, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t wap_corpus_news[] = {
+    0x11, 0x04, 0x20, 0x16, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0x02, 0x02, 0x04, 0x03, 0x04, 0x6A, 0x00, 0x7F, 0xE7,
+    0x55, 0x03, 0x6E, 0x65, 0x77, 0x73, 0x00, 0x36, 0x03, 0x4E, 0x65, 0x77, 0x73, 0x00, 0x01, 0x60,
+    0x64, 0x03, 0x48, 0x65, 0x61, 0x64, 0x6C, 0x69, 0x6E, 0x65, 0x73, 0x00, 0x01, 0x01, 0x60, 0xDC,
+    0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D,
+    0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2F, 0x31, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01,
+    0x03, 0x4D, 0x65, 0x73, 0x68, 0x20, 0x6E, 0x65, 0x74, 0x77, 0x6F, 0x72, 0x6B, 0x20, 0x6C, 0x69,
+    0x6E, 0x6B, 0x73, 0x20, 0x74, 0x68, 0x72, 0x65, 0x65, 0x20, 0x76, 0x69, 0x6C, 0x6C, 0x61, 0x67,
+    0x65, 0x73, 0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65,
+    0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2F, 0x32,
+    0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x4C, 0x6F, 0x52, 0x61, 0x20, 0x67, 0x61, 0x74, 0x65,
+    0x77, 0x61, 0x79, 0x20, 0x63, 0x6F, 0x75, 0x6E, 0x74, 0x20, 0x70, 0x61, 0x73, 0x73, 0x65, 0x73,
+    0x20, 0x74, 0x65, 0x6E, 0x20, 0x74, 0x68, 0x6F, 0x75, 0x73, 0x61, 0x6E, 0x64, 0x00, 0x01, 0x26,
+    0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F,
+    0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2F, 0x33, 0x2E, 0x77, 0x6D, 0x6C, 0x00,
+    0x01, 0x03, 0x52, 0x65, 0x74, 0x72, 0x6F, 0x20, 0x70, 0x68, 0x6F, 0x6E, 0x65, 0x73, 0x20, 0x66,
+    0x69, 0x6E, 0x64, 0x20, 0x61, 0x20, 0x73, 0x65, 0x63, 0x6F, 0x6E, 0x64, 0x20, 0x6C, 0x69, 0x66,
+    0x65, 0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C,
+    0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2F, 0x34, 0x2E,
+    0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x4C, 0x6F, 0x63, 0x61, 0x6C, 0x20, 0x72, 0x61, 0x64, 0x69,
+    0x6F, 0x20, 0x63, 0x6C, 0x75, 0x62, 0x20, 0x68, 0x6F, 0x73, 0x74, 0x73, 0x20, 0x61, 0x6E, 0x74,
+    0x65, 0x6E, 0x6E, 0x61, 0x20, 0x77, 0x6F, 0x72, 0x6B, 0x73, 0x68, 0x6F, 0x70, 0x00, 0x01, 0x26,
+    0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F,
+    0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2F, 0x35, 0x2E, 0x77, 0x6D, 0x6C, 0x00,
+    0x01, 0x03, 0x53, 0x6F, 0x6C, 0x61, 0x72, 0x20, 0x72, 0x65, 0x70, 0x65, 0x61, 0x74, 0x65, 0x72,
+    0x20, 0x73, 0x75, 0x72, 0x76, 0x69, 0x76, 0x65, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x77, 0x69,
+    0x6E, 0x74, 0x65, 0x72, 0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65,
+    0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73,
+    0x2F, 0x36, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x56, 0x6F, 0x6C, 0x75, 0x6E, 0x74, 0x65,
+    0x65, 0x72, 0x73, 0x20, 0x6D, 0x61, 0x70, 0x20, 0x63, 0x6F, 0x76, 0x65, 0x72, 0x61, 0x67, 0x65,
+    0x20, 0x61, 0x6C, 0x6F, 0x6E, 0x67, 0x20, 0x74, 0x68, 0x65, 0x20, 0x63, 0x6F, 0x61, 0x73, 0x74,
+    0x00, 0x01, 0x01, 0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C,
+    0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E, 0x77,
+    0x6D, 0x6C, 0x00, 0x01, 0x03, 0x48, 0x6F, 0x6D, 0x65, 0x00, 0x01, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t wap_corpus_article[] = {
+    0x12, 0x04, 0x20, 0x16, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0x02, 0x04, 0x7C, 0x03, 0x04, 0x6A, 0x00, 0x7F, 0xE7,
+    0x55, 0x03, 0x61, 0x31, 0x00, 0x36, 0x03, 0x4D, 0x65, 0x73, 0x68, 0x20, 0x6C, 0x69, 0x6E, 0x6B,
+    0x73, 0x20, 0x76, 0x69, 0x6C, 0x6C, 0x61, 0x67, 0x65, 0x73, 0x00, 0x01, 0x60, 0x64, 0x03, 0x4D,
+    0x65, 0x73, 0x68, 0x20, 0x6E, 0x65, 0x74, 0x77, 0x6F, 0x72, 0x6B, 0x20, 0x6C, 0x69, 0x6E, 0x6B,
+    0x73, 0x20, 0x74, 0x68, 0x72, 0x65, 0x65, 0x20, 0x76, 0x69, 0x6C, 0x6C, 0x61, 0x67, 0x65, 0x73,
+    0x00, 0x01, 0x01, 0x60, 0x03, 0x52, 0x65, 0x73, 0x69, 0x64, 0x65, 0x6E, 0x74, 0x73, 0x20, 0x6F,
+    0x66, 0x20, 0x74, 0x68, 0x72, 0x65, 0x65, 0x20, 0x6E, 0x65, 0x69, 0x67, 0x68, 0x62, 0x6F, 0x75,
+    0x72, 0x69, 0x6E, 0x67, 0x20, 0x76, 0x69, 0x6C, 0x6C, 0x61, 0x67, 0x65, 0x73, 0x20, 0x63, 0x61,
+    0x6E, 0x20, 0x6E, 0x6F, 0x77, 0x20, 0x65, 0x78, 0x63, 0x68, 0x61, 0x6E, 0x67, 0x65, 0x20, 0x6D,
+    0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x73, 0x20, 0x77, 0x69, 0x74, 0x68, 0x6F, 0x75, 0x74, 0x20,
+    0x61, 0x6E, 0x79, 0x20, 0x6D, 0x6F, 0x62, 0x69, 0x6C, 0x65, 0x20, 0x63, 0x6F, 0x76, 0x65, 0x72,
+    0x61, 0x67, 0x65, 0x2E, 0x20, 0x41, 0x20, 0x68, 0x61, 0x6E, 0x64, 0x66, 0x75, 0x6C, 0x20, 0x6F,
+    0x66, 0x20, 0x76, 0x6F, 0x6C, 0x75, 0x6E, 0x74, 0x65, 0x65, 0x72, 0x73, 0x20, 0x69, 0x6E, 0x73,
+    0x74, 0x61, 0x6C, 0x6C, 0x65, 0x64, 0x20, 0x73, 0x6F, 0x6C, 0x61, 0x72, 0x20, 0x70, 0x6F, 0x77,
+    0x65, 0x72, 0x65, 0x64, 0x20, 0x72, 0x65, 0x70, 0x65, 0x61, 0x74, 0x65, 0x72, 0x73, 0x20, 0x6F,
+    0x6E, 0x20, 0x61, 0x20, 0x63, 0x68, 0x75, 0x72, 0x63, 0x68, 0x20, 0x74, 0x6F, 0x77, 0x65, 0x72,
+    0x2C, 0x20, 0x61, 0x20, 0x77, 0x61, 0x74, 0x65, 0x72, 0x20, 0x74, 0x6F, 0x77, 0x65, 0x72, 0x20,
+    0x61, 0x6E, 0x64, 0x20, 0x61, 0x20, 0x66, 0x61, 0x72, 0x6D, 0x20, 0x73, 0x69, 0x6C, 0x6F, 0x2E,
+    0x20, 0x54, 0x68, 0x65, 0x20, 0x72, 0x65, 0x70, 0x65, 0x61, 0x74, 0x65, 0x72, 0x73, 0x20, 0x72,
+    0x65, 0x6C, 0x61, 0x79, 0x20, 0x73, 0x6D, 0x61, 0x6C, 0x6C, 0x20, 0x74, 0x65, 0x78, 0x74, 0x20,
+    0x70, 0x61, 0x63, 0x6B, 0x65, 0x74, 0x73, 0x20, 0x6F, 0x76, 0x65, 0x72, 0x20, 0x6C, 0x6F, 0x6E,
+    0x67, 0x20, 0x72, 0x61, 0x6E, 0x67, 0x65, 0x20, 0x72, 0x61, 0x64, 0x69, 0x6F, 0x2C, 0x20, 0x61,
+    0x6E, 0x64, 0x20, 0x65, 0x61, 0x63, 0x68, 0x20, 0x68, 0x6F, 0x70, 0x20, 0x63, 0x61, 0x6E, 0x20,
+    0x63, 0x6F, 0x76, 0x65, 0x72, 0x20, 0x73, 0x65, 0x76, 0x65, 0x72, 0x61, 0x6C, 0x20, 0x6B, 0x69,
+    0x6C, 0x6F, 0x6D, 0x65, 0x74, 0x72, 0x65, 0x73, 0x20, 0x6F, 0x6E, 0x20, 0x61, 0x20, 0x63, 0x6C,
+    0x65, 0x61, 0x72, 0x20, 0x64, 0x61, 0x79, 0x2E, 0x00, 0x01, 0x60, 0x03, 0x54, 0x68, 0x65, 0x20,
+    0x6F, 0x72, 0x67, 0x61, 0x6E, 0x69, 0x73, 0x65, 0x72, 0x73, 0x20, 0x73, 0x61, 0x79, 0x20, 0x74,
+    0x68, 0x65, 0x20, 0x6E, 0x65, 0x74, 0x77, 0x6F, 0x72, 0x6B, 0x20, 0x77, 0x61, 0x73, 0x20, 0x66,
+    0x69, 0x72, 0x73, 0x74, 0x20, 0x62, 0x75, 0x69, 0x6C, 0x74, 0x20, 0x61, 0x73, 0x20, 0x61, 0x20,
+    0x62, 0x61, 0x63, 0x6B, 0x75, 0x70, 0x20, 0x66, 0x6F, 0x72, 0x20, 0x73, 0x74, 0x6F, 0x72, 0x6D,
+    0x73, 0x20, 0x61, 0x6E, 0x64, 0x20, 0x70, 0x6F, 0x77, 0x65, 0x72, 0x20, 0x63, 0x75, 0x74, 0x73,
+    0x2C, 0x20, 0x77, 0x68, 0x65, 0x6E, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6C, 0x6F, 0x63, 0x61, 0x6C,
+    0x20, 0x6D, 0x6F, 0x62, 0x69, 0x6C, 0x65, 0x20, 0x6D, 0x61, 0x73, 0x74, 0x73, 0x20, 0x74, 0x65,
+    0x6E, 0x64, 0x20, 0x74, 0x6F, 0x20, 0x66, 0x61, 0x69, 0x6C, 0x20, 0x77, 0x69, 0x74, 0x68, 0x69,
+    0x6E, 0x20, 0x68, 0x6F, 0x75, 0x72, 0x73, 0x2E, 0x20, 0x53, 0x69, 0x6E, 0x63, 0x65, 0x20, 0x74,
+    0x68, 0x65, 0x6E, 0x20, 0x69, 0x74, 0x20, 0x68, 0x61, 0x73, 0x20, 0x62, 0x65, 0x63, 0x6F, 0x6D,
+    0x65, 0x20, 0x61, 0x20, 0x64, 0x61, 0x69, 0x6C, 0x79, 0x20, 0x74, 0x6F, 0x6F, 0x6C, 0x3A, 0x20,
+    0x74, 0x68, 0x65, 0x20, 0x62, 0x61, 0x6B, 0x65, 0x72, 0x79, 0x20, 0x70, 0x6F, 0x73, 0x74, 0x73,
+    0x20, 0x69, 0x74, 0x73, 0x20, 0x6F, 0x70, 0x65, 0x6E, 0x69, 0x6E, 0x67, 0x20, 0x68, 0x6F, 0x75,
+    0x72, 0x73, 0x2C, 0x20, 0x74, 0x68, 0x65, 0x20, 0x66, 0x6F, 0x6F, 0x74, 0x62, 0x61, 0x6C, 0x6C,
+    0x20, 0x63, 0x6C, 0x75, 0x62, 0x20, 0x73, 0x68, 0x61, 0x72, 0x65, 0x73, 0x20, 0x6D, 0x61, 0x74,
+    0x63, 0x68, 0x20, 0x72, 0x65, 0x73, 0x75, 0x6C, 0x74, 0x73, 0x20, 0x61, 0x6E, 0x64, 0x20, 0x74,
+    0x68, 0x65, 0x20, 0x6C, 0x69, 0x62, 0x72, 0x61, 0x72, 0x79, 0x20, 0x61, 0x6E, 0x6E, 0x6F, 0x75,
+    0x6E, 0x63, 0x65, 0x73, 0x20, 0x6E, 0x65, 0x77, 0x20, 0x61, 0x72, 0x72, 0x69, 0x76, 0x61, 0x6C,
+    0x73, 0x2E, 0x00, 0x01, 0x60, 0x03, 0x42, 0x65, 0x63, 0x61, 0x75, 0x73, 0x65, 0x20, 0x65, 0x76,
+    0x65, 0x72, 0x79, 0x20, 0x6D, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x69, 0x73, 0x20, 0x74,
+    0x69, 0x6E, 0x79, 0x2C, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6E, 0x65, 0x74, 0x77, 0x6F, 0x72, 0x6B,
+    0x20, 0x63, 0x6F, 0x70, 0x65, 0x73, 0x20, 0x77, 0x65, 0x6C, 0x6C, 0x20, 0x77, 0x69, 0x74, 0x68,
+    0x20, 0x64, 0x6F, 0x7A, 0x65, 0x6E, 0x73, 0x20, 0x6F, 0x66, 0x20, 0x75, 0x73, 0x65, 0x72, 0x73,
+    0x2E, 0x20, 0x4F, 0x6C, 0x64, 0x20, 0x70, 0x68, 0x6F, 0x6E, 0x65, 0x73, 0x20, 0x77, 0x69, 0x74,
+    0x68, 0x20, 0x61, 0x20, 0x57, 0x41, 0x50, 0x20, 0x62, 0x72, 0x6F, 0x77, 0x73, 0x65, 0x72, 0x20,
+    0x63, 0x61, 0x6E, 0x20, 0x65, 0x76, 0x65, 0x6E, 0x20, 0x72, 0x65, 0x61, 0x64, 0x20, 0x73, 0x69,
+    0x6D, 0x70, 0x6C, 0x65, 0x20, 0x70, 0x61, 0x67, 0x65, 0x73, 0x20, 0x74, 0x68, 0x61, 0x74, 0x20,
+    0x61, 0x72, 0x65, 0x20, 0x63, 0x61, 0x72, 0x72, 0x69, 0x65, 0x64, 0x20, 0x61, 0x63, 0x72, 0x6F,
+    0x73, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6D, 0x65, 0x73, 0x68, 0x20, 0x61, 0x6E, 0x64, 0x20,
+    0x72, 0x65, 0x62, 0x75, 0x69, 0x6C, 0x74, 0x20, 0x62, 0x79, 0x20, 0x61, 0x20, 0x73, 0x6D, 0x61,
+    0x6C, 0x6C, 0x20, 0x67, 0x61, 0x74, 0x65, 0x77, 0x61, 0x79, 0x20, 0x61, 0x74, 0x20, 0x74, 0x68,
+    0x65, 0x20, 0x65, 0x64, 0x67, 0x65, 0x20, 0x6F, 0x66, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6E, 0x65,
+    0x74, 0x77, 0x6F, 0x72, 0x6B, 0x2E, 0x00, 0x01, 0x60, 0x03, 0x54, 0x68, 0x65, 0x20, 0x67, 0x72,
+    0x6F, 0x75, 0x70, 0x20, 0x6E, 0x6F, 0x77, 0x20, 0x70, 0x6C, 0x61, 0x6E, 0x73, 0x20, 0x74, 0x6F,
+    0x20, 0x61, 0x64, 0x64, 0x20, 0x61, 0x20, 0x66, 0x6F, 0x75, 0x72, 0x74, 0x68, 0x20, 0x76, 0x69,
+    0x6C, 0x6C, 0x61, 0x67, 0x65, 0x20, 0x62, 0x65, 0x66, 0x6F, 0x72, 0x65, 0x20, 0x74, 0x68, 0x65,
+    0x20, 0x73, 0x75, 0x6D, 0x6D, 0x65, 0x72, 0x20, 0x61, 0x6E, 0x64, 0x20, 0x69, 0x73, 0x20, 0x6C,
+    0x6F, 0x6F, 0x6B, 0x69, 0x6E, 0x67, 0x20, 0x66, 0x6F, 0x72, 0x20, 0x6D, 0x6F, 0x72, 0x65, 0x20,
+    0x72, 0x6F, 0x6F, 0x66, 0x20, 0x73, 0x70, 0x61, 0x63, 0x65, 0x20, 0x77, 0x69, 0x74, 0x68, 0x20,
+    0x61, 0x20, 0x67, 0x6F, 0x6F, 0x64, 0x20, 0x76, 0x69, 0x65, 0x77, 0x20, 0x6F, 0x66, 0x20, 0x74,
+    0x68, 0x65, 0x20, 0x76, 0x61, 0x6C, 0x6C, 0x65, 0x79, 0x2E, 0x00, 0x01, 0x60, 0xDC, 0x4B, 0x03,
+    0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62,
+    0x65, 0x2F, 0x6E, 0x65, 0x77, 0x73, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x42, 0x61, 0x63,
+    0x6B, 0x20, 0x74, 0x6F, 0x20, 0x6E, 0x65, 0x77, 0x73, 0x00, 0x01, 0x26, 0xDC, 0x4B, 0x03, 0x77,
+    0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65,
+    0x2F, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x48, 0x6F, 0x6D,
+    0x65, 0x00, 0x01, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t wap_corpus_weather[] = {
+    0x13, 0x04, 0x20, 0x16, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0x02, 0x01, 0xAA, 0x03, 0x04, 0x6A, 0x00, 0x7F, 0xE7,
+    0x55, 0x03, 0x77, 0x78, 0x00, 0x36, 0x03, 0x57, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x00, 0x01,
+    0x60, 0x64, 0x03, 0x57, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x20, 0x47, 0x68, 0x65, 0x6E, 0x74,
+    0x00, 0x01, 0x01, 0x60, 0x03, 0x54, 0x6F, 0x64, 0x61, 0x79, 0x3A, 0x20, 0x63, 0x6C, 0x6F, 0x75,
+    0x64, 0x79, 0x2C, 0x20, 0x31, 0x32, 0x43, 0x00, 0x26, 0x03, 0x57, 0x69, 0x6E, 0x64, 0x3A, 0x20,
+    0x53, 0x57, 0x20, 0x32, 0x30, 0x20, 0x6B, 0x6D, 0x2F, 0x68, 0x00, 0x26, 0x03, 0x52, 0x61, 0x69,
+    0x6E, 0x3A, 0x20, 0x34, 0x30, 0x25, 0x00, 0x01, 0x60, 0x03, 0x54, 0x6F, 0x6D, 0x6F, 0x72, 0x72,
+    0x6F, 0x77, 0x3A, 0x20, 0x73, 0x68, 0x6F, 0x77, 0x65, 0x72, 0x73, 0x2C, 0x20, 0x31, 0x30, 0x43,
+    0x00, 0x26, 0x03, 0x57, 0x69, 0x6E, 0x64, 0x3A, 0x20, 0x57, 0x20, 0x33, 0x30, 0x20, 0x6B, 0x6D,
+    0x2F, 0x68, 0x00, 0x26, 0x03, 0x52, 0x61, 0x69, 0x6E, 0x3A, 0x20, 0x38, 0x30, 0x25, 0x00, 0x01,
+    0x60, 0x03, 0x53, 0x75, 0x6E, 0x64, 0x61, 0x79, 0x3A, 0x20, 0x73, 0x75, 0x6E, 0x6E, 0x79, 0x2C,
+    0x20, 0x31, 0x34, 0x43, 0x00, 0x26, 0x03, 0x57, 0x69, 0x6E, 0x64, 0x3A, 0x20, 0x53, 0x20, 0x31,
+    0x30, 0x20, 0x6B, 0x6D, 0x2F, 0x68, 0x00, 0x26, 0x03, 0x52, 0x61, 0x69, 0x6E, 0x3A, 0x20, 0x31,
+    0x30, 0x25, 0x00, 0x01, 0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65,
+    0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x77, 0x65, 0x61, 0x74, 0x68, 0x65,
+    0x72, 0x2E, 0x77, 0x6D, 0x6C, 0x3F, 0x63, 0x69, 0x74, 0x79, 0x3D, 0x61, 0x6E, 0x74, 0x77, 0x65,
+    0x72, 0x70, 0x00, 0x01, 0x03, 0x41, 0x6E, 0x74, 0x77, 0x65, 0x72, 0x70, 0x00, 0x01, 0x03, 0x20,
+    0x7C, 0x20, 0x00, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67,
+    0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x77, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x2E,
+    0x77, 0x6D, 0x6C, 0x3F, 0x63, 0x69, 0x74, 0x79, 0x3D, 0x62, 0x72, 0x75, 0x73, 0x73, 0x65, 0x6C,
+    0x73, 0x00, 0x01, 0x03, 0x42, 0x72, 0x75, 0x73, 0x73, 0x65, 0x6C, 0x73, 0x00, 0x01, 0x03, 0x20,
+    0x7C, 0x20, 0x00, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67,
+    0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x77, 0x65, 0x61, 0x74, 0x68, 0x65, 0x72, 0x2E,
+    0x77, 0x6D, 0x6C, 0x3F, 0x63, 0x69, 0x74, 0x79, 0x3D, 0x6C, 0x69, 0x65, 0x67, 0x65, 0x00, 0x01,
+    0x03, 0x4C, 0x69, 0x65, 0x67, 0x65, 0x00, 0x01, 0x01, 0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70,
+    0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x69,
+    0x6E, 0x64, 0x65, 0x78, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x48, 0x6F, 0x6D, 0x65, 0x00,
+    0x01, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t wap_corpus_search[] = {
+    0x14, 0x04, 0x20, 0x16, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0x02, 0x01, 0x11, 0x03, 0x04, 0x6A, 0x06, 0x71, 0x00,
+    0x63, 0x61, 0x74, 0x00, 0x7F, 0xE7, 0x55, 0x03, 0x73, 0x65, 0x61, 0x72, 0x63, 0x68, 0x00, 0x36,
+    0x03, 0x53, 0x65, 0x61, 0x72, 0x63, 0x68, 0x00, 0x01, 0x60, 0x03, 0x53, 0x65, 0x61, 0x72, 0x63,
+    0x68, 0x20, 0x74, 0x68, 0x65, 0x20, 0x57, 0x41, 0x50, 0x20, 0x64, 0x69, 0x72, 0x65, 0x63, 0x74,
+    0x6F, 0x72, 0x79, 0x3A, 0x00, 0x26, 0xAF, 0x21, 0x03, 0x71, 0x00, 0x48, 0x31, 0x03, 0x31, 0x32,
+    0x00, 0x1A, 0x03, 0x36, 0x34, 0x00, 0x01, 0x26, 0x03, 0x43, 0x61, 0x74, 0x65, 0x67, 0x6F, 0x72,
+    0x79, 0x3A, 0x20, 0x00, 0xF7, 0x21, 0x03, 0x63, 0x61, 0x74, 0x00, 0x01, 0xF5, 0x4D, 0x03, 0x61,
+    0x6C, 0x6C, 0x00, 0x01, 0x03, 0x41, 0x6C, 0x6C, 0x00, 0x01, 0xF5, 0x4D, 0x03, 0x6E, 0x65, 0x77,
+    0x73, 0x00, 0x01, 0x03, 0x4E, 0x65, 0x77, 0x73, 0x00, 0x01, 0xF5, 0x4D, 0x03, 0x67, 0x61, 0x6D,
+    0x65, 0x73, 0x00, 0x01, 0x03, 0x47, 0x61, 0x6D, 0x65, 0x73, 0x00, 0x01, 0xF5, 0x4D, 0x03, 0x74,
+    0x6F, 0x6F, 0x6C, 0x73, 0x00, 0x01, 0x03, 0x54, 0x6F, 0x6F, 0x6C, 0x73, 0x00, 0x01, 0x01, 0x01,
+    0xE8, 0x38, 0x18, 0x03, 0x47, 0x6F, 0x00, 0x01, 0xEB, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62,
+    0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x73, 0x65, 0x61,
+    0x72, 0x63, 0x68, 0x2E, 0x77, 0x6D, 0x6C, 0x00, 0x1B, 0x01, 0xA1, 0x21, 0x03, 0x71, 0x00, 0x4D,
+    0x80, 0x00, 0x01, 0xA1, 0x21, 0x03, 0x63, 0x61, 0x74, 0x00, 0x4D, 0x80, 0x02, 0x01, 0x01, 0x01,
+    0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65, 0x6C, 0x67, 0x61, 0x63,
+    0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E, 0x77, 0x6D, 0x6C, 0x00,
+    0x01, 0x03, 0x48, 0x6F, 0x6D, 0x65, 0x00, 0x01, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t wap_corpus_notfound[] = {
+    0x15, 0x04, 0x20, 0x14, 0x03, 0x94, 0x81, 0xEA, 0xA6, 0x4B, 0x61, 0x6E, 0x6E, 0x65, 0x6C, 0x2F,
+    0x31, 0x2E, 0x34, 0x2E, 0x35, 0x00, 0x8D, 0xD7, 0x03, 0x04, 0x6A, 0x00, 0x7F, 0xE7, 0x55, 0x03,
+    0x65, 0x72, 0x72, 0x00, 0x36, 0x03, 0x4E, 0x6F, 0x74, 0x20, 0x66, 0x6F, 0x75, 0x6E, 0x64, 0x00,
+    0x01, 0x60, 0x03, 0x50, 0x61, 0x67, 0x65, 0x20, 0x6E, 0x6F, 0x74, 0x20, 0x66, 0x6F, 0x75, 0x6E,
+    0x64, 0x2E, 0x00, 0x01, 0x60, 0xDC, 0x4B, 0x03, 0x77, 0x61, 0x70, 0x2E, 0x62, 0x65, 0x76, 0x65,
+    0x6C, 0x67, 0x61, 0x63, 0x6F, 0x6D, 0x2E, 0x62, 0x65, 0x2F, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E,
+    0x77, 0x6D, 0x6C, 0x00, 0x01, 0x03, 0x48, 0x6F, 0x6D, 0x65, 0x00, 0x01, 0x01, 0x01, 0x01,
+};
+
+static const WapCorpusPage wap_corpus[] = {
+    { "portal", "http://wap.bevelgacom.be/",
+      "<wml><card id=\"home\" title=\"Bevelgacom\"><p align=\"center\"><b>Bevelgacom WAP</b><br/>Welcome to the mobile portal</p><p><a href=\"http://wap.bevelgacom.be/news.wml\">News</a><br/><a href=\"http://wap.bevelgacom.be/weather.wml\">Weather</a><br/><a href=\"http://wap.bevelgacom.be/search.wml\">Search</a><br/><a href=\"http://wap.bevelgacom.be/games.wml\">Games</a><br/><a href=\"http://wap.bevelgacom.be/about.wml\">About</a></p></card></wml>",
+      wap_corpus_portal, sizeof(wap_corpus_portal) },
+    { "news", "http://wap.bevelgacom.be/news.wml",
+      "<wml><card id=\"news\" title=\"News\"><p><b>Headlines</b></p><p><a href=\"http://wap.bevelgacom.be/news/1.wml\">Mesh network links three villages</a><br/><a href=\"http://wap.bevelgacom.be/news/2.wml\">LoRa gateway count passes ten thousand</a><br/><a href=\"http://wap.bevelgacom.be/news/3.wml\">Retro phones find a second life</a><br/><a href=\"http://wap.bevelgacom.be/news/4.wml\">Local radio club hosts antenna workshop</a><br/><a href=\"http://wap.bevelgacom.be/news/5.wml\">Solar repeater survives the winter</a><br/><a href=\"http://wap.bevelgacom.be/news/6.wml\">Volunteers map coverage along the coast</a></p><p><a href=\"http://wap.bevelgacom.be/index.wml\">Home</a></p></card></wml>",
+      wap_corpus_news, sizeof(wap_corpus_news) },
+    { "article", "http://wap.bevelgacom.be/news/1.wml",
+      "<wml><card id=\"a1\" title=\"Mesh links villages\"><p><b>Mesh network links three villages</b></p><p>Residents of three neighbouring villages can now exchange messages without any mobile coverage. A handful of volunteers installed solar powered repeaters on a church tower, a water tower and a farm silo. The repeaters relay small text packets over long range radio, and each hop can cover several kilometres on a clear day.</p><p>The organisers say the network was first built as a backup for storms and power cuts, when the local mobile masts tend to fail within hours. Since then it has become a daily tool: the bakery posts its opening hours, the football club shares match results and the library announces new arrivals.</p><p>Because every message is tiny, the network copes well with dozens of users. Old phones with a WAP browser can even read simple pages that are carried across the mesh and rebuilt by a small gateway at the edge of the network.</p><p>The group now plans to add a fourth village before the summer and is looking for more roof space with a good view of the valley.</p><p><a href=\"http://wap.bevelgacom.be/news.wml\">Back to news</a><br/><a href=\"http://wap.bevelgacom.be/index.wml\">Home</a></p></card></wml>",
+      wap_corpus_article, sizeof(wap_corpus_article) },
+    { "weather", "http://wap.bevelgacom.be/weather.wml",
+      "<wml><card id=\"wx\" title=\"Weather\"><p><b>Weather Ghent</b></p><p>Today: cloudy, 12C<br/>Wind: SW 20 km/h<br/>Rain: 40%</p><p>Tomorrow: showers, 10C<br/>Wind: W 30 km/h<br/>Rain: 80%</p><p>Sunday: sunny, 14C<br/>Wind: S 10 km/h<br/>Rain: 10%</p><p><a href=\"http://wap.bevelgacom.be/weather.wml?city=antwerp\">Antwerp</a> | <a href=\"http://wap.bevelgacom.be/weather.wml?city=brussels\">Brussels</a> | <a href=\"http://wap.bevelgacom.be/weather.wml?city=liege\">Liege</a></p><p><a href=\"http://wap.bevelgacom.be/index.wml\">Home</a></p></card></wml>",
+      wap_corpus_weather, sizeof(wap_corpus_weather) },
+    { "search", "http://wap.bevelgacom.be/search.wml",
+      "<wml><card id=\"search\" title=\"Search\"><p>Search the WAP directory:<br/><input name=\"q\" type=\"text\" size=\"12\" maxlength=\"64\"/><br/>Category: <select name=\"cat\"><option value=\"all\">All</option><option value=\"news\">News</option><option value=\"games\">Games</option><option value=\"tools\">Tools</option></select></p><do type=\"accept\" label=\"Go\"><go href=\"http://wap.bevelgacom.be/search.wml\" method=\"get\"><postfield name=\"q\" value=\"$(q)\"/><postfield name=\"cat\" value=\"$(cat)\"/></go></do><p><a href=\"http://wap.bevelgacom.be/index.wml\">Home</a></p></card></wml>",
+      wap_corpus_search, sizeof(wap_corpus_search) },
+    { "notfound", "http://wap.bevelgacom.be/missing.wml",
+      "<wml><card id=\"err\" title=\"Not found\"><p>Page not found.</p><p><a href=\"http://wap.bevelgacom.be/index.wml\">Home</a></p></card></wml>",
+      wap_corpus_notfound, sizeof(wap_corpus_notfound) },
+};
+
+static const size_t wap_corpus_count = sizeof(wap_corpus) / sizeof(wap_corpus[0]);
+
+#endif // WAP_CORPUS_H